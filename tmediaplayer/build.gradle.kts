@@ -19,6 +19,7 @@ android {
 
         buildConfigField("String", "VERSION", "\"${properties["VERSION_NAME"].toString()}\"")
 
+        testInstrumentationRunner = "androidx.test.runner.AndroidJUnitRunner"
         consumerProguardFiles("consumer-rules.pro")
         ndk {
             abiFilters.addAll(listOf("arm64-v8a", "armeabi-v7a", "x86", "x86_64"))
@@ -58,6 +59,8 @@ android {
 
 dependencies {
     implementation(libs.androidx.annotaion)
+    androidTestImplementation(libs.androidx.junit)
+    androidTestImplementation(libs.androidx.test.runner)
 }
 
 publishing {
@@ -0,0 +1,102 @@
+package com.tans.tmediaplayer.player
+
+import android.os.SystemClock
+import android.util.Log
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import com.tans.tmediaplayer.player.model.OptResult
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertTrue
+import org.junit.Test
+import org.junit.runner.RunWith
+import java.io.File
+import java.util.concurrent.CyclicBarrier
+import java.util.concurrent.Executors
+import java.util.concurrent.TimeUnit
+
+/**
+ * Players prepare and decode at the same time, hardware and software video decoders mixed.
+ * Decoder state (e.g. hw pixel format) is per player, no player fails or stalls because of the others.
+ */
+@RunWith(AndroidJUnit4::class)
+class ConcurrentPlayersStressTest {
+
+    @Test
+    fun concurrentPlayersPlayToEnd() {
+        val media = TestMedia.createMp4("stress_test.mp4", MEDIA_DURATION)
+        val single = playConcurrently(media, 1)
+        val concurrent = playConcurrently(media, PLAYER_COUNT)
+        Log.d(TAG, "Play to end: 1 player ${single}ms, $PLAYER_COUNT players ${concurrent}ms")
+        // Players don't serialize on shared state, N players finish about as fast as one.
+        assertTrue("1 player ${single}ms, $PLAYER_COUNT players ${concurrent}ms", concurrent <= single * 3 / 2)
+    }
+
+    @Test
+    fun repeatedConcurrentPrepareAndRelease() {
+        val media = TestMedia.createMp4("stress_test.mp4", MEDIA_DURATION)
+        repeat(ROUNDS) { round ->
+            runConcurrently(PLAYER_COUNT) { index, player ->
+                assertEquals(OptResult.Success, player.prepare(media.absolutePath))
+                assertEquals(OptResult.Success, player.play())
+                SystemClock.sleep(SHORT_PLAY_TIME + index * 50L)
+                val rendered = player.getStats()!!.syncError.sampleCount
+                assertTrue("Round $round, player $index rendered no frame", rendered > 0L)
+                assertTrue(player.getState() is tMediaPlayerState.Playing)
+            }
+        }
+    }
+
+    /**
+     * Return wall time of the slowest player playing to end.
+     */
+    private fun playConcurrently(media: File, count: Int): Long {
+        val times = runConcurrently(count) { index, player ->
+            assertEquals(OptResult.Success, player.prepare(media.absolutePath))
+            player.setPlaySpeed(PLAY_SPEED)
+            val start = SystemClock.uptimeMillis()
+            assertEquals(OptResult.Success, player.play())
+            assertTrue("Player $index not play end: ${player.getState()}", player.awaitPlayEnd(PLAY_END_TIMEOUT))
+            val time = SystemClock.uptimeMillis() - start
+
+            // Every frame is rendered, or dropped because it is late.
+            val rendered = player.getStats()!!.syncError.sampleCount
+            val late = player.getLateFrameStats()!!
+            val dropped = late.droppedBeforeConvert + late.skippedNonRef + late.skippedBidir
+            val expected = TestMedia.videoFrameCount(MEDIA_DURATION)
+            Log.d(TAG, "Player $index: ${time}ms, rendered=$rendered, dropped=$dropped, expected=$expected")
+            assertTrue("Player $index rendered $rendered, dropped $dropped of $expected", rendered + dropped >= expected / 2)
+            time
+        }
+        return times.max()
+    }
+
+    /**
+     * Even players use hardware video decoder, odd players software decoder. Players start together.
+     */
+    private fun <T> runConcurrently(count: Int, block: (Int, tMediaPlayer) -> T): List<T> {
+        val players = List(count) { tMediaPlayer(enableVideoHardwareDecoder = it % 2 == 0) }
+        val barrier = CyclicBarrier(count)
+        val executor = Executors.newFixedThreadPool(count)
+        try {
+            val futures = players.mapIndexed { index, player ->
+                executor.submit<T> {
+                    barrier.await()
+                    block(index, player)
+                }
+            }
+            return futures.map { it.get(PLAY_END_TIMEOUT * 2, TimeUnit.MILLISECONDS) }
+        } finally {
+            players.forEach { it.release() }
+            executor.shutdown()
+        }
+    }
+
+    companion object {
+        private const val TAG = "ConcurrentPlayersStressTest"
+        private const val PLAYER_COUNT = 4
+        private const val ROUNDS = 5
+        private const val MEDIA_DURATION = 4000L
+        private const val PLAY_SPEED = 2.0f
+        private const val SHORT_PLAY_TIME = 500L
+        private const val PLAY_END_TIMEOUT = 15_000L
+    }
+}
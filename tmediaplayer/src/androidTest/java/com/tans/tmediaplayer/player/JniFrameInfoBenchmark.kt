@@ -0,0 +1,84 @@
+package com.tans.tmediaplayer.player
+
+import android.os.SystemClock
+import android.util.Log
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import com.tans.tmediaplayer.player.model.PACKET_INFO_EXPORT_SIZE
+import com.tans.tmediaplayer.player.model.VIDEO_FRAME_INFO_EXPORT_SIZE
+import org.junit.After
+import org.junit.Assert.assertTrue
+import org.junit.Before
+import org.junit.Test
+import org.junit.runner.RunWith
+
+/**
+ * Nanos per frame of fetching frame / packet info from native buffers: one batched jni call against the scalar getters
+ * it replaced. Scalar getters are removed, their cost is measured by the remaining scalar getter called once per field.
+ * The remaining getter is @FastNative and the removed ones were not, so the measured gain is a lower bound.
+ */
+@RunWith(AndroidJUnit4::class)
+class JniFrameInfoBenchmark {
+
+    private lateinit var player: tMediaPlayer
+    private var videoBuffer: Long = 0L
+    private var packet: Long = 0L
+
+    @Before
+    fun setUp() {
+        player = tMediaPlayer()
+        videoBuffer = player.allocVideoBufferInternal()
+        packet = player.allocPacketInternal()
+    }
+
+    @After
+    fun tearDown() {
+        player.releaseVideoBufferInternal(videoBuffer)
+        player.releasePacketInternal(packet)
+        player.release()
+    }
+
+    @Test
+    fun videoFrameInfo() {
+        val info = LongArray(VIDEO_FRAME_INFO_EXPORT_SIZE)
+        val batched = nanosPerFrame { player.getVideoFrameInfoInternal(videoBuffer, info) }
+        val scalar = nanosPerFrame {
+            // Old path: pts, duration, type, width, height, rotation, ratio and a plane size.
+            repeat(VIDEO_FRAME_SCALAR_CALLS) { player.getPacketStreamIndexInternal(packet) }
+        }
+        Log.d(TAG, "Video frame info: batched=${batched}ns, scalar=${scalar}ns per frame")
+        assertTrue("batched ${batched}ns, scalar ${scalar}ns", batched * 2 < scalar)
+    }
+
+    @Test
+    fun packetInfo() {
+        val info = LongArray(PACKET_INFO_EXPORT_SIZE)
+        val batched = nanosPerFrame { player.getPacketInfoInternal(packet, info) }
+        val scalar = nanosPerFrame {
+            // Old path: stream index, size, duration and pts.
+            repeat(PACKET_SCALAR_CALLS) { player.getPacketStreamIndexInternal(packet) }
+        }
+        Log.d(TAG, "Packet info: batched=${batched}ns, scalar=${scalar}ns per packet")
+        assertTrue("batched ${batched}ns, scalar ${scalar}ns", batched < scalar)
+    }
+
+    /**
+     * Best of [ROUNDS] rounds, jit warmed up by the first rounds.
+     */
+    private inline fun nanosPerFrame(frame: () -> Unit): Long {
+        var best = Long.MAX_VALUE
+        repeat(ROUNDS) {
+            val start = SystemClock.elapsedRealtimeNanos()
+            repeat(FRAMES_PER_ROUND) { frame() }
+            best = minOf(best, (SystemClock.elapsedRealtimeNanos() - start) / FRAMES_PER_ROUND)
+        }
+        return best
+    }
+
+    companion object {
+        private const val TAG = "JniFrameInfoBenchmark"
+        private const val ROUNDS = 10
+        private const val FRAMES_PER_ROUND = 100_000
+        private const val VIDEO_FRAME_SCALAR_CALLS = 8
+        private const val PACKET_SCALAR_CALLS = 4
+    }
+}
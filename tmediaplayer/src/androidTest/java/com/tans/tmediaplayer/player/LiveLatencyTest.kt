@@ -0,0 +1,150 @@
+package com.tans.tmediaplayer.player
+
+import android.os.SystemClock
+import android.util.Log
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import com.tans.tmediaplayer.player.model.LIVE_CATCH_UP_HYSTERESIS
+import com.tans.tmediaplayer.player.model.OptResult
+import org.junit.After
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertNotNull
+import org.junit.Assert.assertTrue
+import org.junit.Before
+import org.junit.Test
+import org.junit.runner.RunWith
+import java.io.File
+import java.util.concurrent.Executors
+import java.util.concurrent.TimeUnit
+
+/**
+ * Glass to glass latency of live low latency mode, against a local rtp sender.
+ * Latency is wall time now minus capture time of the frame at player's progress, encoding and sending included.
+ */
+@RunWith(AndroidJUnit4::class)
+class LiveLatencyTest {
+
+    private val executor = Executors.newSingleThreadExecutor()
+
+    private lateinit var sender: RtpH264Sender
+
+    private lateinit var player: tMediaPlayer
+
+    @Before
+    fun setUp() {
+        sender = RtpH264Sender(RtpH264Sender.findFreeRtpPort())
+        sender.start()
+        // Software decoder, frames are not rendered to a surface.
+        player = tMediaPlayer(enableVideoHardwareDecoder = false)
+    }
+
+    @After
+    fun tearDown() {
+        player.release()
+        sender.stop()
+        executor.shutdown()
+    }
+
+    @Test
+    fun latencyStaysUnderTarget() {
+        player.setLiveTargetLatency(TARGET_LATENCY)
+        startLive()
+        SystemClock.sleep(WARM_UP_TIME)
+
+        val measured = ArrayList<Long>()
+        val reported = ArrayList<Long>()
+        val end = SystemClock.uptimeMillis() + MEASURE_TIME
+        while (SystemClock.uptimeMillis() < end) {
+            val latency = measureLatency()
+            val reportedLatency = player.getLiveLatency()
+            assertNotNull(reportedLatency)
+            if (latency != null) {
+                measured.add(latency)
+                reported.add(reportedLatency!!)
+            }
+            SystemClock.sleep(SAMPLE_INTERVAL)
+        }
+        val p50 = percentile(measured, 0.5)
+        val p90 = percentile(measured, 0.9)
+        val reportedP50 = percentile(reported, 0.5)
+        Log.d(TAG, "Glass to glass latency: p50=${p50}ms, p90=${p90}ms, reported p50=${reportedP50}ms, samples=${measured.size}")
+
+        assertTrue(measured.size > 10)
+        assertTrue("p50 latency ${p50}ms", p50 <= TARGET_LATENCY + LIVE_CATCH_UP_HYSTERESIS)
+        assertTrue("p90 latency ${p90}ms", p90 <= TARGET_LATENCY + LIVE_CATCH_UP_HYSTERESIS * 2)
+        // Reported latency is by rtcp wall clock, or buffered latency without it, never more than glass to glass.
+        assertTrue("reported ${reportedP50}ms, measured ${p50}ms", reportedP50 <= p50 + LATENCY_TOLERANCE)
+    }
+
+    @Test
+    fun catchesUpAfterNetworkStall() {
+        player.setLiveTargetLatency(TARGET_LATENCY)
+        startLive()
+        SystemClock.sleep(WARM_UP_TIME)
+        val before = percentile(sampleLatency(1000L), 0.5)
+
+        // Packets delayed by the stall arrive at once, the player is STALL_TIME behind live edge.
+        sender.stall(STALL_TIME)
+        SystemClock.sleep(STALL_TIME)
+
+        val deadline = SystemClock.uptimeMillis() + CATCH_UP_TIMEOUT
+        var after: Long
+        do {
+            after = percentile(sampleLatency(1000L), 0.5)
+            Log.d(TAG, "Latency after stall: ${after}ms, before: ${before}ms")
+        } while (after > TARGET_LATENCY + LIVE_CATCH_UP_HYSTERESIS && SystemClock.uptimeMillis() < deadline)
+
+        assertTrue("Latency after stall ${after}ms, before ${before}ms", after <= TARGET_LATENCY + LIVE_CATCH_UP_HYSTERESIS)
+        assertTrue(player.getState() is tMediaPlayerState.Playing)
+    }
+
+    private fun startLive() {
+        val sdp = sender.writeSdp(File(testCacheDir(), "live_test.sdp"))
+        // Prepare blocks until the stream is probed, start sending after player has opened rtp sockets,
+        // so player's first frame is sender's first frame.
+        val prepareResult = executor.submit<OptResult> { player.prepare(sdp.absolutePath) }
+        SystemClock.sleep(SOCKET_OPEN_TIME)
+        sender.startSending()
+        assertEquals(OptResult.Success, prepareResult.get(10L, TimeUnit.SECONDS))
+        assertTrue(player.getMediaInfo()!!.isRealTime)
+        assertEquals(OptResult.Success, player.play())
+    }
+
+    private fun measureLatency(): Long? {
+        val progress = player.getProgress()
+        val captureStart = sender.firstFrameWallTime
+        if (progress < 0L || captureStart < 0L) {
+            return null
+        }
+        return System.currentTimeMillis() - (captureStart + progress)
+    }
+
+    private fun sampleLatency(durationInMillis: Long): List<Long> {
+        val result = ArrayList<Long>()
+        val end = SystemClock.uptimeMillis() + durationInMillis
+        while (SystemClock.uptimeMillis() < end) {
+            measureLatency()?.let { result.add(it) }
+            SystemClock.sleep(SAMPLE_INTERVAL)
+        }
+        return result
+    }
+
+    private fun percentile(values: List<Long>, p: Double): Long {
+        if (values.isEmpty()) {
+            return Long.MAX_VALUE
+        }
+        val sorted = values.sorted()
+        return sorted[((sorted.size - 1) * p).toInt()]
+    }
+
+    companion object {
+        private const val TAG = "LiveLatencyTest"
+        private const val TARGET_LATENCY = 300L
+        private const val SOCKET_OPEN_TIME = 300L
+        private const val WARM_UP_TIME = 2000L
+        private const val MEASURE_TIME = 4000L
+        private const val SAMPLE_INTERVAL = 50L
+        private const val LATENCY_TOLERANCE = 100L
+        private const val STALL_TIME = 800L
+        private const val CATCH_UP_TIMEOUT = 12_000L
+    }
+}
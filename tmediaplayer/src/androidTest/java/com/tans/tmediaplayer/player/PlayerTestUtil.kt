@@ -0,0 +1,28 @@
+package com.tans.tmediaplayer.player
+
+import android.os.SystemClock
+import androidx.test.platform.app.InstrumentationRegistry
+import java.io.File
+
+internal fun testCacheDir(): File = InstrumentationRegistry.getInstrumentation().targetContext.cacheDir
+
+/**
+ * Poll player's state until [predicate] matches, return the matched state or null if timeout.
+ */
+internal fun tMediaPlayer.awaitState(timeoutInMillis: Long, predicate: (tMediaPlayerState) -> Boolean): tMediaPlayerState? {
+    val deadline = SystemClock.uptimeMillis() + timeoutInMillis
+    while (true) {
+        val state = getState()
+        if (predicate(state)) {
+            return state
+        }
+        if (SystemClock.uptimeMillis() >= deadline) {
+            return null
+        }
+        SystemClock.sleep(10L)
+    }
+}
+
+internal fun tMediaPlayer.awaitPlayEnd(timeoutInMillis: Long): Boolean {
+    return awaitState(timeoutInMillis) { it is tMediaPlayerState.PlayEnd || it is tMediaPlayerState.Error } is tMediaPlayerState.PlayEnd
+}
@@ -0,0 +1,113 @@
+package com.tans.tmediaplayer.player
+
+import android.os.SystemClock
+import android.util.Log
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import com.tans.tmediaplayer.player.model.LooperPriority
+import com.tans.tmediaplayer.player.model.OptResult
+import org.junit.After
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertTrue
+import org.junit.Before
+import org.junit.Test
+import org.junit.runner.RunWith
+
+/**
+ * Renderers are woken by audio track and gl completion instead of polling: shared looper wakeups per decoded frame
+ * while playing, almost none while paused. A/V sync error of rendered video frames stays around a frame duration.
+ */
+@RunWith(AndroidJUnit4::class)
+class RendererWakeupTest {
+
+    private lateinit var player: tMediaPlayer
+
+    @Before
+    fun setUp() {
+        val media = TestMedia.createMp4("wakeup_test.mp4", MEDIA_DURATION)
+        player = tMediaPlayer()
+        assertEquals(OptResult.Success, player.prepare(media.absolutePath))
+    }
+
+    @After
+    fun tearDown() {
+        player.release()
+    }
+
+    @Test
+    fun wakeupsPerFrameWhilePlaying() {
+        assertEquals(OptResult.Success, player.play())
+        SystemClock.sleep(WARM_UP_TIME)
+
+        val audioTasks = handledTasks(LooperPriority.Audio)
+        val videoTasks = handledTasks(LooperPriority.Video)
+        val decodeStats = player.getDecodeStats()!!
+        SystemClock.sleep(MEASURE_TIME)
+        val audioWakeups = handledTasks(LooperPriority.Audio) - audioTasks
+        val videoWakeups = handledTasks(LooperPriority.Video) - videoTasks
+        val newDecodeStats = player.getDecodeStats()!!
+        val audioFrames = newDecodeStats.audioFrames - decodeStats.audioFrames
+        val videoFrames = newDecodeStats.videoFrames - decodeStats.videoFrames
+
+        val seconds = MEASURE_TIME / 1000.0
+        Log.d(TAG, "Audio: ${audioWakeups / seconds} wakeups/s, ${audioFrames / seconds} frames/s; " +
+                "video: ${videoWakeups / seconds} wakeups/s, ${videoFrames / seconds} frames/s")
+        assertTrue(audioFrames > 0L && videoFrames > 0L)
+        // Decode, render and rendered callback per frame. Retrying a full audio track every 6ms
+        // added about 3.5 wakeups per 1024 samples frame at 48kHz.
+        assertTrue("Audio wakeups per frame: ${audioWakeups.toDouble() / audioFrames}", audioWakeups <= audioFrames * MAX_AUDIO_WAKEUPS_PER_FRAME)
+        assertTrue("Video wakeups per frame: ${videoWakeups.toDouble() / videoFrames}", videoWakeups <= videoFrames * MAX_VIDEO_WAKEUPS_PER_FRAME)
+    }
+
+    @Test
+    fun noWakeupsWhilePaused() {
+        assertEquals(OptResult.Success, player.play())
+        SystemClock.sleep(WARM_UP_TIME)
+        assertEquals(OptResult.Success, player.pause())
+        SystemClock.sleep(PAUSE_SETTLE_TIME)
+
+        val tasks = handledTasks(null)
+        SystemClock.sleep(MEASURE_TIME)
+        val wakeupsPerSecond = (handledTasks(null) - tasks) * 1000L / MEASURE_TIME
+        Log.d(TAG, "Paused: $wakeupsPerSecond wakeups/s")
+        assertTrue("Paused wakeups per second: $wakeupsPerSecond", wakeupsPerSecond <= MAX_PAUSED_WAKEUPS_PER_SECOND)
+    }
+
+    @Test
+    fun avSyncJitter() {
+        assertEquals(OptResult.Success, player.play())
+        SystemClock.sleep(WARM_UP_TIME)
+        player.resetStats()
+        SystemClock.sleep(MEASURE_TIME)
+
+        val syncError = player.getStats()!!.syncError
+        Log.d(TAG, "Sync error: samples=${syncError.sampleCount}, mean=${syncError.mean}ms, " +
+                "p50<${syncError.percentile(0.5)}ms, p90<${syncError.percentile(0.9)}ms, max=${syncError.maxValue}ms")
+        // Most video frames are rendered.
+        assertTrue(syncError.sampleCount >= TestMedia.videoFrameCount(MEASURE_TIME) * 3 / 4)
+        // Frame duration is 33ms, percentile is the upper bound of its log2 bucket.
+        assertTrue("Sync error mean: ${syncError.mean}ms", syncError.mean <= MAX_SYNC_ERROR_MEAN)
+        assertTrue("Sync error p90: ${syncError.percentile(0.9)}ms", syncError.percentile(0.9) <= MAX_SYNC_ERROR_P90)
+    }
+
+    /**
+     * Tasks handled by shared looper threads of [priority], all threads if null.
+     */
+    private fun handledTasks(priority: LooperPriority?): Long {
+        return tMediaPlayer.getSharedLooperStats()
+            .filter { priority == null || it.priority == priority }
+            .sumOf { it.handledTasks }
+    }
+
+    companion object {
+        private const val TAG = "RendererWakeupTest"
+        private const val MEDIA_DURATION = 15_000L
+        private const val WARM_UP_TIME = 1000L
+        private const val MEASURE_TIME = 4000L
+        private const val PAUSE_SETTLE_TIME = 500L
+        private const val MAX_AUDIO_WAKEUPS_PER_FRAME = 5
+        private const val MAX_VIDEO_WAKEUPS_PER_FRAME = 6
+        private const val MAX_PAUSED_WAKEUPS_PER_SECOND = 5L
+        private const val MAX_SYNC_ERROR_MEAN = 35.0
+        private const val MAX_SYNC_ERROR_P90 = 64L
+    }
+}
@@ -0,0 +1,289 @@
+package com.tans.tmediaplayer.player
+
+import android.media.MediaCodec
+import android.os.SystemClock
+import android.util.Base64
+import java.io.File
+import java.net.DatagramPacket
+import java.net.DatagramSocket
+import java.net.InetAddress
+import java.nio.ByteBuffer
+import java.util.concurrent.CountDownLatch
+import java.util.concurrent.TimeUnit
+
+/**
+ * Live H.264 source for tests: encodes generated frames in real time and sends them to localhost as rtp
+ * (RFC 6184, single nal unit and FU-A packets), rtcp sender reports map rtp time to wall clock.
+ * Player plays the sdp file written by [writeSdp].
+ *
+ * Frames are encoded from [start], but sent only after [startSending], beginning at the next key frame. The first
+ * frame sent is the first frame player receives: its pts is 0 in player and its capture time is [firstFrameWallTime].
+ */
+internal class RtpH264Sender(private val rtpPort: Int) {
+
+    private val encoder: TestVideoEncoder = TestVideoEncoder()
+
+    private val socket: DatagramSocket = DatagramSocket()
+
+    private val address: InetAddress = InetAddress.getLoopbackAddress()
+
+    private val thread: Thread = Thread({ run() }, "RtpH264Sender")
+
+    private val parameterSetsReady: CountDownLatch = CountDownLatch(1)
+
+    @Volatile
+    private var sps: ByteArray? = null
+
+    @Volatile
+    private var pps: ByteArray? = null
+
+    @Volatile
+    private var isRunning: Boolean = true
+
+    @Volatile
+    private var isSending: Boolean = false
+
+    // Packets are held until this uptime, then sent at once: a network stall.
+    @Volatile
+    private var stallEndTime: Long = 0L
+
+    // Sender thread only.
+    private val heldPackets: ArrayList<ByteArray> = ArrayList()
+    private var isKeyFrameRequested: Boolean = false
+    private var wallStartTime: Long = 0L
+    private var firstFramePts: Long = -1L
+    private var sequence: Int = 0
+    private var packetCount: Long = 0L
+    private var octetCount: Long = 0L
+    private var lastReportTime: Long = 0L
+
+    /**
+     * Wall clock millis of the first sent frame captured, -1 before sending.
+     */
+    @Volatile
+    var firstFrameWallTime: Long = -1L
+        private set
+
+    fun start() {
+        thread.start()
+    }
+
+    /**
+     * Sdp of the stream, sps / pps are in sprop-parameter-sets so the player can probe the stream quickly.
+     */
+    fun writeSdp(file: File): File {
+        check(parameterSetsReady.await(5L, TimeUnit.SECONDS)) { "Encoder has no sps / pps." }
+        val sprop = "${Base64.encodeToString(sps, Base64.NO_WRAP)},${Base64.encodeToString(pps, Base64.NO_WRAP)}"
+        file.writeText(
+            listOf(
+                "v=0",
+                "o=- 0 0 IN IP4 127.0.0.1",
+                "s=tMediaPlayer live test",
+                "c=IN IP4 127.0.0.1",
+                "t=0 0",
+                "m=video $rtpPort RTP/AVP $PAYLOAD_TYPE",
+                "a=rtpmap:$PAYLOAD_TYPE H264/90000",
+                "a=fmtp:$PAYLOAD_TYPE packetization-mode=1;sprop-parameter-sets=$sprop",
+                ""
+            ).joinToString("\n")
+        )
+        return file
+    }
+
+    fun startSending() {
+        isSending = true
+    }
+
+    /**
+     * Hold packets for [millis], then send them at once.
+     */
+    fun stall(millis: Long) {
+        stallEndTime = SystemClock.uptimeMillis() + millis
+    }
+
+    fun stop() {
+        isRunning = false
+        thread.join(2000L)
+    }
+
+    private fun run() {
+        val frameDurationInMicros = encoder.frameDurationInMicros()
+        val startNanos = System.nanoTime()
+        wallStartTime = System.currentTimeMillis()
+        var index = 0
+        try {
+            while (isRunning) {
+                val sleepNanos = startNanos + index * frameDurationInMicros * 1000L - System.nanoTime()
+                if (sleepNanos > 0) {
+                    Thread.sleep(sleepNanos / 1_000_000L, (sleepNanos % 1_000_000L).toInt())
+                }
+                if (isSending && !isKeyFrameRequested) {
+                    encoder.requestKeyFrame()
+                    isKeyFrameRequested = true
+                }
+                encoder.encode(index, index * frameDurationInMicros, ::onEncoded)
+                index ++
+                if (heldPackets.isNotEmpty() && SystemClock.uptimeMillis() >= stallEndTime) {
+                    for (packet in heldPackets) {
+                        socket.send(DatagramPacket(packet, packet.size, address, rtpPort))
+                    }
+                    heldPackets.clear()
+                }
+                if (firstFrameWallTime > 0L && System.currentTimeMillis() - lastReportTime >= SENDER_REPORT_INTERVAL) {
+                    sendSenderReport()
+                }
+            }
+        } finally {
+            encoder.release()
+            socket.close()
+        }
+    }
+
+    private fun onEncoded(bytes: ByteArray, ptsInMicros: Long, flags: Int) {
+        val nals = splitNals(bytes)
+        if (flags and MediaCodec.BUFFER_FLAG_CODEC_CONFIG != 0) {
+            for (nal in nals) {
+                when (nal[0].toInt() and 0x1F) {
+                    NAL_SPS -> sps = nal
+                    NAL_PPS -> pps = nal
+                }
+            }
+            if (sps != null && pps != null) {
+                parameterSetsReady.countDown()
+            }
+            return
+        }
+        if (!isSending) {
+            return
+        }
+        val isKeyFrame = flags and MediaCodec.BUFFER_FLAG_KEY_FRAME != 0
+        if (firstFramePts < 0L) {
+            if (!isKeyFrame) {
+                return
+            }
+            firstFramePts = ptsInMicros
+            firstFrameWallTime = wallStartTime + ptsInMicros / 1000L
+        }
+        val timestamp = RTP_BASE_TIMESTAMP + (ptsInMicros - firstFramePts) * RTP_CLOCK_RATE / 1_000_000L
+        // Parameter sets in band before every key frame, a receiver can start from any key frame.
+        val units = if (isKeyFrame) listOfNotNull(sps, pps) + nals else nals
+        for ((i, nal) in units.withIndex()) {
+            sendNal(nal, timestamp, i == units.size - 1)
+        }
+    }
+
+    private fun sendNal(nal: ByteArray, timestamp: Long, isLastOfFrame: Boolean) {
+        if (nal.size <= MAX_PAYLOAD_SIZE) {
+            sendRtp(timestamp, isLastOfFrame, nal)
+            return
+        }
+        // FU-A: fragments share nal header's nri, first fragment has start bit, last has end bit.
+        val indicator = ((nal[0].toInt() and 0xE0) or NAL_FU_A).toByte()
+        val type = nal[0].toInt() and 0x1F
+        var offset = 1
+        while (offset < nal.size) {
+            val size = minOf(MAX_PAYLOAD_SIZE - 2, nal.size - offset)
+            val isFirst = offset == 1
+            val isLast = offset + size == nal.size
+            val header = (type or (if (isFirst) 0x80 else 0) or (if (isLast) 0x40 else 0)).toByte()
+            val payload = ByteArray(size + 2)
+            payload[0] = indicator
+            payload[1] = header
+            System.arraycopy(nal, offset, payload, 2, size)
+            sendRtp(timestamp, isLastOfFrame && isLast, payload)
+            offset += size
+        }
+    }
+
+    private fun sendRtp(timestamp: Long, marker: Boolean, payload: ByteArray) {
+        val packet = ByteBuffer.allocate(RTP_HEADER_SIZE + payload.size)
+            .put(0x80.toByte())
+            .put(((if (marker) 0x80 else 0) or PAYLOAD_TYPE).toByte())
+            .putShort(sequence.toShort())
+            .putInt(timestamp.toInt())
+            .putInt(SSRC)
+            .put(payload)
+            .array()
+        sequence = (sequence + 1) and 0xFFFF
+        packetCount ++
+        octetCount += payload.size
+        if (SystemClock.uptimeMillis() < stallEndTime || heldPackets.isNotEmpty()) {
+            heldPackets.add(packet)
+        } else {
+            socket.send(DatagramPacket(packet, packet.size, address, rtpPort))
+        }
+    }
+
+    private fun sendSenderReport() {
+        val now = System.currentTimeMillis()
+        lastReportTime = now
+        val timestamp = RTP_BASE_TIMESTAMP + (now - firstFrameWallTime) * RTP_CLOCK_RATE / 1000L
+        val report = ByteBuffer.allocate(28)
+            .put(0x80.toByte())
+            .put(RTCP_SENDER_REPORT.toByte())
+            .putShort(6)
+            .putInt(SSRC)
+            .putInt((now / 1000L + NTP_UNIX_EPOCH_OFFSET).toInt())
+            .putInt(((now % 1000L shl 32) / 1000L).toInt())
+            .putInt(timestamp.toInt())
+            .putInt(packetCount.toInt())
+            .putInt(octetCount.toInt())
+            .array()
+        socket.send(DatagramPacket(report, report.size, address, rtpPort + 1))
+    }
+
+    companion object {
+        private const val PAYLOAD_TYPE = 96
+        private const val RTP_CLOCK_RATE = 90_000L
+        // Not 0, 0 means no base timestamp to ffmpeg's rtp demuxer.
+        private const val RTP_BASE_TIMESTAMP = 90_000L
+        private const val RTP_HEADER_SIZE = 12
+        private const val MAX_PAYLOAD_SIZE = 1400
+        private const val SSRC = 0x74_4D_50_31
+        private const val RTCP_SENDER_REPORT = 200
+        private const val SENDER_REPORT_INTERVAL = 500L
+        private const val NTP_UNIX_EPOCH_OFFSET = 2_208_988_800L
+        private const val NAL_SPS = 7
+        private const val NAL_PPS = 8
+        private const val NAL_FU_A = 28
+
+        /**
+         * Even port with a free odd port after it, for rtp and rtcp.
+         */
+        fun findFreeRtpPort(): Int {
+            while (true) {
+                val port = DatagramSocket(0).use { it.localPort } and 0xFFFE
+                val isFree = runCatching {
+                    DatagramSocket(port).use { DatagramSocket(port + 1).close() }
+                }.isSuccess
+                if (isFree) {
+                    return port
+                }
+            }
+        }
+
+        /**
+         * Split annex b stream by start codes.
+         */
+        fun splitNals(bytes: ByteArray): List<ByteArray> {
+            val starts = ArrayList<Int>()
+            var i = 0
+            while (i + 2 < bytes.size) {
+                if (bytes[i].toInt() == 0 && bytes[i + 1].toInt() == 0 && bytes[i + 2].toInt() == 1) {
+                    starts.add(i + 3)
+                    i += 3
+                } else {
+                    i ++
+                }
+            }
+            return starts.mapIndexed { index, start ->
+                var end = if (index + 1 < starts.size) starts[index + 1] - 3 else bytes.size
+                // Zero byte of 4 bytes start code.
+                while (end > start && bytes[end - 1].toInt() == 0) {
+                    end --
+                }
+                bytes.copyOfRange(start, end)
+            }.filter { it.isNotEmpty() }
+        }
+    }
+}
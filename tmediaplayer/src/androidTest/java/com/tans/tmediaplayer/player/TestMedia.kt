@@ -0,0 +1,138 @@
+package com.tans.tmediaplayer.player
+
+import android.media.MediaCodec
+import android.media.MediaCodecInfo
+import android.media.MediaFormat
+import android.media.MediaMuxer
+import java.io.File
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import kotlin.math.PI
+import kotlin.math.sin
+
+/**
+ * Generated mp4 test media: H.264 video of [TestVideoEncoder] and an AAC 440Hz sine.
+ */
+internal object TestMedia {
+
+    const val VIDEO_FPS = 30
+
+    const val AUDIO_SAMPLE_RATE = 48000
+
+    const val AUDIO_CHANNELS = 2
+
+    // AAC frame.
+    const val AUDIO_SAMPLES_PER_FRAME = 1024
+
+    private class EncodedSample(val bytes: ByteArray, val ptsInMicros: Long, val flags: Int)
+
+    /**
+     * Create media once per [name], reused by later tests in the same process.
+     */
+    @Synchronized
+    fun createMp4(name: String, durationInMillis: Long, withAudio: Boolean = true): File {
+        val file = File(testCacheDir(), name)
+        if (file.isFile && file.length() > 0L) {
+            return file
+        }
+        val tmpFile = File(testCacheDir(), "$name.tmp")
+        val muxer = MediaMuxer(tmpFile.absolutePath, MediaMuxer.OutputFormat.MUXER_OUTPUT_MPEG_4)
+        val (videoFormat, videoSamples) = encodeVideo(durationInMillis)
+        val videoTrack = muxer.addTrack(videoFormat)
+        val audio = if (withAudio) encodeAudio(durationInMillis) else null
+        val audioTrack = audio?.let { muxer.addTrack(it.first) }
+        muxer.start()
+        val info = MediaCodec.BufferInfo()
+        fun write(track: Int, sample: EncodedSample) {
+            info.set(0, sample.bytes.size, sample.ptsInMicros, sample.flags)
+            muxer.writeSampleData(track, ByteBuffer.wrap(sample.bytes), info)
+        }
+        videoSamples.forEach { write(videoTrack, it) }
+        if (audio != null && audioTrack != null) {
+            audio.second.forEach { write(audioTrack, it) }
+        }
+        muxer.stop()
+        muxer.release()
+        tmpFile.renameTo(file)
+        return file
+    }
+
+    fun videoFrameCount(durationInMillis: Long): Long = durationInMillis * VIDEO_FPS / 1000L
+
+    private fun encodeVideo(durationInMillis: Long): Pair<MediaFormat, List<EncodedSample>> {
+        val encoder = TestVideoEncoder(fps = VIDEO_FPS)
+        val samples = ArrayList<EncodedSample>()
+        val onOutput: (ByteArray, Long, Int) -> Unit = { bytes, pts, flags ->
+            if (flags and MediaCodec.BUFFER_FLAG_CODEC_CONFIG == 0) {
+                samples.add(EncodedSample(bytes, pts, flags and MediaCodec.BUFFER_FLAG_KEY_FRAME))
+            }
+        }
+        for (i in 0 until videoFrameCount(durationInMillis).toInt()) {
+            encoder.encode(i, i * encoder.frameDurationInMicros(), onOutput)
+        }
+        encoder.finish(onOutput)
+        return encoder.outputFormat!! to samples
+    }
+
+    private fun encodeAudio(durationInMillis: Long): Pair<MediaFormat, List<EncodedSample>> {
+        val format = MediaFormat.createAudioFormat(MediaFormat.MIMETYPE_AUDIO_AAC, AUDIO_SAMPLE_RATE, AUDIO_CHANNELS).apply {
+            setInteger(MediaFormat.KEY_AAC_PROFILE, MediaCodecInfo.CodecProfileLevel.AACObjectLC)
+            setInteger(MediaFormat.KEY_BIT_RATE, 128_000)
+        }
+        val codec = MediaCodec.createEncoderByType(MediaFormat.MIMETYPE_AUDIO_AAC)
+        codec.configure(format, null, null, MediaCodec.CONFIGURE_FLAG_ENCODE)
+        codec.start()
+        val samples = ArrayList<EncodedSample>()
+        val info = MediaCodec.BufferInfo()
+        var outputFormat: MediaFormat? = null
+        val totalFrames = durationInMillis * AUDIO_SAMPLE_RATE / 1000L / AUDIO_SAMPLES_PER_FRAME
+        val pcm = ByteBuffer.allocate(AUDIO_SAMPLES_PER_FRAME * AUDIO_CHANNELS * 2).order(ByteOrder.LITTLE_ENDIAN)
+        var frame = 0L
+        var isInputEnd = false
+        while (true) {
+            if (!isInputEnd) {
+                val inputIndex = codec.dequeueInputBuffer(TIMEOUT_IN_MICROS)
+                if (inputIndex >= 0) {
+                    val ptsInMicros = frame * AUDIO_SAMPLES_PER_FRAME * 1_000_000L / AUDIO_SAMPLE_RATE
+                    if (frame >= totalFrames) {
+                        codec.queueInputBuffer(inputIndex, 0, 0, ptsInMicros, MediaCodec.BUFFER_FLAG_END_OF_STREAM)
+                        isInputEnd = true
+                    } else {
+                        pcm.clear()
+                        for (i in 0 until AUDIO_SAMPLES_PER_FRAME) {
+                            val t = (frame * AUDIO_SAMPLES_PER_FRAME + i).toDouble() / AUDIO_SAMPLE_RATE
+                            val value = (sin(2.0 * PI * 440.0 * t) * 8000.0).toInt().toShort()
+                            repeat(AUDIO_CHANNELS) { pcm.putShort(value) }
+                        }
+                        val input = codec.getInputBuffer(inputIndex)!!
+                        input.clear()
+                        input.put(pcm.array(), 0, pcm.position())
+                        codec.queueInputBuffer(inputIndex, 0, pcm.position(), ptsInMicros, 0)
+                        frame ++
+                    }
+                }
+            }
+            val outputIndex = codec.dequeueOutputBuffer(info, TIMEOUT_IN_MICROS)
+            if (outputIndex == MediaCodec.INFO_OUTPUT_FORMAT_CHANGED) {
+                outputFormat = codec.outputFormat
+            } else if (outputIndex >= 0) {
+                if (info.size > 0 && info.flags and MediaCodec.BUFFER_FLAG_CODEC_CONFIG == 0) {
+                    val bytes = ByteArray(info.size)
+                    val output = codec.getOutputBuffer(outputIndex)!!
+                    output.position(info.offset)
+                    output.get(bytes)
+                    samples.add(EncodedSample(bytes, info.presentationTimeUs, 0))
+                }
+                codec.releaseOutputBuffer(outputIndex, false)
+                if (info.flags and MediaCodec.BUFFER_FLAG_END_OF_STREAM != 0) {
+                    break
+                }
+            }
+        }
+        codec.stop()
+        codec.release()
+        return outputFormat!! to samples
+    }
+
+    private const val TIMEOUT_IN_MICROS = 10_000L
+}
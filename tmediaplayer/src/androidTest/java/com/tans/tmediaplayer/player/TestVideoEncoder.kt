@@ -0,0 +1,139 @@
+package com.tans.tmediaplayer.player
+
+import android.media.MediaCodec
+import android.media.MediaCodecInfo
+import android.media.MediaFormat
+import android.os.Bundle
+
+/**
+ * H.264 encoder of generated frames for tests: a bright bar moving over a gradient, frame index decides the image.
+ * Output is annex b, codec config (sps / pps) is flagged by [MediaCodec.BUFFER_FLAG_CODEC_CONFIG].
+ */
+internal class TestVideoEncoder(
+    val width: Int = 640,
+    val height: Int = 360,
+    val fps: Int = 30,
+    bitrate: Int = 1_000_000
+) {
+
+    private val codec: MediaCodec = MediaCodec.createEncoderByType(MediaFormat.MIMETYPE_VIDEO_AVC)
+
+    private val bufferInfo = MediaCodec.BufferInfo()
+
+    private val yRow = ByteArray(width)
+
+    /**
+     * Encoder output format with csd, known after first output.
+     */
+    var outputFormat: MediaFormat? = null
+        private set
+
+    init {
+        val format = MediaFormat.createVideoFormat(MediaFormat.MIMETYPE_VIDEO_AVC, width, height).apply {
+            setInteger(MediaFormat.KEY_COLOR_FORMAT, MediaCodecInfo.CodecCapabilities.COLOR_FormatYUV420Flexible)
+            setInteger(MediaFormat.KEY_BIT_RATE, bitrate)
+            setInteger(MediaFormat.KEY_FRAME_RATE, fps)
+            setInteger(MediaFormat.KEY_I_FRAME_INTERVAL, 1)
+            setInteger(MediaFormat.KEY_PROFILE, MediaCodecInfo.CodecProfileLevel.AVCProfileBaseline)
+            setInteger(MediaFormat.KEY_LEVEL, MediaCodecInfo.CodecProfileLevel.AVCLevel31)
+        }
+        codec.configure(format, null, null, MediaCodec.CONFIGURE_FLAG_ENCODE)
+        codec.start()
+    }
+
+    fun frameDurationInMicros(): Long = 1_000_000L / fps
+
+    /**
+     * Queue frame [index], outputs ready are passed to [onOutput] (bytes, pts in micros, buffer flags).
+     */
+    fun encode(index: Int, ptsInMicros: Long, onOutput: (ByteArray, Long, Int) -> Unit) {
+        while (true) {
+            val inputIndex = codec.dequeueInputBuffer(TIMEOUT_IN_MICROS)
+            if (inputIndex >= 0) {
+                fillFrame(inputIndex, index)
+                codec.queueInputBuffer(inputIndex, 0, width * height * 3 / 2, ptsInMicros, 0)
+                break
+            }
+            drain(false, onOutput)
+        }
+        drain(false, onOutput)
+    }
+
+    /**
+     * Next output frame is a key frame.
+     */
+    fun requestKeyFrame() {
+        codec.setParameters(Bundle().apply { putInt(MediaCodec.PARAMETER_KEY_REQUEST_SYNC_FRAME, 0) })
+    }
+
+    /**
+     * Flush all queued frames to [onOutput] and release encoder.
+     */
+    fun finish(onOutput: (ByteArray, Long, Int) -> Unit) {
+        while (true) {
+            val inputIndex = codec.dequeueInputBuffer(TIMEOUT_IN_MICROS)
+            if (inputIndex >= 0) {
+                codec.queueInputBuffer(inputIndex, 0, 0, 0L, MediaCodec.BUFFER_FLAG_END_OF_STREAM)
+                break
+            }
+            drain(false, onOutput)
+        }
+        drain(true, onOutput)
+        release()
+    }
+
+    fun release() {
+        codec.stop()
+        codec.release()
+    }
+
+    private fun fillFrame(inputIndex: Int, frameIndex: Int) {
+        val image = codec.getInputImage(inputIndex)!!
+        val barStart = (frameIndex * 8) % width
+        for (x in 0 until width) {
+            yRow[x] = if (x - barStart in 0 until 32) 235.toByte() else (16 + (x + frameIndex) % 200).toByte()
+        }
+        val yPlane = image.planes[0]
+        val yBuffer = yPlane.buffer
+        for (y in 0 until height) {
+            yBuffer.position(y * yPlane.rowStride)
+            yBuffer.put(yRow)
+        }
+        for (p in 1..2) {
+            val plane = image.planes[p]
+            val buffer = plane.buffer
+            for (y in 0 until height / 2) {
+                for (x in 0 until width / 2) {
+                    buffer.put(y * plane.rowStride + x * plane.pixelStride, 128.toByte())
+                }
+            }
+        }
+    }
+
+    private fun drain(endOfStream: Boolean, onOutput: (ByteArray, Long, Int) -> Unit) {
+        while (true) {
+            val outputIndex = codec.dequeueOutputBuffer(bufferInfo, if (endOfStream) TIMEOUT_IN_MICROS else 0L)
+            when {
+                outputIndex == MediaCodec.INFO_TRY_AGAIN_LATER -> if (!endOfStream) return
+                outputIndex == MediaCodec.INFO_OUTPUT_FORMAT_CHANGED -> outputFormat = codec.outputFormat
+                outputIndex >= 0 -> {
+                    val buffer = codec.getOutputBuffer(outputIndex)!!
+                    if (bufferInfo.size > 0) {
+                        val bytes = ByteArray(bufferInfo.size)
+                        buffer.position(bufferInfo.offset)
+                        buffer.get(bytes)
+                        onOutput(bytes, bufferInfo.presentationTimeUs, bufferInfo.flags)
+                    }
+                    codec.releaseOutputBuffer(outputIndex, false)
+                    if (bufferInfo.flags and MediaCodec.BUFFER_FLAG_END_OF_STREAM != 0) {
+                        return
+                    }
+                }
+            }
+        }
+    }
+
+    companion object {
+        private const val TIMEOUT_IN_MICROS = 10_000L
+    }
+}
@@ -3,6 +3,9 @@
 #define TMEDIAPLAYER_TMEDIAAUDIOTRACK_H
 
 #include <jni.h>
+#include <chrono>
+#include <deque>
+#include <mutex>
 #include "tmediaplayer.h"
 
 extern "C" {
@@ -10,12 +13,33 @@ extern "C" {
 #include <SLES/OpenSLES_Android.h>
 }
 
-typedef struct tMediaAudioTrackContext {
+typedef struct EnqueuedAudioBuffer {
+    int64_t pts = 0L;
+    // Offset of buffer start since last position reset.
+    double startOffsetInMillis = 0.0;
+    double durationInMillis = 0.0;
+    // Not equals durationInMillis when audio is time stretched.
+    double mediaDurationInMillis = 0.0;
+} EnqueuedAudioBuffer;
+
+/**
+ * Process-wide sl engine and output mix, shared by all audio tracks.
+ */
+typedef struct tMediaAudioEngine {
     SLObjectItf engineObject = nullptr;
     SLEngineItf engineInterface = nullptr;
 
     SLObjectItf outputMixObject = nullptr;
 
+    int32_t refCount = 0;
+} tMediaAudioEngine;
+
+typedef struct tMediaAudioTrackContext {
+    // Borrowed from shared tMediaAudioEngine, don't destroy.
+    SLEngineItf engineInterface = nullptr;
+    SLObjectItf outputMixObject = nullptr;
+    bool isEngineAcquired = false;
+
     SLObjectItf playerObject = nullptr;
     SLPlayItf playerInterface = nullptr;
     SLAndroidSimpleBufferQueueItf playerBufferQueueInterface = nullptr;
@@ -26,6 +50,19 @@ typedef struct tMediaAudioTrackContext {
     SLuint32 inputSampleRate = SL_SAMPLINGRATE_48;
     SLuint32 inputSampleFormat = SL_PCMSAMPLEFORMAT_FIXED_16;
 
+    uint32_t bytesPerMillis = 0;
+
+    /**
+     * Playback position
+     */
+    std::mutex playbackPositionLock;
+    // Buffers which are enqueued and not played finished.
+    std::deque<EnqueuedAudioBuffer> enqueuedBuffers;
+    // Player position when enqueuedBuffers offset reset.
+    SLmillisecond basePosition = 0;
+    double enqueuedOffsetInMillis = 0.0;
+    int64_t lastPlayedPts = -1L;
+
     JavaVM *jvm = nullptr;
     jobject j_audioTrack = nullptr;
     jmethodID j_callbackMethodId = nullptr;
@@ -36,16 +73,27 @@ typedef struct tMediaAudioTrackContext {
 
     tMediaOptResult pause() const;
 
-    tMediaOptResult stop() const;
+    tMediaOptResult stop();
 
-    tMediaOptResult enqueueBuffer(tMediaAudioBuffer* buffer) const;
+    tMediaOptResult enqueueBuffer(tMediaAudioBuffer* buffer);
 
     int32_t getBufferQueueCount() const;
 
-    tMediaOptResult clearBuffers() const;
+    /**
+     * Media pts of the sample which is playing by sink, compute by player position.
+     * @return -1 if no buffer played.
+     */
+    int64_t getPlaybackPts();
+
+    tMediaOptResult clearBuffers();
 
     void release();
 
+    SLmillisecond getPlayerPosition() const;
+
+    // Need hold playbackPositionLock.
+    void resetPlaybackPosition();
+
 } tMediaAudioTrackContext;
 
 #endif
\ No newline at end of file
@@ -50,6 +50,15 @@ Java_com_tans_tmediaplayer_audiotrack_tMediaAudioTrack_getBufferQueueCountNative
     return audioTrack->getBufferQueueCount();
 }
 
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_tans_tmediaplayer_audiotrack_tMediaAudioTrack_getPlaybackPtsNative(
+        JNIEnv * env,
+        jobject j_audio_track,
+        jlong native_audio_track) {
+    auto audioTrack = reinterpret_cast<tMediaAudioTrackContext *>(native_audio_track);
+    return audioTrack->getPlaybackPts();
+}
+
 extern "C" JNIEXPORT jint JNICALL
 Java_com_tans_tmediaplayer_audiotrack_tMediaAudioTrack_clearBuffersNative(
         JNIEnv * env,
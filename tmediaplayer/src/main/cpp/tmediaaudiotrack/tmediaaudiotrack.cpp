@@ -27,42 +27,96 @@ void playerBufferQueueCallback(SLAndroidSimpleBufferQueueItf bq, void *context)
     env->CallVoidMethod(audioTrackContext->j_audioTrack, audioTrackContext->j_callbackMethodId);
 }
 
-tMediaOptResult tMediaAudioTrackContext::prepare(unsigned int bufferQueueSize, unsigned int outputChannels, unsigned int outputSampleRate, unsigned int outputSampleBitDepth) {
-    // region Init sl engine
-    SLresult result = slCreateEngine(&engineObject, 0, nullptr, 0, nullptr, nullptr);
-    if (result != SL_RESULT_SUCCESS) {
-        LOGE("Create sl engine object fail: %d", result);
-        return OptFail;
-    }
-    result = (*engineObject)->Realize(engineObject, SL_BOOLEAN_FALSE);
-    if (result != SL_RESULT_SUCCESS) {
-        LOGE("Realize sl engine object fail: %d", result);
-        return OptFail;
+// region Shared sl engine
+static std::mutex audioEngineLock;
+static tMediaAudioEngine audioEngine;
+
+static void destroyAudioEngine() {
+    if (audioEngine.outputMixObject != nullptr) {
+        (*audioEngine.outputMixObject)->Destroy(audioEngine.outputMixObject);
+        audioEngine.outputMixObject = nullptr;
     }
-    result = (*engineObject)->GetInterface(engineObject, SL_IID_ENGINE, &engineInterface);
-    if (result != SL_RESULT_SUCCESS) {
-        LOGE("Get sl engine interface fail: %d", result);
-        return OptFail;
+    if (audioEngine.engineObject != nullptr) {
+        (*audioEngine.engineObject)->Destroy(audioEngine.engineObject);
+        audioEngine.engineObject = nullptr;
+        audioEngine.engineInterface = nullptr;
     }
-    // endregion
+}
+
+static tMediaOptResult acquireAudioEngine(SLEngineItf *engineInterface, SLObjectItf *outputMixObject) {
+    std::lock_guard<std::mutex> lockGuard(audioEngineLock);
+    if (audioEngine.refCount <= 0) {
+        // Init sl engine
+        SLresult result = slCreateEngine(&audioEngine.engineObject, 0, nullptr, 0, nullptr, nullptr);
+        if (result != SL_RESULT_SUCCESS) {
+            LOGE("Create sl engine object fail: %d", result);
+            destroyAudioEngine();
+            return OptFail;
+        }
+        result = (*audioEngine.engineObject)->Realize(audioEngine.engineObject, SL_BOOLEAN_FALSE);
+        if (result != SL_RESULT_SUCCESS) {
+            LOGE("Realize sl engine object fail: %d", result);
+            destroyAudioEngine();
+            return OptFail;
+        }
+        result = (*audioEngine.engineObject)->GetInterface(audioEngine.engineObject, SL_IID_ENGINE, &audioEngine.engineInterface);
+        if (result != SL_RESULT_SUCCESS) {
+            LOGE("Get sl engine interface fail: %d", result);
+            destroyAudioEngine();
+            return OptFail;
+        }
 
-    // region Init output mix
+        // Init output mix
 //    const SLInterfaceID outputMixIds[1] = {SL_IID_ENVIRONMENTALREVERB};
 //    const SLboolean outputMixReq[1] = {SL_BOOLEAN_FALSE};
-    result = (*engineInterface)->CreateOutputMix(engineInterface, &outputMixObject, 0, nullptr,
-                                                 nullptr);
-    if (result != SL_RESULT_SUCCESS) {
-        LOGE("Create output mix object fail: %d", result);
-        return OptFail;
+        result = (*audioEngine.engineInterface)->CreateOutputMix(audioEngine.engineInterface, &audioEngine.outputMixObject, 0, nullptr,
+                                                                 nullptr);
+        if (result != SL_RESULT_SUCCESS) {
+            LOGE("Create output mix object fail: %d", result);
+            destroyAudioEngine();
+            return OptFail;
+        }
+        result = (*audioEngine.outputMixObject)->Realize(audioEngine.outputMixObject, SL_BOOLEAN_FALSE);
+        if (result != SL_RESULT_SUCCESS) {
+            LOGE("Realize output mix object fail: %d", result);
+            destroyAudioEngine();
+            return OptFail;
+        }
+        LOGD("Create shared sl engine.");
     }
-    result = (*outputMixObject)->Realize(outputMixObject, SL_BOOLEAN_FALSE);
-    if (result != SL_RESULT_SUCCESS) {
-        LOGE("Realize output mix object fail: %d", result);
+    audioEngine.refCount ++;
+    *engineInterface = audioEngine.engineInterface;
+    *outputMixObject = audioEngine.outputMixObject;
+    return OptSuccess;
+}
+
+static void releaseAudioEngine() {
+    std::lock_guard<std::mutex> lockGuard(audioEngineLock);
+    audioEngine.refCount --;
+    if (audioEngine.refCount <= 0) {
+        audioEngine.refCount = 0;
+        destroyAudioEngine();
+        LOGD("Destroy shared sl engine.");
+    }
+}
+// endregion
+
+static int64_t elapsedMicros(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+tMediaOptResult tMediaAudioTrackContext::prepare(unsigned int bufferQueueSize, unsigned int outputChannels, unsigned int outputSampleRate, unsigned int outputSampleBitDepth) {
+    auto startTime = std::chrono::steady_clock::now();
+    // region Acquire sl engine and output mix
+    if (acquireAudioEngine(&engineInterface, &outputMixObject) != OptSuccess) {
         return OptFail;
     }
+    isEngineAcquired = true;
+    int64_t engineCostInMicros = elapsedMicros(startTime);
     // endregion
 
     // region Create player
+    SLresult result;
 
     // Audio source configure
     if (outputChannels == 1) {
@@ -146,7 +200,12 @@ tMediaOptResult tMediaAudioTrackContext::prepare(unsigned int bufferQueueSize, u
     playerBufferQueueState = new SLAndroidSimpleBufferQueueState;
     // endregion
 
-    LOGD("Prepare audio track success!!");
+    bytesPerMillis = outputSampleRate * inputSampleChannels * (inputSampleFormat / 8) / 1000;
+    playbackPositionLock.lock();
+    resetPlaybackPosition();
+    playbackPositionLock.unlock();
+
+    LOGD("Prepare audio track success!! engine cost: %lld us, total cost: %lld us", (long long) engineCostInMicros, (long long) elapsedMicros(startTime));
 
     return OptSuccess;
 }
@@ -169,18 +228,33 @@ tMediaOptResult tMediaAudioTrackContext::pause() const {
     }
 }
 
-tMediaOptResult tMediaAudioTrackContext::stop() const {
+tMediaOptResult tMediaAudioTrackContext::stop() {
     SLresult result = (*playerInterface)->SetPlayState(playerInterface, SL_PLAYSTATE_STOPPED);
     if (result == SL_RESULT_SUCCESS) {
+        // Stopped player position reset to 0.
+        std::lock_guard<std::mutex> lockGuard(playbackPositionLock);
+        resetPlaybackPosition();
         return OptSuccess;
     } else {
         return OptFail;
     }
 }
 
-tMediaOptResult tMediaAudioTrackContext::enqueueBuffer(tMediaAudioBuffer *buffer) const {
+tMediaOptResult tMediaAudioTrackContext::enqueueBuffer(tMediaAudioBuffer *buffer) {
+    std::lock_guard<std::mutex> lockGuard(playbackPositionLock);
     SLresult result = (*playerBufferQueueInterface)->Enqueue(playerBufferQueueInterface, buffer->pcmBuffer, buffer->contentSize);
     if (result == SL_RESULT_SUCCESS) {
+        EnqueuedAudioBuffer enqueued;
+        enqueued.pts = buffer->pts;
+        enqueued.startOffsetInMillis = enqueuedOffsetInMillis;
+        if (bytesPerMillis > 0) {
+            enqueued.durationInMillis = (double) buffer->contentSize / (double) bytesPerMillis;
+        } else {
+            enqueued.durationInMillis = (double) buffer->duration;
+        }
+        enqueued.mediaDurationInMillis = (double) buffer->duration;
+        enqueuedOffsetInMillis += enqueued.durationInMillis;
+        enqueuedBuffers.push_back(enqueued);
         return OptSuccess;
     } else {
         return OptFail;
@@ -196,8 +270,35 @@ int32_t tMediaAudioTrackContext::getBufferQueueCount() const {
     }
 }
 
-tMediaOptResult tMediaAudioTrackContext::clearBuffers() const {
+int64_t tMediaAudioTrackContext::getPlaybackPts() {
+    std::lock_guard<std::mutex> lockGuard(playbackPositionLock);
+    SLmillisecond position = getPlayerPosition();
+    // Queue buffers underflow, the position maybe less than base position.
+    double playedInMillis = position > basePosition ? (double) (position - basePosition) : 0.0;
+    while (!enqueuedBuffers.empty()) {
+        auto &head = enqueuedBuffers.front();
+        if (playedInMillis < head.startOffsetInMillis + head.durationInMillis) {
+            double playedInBuffer = playedInMillis - head.startOffsetInMillis;
+            if (playedInBuffer < 0.0) {
+                playedInBuffer = 0.0;
+            }
+            if (head.durationInMillis > 0.0) {
+                playedInBuffer = playedInBuffer * head.mediaDurationInMillis / head.durationInMillis;
+            }
+            lastPlayedPts = head.pts + (int64_t) playedInBuffer;
+            return lastPlayedPts;
+        }
+        // Head buffer played finished.
+        lastPlayedPts = head.pts + (int64_t) head.mediaDurationInMillis;
+        enqueuedBuffers.pop_front();
+    }
+    return lastPlayedPts;
+}
+
+tMediaOptResult tMediaAudioTrackContext::clearBuffers() {
+    std::lock_guard<std::mutex> lockGuard(playbackPositionLock);
     SLresult result = (*playerBufferQueueInterface)->Clear(playerBufferQueueInterface);
+    resetPlaybackPosition();
     if (result == SL_RESULT_SUCCESS) {
         return OptSuccess;
     } else {
@@ -205,6 +306,20 @@ tMediaOptResult tMediaAudioTrackContext::clearBuffers() const {
     }
 }
 
+SLmillisecond tMediaAudioTrackContext::getPlayerPosition() const {
+    SLmillisecond position = 0;
+    if (playerInterface != nullptr) {
+        (*playerInterface)->GetPosition(playerInterface, &position);
+    }
+    return position;
+}
+
+void tMediaAudioTrackContext::resetPlaybackPosition() {
+    enqueuedBuffers.clear();
+    enqueuedOffsetInMillis = 0.0;
+    basePosition = getPlayerPosition();
+    lastPlayedPts = -1L;
+}
 
 void tMediaAudioTrackContext::release() {
     if (playerObject != nullptr) {
@@ -213,18 +328,16 @@ void tMediaAudioTrackContext::release() {
         playerInterface = nullptr;
         playerBufferQueueInterface = nullptr;
     }
-    if (outputMixObject != nullptr) {
-        (*outputMixObject)->Destroy(outputMixObject);
-        outputMixObject = nullptr;
-    }
-    if (engineObject != nullptr) {
-        (*engineObject)->Destroy(engineObject);
-        engineObject = nullptr;
-        engineInterface = nullptr;
+    outputMixObject = nullptr;
+    engineInterface = nullptr;
+    if (isEngineAcquired) {
+        releaseAudioEngine();
+        isEngineAcquired = false;
     }
     if (playerBufferQueueState != nullptr) {
         free(playerBufferQueueState);
         playerBufferQueueState = nullptr;
     }
+    enqueuedBuffers.clear();
     LOGD("Audio track released.");
 }
\ No newline at end of file
@@ -0,0 +1,114 @@
+#ifndef TMEDIAPLAYER_TMEDIAABR_H
+#define TMEDIAPLAYER_TMEDIAABR_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+#include "tmediabuffering.h"
+
+extern "C" {
+#include "libavformat/avformat.h"
+}
+
+#define ABR_MAX_VARIANTS 16
+// Variant bitrate must be below this fraction of estimated bandwidth.
+#define ABR_BANDWIDTH_FRACTION 0.75
+// Bandwidth moving average weight of new segment sample.
+#define ABR_EWMA_WEIGHT 0.3
+// Smaller segment reads are dominated by request latency, not used as bandwidth samples.
+#define ABR_MIN_SAMPLE_BYTES (64 * 1024)
+#define ABR_SEGMENT_IO_BUFFER_SIZE (32 * 1024)
+// Switch up only when buffered enough to survive a wrong estimate.
+#define ABR_MIN_BUFFER_FOR_UP_SWITCH_IN_MILLIS 8000L
+// Don't switch down while buffer is healthy, a short bandwidth drop is absorbed by buffer.
+#define ABR_MAX_BUFFER_FOR_DOWN_SWITCH_IN_MILLIS 20000L
+
+// Size of exported abr stats: variant count, current variant, bandwidth, switch count, then bitrate, width, height of each variant.
+#define ABR_STATS_EXPORT_SIZE (4 + ABR_MAX_VARIANTS * 3)
+
+typedef struct tMediaAbrVariant {
+    // bits per second, declared by playlist / manifest.
+    int64_t bandwidth = 0;
+    int videoStreamIndex = -1;
+    int32_t width = 0;
+    int32_t height = 0;
+    // Streams needed by this variant, other variants' streams are discarded.
+    std::vector<int> streams;
+} tMediaAbrVariant;
+
+/**
+ * Segment AVIOContext opened by hls / dash demuxer, wraps the default io to measure segment download time.
+ */
+typedef struct tMediaAbrSegmentIO {
+    AVIOContext *source = nullptr;
+    AVIOContext *avio = nullptr;
+    int64_t readBytes = 0;
+    int64_t readCostInMicros = 0;
+} tMediaAbrSegmentIO;
+
+/**
+ * Adaptive bitrate for hls / dash medias, all variants are opened by FFmpeg demuxer as streams.
+ * Variants not playing are discarded (AVDISCARD_ALL), demuxer stops downloading their segments.
+ * Bandwidth is estimated by segment read time in io layer, switching is applied after demuxer opens a new segment,
+ * demuxer restarts the new variant from current timestamp at a keyframe.
+ * Packets of all variants are mapped to the player's audio / video stream, so queues and decoders don't see the switch.
+ * All methods except exportTo are called by demux thread.
+ */
+typedef struct tMediaAbr {
+    std::mutex lock;
+    AVFormatContext *formatCtx = nullptr;
+    int (*defaultIOOpen)(struct AVFormatContext *s, AVIOContext **pb, const char *url, int flags, AVDictionary **options) = nullptr;
+    int (*defaultIOClose)(struct AVFormatContext *s, AVIOContext *pb) = nullptr;
+    std::map<AVIOContext *, tMediaAbrSegmentIO *> segmentIOs;
+
+    // Sorted by bandwidth.
+    std::vector<tMediaAbrVariant> variants;
+    // All streams belong to variants.
+    std::vector<int> variantStreams;
+    AVStream *baseVideoStream = nullptr;
+    AVStream *baseAudioStream = nullptr;
+    int currentVariant = -1;
+    int pendingVariant = -1;
+    bool segmentOpened = false;
+    // Video stream of last video packet, new extradata is attached to first packet of a different stream.
+    int lastVideoStreamIndex = -1;
+
+    // bits per second.
+    int64_t bandwidth = 0;
+    int64_t switchCount = 0;
+
+    // Receives segment read throughput, owned by player and released after abr.
+    tMediaBuffering *buffering = nullptr;
+
+    /**
+     * @return false if media has less than 2 variants, abr is not needed.
+     */
+    bool prepare(AVFormatContext *ctx, AVStream *videoStream, AVStream *audioStream);
+
+    int openSegment(AVIOContext **pb, const char *url, int flags, AVDictionary **options);
+
+    int closeSegment(AVIOContext *pb);
+
+    void onSegmentRead(int64_t bytes, int64_t costInMicros);
+
+    /**
+     * Called before reading packet, choose variant and apply pending switching at segment boundary.
+     */
+    void update(int64_t bufferedDurationInMillis);
+
+    /**
+     * Map packet of variant streams to base audio / video stream.
+     */
+    void routePacket(AVPacket *pkt);
+
+    int chooseVariant(int64_t bandwidth, int64_t bufferedDurationInMillis) const;
+
+    void applyVariant(int index);
+
+    void exportTo(int64_t *dst);
+
+    void release();
+} tMediaAbr;
+
+#endif //TMEDIAPLAYER_TMEDIAABR_H
@@ -0,0 +1,95 @@
+#ifndef TMEDIAPLAYER_TMEDIABUFFERING_H
+#define TMEDIAPLAYER_TMEDIABUFFERING_H
+
+#include <cstdint>
+#include <mutex>
+
+// Local: decoders only need a little buffer, bytes limit scales with bitrate.
+#define BUFFERING_LOCAL_MAX_DURATION_IN_MILLIS 1000L
+#define BUFFERING_LOCAL_MIN_BYTES (4LL * 1024 * 1024)
+#define BUFFERING_LOCAL_MAX_BYTES (64LL * 1024 * 1024)
+// Network: buffer as much as possible to survive bandwidth drops.
+#define BUFFERING_NETWORK_MAX_DURATION_IN_MILLIS 30000L
+#define BUFFERING_NETWORK_MAX_BYTES (64LL * 1024 * 1024)
+// Network: buffered duration to start or resume playback.
+#define BUFFERING_NETWORK_MIN_DURATION_IN_MILLIS 2500L
+// Network: slow network, buffer more before resuming playback.
+#define BUFFERING_NETWORK_SLOW_MIN_DURATION_IN_MILLIS 5000L
+// Throughput / bitrate below this is slow network.
+#define BUFFERING_SLOW_THROUGHPUT_RATIO 1.5
+// Bitrate and throughput moving average weight of new sample.
+#define BUFFERING_EWMA_WEIGHT 0.1
+// Queue duration needed to estimate bitrate.
+#define BUFFERING_BITRATE_MIN_DURATION_IN_MILLIS 500L
+// Network reads are summed to this size as one throughput sample, single reads are too short to time.
+#define BUFFERING_IO_MIN_SAMPLE_BYTES (256 * 1024)
+
+#define BUFFERING_UPDATE_FULL 1
+#define BUFFERING_UPDATE_REBUFFER_END 2
+
+// Size of exported buffering stats.
+#define BUFFERING_STATS_EXPORT_SIZE 12
+
+enum BufferingSourceType {
+    BufferingSourceLocal,
+    BufferingSourceNetwork,
+    BufferingSourceRealTime
+};
+
+/**
+ * Packet buffering policy: min / max buffer targets in time and bytes by source type, media bitrate and download throughput.
+ * Max targets stop packet reading, min target is buffered duration to finish a rebuffering.
+ * Rebuffering starts when a playing stream's packet queue underruns before eof.
+ */
+typedef struct tMediaBuffering {
+    std::mutex lock;
+    BufferingSourceType sourceType = BufferingSourceLocal;
+
+    // bits per second.
+    int64_t bitrate = 0;
+    // Download bytes per second, measured by network io layers (read ahead io and abr segment io).
+    int64_t throughput = 0;
+
+    int64_t minDurationInMillis = 0;
+    int64_t maxDurationInMillis = BUFFERING_LOCAL_MAX_DURATION_IN_MILLIS;
+    int64_t maxBytes = BUFFERING_LOCAL_MIN_BYTES;
+
+    int64_t bufferedDurationInMillis = 0;
+    int64_t bufferedBytes = 0;
+
+    // Buffered min duration since prepare or seek, underrun before it is startup buffering, not rebuffering.
+    bool startupFinished = false;
+    bool rebuffering = false;
+    int64_t rebufferStartInMillis = 0;
+    int64_t rebufferCount = 0;
+    int64_t rebufferTotalInMillis = 0;
+
+    void prepare(BufferingSourceType type, int64_t containerBitrate);
+
+    /**
+     * Called by network io layers with bytes read from source and time spent in the reads, may be called before prepare.
+     */
+    void onIORead(int64_t bytes, int64_t costInMicros);
+
+    /**
+     * Called by reader thread before reading packet.
+     * @param audioDuration -1 if no audio stream.
+     * @param videoDuration -1 if no video stream.
+     * @return BUFFERING_UPDATE_* flags.
+     */
+    int32_t update(int64_t audioDuration, int64_t videoDuration, int64_t bytes, bool eof);
+
+    /**
+     * Called by decoder threads when packet queue is empty while playing.
+     * @return true if new rebuffering started.
+     */
+    bool onUnderrun(bool eof);
+
+    void onSeek();
+
+    void computeTargets();
+
+    void exportTo(int64_t *dst);
+} tMediaBuffering;
+
+#endif //TMEDIAPLAYER_TMEDIABUFFERING_H
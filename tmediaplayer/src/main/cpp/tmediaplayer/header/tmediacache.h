@@ -0,0 +1,85 @@
+#ifndef TMEDIAPLAYER_TMEDIACACHE_H
+#define TMEDIAPLAYER_TMEDIACACHE_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include "tmediaio.h"
+
+extern "C" {
+#include "libavformat/avio.h"
+}
+
+#define CACHE_DEFAULT_MAX_SIZE (512LL * 1024 * 1024)
+#define CACHE_AVIO_BUFFER_SIZE (64 * 1024)
+// Save range index after these new cached bytes, lost ranges after crash are downloaded again.
+#define CACHE_INDEX_SAVE_INTERVAL_BYTES (4LL * 1024 * 1024)
+#define CACHE_INDEX_MAGIC 0x31434D54
+#define CACHE_DATA_FILE_SUFFIX ".data"
+#define CACHE_INDEX_FILE_SUFFIX ".index"
+// Locked while saving index, players of the same media merge their ranges.
+#define CACHE_LOCK_FILE_SUFFIX ".lock"
+
+/**
+ * Cache through AVIOContext for progressive http media.
+ * Fetched bytes are written to a sparse data file at the same offsets, cached ranges are recorded in an index file.
+ * Cached ranges are read from disk, only missing ranges are fetched from network.
+ * Cache files of all medias are evicted by last access time (index file mtime) under a global size cap.
+ * Players may open the same media: data file is flock shared by each of them, it is only truncated or deleted
+ * when exclusive lock succeeds, index saving merges ranges saved by others.
+ * Only used by one thread (demux thread or read ahead io thread).
+ */
+typedef struct tMediaCacheIO {
+    std::string url;
+    AVIOInterruptCB interruptCb = {nullptr, nullptr};
+    AVDictionary *upstreamOptions = nullptr;
+    // Opened when first cache miss, full cached media is played without network.
+    AVIOContext *upstream = nullptr;
+    int64_t upstreamPos = 0;
+
+    std::string cacheDir;
+    std::string key;
+    int64_t maxCacheSize = CACHE_DEFAULT_MAX_SIZE;
+    int dataFd = -1;
+    int64_t contentLength = -1;
+    // Cached ranges [start, end), sorted and merged.
+    std::map<int64_t, int64_t> ranges;
+    int64_t unsavedBytes = 0;
+    // Live or unknown length streams are not cached.
+    bool cacheEnabled = true;
+
+    int64_t position = 0;
+    AVIOContext *avio = nullptr;
+
+    int64_t hitBytes = 0;
+    int64_t missBytes = 0;
+
+    bool open(const char *url, const AVIOInterruptCB *cb, AVDictionary **options, const char *cacheDir, int64_t maxCacheSize);
+
+    int read(uint8_t *buf, int size);
+
+    int64_t seek(int64_t offset, int whence);
+
+    int openUpstream();
+
+    void addRange(int64_t start, int64_t end);
+
+    bool loadIndex();
+
+    void saveIndex();
+
+    /**
+     * Drop cached data.
+     * @return false if other players use the data file, it is kept and only ranges of this one are cleared.
+     */
+    bool resetCache();
+
+    void release();
+} tMediaCacheIO;
+
+/**
+ * Delete least recently used cache files until total size below maxCacheSize, medias in use are skipped.
+ */
+void evictMediaCache(const char *cacheDir, int64_t maxCacheSize);
+
+#endif //TMEDIAPLAYER_TMEDIACACHE_H
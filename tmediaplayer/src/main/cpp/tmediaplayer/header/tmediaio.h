@@ -0,0 +1,163 @@
+#ifndef TMEDIAPLAYER_TMEDIAIO_H
+#define TMEDIAPLAYER_TMEDIAIO_H
+
+#include <atomic>
+#include <cstdint>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "tmediabuffering.h"
+
+extern "C" {
+#include "libavformat/avio.h"
+}
+
+// Default buffered read size when mmap is not available, FFmpeg file protocol only reads 32KB once.
+#define LOCAL_IO_DEFAULT_BUFFER_SIZE (1024 * 1024)
+#define LOCAL_IO_MIN_BUFFER_SIZE (32 * 1024)
+// AVIOContext buffer size in mmap mode, data is copied from mapped memory.
+#define LOCAL_IO_MMAP_AVIO_BUFFER_SIZE (256 * 1024)
+// Ask kernel to read ahead this window in front of read position.
+#define LOCAL_IO_READ_AHEAD_WINDOW (8 * 1024 * 1024)
+// Avoid using out address space on 32 bits devices.
+#define LOCAL_IO_MAX_MMAP_SIZE_32BITS (512LL * 1024 * 1024)
+
+#define READ_AHEAD_DEFAULT_BUFFER_SIZE (16 * 1024 * 1024)
+#define READ_AHEAD_DEFAULT_LOW_WATERMARK (4 * 1024 * 1024)
+#define READ_AHEAD_DEFAULT_HIGH_WATERMARK (12 * 1024 * 1024)
+#define READ_AHEAD_MIN_BUFFER_SIZE (256 * 1024)
+// Max bytes of one network read.
+#define READ_AHEAD_CHUNK_SIZE (64 * 1024)
+#define READ_AHEAD_AVIO_BUFFER_SIZE (32 * 1024)
+// Demux thread checks interrupt callback in this interval while waiting data.
+#define READ_AHEAD_WAIT_INTERVAL_IN_MILLIS 20
+
+typedef struct tMediaIOStats {
+    int64_t bytesRead = 0;
+    int64_t readCount = 0;
+    // read / pread / posix_fadvise / madvise calls, or network source reads and seeks.
+    int64_t syscallCount = 0;
+    int64_t seekCount = 0;
+    // Time spent in read callback.
+    int64_t readCostInMicros = 0;
+    int64_t openTimeInMicros = 0;
+} tMediaIOStats;
+
+/**
+ * AVIOContext for local files, mmap whole file if possible, otherwise fallback to large buffered pread.
+ * Seeking only moves read position, no data re-read and no lseek.
+ * Only used by reader thread.
+ */
+typedef struct tMediaLocalIO {
+    int fd = -1;
+    int64_t fileSize = 0;
+    int64_t position = 0;
+
+    // mmap mode.
+    uint8_t *mapped = nullptr;
+    // Read ahead hinted end position.
+    int64_t readAheadEnd = 0;
+
+    // Buffered mode.
+    int32_t bufferSize = LOCAL_IO_DEFAULT_BUFFER_SIZE;
+
+    AVIOContext *avio = nullptr;
+
+    tMediaIOStats stats;
+
+    /**
+     * @param path local file path, "file:" prefix is allowed.
+     * @param enableMmap if false or mmap fail, use buffered read.
+     */
+    bool open(const char *path, int32_t bufferSize, bool enableMmap);
+
+    int read(uint8_t *buf, int size);
+
+    int64_t seek(int64_t offset, int whence);
+
+    void hintReadAhead();
+
+    /**
+     * Log throughput and syscalls per second.
+     */
+    void logStats() const;
+
+    void release();
+} tMediaLocalIO;
+
+/**
+ * AVIOContext for network streams, an io thread reads source ahead of demuxer into a ring buffer.
+ * IO thread stops filling when buffered bytes reach high watermark, and restarts when buffered bytes below low watermark.
+ * Read data is kept in ring buffer until overwritten, short backward and forward seeks are served from buffer.
+ */
+typedef struct tMediaReadAheadIO {
+    AVIOContext *source = nullptr;
+    // Source is opened by read ahead io, or external (e.g. cache io) which is released by owner.
+    bool ownSource = true;
+    AVIOInterruptCB interruptCb = {nullptr, nullptr};
+    int64_t sourceSize = -1;
+
+    uint8_t *ring = nullptr;
+    int64_t capacity = 0;
+    int64_t lowWatermark = 0;
+    int64_t highWatermark = 0;
+
+    std::mutex lock;
+    std::condition_variable readerCond;
+    std::condition_variable writerCond;
+    // Absolute byte offsets of source, valid data in ring is [validStart, writePos).
+    int64_t validStart = 0;
+    int64_t readPos = 0;
+    int64_t writePos = 0;
+    bool filling = true;
+    bool eof = false;
+    int error = 0;
+    // Seek which is out of buffered range, done by io thread.
+    int64_t seekTarget = 0;
+    int64_t seekRequestSerial = 0;
+    int64_t seekDoneSerial = 0;
+    int64_t seekResult = 0;
+    std::atomic<bool> stopped{false};
+    std::thread ioThread;
+
+    AVIOContext *avio = nullptr;
+
+    tMediaIOStats stats;
+
+    // Receives source read throughput, owned by player and released after io thread stopped.
+    tMediaBuffering *buffering = nullptr;
+
+    /**
+     * @param externalSource if not null, read ahead it instead of opening url.
+     */
+    bool open(const char *url, AVIOContext *externalSource, const AVIOInterruptCB *cb, AVDictionary **options, int64_t bufferSize, int64_t lowWatermark, int64_t highWatermark);
+
+    /**
+     * Interrupt callback for source, interrupted when read ahead io released or player interrupted.
+     */
+    AVIOInterruptCB sourceInterruptCallback();
+
+    int read(uint8_t *buf, int size);
+
+    int64_t seek(int64_t offset, int whence);
+
+    void ioLoop();
+
+    int64_t bufferedBytes();
+
+    bool isInterrupted() const;
+
+    void release();
+} tMediaReadAheadIO;
+
+/**
+ * Streams which read ahead is useful: http and https, except HLS playlists (segments are opened by demuxer itself).
+ */
+bool isReadAheadUrl(const char *url);
+
+/**
+ * If media url is a local file, return file path without "file:" prefix, otherwise return nullptr.
+ */
+const char * localFilePath(const char *url);
+
+#endif //TMEDIAPLAYER_TMEDIAIO_H
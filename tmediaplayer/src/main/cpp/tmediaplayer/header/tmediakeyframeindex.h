@@ -0,0 +1,68 @@
+#ifndef TMEDIAPLAYER_TMEDIAKEYFRAMEINDEX_H
+#define TMEDIAPLAYER_TMEDIAKEYFRAMEINDEX_H
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Audio only media all packets are keyframes, keep index small.
+#define KEYFRAME_INDEX_MIN_INTERVAL_IN_MILLIS 500L
+#define KEYFRAME_INDEX_MAX_SIZE 100000
+// Max pts distance of indexed keyframes around seek target to use byte seek, accurate seek decodes frames from the first one.
+#define KEYFRAME_INDEX_MAX_BYTE_SEEK_GAP_IN_MILLIS 20000L
+
+typedef struct KeyframeEntry {
+    int64_t pts = 0L;
+    // Byte position in file.
+    int64_t pos = -1L;
+    int32_t size = 0;
+} KeyframeEntry;
+
+// Pts range which all keyframes were read.
+typedef struct KeyframeRange {
+    int64_t start = 0L;
+    int64_t end = 0L;
+} KeyframeRange;
+
+/**
+ * Keyframes sorted by pts, copied from container index or collected by reading packets.
+ * Packets are read from seeking targets, so index has gaps, covered ranges record where no keyframe is missing.
+ * Written by reader thread, queried by player thread.
+ */
+typedef struct tMediaKeyframeIndex {
+    std::mutex lock;
+    std::vector<KeyframeEntry> entries;
+    // Sorted and not overlapped.
+    std::vector<KeyframeRange> coveredRanges;
+    // Last keyframe pts of current continuous reading, -1 after discontinuity.
+    int64_t runLastPts = -1L;
+
+    /**
+     * Keyframes must be added in reading order.
+     */
+    void add(int64_t pts, int64_t pos, int32_t size);
+
+    /**
+     * Packets are not read continuously (seeking), next keyframe starts a new covered range.
+     */
+    void onDiscontinuity();
+
+    /**
+     * @return true if all keyframes in [startPts, endPts] were read.
+     */
+    bool isCovered(int64_t startPts, int64_t endPts);
+
+    /**
+     * Last keyframe which pts <= target.
+     */
+    bool findBefore(int64_t pts, KeyframeEntry *out);
+
+    /**
+     * First keyframe which pts >= target.
+     */
+    bool findAfter(int64_t pts, KeyframeEntry *out);
+
+    int32_t size();
+} tMediaKeyframeIndex;
+
+#endif //TMEDIAPLAYER_TMEDIAKEYFRAMEINDEX_H
@@ -0,0 +1,89 @@
+#ifndef TMEDIAPLAYER_TMEDIALATEFRAME_H
+#define TMEDIAPLAYER_TMEDIALATEFRAME_H
+
+#include <atomic>
+#include <cstdint>
+
+extern "C" {
+#include "libavcodec/avcodec.h"
+}
+
+// Decoded frame older than master clock by this is dropped before converting to video buffer.
+#define LATE_FRAME_DROP_THRESHOLD_IN_MILLIS 40L
+// Keep some late frames, video doesn't freeze when every frame is late.
+#define LATE_FRAME_MAX_CONTINUOUS_DROPS 4
+// Renderer lateness over this is counted as behind.
+#define LATE_FRAME_BEHIND_THRESHOLD_IN_MILLIS 100L
+// Renderer lateness over this is counted as far behind.
+#define LATE_FRAME_FAR_BEHIND_THRESHOLD_IN_MILLIS 300L
+// Renderer lateness below this is counted as on time.
+#define LATE_FRAME_ON_TIME_THRESHOLD_IN_MILLIS 20L
+// Continuous behind reports to skip non reference frames.
+#define LATE_FRAME_NONREF_REPORTS 8
+// Continuous far behind reports to skip bidirectional frames.
+#define LATE_FRAME_BIDIR_REPORTS 24
+// Continuous on time reports to step back a stage.
+#define LATE_FRAME_RECOVER_REPORTS 30
+
+// Size of exported late frame stats: stage, dropped before convert, skipped at nonref and bidir stages.
+#define LATE_FRAME_STATS_EXPORT_SIZE 4
+
+enum LateFrameStage {
+    LateFrameStageNone,
+    // Decoder skips non reference frames.
+    LateFrameStageSkipNonRef,
+    // Decoder skips all bidirectional frames.
+    LateFrameStageSkipBidir
+};
+
+/**
+ * Video late frame policy, driven by renderer's lateness to master clock.
+ * Stage 0: decoded late frames are dropped before converting (sws scale / copy), the most expensive work after decoding.
+ * Stage 1 / 2: software decoder is persistently behind, skip decoding of frames no other frame depends on.
+ * Stage steps back after renderer is on time for a while.
+ * Lateness is reported by renderer thread, others are called by video decode thread.
+ */
+typedef struct tMediaLateFrame {
+    // Master clock in millis when renderer reported, -1 is unknown.
+    std::atomic<int64_t> masterClockInMillis{-1};
+    std::atomic<int32_t> stage{LateFrameStageNone};
+    // Renderer thread only.
+    int32_t behindReports = 0;
+    int32_t farBehindReports = 0;
+    int32_t onTimeReports = 0;
+
+    // Decode thread only.
+    int32_t continuousDrops = 0;
+    // Skipped frames are not reported by decoder, estimated by packets sent and frames received while stage is active.
+    int64_t stagePackets[3] = {0, 0, 0};
+    int64_t stageFrames[3] = {0, 0, 0};
+
+    std::atomic<int64_t> droppedBeforeConvert{0};
+    std::atomic<int64_t> skippedNonRef{0};
+    std::atomic<int64_t> skippedBidir{0};
+
+    /**
+     * @param latenessInMillis master clock - rendered frame pts, positive is late.
+     */
+    void reportLateness(int64_t masterClock, int64_t latenessInMillis);
+
+    /**
+     * Set decoder skip_frame by stage, called before sending packet.
+     */
+    void applyToDecoder(AVCodecContext *ctx, bool sendPacket);
+
+    /**
+     * Called when decoder output a frame.
+     * @return true if frame is late and should be dropped before converting.
+     */
+    bool onFrameDecoded(int64_t framePtsInMillis);
+
+    /**
+     * Seeking or track switching, clock is not valid until renderer reports again.
+     */
+    void reset();
+
+    void exportTo(int64_t *dst);
+} tMediaLateFrame;
+
+#endif //TMEDIAPLAYER_TMEDIALATEFRAME_H
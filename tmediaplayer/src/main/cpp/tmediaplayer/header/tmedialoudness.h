@@ -0,0 +1,91 @@
+#ifndef TMEDIAPLAYER_TMEDIALOUDNESS_H
+#define TMEDIAPLAYER_TMEDIALOUDNESS_H
+
+#include <cstdint>
+
+extern "C" {
+#include "libavutil/samplefmt.h"
+}
+
+// Output pcm is mono or stereo.
+#define LOUDNESS_MAX_CHANNELS 2
+// ReplayGain 2.0 reference level.
+#define LOUDNESS_TARGET_LUFS (-18.0)
+#define LOUDNESS_MAX_GAIN_DB 12.0
+#define LOUDNESS_MIN_GAIN_DB (-24.0)
+// Gain moves to target gain in seconds, avoid pumping.
+#define LOUDNESS_GAIN_SMOOTH_SECONDS 3.0
+// Gating block is 400ms with 75% overlap, measured by 100ms sub blocks.
+#define LOUDNESS_SUB_BLOCKS_PER_BLOCK 4
+// Need measure 1s at least before changing gain.
+#define LOUDNESS_MIN_BLOCKS 10
+// Gated blocks histogram, -70 LUFS ~ +5 LUFS, 0.1 LU per bin.
+#define LOUDNESS_HISTOGRAM_MIN_LUFS (-70.0)
+#define LOUDNESS_HISTOGRAM_BIN_LU 0.1
+#define LOUDNESS_HISTOGRAM_SIZE 750
+
+typedef struct KWeightingFilter {
+    // Stage 1 high shelf, stage 2 high pass.
+    float b1[3] = {1.0f, 0.0f, 0.0f};
+    float a1[3] = {1.0f, 0.0f, 0.0f};
+    float b2[3] = {1.0f, 0.0f, 0.0f};
+    float a2[3] = {1.0f, 0.0f, 0.0f};
+    // Transposed direct form II states.
+    float z1[LOUDNESS_MAX_CHANNELS][2] = {};
+    float z2[LOUDNESS_MAX_CHANNELS][2] = {};
+} KWeightingFilter;
+
+/**
+ * Loudness normalization for decoded pcm, use ReplayGain / R128 tags if media contains,
+ * otherwise measure EBU R128 integrated loudness incrementally while playing.
+ * Measurement and gain are done in one pass over the pcm buffer.
+ */
+typedef struct tMediaLoudness {
+    int32_t sampleRate = 48000;
+    int32_t channels = 2;
+    AVSampleFormat sampleFmt = AV_SAMPLE_FMT_S16;
+
+    bool hasTagGain = false;
+    double tagGainDb = 0.0;
+
+    KWeightingFilter kWeighting;
+
+    // Sub block accumulation.
+    int32_t subBlockSamples = 4800;
+    int32_t subBlockFill = 0;
+    double subBlockEnergy = 0.0;
+    double subBlockEnergies[LOUDNESS_SUB_BLOCKS_PER_BLOCK] = {};
+    int32_t subBlockCount = 0;
+
+    // Gating.
+    uint32_t histogram[LOUDNESS_HISTOGRAM_SIZE] = {};
+    int64_t blockCount = 0;
+    double integratedLufs = LOUDNESS_HISTOGRAM_MIN_LUFS;
+
+    float currentGain = 1.0f;
+
+    void prepare(int32_t sampleRate, int32_t channels, AVSampleFormat sampleFmt);
+
+    /**
+     * Media changed, clear measurement and tag gain.
+     */
+    void reset();
+
+    /**
+     * Gain in dB to reach LOUDNESS_TARGET_LUFS, read from ReplayGain or R128 tags.
+     */
+    void setTagGain(double gainDb);
+
+    /**
+     * Measure and apply gain in place, pcm is packed.
+     * @param enabled if false, gain goes back to unity and skip measure.
+     */
+    void process(uint8_t *pcm, int32_t nbSamples, bool enabled);
+
+    double getTargetGainDb() const;
+
+    void finishSubBlock();
+
+} tMediaLoudness;
+
+#endif //TMEDIAPLAYER_TMEDIALOUDNESS_H
@@ -0,0 +1,59 @@
+#ifndef TMEDIAPLAYER_TMEDIAMEMORY_H
+#define TMEDIAPLAYER_TMEDIAMEMORY_H
+
+#include <atomic>
+#include <cstdint>
+
+// Packet bytes limit of a player under memory budget, keep playing smoothly even if budget is exhausted.
+#define MEMORY_BUDGET_MIN_PACKET_BYTES (2LL * 1024 * 1024)
+
+enum tMediaMemoryType {
+    // Packets in packet queues.
+    MemoryPacket,
+    // Planes of tMediaVideoBuffer.
+    MemoryVideoBuffer,
+    // Pcm of tMediaAudioBuffer.
+    MemoryAudioBuffer,
+    // Rgba canvas of subtitle buffer.
+    MemorySubtitleBuffer
+};
+#define MEMORY_TYPE_COUNT 4
+
+// Size of exported memory stats: player bytes of each type, process bytes of each type and process budget.
+#define MEMORY_STATS_EXPORT_SIZE (MEMORY_TYPE_COUNT * 2 + 1)
+
+/**
+ * Bytes held by one player's buffers, owned by java player and outlive native players and buffers.
+ * Every change is added to process-wide totals too, lock free.
+ */
+typedef struct tMediaMemoryTracker {
+    std::atomic<int64_t> bytes[MEMORY_TYPE_COUNT]{};
+
+    void add(tMediaMemoryType type, int64_t delta);
+
+    void set(tMediaMemoryType type, int64_t value);
+
+    void exportTo(int64_t *dst) const;
+
+    /**
+     * Remove bytes still tracked from process-wide totals.
+     */
+    void release();
+} tMediaMemoryTracker;
+
+int64_t getProcessMemoryBytes();
+
+/**
+ * @param budget process-wide bytes of all players' buffers, 0 is unlimited.
+ */
+void setProcessMemoryBudget(int64_t budget);
+
+int64_t getProcessMemoryBudget();
+
+/**
+ * Packet bytes a player could hold: current packet bytes plus left budget (negative if over budget),
+ * INT64_MAX if no budget.
+ */
+int64_t getPacketMemoryLimit(int64_t packetBytes);
+
+#endif //TMEDIAPLAYER_TMEDIAMEMORY_H
@@ -7,6 +7,17 @@
 
 #include <android/log.h>
 #include <jni.h>
+#include <atomic>
+#include <vector>
+#include "tmediastats.h"
+#include "tmediamemory.h"
+#include "tmedialoudness.h"
+#include "tmediakeyframeindex.h"
+#include "tmediaio.h"
+#include "tmediacache.h"
+#include "tmediabuffering.h"
+#include "tmediaabr.h"
+#include "tmedialateframe.h"
 
 extern "C" {
 #include <android/native_window_jni.h>
@@ -17,7 +28,13 @@ extern "C" {
 #include "libavutil/imgutils.h"
 #include "libswresample/swresample.h"
 #include "libavcodec/mediacodec.h"
+#include "libavcodec/jni.h"
 #include "libavutil/display.h"
+#include "libavutil/replaygain.h"
+#include "libavutil/time.h"
+#include "libavfilter/avfilter.h"
+#include "libavfilter/buffersrc.h"
+#include "libavfilter/buffersink.h"
 }
 
 #define LOG_TAG "tMediaPlayerNative"
@@ -25,6 +42,24 @@ extern "C" {
 #define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
 
 #define YUV_ALIGN_SIZE 8
+// Max frames drained from decoder after sending a packet.
+#define DECODED_FRAME_QUEUE_SIZE 8
+// Size of exported decode stats: decode calls and received frames of video and audio, audio pcm output bytes, copied bytes and their duration.
+#define DECODE_STATS_EXPORT_SIZE 7
+// Size of exported packet info: stream index, bytes size, duration and pts.
+#define PACKET_INFO_EXPORT_SIZE 4
+// Size of exported video frame info: pts, duration, type, width, height, display rotation, display ratio bits and content size of rgba, y, u, v, uv.
+#define VIDEO_FRAME_INFO_EXPORT_SIZE 12
+// Size of exported audio frame info: pts, duration and content size.
+#define AUDIO_FRAME_INFO_EXPORT_SIZE 3
+// Only downscale to output size when frame is reduced below this ratio, small downscale costs more than it saves.
+#define VIDEO_OUTPUT_MAX_SCALE_RATIO 0.75
+
+// Live low latency.
+#define LIVE_PROBE_SIZE 32768
+#define LIVE_MAX_ANALYZE_DURATION (AV_TIME_BASE / 2)
+// Max packets reorder delay in micros.
+#define LIVE_MAX_DELAY "100000"
 
 enum ImageRawType {
     Yuv420p,
@@ -58,6 +93,12 @@ typedef struct tMediaVideoBuffer {
     int64_t duration = 0L;
     int32_t displayRotation = 0;
     float_t displayRatio = 0.0f;
+    // Tracker of player which last wrote this buffer, nullable.
+    tMediaMemoryTracker *memoryTracker = nullptr;
+
+    void exportInfo(int64_t *dst) const;
+
+    int64_t allocatedBytes() const;
 } tMediaVideoBuffer;
 
 typedef struct tMediaAudioBuffer {
@@ -66,6 +107,10 @@ typedef struct tMediaAudioBuffer {
     uint8_t  *pcmBuffer = nullptr;
     int64_t pts = 0L;
     int64_t duration = 0L;
+    // Tracker of player which last wrote this buffer, nullable.
+    tMediaMemoryTracker *memoryTracker = nullptr;
+
+    void exportInfo(int64_t *dst) const;
 } tMediaAudioBuffer;
 
 enum tMediaDecodeResult {
@@ -101,6 +146,80 @@ typedef struct SubtitleStream {
     Metadata streamMetadata;
 } SubtitleStream;
 
+typedef struct MediaTrack {
+    AVStream *stream = nullptr;
+    Metadata streamMetadata;
+} MediaTrack;
+
+/**
+ * Demuxer seeks back to current position when switching track, packets of other streams already read are dropped.
+ * Reader thread only.
+ */
+typedef struct TrackSwitchFilter {
+    // Raw dts of each stream.
+    std::vector<int64_t> lastReadDts;
+    std::vector<int64_t> skipUntilDts;
+
+    /**
+     * @return false if packet has been read before track switching.
+     */
+    bool filterPacket(AVPacket *pkt);
+
+    void onSwitch(int switchedStreamIndex);
+} TrackSwitchFilter;
+
+/**
+ * Frames received from decoder but not output yet. Decoder is drained after each packet sent,
+ * packets producing multiple frames (audio, frame threading) don't need a send / receive round trip for each frame.
+ * Decoder thread only, except stats.
+ */
+typedef struct DecodedFrameQueue {
+    AVFrame *frames[DECODED_FRAME_QUEUE_SIZE] = {};
+    int32_t head = 0;
+    int32_t count = 0;
+    // Decode calls from java and frames received from decoder.
+    std::atomic<int64_t> decodeCalls{0};
+    std::atomic<int64_t> receivedFrames{0};
+
+    bool isFull() const;
+
+    bool isEmpty() const;
+
+    /**
+     * Frame to receive into, allocated lazily.
+     */
+    AVFrame *writable();
+
+    void commitWritable();
+
+    /**
+     * Move first queued frame to dst.
+     * @return false if queue is empty.
+     */
+    bool pop(AVFrame *dst);
+
+    void flush();
+
+    void release();
+} DecodedFrameQueue;
+
+/**
+ * Accurate seek: decode from the key frame before target and drop frames before target.
+ */
+typedef struct AccurateSeek {
+    // Write by reader thread when seek success, -1 is not accurate seek.
+    std::atomic<int64_t> pendingTargetPts{-1};
+    std::atomic<int64_t> pendingSeekTimeInMicros{0};
+    // Decoder thread only, active after decoder flushed by new serial packets.
+    int64_t targetPts = -1;
+    int64_t seekTimeInMicros = 0;
+    int32_t droppedFrames = 0;
+    int64_t decodeCostInMicros = 0;
+    // Decoder's skip settings before accurate seek, set by late frame dropping or live mode, restored after seek.
+    AVDiscard savedSkipFrame = AVDISCARD_DEFAULT;
+    AVDiscard savedSkipLoopFilter = AVDISCARD_DEFAULT;
+} AccurateSeek;
+
 typedef struct VideoDecoder {
     const AVCodec *video_decoder = nullptr;
     char *videoDecoderName = nullptr;
@@ -110,8 +229,43 @@ typedef struct VideoDecoder {
     ANativeWindow *hw_native_window = nullptr;
     SwsContext * video_sws_ctx = nullptr;
     AVPixelFormat video_pixel_format = AV_PIX_FMT_NONE;
+    // MediaCodec output format, chosen by get_format callback.
+    AVPixelFormat hw_pix_fmt = AV_PIX_FMT_NONE;
     AVPacket *video_pkt = nullptr;
     AVFrame *video_frame = nullptr;
+    DecodedFrameQueue decoded_frames;
+    AccurateSeek accurate_seek;
+    // Scrub preview: only decode keyframes. Write by player thread, read by decode thread.
+    std::atomic<bool> requested_scrub{false};
+    bool scrub_active = false;
+    // Decoder drained by last scrub keyframe, flushed before next decode: flushing right after receiving
+    // invalidates MediaCodec output buffer before it is rendered.
+    bool scrub_drained = false;
+    // Live: late packets dropped before decoding.
+    int64_t live_dropped_packets = 0;
+    // Drop late frames before converting, skip decoding when persistently behind.
+    tMediaLateFrame late_frame;
+    // Render surface size, frames are downscaled to it when converting. Write by player thread, read by decode thread.
+    std::atomic<int32_t> output_width{0};
+    std::atomic<int32_t> output_height{0};
+    // Surface is covered by frame (center crop), otherwise frame fits in surface.
+    std::atomic<bool> output_crop{false};
+    // Sws ctx is recreated when any of them changed.
+    int32_t sws_src_width = 0;
+    int32_t sws_src_height = 0;
+    int32_t sws_src_format = AV_PIX_FMT_NONE;
+    int32_t sws_dst_width = 0;
+    int32_t sws_dst_height = 0;
+    // Open params, MediaCodec decoder is reopened when abr variant has new extradata.
+    bool request_hw = false;
+    bool low_delay = false;
+    // Global ref.
+    jobject hw_surface = nullptr;
+    // Decoding stream, changed by track switching.
+    int stream_index = -1;
+    AVRational time_base = {0, 1};
+    // Params of new track, write by reader thread, read by decode thread when first packet of new track arrives.
+    std::atomic<AVCodecParameters *> requested_params{nullptr};
 } VideoDecoder;
 
 typedef struct AudioDecoder {
@@ -125,6 +279,46 @@ typedef struct AudioDecoder {
     int32_t audio_output_channels = 2;
     AVPacket *audio_pkt = nullptr;
     AVFrame *audio_frame = nullptr;
+    DecodedFrameQueue decoded_frames;
+    AccurateSeek accurate_seek;
+    // Scrub preview: skip audio decode.
+    std::atomic<bool> requested_scrub{false};
+
+    // Time stretch: abuffer -> atempo -> abuffersink, only created when tempo is not 1.0
+    // A graph never changes tempo, tempo change drains the old graph and creates a new one, so output maps to media time exactly.
+    AVFilterGraph *tempo_graph = nullptr;
+    AVFilterContext *tempo_src_ctx = nullptr;
+    AVFilterContext *tempo_filter_ctx = nullptr;
+    AVFilterContext *tempo_sink_ctx = nullptr;
+    // Reused filter input, samples of its buffer.
+    AVFrame *tempo_in_frame = nullptr;
+    int32_t tempo_in_capacity = 0;
+    // Filter outputs of one drain, pcm buffer is sized once for all of them.
+    std::vector<AVFrame *> tempo_out_frames;
+    // Media pts of graph's first input in 1 / audio_output_sample_rate, filter input pts continue from it.
+    int64_t tempo_start_pts = AV_NOPTS_VALUE;
+    int64_t tempo_in_samples = 0;
+    // Media pts (millis) of next tempo filter output sample.
+    double tempo_next_pts = -1.0;
+    double tempo = 1.0;
+    // Write by player thread, read by decode thread.
+    std::atomic<double> requested_tempo{1.0};
+
+    // Loudness normalization after swr convert.
+    tMediaLoudness loudness;
+    std::atomic<bool> requested_normalization{false};
+
+    // Swr writes pcm to audio buffers once and sink consumes them in place, only tempo filter output is copied.
+    std::atomic<int64_t> pcm_output_bytes{0};
+    std::atomic<int64_t> pcm_copied_bytes{0};
+    int64_t pcm_stats_start_in_micros = 0;
+
+    bool low_delay = false;
+    // Decoding stream, changed by track switching.
+    int stream_index = -1;
+    AVRational time_base = {0, 1};
+    // Params of new track, write by reader thread, read by decode thread when first packet of new track arrives.
+    std::atomic<AVCodecParameters *> requested_params{nullptr};
 } AudioDecoder;
 
 typedef struct tMediaPlayerContext {
@@ -133,11 +327,45 @@ typedef struct tMediaPlayerContext {
      */
     AVFormatContext *format_ctx = nullptr;
     bool isRealTime = false;
+    // Live low latency mode: demuxer no buffer, minimal probe, low delay decoders and drop late frames.
+    bool requestLowLatency = true;
+    bool lowLatency = false;
     bool interruptReadPkt = false;
     int64_t startTime = -1L;
     int64_t duration = -1L;
     char *containerName = nullptr;
     Metadata *fileMetadata = nullptr;
+    // Keyframes of video stream (or audio stream if no video).
+    AVStream *keyframe_index_stream = nullptr;
+    tMediaKeyframeIndex *keyframeIndex = nullptr;
+    bool containerHasKeyframeIndex = false;
+    // Custom io for local files.
+    tMediaLocalIO *localIO = nullptr;
+    int32_t localIOBufferSize = LOCAL_IO_DEFAULT_BUFFER_SIZE;
+    bool localIOMmap = true;
+    // Read ahead io for network streams.
+    tMediaReadAheadIO *readAheadIO = nullptr;
+    int64_t readAheadBufferSize = READ_AHEAD_DEFAULT_BUFFER_SIZE;
+    int64_t readAheadLowWatermark = READ_AHEAD_DEFAULT_LOW_WATERMARK;
+    int64_t readAheadHighWatermark = READ_AHEAD_DEFAULT_HIGH_WATERMARK;
+    // Disk cache for progressive http medias, disabled if cacheDir is null.
+    tMediaCacheIO *cacheIO = nullptr;
+    char *cacheDir = nullptr;
+    int64_t maxCacheSize = CACHE_DEFAULT_MAX_SIZE;
+    // Packet buffering policy.
+    tMediaBuffering *buffering = nullptr;
+    // Adaptive bitrate for hls / dash medias with multiple variants.
+    tMediaAbr *abr = nullptr;
+    bool requestAbr = true;
+    TrackSwitchFilter *trackSwitchFilter = nullptr;
+    // Player stats, owned by java player and outlive this context, nullable.
+    tMediaPlayerStats *stats = nullptr;
+    // Player memory tracker, owned by java player and outlive this context, nullable.
+    tMediaMemoryTracker *memoryTracker = nullptr;
+    // Video output size, 0 is decoded size.
+    int32_t videoOutputWidth = 0;
+    int32_t videoOutputHeight = 0;
+    bool videoOutputCrop = false;
     // buffer
     AVPacket *pkt = nullptr;
 
@@ -166,6 +394,10 @@ typedef struct tMediaPlayerContext {
     // Video decoder
     VideoDecoder *videoDecoder = nullptr;
     bool requestHwVideoDecoder = false;
+    // All video streams, except attached pictures, inactive streams are discarded.
+    int videoTrackCount = 0;
+    MediaTrack **videoTracks = nullptr;
+    std::atomic<int32_t> selectedVideoStreamIndex{-1};
 
     /**
      * Audio
@@ -184,6 +416,10 @@ typedef struct tMediaPlayerContext {
     Metadata *audioMetadata = nullptr;
     // Audio decoder
     AudioDecoder *audioDecoder = nullptr;
+    // All audio streams, inactive streams are discarded.
+    int audioTrackCount = 0;
+    MediaTrack **audioTracks = nullptr;
+    std::atomic<int32_t> selectedAudioStreamIndex{-1};
 
     /**
      * Subtitle
@@ -199,30 +435,164 @@ typedef struct tMediaPlayerContext {
             int target_audio_sample_rate,
             int target_audio_sample_bit_depth);
 
+    /**
+     * Open media file and read streams info, don't create decoders.
+     */
+    tMediaOptResult openMedia(const char * media_file);
+
+    /**
+     * Must be called before openMedia.
+     */
+    void setLocalIOConfig(int32_t bufferSize, bool enableMmap);
+
+    /**
+     * Must be called before openMedia, bufferSize <= 0 disables read ahead.
+     */
+    void setReadAheadConfig(int64_t bufferSize, int64_t lowWatermark, int64_t highWatermark);
+
+    /**
+     * Must be called before openMedia, cacheDir null disables cache.
+     */
+    void setCacheConfig(const char *cacheDir, int64_t maxCacheSize);
+
+    /**
+     * Must be called before openMedia, live low latency mode for rtsp / rtp / udp / srt streams.
+     */
+    void setLowLatency(bool enable);
+
+    /**
+     * Glass to glass latency of the playing pts, needs stream wall clock (RTCP), -1 if unknown.
+     */
+    int64_t getLiveLatency(int64_t playPtsInMillis) const;
+
+    /**
+     * Must be called before openMedia.
+     */
+    void setAbrConfig(bool enable);
+
+    /**
+     * @return false if media has no abr variants.
+     */
+    bool exportAbrStats(int64_t *dst) const;
+
+    /**
+     * Bytes read ahead by network io thread and not consumed by demuxer, -1 if no read ahead io.
+     */
+    int64_t getReadAheadBufferedBytes() const;
+
+    /**
+     * Estimated by container bitrate, -1 if unknown.
+     */
+    int64_t getReadAheadBufferedDuration() const;
+
+    /**
+     * @return BUFFERING_UPDATE_* flags.
+     */
+    int32_t updateBuffering(int64_t audioDuration, int64_t videoDuration, int64_t bytes, bool eof) const;
+
+    /**
+     * @return true if new rebuffering started.
+     */
+    bool bufferingUnderrun(bool eof) const;
+
+    void exportBufferingStats(int64_t *dst) const;
+
+    /**
+     * Open media and decoders while current media is playing, switching only moves them to player.
+     */
+    tMediaOptResult prepareNext(
+            const char *media_file_p,
+            bool is_request_hw,
+            jobject hwSurface,
+            int target_audio_channels,
+            int target_audio_sample_rate,
+            int target_audio_sample_bit_depth);
+
+    /**
+     * Create decoders, decoders opened by prepareNext are used, else if previous not null, reuse previous decoders when codec params match.
+     */
+    tMediaOptResult prepareDecoders(
+            tMediaPlayerContext *previous,
+            bool is_request_hw,
+            jobject hwSurface,
+            int target_audio_channels,
+            int target_audio_sample_rate,
+            int target_audio_sample_bit_depth);
+
     tMediaReadPktResult readPacket() const;
 
+    /**
+     * @return keyframe pts in millis, -1 if not found.
+     */
+    int64_t findNearestKeyframe(int64_t targetPosInMillis, bool before) const;
+
     tMediaOptResult pauseReadPacket() const;
 
     tMediaOptResult resumeReadPacket() const;
 
     void movePacketRef(AVPacket *target) const;
 
-    tMediaOptResult seekTo(int64_t targetPosInMillis) const;
+    /**
+     * Switch active audio or video stream, called by reader thread.
+     * Demuxer seeks to position, decoder of switched stream drops frames before position, other streams are not affected.
+     */
+    tMediaOptResult selectTrack(int32_t streamIndex, int64_t positionInMillis);
+
+    /**
+     * @param accurate if true, decoders drop frames before target after seek to key frame.
+     */
+    tMediaOptResult seekTo(int64_t targetPosInMillis, bool accurate) const;
+
+    /**
+     * @param late live mode only, packet is late to play, drop it or skip non reference frames.
+     */
+    tMediaDecodeResult decodeVideo(AVPacket *targetPkt, bool late) const;
+
+    /**
+     * Called by video renderer after a frame rendered.
+     * @param latenessInMillis master clock - rendered frame pts.
+     */
+    void reportVideoLateness(int64_t masterClockInMillis, int64_t latenessInMillis) const;
+
+    void exportLateFrameStats(int64_t *dst) const;
 
-    tMediaDecodeResult decodeVideo(AVPacket *targetPkt) const;
+    void exportDecodeStats(int64_t *dst) const;
 
     tMediaOptResult moveDecodedVideoFrameToBuffer(tMediaVideoBuffer* buffer);
 
+    tMediaOptResult convertVideoFrame(tMediaVideoBuffer* buffer);
+
     void flushVideoCodecBuffer() const;
 
     tMediaDecodeResult decodeAudio(AVPacket *targetPkt) const;
 
     tMediaOptResult moveDecodedAudioFrameToBuffer(tMediaAudioBuffer* buffer) const;
 
+    tMediaOptResult convertAudioFrame(tMediaAudioBuffer* buffer) const;
+
     void flushAudioCodecBuffer() const;
 
+    void setAudioTempo(double tempo) const;
+
+    /**
+     * Render surface size, decoded frames bigger than it are downscaled when converting.
+     * @param crop surface is covered by frame, otherwise frame fits in surface.
+     */
+    void setVideoOutputSize(int32_t width, int32_t height, bool crop);
+
+    void setAudioNormalization(bool enable) const;
+
+    /**
+     * Scrub preview mode, video decoder only decodes keyframes and outputs them immediately, audio is not decoded.
+     */
+    void setScrubMode(bool enable) const;
+
     void requestInterruptReadPkt();
 
+    void increaseStats(tMediaStatsCounterType type, int64_t count = 1) const;
+
+    void recordStats(tMediaStatsHistogramType type, int64_t value) const;
+
     void release();
 } tMediaPlayerContext;
 
@@ -0,0 +1,101 @@
+#ifndef TMEDIAPLAYER_TMEDIASTATS_H
+#define TMEDIAPLAYER_TMEDIASTATS_H
+
+#include <atomic>
+#include <cstdint>
+
+// Bucket 0 holds value 0, bucket n holds [2^(n-1), 2^n), last bucket holds all bigger values.
+#define STATS_HISTOGRAM_BUCKET_COUNT 20
+// sampleCount, sampleSum, maxValue and buckets.
+#define STATS_HISTOGRAM_EXPORT_SIZE (3 + STATS_HISTOGRAM_BUCKET_COUNT)
+
+typedef struct tMediaHistogram {
+    std::atomic<int64_t> sampleCount{0};
+    std::atomic<int64_t> sampleSum{0};
+    std::atomic<int64_t> maxValue{0};
+    std::atomic<int64_t> buckets[STATS_HISTOGRAM_BUCKET_COUNT]{};
+
+    /**
+     * Record a sample, negative value use its absolute value.
+     * Lock free, could be called from any thread.
+     */
+    void record(int64_t value);
+
+    void reset();
+
+    /**
+     * Write values to dst, dst size must be STATS_HISTOGRAM_EXPORT_SIZE.
+     */
+    void exportTo(int64_t *dst) const;
+} tMediaHistogram;
+
+enum tMediaStatsHistogramType {
+    // |video pts - master clock| in millis when video frame rendered.
+    StatsSyncError,
+    // Millis from seek request to first video frame displayed.
+    StatsSeekLatency,
+    // Micros of av_read_frame().
+    StatsDemuxReadTime,
+    // Packet queues bytes in KB, recorded before reading packet.
+    StatsPacketQueueBytes,
+    // Packet queues buffered duration in millis, recorded before reading packet.
+    StatsPacketQueueDuration,
+    // Micros of decoding a frame.
+    StatsVideoDecodeTime,
+    StatsAudioDecodeTime,
+    // Micros of moving decoded frame to java buffer, include scaling, resampling and time stretch.
+    StatsVideoConvertTime,
+    StatsAudioConvertTime,
+    // Accurate seek breakdown, recorded by video and audio decoders when their first frame at target decoded.
+    // Frames decoded and dropped before target.
+    StatsAccurateSeekDroppedFrames,
+    // Micros of decoding frames before target.
+    StatsAccurateSeekDecodeTime,
+    // Micros from seek request to first frame at target.
+    StatsAccurateSeekFirstFrameTime
+};
+#define STATS_HISTOGRAM_TYPE_COUNT 12
+
+enum tMediaStatsCounterType {
+    // Frames dropped by decoder because video is late, include packets dropped before decoding.
+    StatsDropDecodeLate,
+    // Frames before accurate seek target.
+    StatsDropAccurateSeek,
+    // Frames dropped by video renderer because they are out of date.
+    StatsDropRenderLate,
+    // Frames gl renderer can't render: bad frame, surface not ready or replaced by newer frame.
+    StatsDropRenderFail,
+    // Frames of old serial skipped by renderers after seeking or switching media.
+    StatsDropSerialChanged,
+    // Audio renderer has no frame to render while playing.
+    StatsAudioUnderrun,
+    // Pixel / pcm buffers allocated or grown.
+    StatsVideoBufferAlloc,
+    StatsAudioBufferAlloc
+};
+#define STATS_COUNTER_TYPE_COUNT 8
+
+// Size of exported player stats: counters, then histograms.
+#define PLAYER_STATS_EXPORT_SIZE (STATS_COUNTER_TYPE_COUNT + STATS_HISTOGRAM_TYPE_COUNT * STATS_HISTOGRAM_EXPORT_SIZE)
+
+/**
+ * Player health stats, owned by java player and live across medias, native players record to it directly.
+ * Lock free, cheap enough to always record.
+ */
+typedef struct tMediaPlayerStats {
+    std::atomic<int64_t> counters[STATS_COUNTER_TYPE_COUNT]{};
+    tMediaHistogram histograms[STATS_HISTOGRAM_TYPE_COUNT];
+
+    void increase(tMediaStatsCounterType type, int64_t count = 1);
+
+    void record(tMediaStatsHistogramType type, int64_t value);
+
+    void reset();
+
+    /**
+     * Write values to dst, dst size must be PLAYER_STATS_EXPORT_SIZE.
+     */
+    void exportTo(int64_t *dst) const;
+} tMediaPlayerStats;
+
+#endif //TMEDIAPLAYER_TMEDIASTATS_H
@@ -10,14 +10,203 @@ extern "C" {
 extern "C" JNIEXPORT jlong JNICALL
 Java_com_tans_tmediaplayer_player_tMediaPlayer_createPlayerNative(
         JNIEnv * env,
-        jobject j_player) {
+        jobject j_player,
+        jlong native_stats,
+        jlong native_memory_tracker) {
     JavaVM * jvm = nullptr;
     env->GetJavaVM(&jvm);
     auto player = new tMediaPlayerContext;
     player->jvm = jvm;
+    player->stats = reinterpret_cast<tMediaPlayerStats *>(native_stats);
+    player->memoryTracker = reinterpret_cast<tMediaMemoryTracker *>(native_memory_tracker);
     return reinterpret_cast<jlong>(player);
 }
 
+extern "C" JNIEXPORT void JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_setLocalIOConfigNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong native_player,
+        jint buffer_size,
+        jboolean enable_mmap) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    player->setLocalIOConfig(buffer_size, enable_mmap);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_setReadAheadConfigNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong native_player,
+        jlong buffer_size,
+        jlong low_watermark,
+        jlong high_watermark) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    player->setReadAheadConfig(buffer_size, low_watermark, high_watermark);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_setCacheConfigNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong native_player,
+        jstring cache_dir,
+        jlong max_cache_size) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    if (cache_dir == nullptr) {
+        player->setCacheConfig(nullptr, max_cache_size);
+    } else {
+        const char * cache_dir_chars = env->GetStringUTFChars(cache_dir, JNI_FALSE);
+        player->setCacheConfig(cache_dir_chars, max_cache_size);
+        env->ReleaseStringUTFChars(cache_dir, cache_dir_chars);
+    }
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_getReadAheadBufferedBytesNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong native_player) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    return player->getReadAheadBufferedBytes();
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_getReadAheadBufferedDurationNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong native_player) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    return player->getReadAheadBufferedDuration();
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_updateBufferingNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong native_player,
+        jlong audio_duration,
+        jlong video_duration,
+        jlong bytes,
+        jboolean eof) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    return player->updateBuffering(audio_duration, video_duration, bytes, eof);
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_bufferingUnderrunNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong native_player,
+        jboolean eof) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    return player->bufferingUnderrun(eof);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_getBufferingStatsNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong native_player,
+        jlongArray j_values) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    int64_t values[BUFFERING_STATS_EXPORT_SIZE] = {};
+    player->exportBufferingStats(values);
+    env->SetLongArrayRegion(j_values, 0, BUFFERING_STATS_EXPORT_SIZE, reinterpret_cast<const jlong *>(values));
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_setVideoOutputSizeNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong native_player,
+        jint width,
+        jint height,
+        jboolean crop) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    player->setVideoOutputSize(width, height, crop);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_reportVideoLatenessNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong native_player,
+        jlong master_clock_in_millis,
+        jlong lateness_in_millis) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    player->reportVideoLateness(master_clock_in_millis, lateness_in_millis);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_getLateFrameStatsNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong native_player,
+        jlongArray j_values) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    int64_t values[LATE_FRAME_STATS_EXPORT_SIZE] = {};
+    player->exportLateFrameStats(values);
+    env->SetLongArrayRegion(j_values, 0, LATE_FRAME_STATS_EXPORT_SIZE, reinterpret_cast<const jlong *>(values));
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_getDecodeStatsNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong native_player,
+        jlongArray j_values) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    int64_t values[DECODE_STATS_EXPORT_SIZE] = {};
+    player->exportDecodeStats(values);
+    env->SetLongArrayRegion(j_values, 0, DECODE_STATS_EXPORT_SIZE, reinterpret_cast<const jlong *>(values));
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_setAbrConfigNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong native_player,
+        jboolean enable) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    player->setAbrConfig(enable);
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_getAbrStatsNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong native_player,
+        jlongArray j_values) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    int64_t values[ABR_STATS_EXPORT_SIZE] = {};
+    if (!player->exportAbrStats(values)) {
+        return false;
+    }
+    env->SetLongArrayRegion(j_values, 0, ABR_STATS_EXPORT_SIZE, reinterpret_cast<const jlong *>(values));
+    return true;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_setLowLatencyNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong native_player,
+        jboolean enable) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    player->setLowLatency(enable);
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_getLiveLatencyNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong native_player,
+        jlong play_pts) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    return player->getLiveLatency(play_pts);
+}
+
 extern "C" JNIEXPORT jint JNICALL
 Java_com_tans_tmediaplayer_player_tMediaPlayer_prepareNative(
         JNIEnv * env,
@@ -42,6 +231,50 @@ Java_com_tans_tmediaplayer_player_tMediaPlayer_prepareNative(
     return result;
 }
 
+extern "C" JNIEXPORT jint JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_prepareNextNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong native_player,
+        jstring file_path,
+        jboolean requestHw,
+        jobject hwSurface,
+        jint targetAudioChannels,
+        jint targetAudioSampleRate,
+        jint targetAudioSampleBitDepth) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    if (player == nullptr) {
+        return OptFail;
+    }
+    av_jni_set_java_vm(player->jvm, nullptr);
+    const char * file_path_chars = env->GetStringUTFChars(file_path, JNI_FALSE);
+    auto result = player->prepareNext(file_path_chars, requestHw, hwSurface, targetAudioChannels, targetAudioSampleRate, targetAudioSampleBitDepth);
+    env->ReleaseStringUTFChars(file_path, file_path_chars);
+    return result;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_takeOverDecodersNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong native_player,
+        jlong previous_native_player,
+        jboolean requestHw,
+        jobject hwSurface,
+        jint targetAudioChannels,
+        jint targetAudioSampleRate,
+        jint targetAudioSampleBitDepth) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    auto *previous = reinterpret_cast<tMediaPlayerContext *>(previous_native_player);
+    if (player == nullptr) {
+        return OptFail;
+    }
+    jobject hwSurfaceRef = env->NewLocalRef(hwSurface);
+    auto result = player->prepareDecoders(previous, requestHw, hwSurfaceRef, targetAudioChannels, targetAudioSampleRate, targetAudioSampleBitDepth);
+    env->DeleteLocalRef(hwSurfaceRef);
+    return result;
+}
+
 extern "C" JNIEXPORT jint JNICALL
 Java_com_tans_tmediaplayer_player_tMediaPlayer_readPacketNative(
         JNIEnv * env,
@@ -85,9 +318,21 @@ Java_com_tans_tmediaplayer_player_tMediaPlayer_seekToNative(
         JNIEnv * env,
         jobject j_player,
         jlong native_player,
-        jlong target_pos_in_millis) {
+        jlong target_pos_in_millis,
+        jboolean accurate) {
     auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
-    return player->seekTo(target_pos_in_millis);
+    return player->seekTo(target_pos_in_millis, accurate);
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_findNearestKeyframeNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong native_player,
+        jlong target_pos_in_millis,
+        jboolean before) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    return player->findNearestKeyframe(target_pos_in_millis, before);
 }
 
 extern "C" JNIEXPORT jint JNICALL
@@ -95,13 +340,14 @@ Java_com_tans_tmediaplayer_player_tMediaPlayer_decodeVideoNative(
         JNIEnv * env,
         jobject j_player,
         jlong native_player,
-        jlong native_buffer) {
+        jlong native_buffer,
+        jboolean late) {
     auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
     if (native_buffer != 0L) {
         auto *pkt = reinterpret_cast<AVPacket *>(native_buffer);
-        return player->decodeVideo(pkt);
+        return player->decodeVideo(pkt, late);
     } else {
-        return player->decodeVideo(nullptr);
+        return player->decodeVideo(nullptr, late);
     }
 }
 
@@ -149,6 +395,36 @@ Java_com_tans_tmediaplayer_player_tMediaPlayer_flushAudioCodecBufferNative(
     player->flushAudioCodecBuffer();
 }
 
+extern "C" JNIEXPORT void JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_setAudioTempoNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong native_player,
+        jdouble tempo) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    player->setAudioTempo(tempo);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_setScrubModeNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong native_player,
+        jboolean enable) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    player->setScrubMode(enable);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_setAudioNormalizationNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong native_player,
+        jboolean enable) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    player->setAudioNormalization(enable);
+}
+
 extern "C" JNIEXPORT jint JNICALL
 Java_com_tans_tmediaplayer_player_tMediaPlayer_moveDecodedAudioFrameToBufferNative(
         JNIEnv * env,
@@ -515,160 +791,121 @@ Java_com_tans_tmediaplayer_player_tMediaPlayer_subtitleStreamMetadataNative(
 
 // endregion
 
-// region Packet buffer
-#pragma clang diagnostic push
-#pragma ide diagnostic ignored "MemoryLeak"
-extern "C" JNIEXPORT jlong JNICALL
-Java_com_tans_tmediaplayer_player_tMediaPlayer_allocPacketNative(
-        JNIEnv * env,
-        jobject j_player) {
-    auto pkt = av_packet_alloc();
-    return reinterpret_cast<jlong>(pkt);
-}
-#pragma clang diagnostic pop
-
+// region Audio and video tracks
 extern "C" JNIEXPORT jint JNICALL
-Java_com_tans_tmediaplayer_player_tMediaPlayer_getPacketStreamIndexNative(
+Java_com_tans_tmediaplayer_player_tMediaPlayer_audioTrackCountNative(
         JNIEnv * env,
         jobject j_player,
-        jlong nativeBuffer) {
-    auto *pkt = reinterpret_cast<AVPacket*>(nativeBuffer);
-    return pkt->stream_index;
-}
-
-extern "C" JNIEXPORT jlong JNICALL
-Java_com_tans_tmediaplayer_player_tMediaPlayer_getPacketPtsNative(
-        JNIEnv * env,
-        jobject j_player,
-        jlong nativeBuffer) {
-    auto *pkt = reinterpret_cast<AVPacket*>(nativeBuffer);
-    if (pkt->pts == AV_NOPTS_VALUE) {
-        return 0L;
-    } else {
-        return (jlong) ((double)pkt->pts * av_q2d(pkt->time_base) * 1000.0);
-    }
-}
-
-extern "C" JNIEXPORT jlong JNICALL
-Java_com_tans_tmediaplayer_player_tMediaPlayer_getPacketDurationNative(
-        JNIEnv * env,
-        jobject j_player,
-        jlong nativeBuffer) {
-    auto *pkt = reinterpret_cast<AVPacket*>(nativeBuffer);
-    if (pkt->duration == AV_NOPTS_VALUE) {
-        return 0L;
-    } else {
-        return (jlong) ((double)pkt->duration * av_q2d(pkt->time_base) * 1000.0);
-    }
+        jlong native_player) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    return player->audioTrackCount;
 }
 
 extern "C" JNIEXPORT jint JNICALL
-Java_com_tans_tmediaplayer_player_tMediaPlayer_getPacketBytesSizeNative(
+Java_com_tans_tmediaplayer_player_tMediaPlayer_audioTrackIdNative(
         JNIEnv * env,
         jobject j_player,
-        jlong nativeBuffer) {
-    auto *pkt = reinterpret_cast<AVPacket*>(nativeBuffer);
-    return pkt->size;
+        jlong native_player,
+        jint index) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    return player->audioTracks[index]->stream->index;
 }
 
-extern "C" JNIEXPORT void JNICALL
-Java_com_tans_tmediaplayer_player_tMediaPlayer_releasePacketNative(
+extern "C" JNIEXPORT jobjectArray JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_audioTrackMetadataNative(
         JNIEnv * env,
         jobject j_player,
-        jlong nativeBuffer) {
-    auto *pkt = reinterpret_cast<AVPacket*>(nativeBuffer);
-    av_packet_unref(pkt);
-    av_packet_free(&pkt);
-}
-// endregion
-
-// region VideoBuffer
-#pragma clang diagnostic push
-#pragma ide diagnostic ignored "MemoryLeak"
-extern "C" JNIEXPORT jlong JNICALL
-Java_com_tans_tmediaplayer_player_tMediaPlayer_allocVideoBufferNative(
-        JNIEnv * env,
-        jobject j_player) {
-    auto buffer = new tMediaVideoBuffer;
-    return reinterpret_cast<jlong>(buffer);
+        jlong native_player,
+        jint index) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    return readMetadata(env, &player->audioTracks[index]->streamMetadata);
 }
-#pragma clang diagnostic pop
 
-extern "C" JNIEXPORT jlong JNICALL
-Java_com_tans_tmediaplayer_player_tMediaPlayer_getVideoPtsNative(
+extern "C" JNIEXPORT jint JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_videoTrackCountNative(
         JNIEnv * env,
         jobject j_player,
-        jlong buffer_l) {
-    auto buffer = reinterpret_cast<tMediaVideoBuffer *>(buffer_l);
-    return buffer -> pts;
+        jlong native_player) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    return player->videoTrackCount;
 }
 
-extern "C" JNIEXPORT jlong JNICALL
-Java_com_tans_tmediaplayer_player_tMediaPlayer_getVideoDurationNative(
+extern "C" JNIEXPORT jint JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_videoTrackIdNative(
         JNIEnv * env,
         jobject j_player,
-        jlong buffer_l) {
-    auto buffer = reinterpret_cast<tMediaVideoBuffer *>(buffer_l);
-    return buffer -> duration;
+        jlong native_player,
+        jint index) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    return player->videoTracks[index]->stream->index;
 }
 
-extern "C" JNIEXPORT jint JNICALL
-Java_com_tans_tmediaplayer_player_tMediaPlayer_getVideoWidthNative(
+extern "C" JNIEXPORT jobjectArray JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_videoTrackMetadataNative(
         JNIEnv * env,
         jobject j_player,
-        jlong buffer_l) {
-    auto buffer = reinterpret_cast<tMediaVideoBuffer *>(buffer_l);
-    return buffer -> width;
+        jlong native_player,
+        jint index) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    return readMetadata(env, &player->videoTracks[index]->streamMetadata);
 }
 
 extern "C" JNIEXPORT jint JNICALL
-Java_com_tans_tmediaplayer_player_tMediaPlayer_getVideoHeightNative(
+Java_com_tans_tmediaplayer_player_tMediaPlayer_selectTrackNative(
         JNIEnv * env,
         jobject j_player,
-        jlong buffer_l) {
-    auto buffer = reinterpret_cast<tMediaVideoBuffer *>(buffer_l);
-    return buffer -> height;
+        jlong native_player,
+        jint stream_index,
+        jlong position_in_millis) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    return player->selectTrack(stream_index, position_in_millis);
 }
 
 extern "C" JNIEXPORT jint JNICALL
-Java_com_tans_tmediaplayer_player_tMediaPlayer_getVideoFrameTypeNative(
+Java_com_tans_tmediaplayer_player_tMediaPlayer_getSelectedTrackNative(
         JNIEnv * env,
         jobject j_player,
-        jlong buffer_l) {
-    auto buffer = reinterpret_cast<tMediaVideoBuffer *>(buffer_l);
-    return buffer->type;
+        jlong native_player,
+        jboolean is_video) {
+    auto *player = reinterpret_cast<tMediaPlayerContext *>(native_player);
+    return is_video ? player->selectedVideoStreamIndex.load() : player->selectedAudioStreamIndex.load();
 }
+// endregion
 
-extern "C" JNIEXPORT jint JNICALL
-Java_com_tans_tmediaplayer_player_tMediaPlayer_getVideoFrameDisplayRotationNative(
+// region Packet buffer
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "MemoryLeak"
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_allocPacketNative(
         JNIEnv * env,
-        jobject j_player,
-        jlong buffer_l) {
-    auto buffer = reinterpret_cast<tMediaVideoBuffer *>(buffer_l);
-    return buffer->displayRotation;
+        jobject j_player) {
+    auto pkt = av_packet_alloc();
+    return reinterpret_cast<jlong>(pkt);
 }
+#pragma clang diagnostic pop
 
-extern "C" JNIEXPORT jfloat JNICALL
-Java_com_tans_tmediaplayer_player_tMediaPlayer_getVideoFrameDisplayRatioNative(
+extern "C" JNIEXPORT void JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_releasePacketNative(
         JNIEnv * env,
         jobject j_player,
-        jlong buffer_l) {
-    auto buffer = reinterpret_cast<tMediaVideoBuffer *>(buffer_l);
-    return buffer->displayRatio;
+        jlong nativeBuffer) {
+    auto *pkt = reinterpret_cast<AVPacket*>(nativeBuffer);
+    av_packet_unref(pkt);
+    av_packet_free(&pkt);
 }
+// endregion
 
-extern "C" JNIEXPORT jint JNICALL
-Java_com_tans_tmediaplayer_player_tMediaPlayer_getVideoFrameRgbaSizeNative(
+// region VideoBuffer
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "MemoryLeak"
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_allocVideoBufferNative(
         JNIEnv * env,
-        jobject j_player,
-        jlong buffer_l) {
-    auto buffer = reinterpret_cast<tMediaVideoBuffer *>(buffer_l);
-    if (buffer->type == Rgba) {
-        return buffer->rgbaContentSize;
-    } else {
-        return 0;
-    }
+        jobject j_player) {
+    auto buffer = new tMediaVideoBuffer;
+    return reinterpret_cast<jlong>(buffer);
 }
+#pragma clang diagnostic pop
 
 extern "C" JNIEXPORT void JNICALL
 Java_com_tans_tmediaplayer_player_tMediaPlayer_getVideoFrameRgbaBytesNative(
@@ -685,19 +922,6 @@ Java_com_tans_tmediaplayer_player_tMediaPlayer_getVideoFrameRgbaBytesNative(
     env->DeleteLocalRef(j_bytes);
 }
 
-extern "C" JNIEXPORT jint JNICALL
-Java_com_tans_tmediaplayer_player_tMediaPlayer_getVideoFrameYSizeNative(
-        JNIEnv * env,
-        jobject j_player,
-        jlong buffer_l) {
-    auto buffer = reinterpret_cast<tMediaVideoBuffer *>(buffer_l);
-    if (buffer->type == Nv12 || buffer->type == Nv21 || buffer->type == Yuv420p) {
-        return buffer->yContentSize;
-    } else {
-        return 0;
-    }
-}
-
 extern "C" JNIEXPORT void JNICALL
 Java_com_tans_tmediaplayer_player_tMediaPlayer_getVideoFrameYBytesNative(
         JNIEnv * env,
@@ -713,19 +937,6 @@ Java_com_tans_tmediaplayer_player_tMediaPlayer_getVideoFrameYBytesNative(
     env->DeleteLocalRef(j_bytes);
 }
 
-extern "C" JNIEXPORT jint JNICALL
-Java_com_tans_tmediaplayer_player_tMediaPlayer_getVideoFrameUSizeNative(
-        JNIEnv * env,
-        jobject j_player,
-        jlong buffer_l) {
-    auto buffer = reinterpret_cast<tMediaVideoBuffer *>(buffer_l);
-    if (buffer->type == Yuv420p) {
-        return buffer->uContentSize;
-    } else {
-        return 0;
-    }
-}
-
 extern "C" JNIEXPORT void JNICALL
 Java_com_tans_tmediaplayer_player_tMediaPlayer_getVideoFrameUBytesNative(
         JNIEnv * env,
@@ -741,19 +952,6 @@ Java_com_tans_tmediaplayer_player_tMediaPlayer_getVideoFrameUBytesNative(
     env->DeleteLocalRef(j_bytes);
 }
 
-extern "C" JNIEXPORT jint JNICALL
-Java_com_tans_tmediaplayer_player_tMediaPlayer_getVideoFrameVSizeNative(
-        JNIEnv * env,
-        jobject j_player,
-        jlong buffer_l) {
-    auto buffer = reinterpret_cast<tMediaVideoBuffer *>(buffer_l);
-    if (buffer->type == Yuv420p) {
-        return buffer->vContentSize;
-    } else {
-        return 0;
-    }
-}
-
 extern "C" JNIEXPORT void JNICALL
 Java_com_tans_tmediaplayer_player_tMediaPlayer_getVideoFrameVBytesNative(
         JNIEnv * env,
@@ -769,19 +967,6 @@ Java_com_tans_tmediaplayer_player_tMediaPlayer_getVideoFrameVBytesNative(
     env->DeleteLocalRef(j_bytes);
 }
 
-extern "C" JNIEXPORT jint JNICALL
-Java_com_tans_tmediaplayer_player_tMediaPlayer_getVideoFrameUVSizeNative(
-        JNIEnv * env,
-        jobject j_player,
-        jlong buffer_l) {
-    auto buffer = reinterpret_cast<tMediaVideoBuffer *>(buffer_l);
-    if (buffer->type == Nv12 || buffer->type == Nv21) {
-        return buffer->uvContentSize;
-    } else {
-        return 0;
-    }
-}
-
 extern "C" JNIEXPORT void JNICALL
 Java_com_tans_tmediaplayer_player_tMediaPlayer_getVideoFrameUVBytesNative(
         JNIEnv * env,
@@ -803,6 +988,9 @@ Java_com_tans_tmediaplayer_player_tMediaPlayer_releaseVideoBufferNative(
         jobject j_player,
         jlong native_buffer) {
     auto buffer = reinterpret_cast<tMediaVideoBuffer *>(native_buffer);
+    if (buffer->memoryTracker != nullptr) {
+        buffer->memoryTracker->add(MemoryVideoBuffer, -buffer->allocatedBytes());
+    }
     if (buffer->rgbaBuffer != nullptr) {
         free(buffer->rgbaBuffer);
     }
@@ -836,54 +1024,210 @@ Java_com_tans_tmediaplayer_player_tMediaPlayer_allocAudioBufferNative(
 #pragma clang diagnostic pop
 
 extern "C" JNIEXPORT void JNICALL
-Java_com_tans_tmediaplayer_player_tMediaPlayer_getAudioFrameBytesNative(
+Java_com_tans_tmediaplayer_player_tMediaPlayer_releaseAudioBufferNative(
         JNIEnv * env,
         jobject j_player,
-        jlong buffer_l,
-        jbyteArray j_bytes) {
-    j_bytes = reinterpret_cast<jbyteArray>(env->NewLocalRef((jobject) j_bytes));
-    auto buffer = reinterpret_cast<tMediaAudioBuffer *>(buffer_l);
-    env->SetByteArrayRegion(j_bytes, 0, buffer->contentSize,
-                            reinterpret_cast<const jbyte *>(buffer->pcmBuffer));
-    env->DeleteLocalRef(j_bytes);
+        jlong native_buffer) {
+    auto buffer = reinterpret_cast<tMediaAudioBuffer *>(native_buffer);
+    if (buffer->pcmBuffer != nullptr) {
+        if (buffer->memoryTracker != nullptr) {
+            buffer->memoryTracker->add(MemoryAudioBuffer, -buffer->bufferSize);
+        }
+        free(buffer->pcmBuffer);
+    }
+    delete buffer;
 }
+//endregion
 
-extern "C" JNIEXPORT jint JNICALL
-Java_com_tans_tmediaplayer_player_tMediaPlayer_getAudioFrameSizeNative(
+// region Player stats
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_createStatsNative(
+        JNIEnv * env,
+        jobject j_player) {
+    auto stats = new tMediaPlayerStats;
+    return reinterpret_cast<jlong>(stats);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_resetStatsNative(
         JNIEnv * env,
         jobject j_player,
-        jlong buffer_l) {
-    auto buffer = reinterpret_cast<tMediaAudioBuffer *>(buffer_l);
-    return buffer->contentSize;
+        jlong native_stats) {
+    auto stats = reinterpret_cast<tMediaPlayerStats *>(native_stats);
+    stats->reset();
 }
 
-extern "C" JNIEXPORT jlong JNICALL
-Java_com_tans_tmediaplayer_player_tMediaPlayer_getAudioPtsNative(
+extern "C" JNIEXPORT void JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_increaseStatsCounterNative(
         JNIEnv * env,
         jobject j_player,
-        jlong buffer_l) {
-    auto buffer = reinterpret_cast<tMediaAudioBuffer *>(buffer_l);
-    return buffer->pts;
+        jlong native_stats,
+        jint counter_type) {
+    auto stats = reinterpret_cast<tMediaPlayerStats *>(native_stats);
+    stats->increase(static_cast<tMediaStatsCounterType>(counter_type));
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_recordStatsNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong native_stats,
+        jint histogram_type,
+        jlong value) {
+    auto stats = reinterpret_cast<tMediaPlayerStats *>(native_stats);
+    stats->record(static_cast<tMediaStatsHistogramType>(histogram_type), value);
 }
 
+extern "C" JNIEXPORT void JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_getStatsNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong native_stats,
+        jlongArray j_values) {
+    auto stats = reinterpret_cast<tMediaPlayerStats *>(native_stats);
+    int64_t values[PLAYER_STATS_EXPORT_SIZE];
+    stats->exportTo(values);
+    env->SetLongArrayRegion(j_values, 0, PLAYER_STATS_EXPORT_SIZE, reinterpret_cast<const jlong *>(values));
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_releaseStatsNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong native_stats) {
+    auto stats = reinterpret_cast<tMediaPlayerStats *>(native_stats);
+    delete stats;
+}
+// endregion
+
+// region Memory
 extern "C" JNIEXPORT jlong JNICALL
-Java_com_tans_tmediaplayer_player_tMediaPlayer_getAudioDurationNative(
+Java_com_tans_tmediaplayer_player_tMediaPlayer_createMemoryTrackerNative(
+        JNIEnv * env,
+        jobject j_player) {
+    auto tracker = new tMediaMemoryTracker;
+    return reinterpret_cast<jlong>(tracker);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_getMemoryStatsNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong native_memory_tracker,
+        jlongArray j_values) {
+    auto tracker = reinterpret_cast<tMediaMemoryTracker *>(native_memory_tracker);
+    int64_t values[MEMORY_STATS_EXPORT_SIZE];
+    tracker->exportTo(values);
+    env->SetLongArrayRegion(j_values, 0, MEMORY_STATS_EXPORT_SIZE, reinterpret_cast<const jlong *>(values));
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_releaseMemoryTrackerNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong native_memory_tracker) {
+    auto tracker = reinterpret_cast<tMediaMemoryTracker *>(native_memory_tracker);
+    tracker->release();
+    delete tracker;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_tans_tmediaplayer_player_tMediaPlayer_setProcessMemoryBudgetNative(
+        JNIEnv * env,
+        jclass j_player_class,
+        jlong budget) {
+    setProcessMemoryBudget(budget);
+}
+// endregion
+
+// region Fast natives
+// Called for every packet and frame, registered by JNI_OnLoad and marked @FastNative in java.
+static jint getPacketStreamIndexNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong nativeBuffer) {
+    auto *pkt = reinterpret_cast<AVPacket*>(nativeBuffer);
+    return pkt->stream_index;
+}
+
+static jlong packetTimeInMillis(int64_t t, AVRational timeBase) {
+    if (t == AV_NOPTS_VALUE) {
+        return 0L;
+    } else {
+        return (jlong) ((double) t * av_q2d(timeBase) * 1000.0);
+    }
+}
+
+static void getPacketInfoNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong nativeBuffer,
+        jlongArray j_values) {
+    auto *pkt = reinterpret_cast<AVPacket*>(nativeBuffer);
+    jlong values[PACKET_INFO_EXPORT_SIZE];
+    values[0] = pkt->stream_index;
+    values[1] = pkt->size;
+    values[2] = packetTimeInMillis(pkt->duration, pkt->time_base);
+    values[3] = packetTimeInMillis(pkt->pts, pkt->time_base);
+    env->SetLongArrayRegion(j_values, 0, PACKET_INFO_EXPORT_SIZE, values);
+}
+
+static void getVideoFrameInfoNative(
+        JNIEnv * env,
+        jobject j_player,
+        jlong buffer_l,
+        jlongArray j_values) {
+    auto buffer = reinterpret_cast<tMediaVideoBuffer *>(buffer_l);
+    int64_t values[VIDEO_FRAME_INFO_EXPORT_SIZE];
+    buffer->exportInfo(values);
+    env->SetLongArrayRegion(j_values, 0, VIDEO_FRAME_INFO_EXPORT_SIZE, reinterpret_cast<const jlong *>(values));
+}
+
+static jint getAudioFrameSizeNative(
         JNIEnv * env,
         jobject j_player,
         jlong buffer_l) {
     auto buffer = reinterpret_cast<tMediaAudioBuffer *>(buffer_l);
-    return buffer->duration;
+    return buffer->contentSize;
 }
 
-extern "C" JNIEXPORT void JNICALL
-Java_com_tans_tmediaplayer_player_tMediaPlayer_releaseAudioBufferNative(
+static void getAudioFrameInfoNative(
         JNIEnv * env,
         jobject j_player,
-        jlong native_buffer) {
-    auto buffer = reinterpret_cast<tMediaAudioBuffer *>(native_buffer);
-    if (buffer->pcmBuffer != nullptr) {
-        free(buffer->pcmBuffer);
+        jlong buffer_l,
+        jlongArray j_values) {
+    auto buffer = reinterpret_cast<tMediaAudioBuffer *>(buffer_l);
+    int64_t values[AUDIO_FRAME_INFO_EXPORT_SIZE];
+    buffer->exportInfo(values);
+    env->SetLongArrayRegion(j_values, 0, AUDIO_FRAME_INFO_EXPORT_SIZE, reinterpret_cast<const jlong *>(values));
+}
+
+static const JNINativeMethod fastNativeMethods[] = {
+        {"getPacketStreamIndexNative", "(J)I", reinterpret_cast<void *>(getPacketStreamIndexNative)},
+        {"getPacketInfoNative", "(J[J)V", reinterpret_cast<void *>(getPacketInfoNative)},
+        {"getVideoFrameInfoNative", "(J[J)V", reinterpret_cast<void *>(getVideoFrameInfoNative)},
+        {"getAudioFrameSizeNative", "(J)I", reinterpret_cast<void *>(getAudioFrameSizeNative)},
+        {"getAudioFrameInfoNative", "(J[J)V", reinterpret_cast<void *>(getAudioFrameInfoNative)},
+};
+
+extern "C" JNIEXPORT jint JNICALL
+JNI_OnLoad(JavaVM *jvm, void *reserved) {
+    JNIEnv *env = nullptr;
+    if (jvm->GetEnv(reinterpret_cast<void **>(&env), JNI_VERSION_1_6) != JNI_OK) {
+        return JNI_ERR;
     }
-    delete buffer;
+    jclass playerClazz = env->FindClass("com/tans/tmediaplayer/player/tMediaPlayer");
+    if (playerClazz == nullptr) {
+        LOGE("JNI_OnLoad: can't find tMediaPlayer class.");
+        return JNI_ERR;
+    }
+    int methodsCount = sizeof(fastNativeMethods) / sizeof(fastNativeMethods[0]);
+    if (env->RegisterNatives(playerClazz, fastNativeMethods, methodsCount) != JNI_OK) {
+        LOGE("JNI_OnLoad: register natives fail.");
+        env->DeleteLocalRef(playerClazz);
+        return JNI_ERR;
+    }
+    env->DeleteLocalRef(playerClazz);
+    return JNI_VERSION_1_6;
 }
-//endregion
+// endregion
@@ -0,0 +1,354 @@
+#include <algorithm>
+#include <chrono>
+#include "tmediaplayer.h"
+#include "tmediaabr.h"
+
+extern "C" {
+#include "libavutil/opt.h"
+}
+
+static int64_t abrNowInMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Playlists and manifests are small and reloaded, not used as bandwidth samples.
+static bool isManifestUrl(const char *url) {
+    const char *query = strchr(url, '?');
+    size_t len = query != nullptr ? (size_t) (query - url) : strlen(url);
+    auto endsWith = [url, len](const char *suffix) {
+        size_t suffixLen = strlen(suffix);
+        return len >= suffixLen && strncasecmp(url + len - suffixLen, suffix, suffixLen) == 0;
+    };
+    return endsWith(".m3u8") || endsWith(".m3u") || endsWith(".mpd");
+}
+
+static int64_t variantBitrate(AVDictionary *metadata) {
+    auto entry = av_dict_get(metadata, "variant_bitrate", nullptr, 0);
+    if (entry == nullptr || entry->value == nullptr) {
+        return 0;
+    }
+    return strtoll(entry->value, nullptr, 10);
+}
+
+static bool isVariantVideoStream(AVStream *s, AVStream *baseVideoStream) {
+    return s->codecpar->codec_type == AVMEDIA_TYPE_VIDEO &&
+           !(s->disposition & AV_DISPOSITION_ATTACHED_PIC) &&
+           s->codecpar->codec_id == baseVideoStream->codecpar->codec_id;
+}
+
+// Audio decoder and resampler are not reopened, variants' audio must have the same format.
+static bool isVariantAudioStream(AVStream *s, AVStream *baseAudioStream) {
+    if (baseAudioStream == nullptr || s == baseAudioStream) {
+        return true;
+    }
+    auto a = s->codecpar;
+    auto b = baseAudioStream->codecpar;
+    return a->codec_id == b->codec_id &&
+           a->sample_rate == b->sample_rate &&
+           av_channel_layout_compare(&a->ch_layout, &b->ch_layout) == 0;
+}
+
+// region AVIOContext callbacks
+static int abrSegmentRead(void *opaque, uint8_t *buf, int size) {
+    auto io = static_cast<tMediaAbrSegmentIO *>(opaque);
+    int64_t start = abrNowInMicros();
+    int ret = avio_read_partial(io->source, buf, size);
+    io->readCostInMicros += abrNowInMicros() - start;
+    if (ret == 0 && avio_feof(io->source)) {
+        return AVERROR_EOF;
+    }
+    if (ret > 0) {
+        io->readBytes += ret;
+    }
+    return ret;
+}
+
+static int64_t abrSegmentSeek(void *opaque, int64_t offset, int whence) {
+    auto io = static_cast<tMediaAbrSegmentIO *>(opaque);
+    if (whence & AVSEEK_SIZE) {
+        return avio_size(io->source);
+    }
+    return avio_seek(io->source, offset, whence & ~AVSEEK_FORCE);
+}
+
+static int abrIOOpen(struct AVFormatContext *s, AVIOContext **pb, const char *url, int flags, AVDictionary **options) {
+    auto abr = static_cast<tMediaAbr *>(s->opaque);
+    return abr->openSegment(pb, url, flags, options);
+}
+
+static int abrIOClose(struct AVFormatContext *s, AVIOContext *pb) {
+    auto abr = static_cast<tMediaAbr *>(s->opaque);
+    return abr->closeSegment(pb);
+}
+// endregion
+
+bool tMediaAbr::prepare(AVFormatContext *ctx, AVStream *videoStream, AVStream *audioStream) {
+    formatCtx = ctx;
+    baseVideoStream = videoStream;
+    baseAudioStream = audioStream;
+    if (videoStream == nullptr || (videoStream->disposition & AV_DISPOSITION_ATTACHED_PIC)) {
+        return false;
+    }
+    // Hls: each variant is a program.
+    for (unsigned int i = 0; i < ctx->nb_programs; i ++) {
+        auto program = ctx->programs[i];
+        tMediaAbrVariant variant;
+        variant.bandwidth = variantBitrate(program->metadata);
+        int audioStreamIndex = -1;
+        bool audioMatch = true;
+        for (unsigned int j = 0; j < program->nb_stream_indexes; j ++) {
+            int index = (int) program->stream_index[j];
+            auto s = ctx->streams[index];
+            variantStreams.push_back(index);
+            auto type = s->codecpar->codec_type;
+            if (type == AVMEDIA_TYPE_VIDEO) {
+                if (variant.videoStreamIndex < 0 && isVariantVideoStream(s, videoStream)) {
+                    variant.videoStreamIndex = index;
+                    variant.width = s->codecpar->width;
+                    variant.height = s->codecpar->height;
+                    variant.streams.push_back(index);
+                }
+            } else if (type == AVMEDIA_TYPE_AUDIO) {
+                // Prefer player's audio stream (shared audio rendition), else first audio of variant.
+                if (audioStream != nullptr && index == audioStream->index) {
+                    audioStreamIndex = index;
+                } else if (audioStreamIndex < 0) {
+                    audioStreamIndex = index;
+                }
+            } else {
+                variant.streams.push_back(index);
+            }
+        }
+        if (audioStreamIndex >= 0) {
+            audioMatch = isVariantAudioStream(ctx->streams[audioStreamIndex], audioStream);
+            variant.streams.push_back(audioStreamIndex);
+        }
+        if (variant.bandwidth > 0 && variant.videoStreamIndex >= 0 && audioMatch) {
+            variants.push_back(variant);
+        }
+    }
+    if (variants.size() < 2) {
+        // Dash: each video representation is a stream.
+        variants.clear();
+        variantStreams.clear();
+        for (unsigned int i = 0; i < ctx->nb_streams; i ++) {
+            auto s = ctx->streams[i];
+            int64_t bandwidth = variantBitrate(s->metadata);
+            if (bandwidth > 0 && isVariantVideoStream(s, videoStream)) {
+                tMediaAbrVariant variant;
+                variant.bandwidth = bandwidth;
+                variant.videoStreamIndex = s->index;
+                variant.width = s->codecpar->width;
+                variant.height = s->codecpar->height;
+                variant.streams.push_back(s->index);
+                variants.push_back(variant);
+                variantStreams.push_back(s->index);
+            }
+        }
+    }
+    std::sort(variants.begin(), variants.end(), [](const tMediaAbrVariant &a, const tMediaAbrVariant &b) {
+        return a.bandwidth < b.bandwidth;
+    });
+    if (variants.size() > ABR_MAX_VARIANTS) {
+        variants.resize(ABR_MAX_VARIANTS);
+    }
+    int initialVariant = -1;
+    for (size_t i = 0; i < variants.size(); i ++) {
+        if (variants[i].videoStreamIndex == videoStream->index) {
+            initialVariant = (int) i;
+            break;
+        }
+    }
+    if (variants.size() < 2 || initialVariant < 0) {
+        variants.clear();
+        variantStreams.clear();
+        return false;
+    }
+    // Start with the variant FFmpeg picked, other variants stop downloading.
+    applyVariant(initialVariant);
+    lastVideoStreamIndex = videoStream->index;
+
+    // Segment reads are timed by wrapped io, keep alive reuses the connection io inside demuxer and bypasses io_open.
+    av_opt_set_int(ctx->priv_data, "http_persistent", 0, 0);
+    defaultIOOpen = ctx->io_open;
+    defaultIOClose = ctx->io_close2;
+    ctx->opaque = this;
+    ctx->io_open = abrIOOpen;
+    ctx->io_close2 = abrIOClose;
+    LOGD("Abr prepared: variants=%d, initial=%lld bps", (int) variants.size(), (long long) variants[initialVariant].bandwidth);
+    return true;
+}
+
+int tMediaAbr::openSegment(AVIOContext **pb, const char *url, int flags, AVDictionary **options) {
+    int ret = defaultIOOpen(formatCtx, pb, url, flags, options);
+    if (ret < 0 || (flags & AVIO_FLAG_WRITE) || isManifestUrl(url)) {
+        return ret;
+    }
+    segmentOpened = true;
+    auto io = new tMediaAbrSegmentIO;
+    io->source = *pb;
+    auto buffer = static_cast<uint8_t *>(av_malloc(ABR_SEGMENT_IO_BUFFER_SIZE));
+    if (buffer != nullptr) {
+        io->avio = avio_alloc_context(buffer, ABR_SEGMENT_IO_BUFFER_SIZE, 0, io, abrSegmentRead, nullptr, abrSegmentSeek);
+    }
+    if (io->avio == nullptr) {
+        // Keep the default io, segment is not measured.
+        av_free(buffer);
+        delete io;
+        return ret;
+    }
+    io->avio->seekable = io->source->seekable;
+    segmentIOs[io->avio] = io;
+    *pb = io->avio;
+    return ret;
+}
+
+int tMediaAbr::closeSegment(AVIOContext *pb) {
+    auto it = segmentIOs.find(pb);
+    if (it == segmentIOs.end()) {
+        return defaultIOClose(formatCtx, pb);
+    }
+    auto io = it->second;
+    segmentIOs.erase(it);
+    if (io->readBytes >= ABR_MIN_SAMPLE_BYTES && io->readCostInMicros > 0) {
+        onSegmentRead(io->readBytes, io->readCostInMicros);
+        if (buffering != nullptr) {
+            buffering->onIORead(io->readBytes, io->readCostInMicros);
+        }
+    }
+    int ret = defaultIOClose(formatCtx, io->source);
+    av_freep(&io->avio->buffer);
+    avio_context_free(&io->avio);
+    delete io;
+    return ret;
+}
+
+void tMediaAbr::onSegmentRead(int64_t bytes, int64_t costInMicros) {
+    std::lock_guard<std::mutex> l(lock);
+    auto sample = (int64_t) ((double) bytes * 8.0 * 1000000.0 / (double) costInMicros);
+    if (bandwidth <= 0) {
+        bandwidth = sample;
+    } else {
+        bandwidth = (int64_t) ((double) bandwidth * (1.0 - ABR_EWMA_WEIGHT) + (double) sample * ABR_EWMA_WEIGHT);
+    }
+    LOGD("Abr segment read: bytes=%lld, cost=%lldus, sample=%lld bps, bandwidth=%lld bps",
+         (long long) bytes, (long long) costInMicros, (long long) sample, (long long) bandwidth);
+}
+
+int tMediaAbr::chooseVariant(int64_t estimatedBandwidth, int64_t bufferedDurationInMillis) const {
+    int target = 0;
+    for (size_t i = 0; i < variants.size(); i ++) {
+        if ((double) variants[i].bandwidth <= (double) estimatedBandwidth * ABR_BANDWIDTH_FRACTION) {
+            target = (int) i;
+        }
+    }
+    if (target > currentVariant && bufferedDurationInMillis < ABR_MIN_BUFFER_FOR_UP_SWITCH_IN_MILLIS) {
+        return currentVariant;
+    }
+    if (target < currentVariant && bufferedDurationInMillis >= ABR_MAX_BUFFER_FOR_DOWN_SWITCH_IN_MILLIS) {
+        return currentVariant;
+    }
+    return target;
+}
+
+void tMediaAbr::update(int64_t bufferedDurationInMillis) {
+    if (variants.empty()) {
+        return;
+    }
+    if (pendingVariant >= 0 && segmentOpened) {
+        LOGD("Abr switch variant: %lld bps -> %lld bps", (long long) variants[currentVariant].bandwidth, (long long) variants[pendingVariant].bandwidth);
+        applyVariant(pendingVariant);
+        pendingVariant = -1;
+        std::lock_guard<std::mutex> l(lock);
+        switchCount ++;
+    }
+    // Only written by this thread.
+    int64_t estimatedBandwidth = bandwidth;
+    if (estimatedBandwidth <= 0) {
+        return;
+    }
+    int target = chooseVariant(estimatedBandwidth, bufferedDurationInMillis);
+    if (target == currentVariant) {
+        pendingVariant = -1;
+    } else if (target != pendingVariant) {
+        // Wait demuxer finishing current segment.
+        pendingVariant = target;
+        segmentOpened = false;
+    }
+}
+
+void tMediaAbr::applyVariant(int index) {
+    auto &variant = variants[index];
+    for (auto i : variantStreams) {
+        formatCtx->streams[i]->discard = AVDISCARD_ALL;
+    }
+    for (auto i : variant.streams) {
+        formatCtx->streams[i]->discard = AVDISCARD_DEFAULT;
+    }
+    std::lock_guard<std::mutex> l(lock);
+    currentVariant = index;
+}
+
+void tMediaAbr::routePacket(AVPacket *pkt) {
+    if (variants.empty()) {
+        return;
+    }
+    auto s = formatCtx->streams[pkt->stream_index];
+    auto type = s->codecpar->codec_type;
+    AVStream *base;
+    if (type == AVMEDIA_TYPE_VIDEO) {
+        base = baseVideoStream;
+    } else if (type == AVMEDIA_TYPE_AUDIO) {
+        base = baseAudioStream;
+    } else {
+        return;
+    }
+    if (base == nullptr || std::find(variantStreams.begin(), variantStreams.end(), pkt->stream_index) == variantStreams.end()) {
+        return;
+    }
+    if (type == AVMEDIA_TYPE_VIDEO && pkt->stream_index != lastVideoStreamIndex) {
+        // Decoder is not reopened for the new variant, give it new extradata (sps / pps) in packet.
+        auto last = formatCtx->streams[lastVideoStreamIndex]->codecpar;
+        auto current = s->codecpar;
+        if (current->extradata_size > 0 &&
+            (current->extradata_size != last->extradata_size || memcmp(current->extradata, last->extradata, current->extradata_size) != 0)) {
+            uint8_t *sideData = av_packet_new_side_data(pkt, AV_PKT_DATA_NEW_EXTRADATA, current->extradata_size);
+            if (sideData != nullptr) {
+                memcpy(sideData, current->extradata, current->extradata_size);
+            }
+        }
+        lastVideoStreamIndex = pkt->stream_index;
+    }
+    if (s != base) {
+        av_packet_rescale_ts(pkt, s->time_base, base->time_base);
+        pkt->stream_index = base->index;
+    }
+}
+
+void tMediaAbr::exportTo(int64_t *dst) {
+    std::lock_guard<std::mutex> l(lock);
+    dst[0] = (int64_t) variants.size();
+    dst[1] = currentVariant;
+    dst[2] = bandwidth;
+    dst[3] = switchCount;
+    for (size_t i = 0; i < variants.size() && i < ABR_MAX_VARIANTS; i ++) {
+        dst[4 + i * 3] = variants[i].bandwidth;
+        dst[4 + i * 3 + 1] = variants[i].width;
+        dst[4 + i * 3 + 2] = variants[i].height;
+    }
+}
+
+void tMediaAbr::release() {
+    // Demuxer closed, close segments it leaked.
+    for (auto &it : segmentIOs) {
+        auto io = it.second;
+        avio_closep(&io->source);
+        av_freep(&io->avio->buffer);
+        avio_context_free(&io->avio);
+        delete io;
+    }
+    segmentIOs.clear();
+    variants.clear();
+    variantStreams.clear();
+    formatCtx = nullptr;
+}
@@ -0,0 +1,144 @@
+#include <chrono>
+#include "tmediabuffering.h"
+#include "tmediamemory.h"
+
+static int64_t bufferingNowInMillis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int64_t ewma(int64_t last, int64_t sample) {
+    if (last <= 0) {
+        return sample;
+    }
+    return (int64_t) ((double) last * (1.0 - BUFFERING_EWMA_WEIGHT) + (double) sample * BUFFERING_EWMA_WEIGHT);
+}
+
+void tMediaBuffering::prepare(BufferingSourceType type, int64_t containerBitrate) {
+    std::lock_guard<std::mutex> l(lock);
+    this->sourceType = type;
+    this->bitrate = containerBitrate > 0 ? containerBitrate : 0;
+    bufferedDurationInMillis = 0;
+    bufferedBytes = 0;
+    startupFinished = false;
+    rebuffering = false;
+    rebufferCount = 0;
+    rebufferTotalInMillis = 0;
+    computeTargets();
+}
+
+void tMediaBuffering::onIORead(int64_t bytes, int64_t costInMicros) {
+    if (bytes <= 0 || costInMicros <= 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> l(lock);
+    throughput = ewma(throughput, bytes * 1000000L / costInMicros);
+}
+
+void tMediaBuffering::computeTargets() {
+    int64_t bytesPerSecond = bitrate / 8;
+    switch (sourceType) {
+        case BufferingSourceLocal: {
+            minDurationInMillis = 0;
+            maxDurationInMillis = BUFFERING_LOCAL_MAX_DURATION_IN_MILLIS;
+            // 2x of max duration, queues of audio and video are not filled equally.
+            int64_t bytes = bytesPerSecond * maxDurationInMillis * 2 / 1000;
+            maxBytes = bytes < BUFFERING_LOCAL_MIN_BYTES ? BUFFERING_LOCAL_MIN_BYTES : (bytes > BUFFERING_LOCAL_MAX_BYTES ? BUFFERING_LOCAL_MAX_BYTES : bytes);
+            break;
+        }
+        case BufferingSourceNetwork: {
+            bool slow = bytesPerSecond > 0 && throughput > 0 && (double) throughput < (double) bytesPerSecond * BUFFERING_SLOW_THROUGHPUT_RATIO;
+            minDurationInMillis = slow ? BUFFERING_NETWORK_SLOW_MIN_DURATION_IN_MILLIS : BUFFERING_NETWORK_MIN_DURATION_IN_MILLIS;
+            maxDurationInMillis = BUFFERING_NETWORK_MAX_DURATION_IN_MILLIS;
+            int64_t bytes = bytesPerSecond * maxDurationInMillis * 2 / 1000;
+            maxBytes = bytes <= 0 || bytes > BUFFERING_NETWORK_MAX_BYTES ? BUFFERING_NETWORK_MAX_BYTES : bytes;
+            break;
+        }
+        case BufferingSourceRealTime: {
+            // Never stop reading real time streams, else server drops data.
+            minDurationInMillis = 0;
+            maxDurationInMillis = INT64_MAX;
+            maxBytes = INT64_MAX;
+            break;
+        }
+    }
+}
+
+int32_t tMediaBuffering::update(int64_t audioDuration, int64_t videoDuration, int64_t bytes, bool eof) {
+    std::lock_guard<std::mutex> l(lock);
+    int64_t duration;
+    if (audioDuration >= 0 && videoDuration >= 0) {
+        duration = audioDuration < videoDuration ? audioDuration : videoDuration;
+    } else {
+        duration = audioDuration >= 0 ? audioDuration : (videoDuration >= 0 ? videoDuration : 0);
+    }
+    bufferedDurationInMillis = duration;
+    bufferedBytes = bytes;
+    int64_t maxDuration = audioDuration > videoDuration ? audioDuration : videoDuration;
+    if (maxDuration >= BUFFERING_BITRATE_MIN_DURATION_IN_MILLIS && bytes > 0) {
+        bitrate = ewma(bitrate, bytes * 8L * 1000L / maxDuration);
+    }
+    computeTargets();
+    if (sourceType != BufferingSourceRealTime) {
+        // Process memory budget shrinks packet queues of all players.
+        int64_t memoryLimit = getPacketMemoryLimit(bytes);
+        if (memoryLimit < maxBytes) {
+            maxBytes = memoryLimit < MEMORY_BUDGET_MIN_PACKET_BYTES ? MEMORY_BUDGET_MIN_PACKET_BYTES : memoryLimit;
+        }
+    }
+
+    int32_t flags = 0;
+    // Bytes full: can't buffer min duration under memory budget, resume playback.
+    if (eof || duration >= minDurationInMillis || bytes > maxBytes) {
+        startupFinished = true;
+        if (rebuffering) {
+            rebuffering = false;
+            rebufferTotalInMillis += bufferingNowInMillis() - rebufferStartInMillis;
+            flags |= BUFFERING_UPDATE_REBUFFER_END;
+        }
+    }
+    // Every stream buffered max duration or bytes reach max.
+    if (bytes > maxBytes || duration > maxDurationInMillis) {
+        flags |= BUFFERING_UPDATE_FULL;
+    }
+    return flags;
+}
+
+bool tMediaBuffering::onUnderrun(bool eof) {
+    std::lock_guard<std::mutex> l(lock);
+    if (eof || !startupFinished || rebuffering || sourceType == BufferingSourceRealTime) {
+        return false;
+    }
+    rebuffering = true;
+    rebufferStartInMillis = bufferingNowInMillis();
+    rebufferCount ++;
+    return true;
+}
+
+void tMediaBuffering::onSeek() {
+    std::lock_guard<std::mutex> l(lock);
+    startupFinished = false;
+    if (rebuffering) {
+        rebuffering = false;
+        rebufferTotalInMillis += bufferingNowInMillis() - rebufferStartInMillis;
+    }
+}
+
+void tMediaBuffering::exportTo(int64_t *dst) {
+    std::lock_guard<std::mutex> l(lock);
+    int64_t rebufferTotal = rebufferTotalInMillis;
+    if (rebuffering) {
+        rebufferTotal += bufferingNowInMillis() - rebufferStartInMillis;
+    }
+    dst[0] = sourceType;
+    dst[1] = bitrate;
+    dst[2] = throughput;
+    dst[3] = minDurationInMillis;
+    dst[4] = maxDurationInMillis == INT64_MAX ? -1L : maxDurationInMillis;
+    dst[5] = maxBytes == INT64_MAX ? -1L : maxBytes;
+    dst[6] = bufferedDurationInMillis;
+    dst[7] = bufferedBytes;
+    dst[8] = rebuffering ? 1L : 0L;
+    dst[9] = rebufferCount;
+    dst[10] = rebufferTotal;
+    dst[11] = startupFinished ? 1L : 0L;
+}
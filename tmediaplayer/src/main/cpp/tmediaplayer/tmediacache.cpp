@@ -0,0 +1,467 @@
+#include <algorithm>
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <mutex>
+#include <set>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include "tmediaplayer.h"
+#include "tmediacache.h"
+
+// Medias are opened by multiple players (next media, frame loader), guard eviction and in use keys.
+static std::mutex cacheLock;
+static std::multiset<std::string> cacheKeysInUse;
+
+static std::string cacheKeyOf(const char *url) {
+    // FNV-1a 64
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const char *p = url; *p != '\0'; p ++) {
+        hash ^= (uint8_t) *p;
+        hash *= 0x100000001b3ULL;
+    }
+    char key[17];
+    snprintf(key, sizeof(key), "%016llx", (unsigned long long) hash);
+    return key;
+}
+
+// region AVIOContext callbacks
+static int cacheIORead(void *opaque, uint8_t *buf, int size) {
+    auto io = static_cast<tMediaCacheIO *>(opaque);
+    return io->read(buf, size);
+}
+
+static int64_t cacheIOSeek(void *opaque, int64_t offset, int whence) {
+    auto io = static_cast<tMediaCacheIO *>(opaque);
+    return io->seek(offset, whence);
+}
+// endregion
+
+void evictMediaCache(const char *cacheDir, int64_t maxCacheSize) {
+    struct CacheEntry {
+        std::string key;
+        int64_t lastAccess;
+        int64_t size;
+    };
+    std::lock_guard<std::mutex> l(cacheLock);
+    DIR *dir = opendir(cacheDir);
+    if (dir == nullptr) {
+        return;
+    }
+    std::string dirPath = cacheDir;
+    std::vector<CacheEntry> entries;
+    int64_t totalSize = 0;
+    size_t suffixLen = strlen(CACHE_INDEX_FILE_SUFFIX);
+    struct dirent *d;
+    while ((d = readdir(dir)) != nullptr) {
+        size_t nameLen = strlen(d->d_name);
+        if (nameLen <= suffixLen || strcmp(d->d_name + nameLen - suffixLen, CACHE_INDEX_FILE_SUFFIX) != 0) {
+            continue;
+        }
+        std::string key(d->d_name, nameLen - suffixLen);
+        struct stat indexSt {};
+        struct stat dataSt {};
+        if (stat((dirPath + "/" + key + CACHE_INDEX_FILE_SUFFIX).c_str(), &indexSt) != 0) {
+            continue;
+        }
+        int64_t size = indexSt.st_size;
+        if (stat((dirPath + "/" + key + CACHE_DATA_FILE_SUFFIX).c_str(), &dataSt) == 0) {
+            // Sparse file, count allocated blocks.
+            size += (int64_t) dataSt.st_blocks * 512;
+        }
+        totalSize += size;
+        entries.push_back({key, (int64_t) indexSt.st_mtime, size});
+    }
+    closedir(dir);
+    if (totalSize <= maxCacheSize) {
+        return;
+    }
+    std::sort(entries.begin(), entries.end(), [](const CacheEntry &a, const CacheEntry &b) {
+        return a.lastAccess < b.lastAccess;
+    });
+    for (auto &e : entries) {
+        if (totalSize <= maxCacheSize) {
+            break;
+        }
+        if (cacheKeysInUse.count(e.key) > 0) {
+            continue;
+        }
+        unlink((dirPath + "/" + e.key + CACHE_INDEX_FILE_SUFFIX).c_str());
+        unlink((dirPath + "/" + e.key + CACHE_DATA_FILE_SUFFIX).c_str());
+        unlink((dirPath + "/" + e.key + CACHE_LOCK_FILE_SUFFIX).c_str());
+        totalSize -= e.size;
+        LOGD("Evict media cache: %s, size=%lld", e.key.c_str(), (long long) e.size);
+    }
+}
+
+bool tMediaCacheIO::open(const char *url_, const AVIOInterruptCB *cb, AVDictionary **options, const char *cacheDir_, int64_t maxCacheSize_) {
+    this->url = url_;
+    if (cb != nullptr) {
+        interruptCb = *cb;
+    }
+    if (options != nullptr) {
+        av_dict_copy(&upstreamOptions, *options, 0);
+    }
+    this->cacheDir = cacheDir_;
+    this->maxCacheSize = maxCacheSize_;
+    this->key = cacheKeyOf(url_);
+    mkdir(cacheDir_, 0700);
+    {
+        std::lock_guard<std::mutex> l(cacheLock);
+        cacheKeysInUse.insert(key);
+    }
+    std::string dataPath = cacheDir + "/" + key + CACHE_DATA_FILE_SUFFIX;
+    dataFd = ::open(dataPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (dataFd < 0) {
+        LOGE("Open cache data file fail: %d", errno);
+        release();
+        return false;
+    }
+    // Mark data file in use, waits if other player is truncating it.
+    flock(dataFd, LOCK_SH);
+    if (loadIndex()) {
+        // Update last access time.
+        utimensat(AT_FDCWD, (cacheDir + "/" + key + CACHE_INDEX_FILE_SUFFIX).c_str(), nullptr, 0);
+    } else {
+        // Other player may be filling the data file before its first index save, keep its data then.
+        resetCache();
+    }
+    if (contentLength <= 0) {
+        // Need content length to cache.
+        int ret = openUpstream();
+        if (ret < 0) {
+            release();
+            return false;
+        }
+    }
+    evictMediaCache(cacheDir_, maxCacheSize);
+
+    auto avioBuffer = static_cast<uint8_t *>(av_malloc(CACHE_AVIO_BUFFER_SIZE));
+    if (avioBuffer == nullptr) {
+        release();
+        return false;
+    }
+    avio = avio_alloc_context(avioBuffer, CACHE_AVIO_BUFFER_SIZE, 0, this, cacheIORead, nullptr, cacheIOSeek);
+    if (avio == nullptr) {
+        av_free(avioBuffer);
+        release();
+        return false;
+    }
+    avio->seekable = cacheEnabled ? AVIO_SEEKABLE_NORMAL : upstream->seekable;
+    int64_t cachedBytes = 0;
+    for (auto &r : ranges) {
+        cachedBytes += r.second - r.first;
+    }
+    LOGD("Cache io opened: key=%s, contentLength=%lld, cached=%lld, ranges=%d, cacheEnabled=%d",
+         key.c_str(), (long long) contentLength, (long long) cachedBytes, (int) ranges.size(), cacheEnabled);
+    return true;
+}
+
+int tMediaCacheIO::openUpstream() {
+    if (upstream != nullptr) {
+        return 0;
+    }
+    AVDictionary *opts = nullptr;
+    av_dict_copy(&opts, upstreamOptions, 0);
+    int ret = avio_open2(&upstream, url.c_str(), AVIO_FLAG_READ, &interruptCb, &opts);
+    av_dict_free(&opts);
+    if (ret < 0) {
+        LOGE("Cache io open upstream fail: %d", ret);
+        upstream = nullptr;
+        return ret;
+    }
+    upstreamPos = 0;
+    int64_t size = avio_size(upstream);
+    if (size <= 0 || !(upstream->seekable & AVIO_SEEKABLE_NORMAL)) {
+        // Live stream, read through.
+        cacheEnabled = false;
+        contentLength = size;
+    } else if (contentLength > 0 && contentLength != size) {
+        LOGE("Cache io content length changed: %lld -> %lld, reset cache.", (long long) contentLength, (long long) size);
+        if (!resetCache()) {
+            // Other players use cached old content, read through.
+            cacheEnabled = false;
+        }
+        contentLength = size;
+    } else {
+        contentLength = size;
+    }
+    return 0;
+}
+
+int tMediaCacheIO::read(uint8_t *buf, int size) {
+    if (contentLength > 0 && position >= contentLength) {
+        return AVERROR_EOF;
+    }
+    int64_t limit = size;
+    if (cacheEnabled) {
+        auto next = ranges.upper_bound(position);
+        if (next != ranges.begin()) {
+            auto cached = std::prev(next);
+            if (position < cached->second) {
+                // Cache hit.
+                int64_t n = std::min(limit, cached->second - position);
+                ssize_t ret;
+                do {
+                    ret = pread(dataFd, buf, (size_t) n, position);
+                } while (ret < 0 && errno == EINTR);
+                if (ret > 0) {
+                    position += ret;
+                    hitBytes += ret;
+                    return (int) ret;
+                }
+                // Cache file broken, drop it and fetch from network.
+                LOGE("Cache io read cache file fail: %d", errno);
+                if (!resetCache()) {
+                    cacheEnabled = false;
+                }
+                next = ranges.end();
+            }
+        }
+        // Only fetch missing bytes before next cached range.
+        if (next != ranges.end() && next->first - position < limit) {
+            limit = next->first - position;
+        }
+    }
+    int ret = openUpstream();
+    if (ret < 0) {
+        return ret;
+    }
+    if (upstreamPos != position) {
+        int64_t seekRet = avio_seek(upstream, position, SEEK_SET);
+        if (seekRet < 0) {
+            return (int) seekRet;
+        }
+        upstreamPos = position;
+    }
+    ret = avio_read_partial(upstream, buf, (int) limit);
+    if (ret == 0 && avio_feof(upstream)) {
+        return AVERROR_EOF;
+    }
+    if (ret <= 0) {
+        return ret;
+    }
+    if (cacheEnabled) {
+        ssize_t written;
+        do {
+            written = pwrite(dataFd, buf, ret, position);
+        } while (written < 0 && errno == EINTR);
+        if (written == ret) {
+            addRange(position, position + ret);
+            unsavedBytes += ret;
+            if (unsavedBytes >= CACHE_INDEX_SAVE_INTERVAL_BYTES) {
+                saveIndex();
+            }
+        } else {
+            LOGE("Cache io write cache file fail: %d", errno);
+        }
+    }
+    position += ret;
+    upstreamPos += ret;
+    missBytes += ret;
+    return ret;
+}
+
+int64_t tMediaCacheIO::seek(int64_t offset, int whence) {
+    if (whence == AVSEEK_SIZE) {
+        return contentLength;
+    }
+    int64_t target;
+    switch (whence & ~AVSEEK_FORCE) {
+        case SEEK_SET:
+            target = offset;
+            break;
+        case SEEK_CUR:
+            target = position + offset;
+            break;
+        case SEEK_END:
+            if (contentLength <= 0) {
+                return AVERROR(ENOSYS);
+            }
+            target = contentLength + offset;
+            break;
+        default:
+            return AVERROR(EINVAL);
+    }
+    if (target < 0) {
+        return AVERROR(EINVAL);
+    }
+    if (!cacheEnabled && upstream != nullptr) {
+        // Read through, seek upstream directly.
+        int64_t ret = avio_seek(upstream, target, SEEK_SET);
+        if (ret < 0) {
+            return ret;
+        }
+        upstreamPos = target;
+    }
+    // Upstream is seeked lazily on next cache miss.
+    position = target;
+    return position;
+}
+
+void tMediaCacheIO::addRange(int64_t start, int64_t end) {
+    auto it = ranges.upper_bound(start);
+    if (it != ranges.begin()) {
+        auto prev = std::prev(it);
+        if (prev->second >= start) {
+            start = prev->first;
+            end = std::max(end, prev->second);
+            it = ranges.erase(prev);
+        }
+    }
+    while (it != ranges.end() && it->first <= end) {
+        end = std::max(end, it->second);
+        it = ranges.erase(it);
+    }
+    ranges[start] = end;
+}
+
+/**
+ * Read ranges saved in index file, ranges are not merged.
+ */
+static bool readIndexFile(const std::string &indexPath, int64_t *length, std::vector<std::pair<int64_t, int64_t>> *out) {
+    FILE *f = fopen(indexPath.c_str(), "rb");
+    if (f == nullptr) {
+        return false;
+    }
+    uint32_t magic = 0;
+    int32_t count = 0;
+    bool success = fread(&magic, sizeof(magic), 1, f) == 1 && magic == CACHE_INDEX_MAGIC &&
+                   fread(length, sizeof(*length), 1, f) == 1 &&
+                   fread(&count, sizeof(count), 1, f) == 1 && count >= 0;
+    for (int32_t i = 0; success && i < count; i ++) {
+        int64_t r[2];
+        if (fread(r, sizeof(int64_t), 2, f) != 2 || r[0] < 0 || r[1] <= r[0] || r[1] > *length) {
+            success = false;
+            break;
+        }
+        out->emplace_back(r[0], r[1]);
+    }
+    fclose(f);
+    return success;
+}
+
+bool tMediaCacheIO::loadIndex() {
+    int64_t length = -1;
+    std::vector<std::pair<int64_t, int64_t>> saved;
+    ranges.clear();
+    if (!readIndexFile(cacheDir + "/" + key + CACHE_INDEX_FILE_SUFFIX, &length, &saved)) {
+        return false;
+    }
+    for (auto &r : saved) {
+        addRange(r.first, r.second);
+    }
+    contentLength = length;
+    return true;
+}
+
+void tMediaCacheIO::saveIndex() {
+    if (!cacheEnabled || contentLength <= 0 || dataFd < 0) {
+        return;
+    }
+    std::string indexPath = cacheDir + "/" + key + CACHE_INDEX_FILE_SUFFIX;
+    std::string tmpPath = indexPath + ".tmp";
+    // Index is replaced by rename, lock a separate file. Players of the same media save one by one.
+    int lockFd = ::open((cacheDir + "/" + key + CACHE_LOCK_FILE_SUFFIX).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (lockFd < 0) {
+        LOGE("Cache io open index lock fail: %d", errno);
+        return;
+    }
+    flock(lockFd, LOCK_EX);
+    // Merge ranges saved by other players of the same content, they synced the data before saving.
+    int64_t savedLength = -1;
+    std::vector<std::pair<int64_t, int64_t>> saved;
+    if (readIndexFile(indexPath, &savedLength, &saved) && savedLength == contentLength) {
+        for (auto &r : saved) {
+            addRange(r.first, r.second);
+        }
+    }
+    FILE *f = fopen(tmpPath.c_str(), "wb");
+    if (f == nullptr) {
+        LOGE("Cache io save index fail: %d", errno);
+        flock(lockFd, LOCK_UN);
+        close(lockFd);
+        return;
+    }
+    uint32_t magic = CACHE_INDEX_MAGIC;
+    auto count = (int32_t) ranges.size();
+    bool success = fwrite(&magic, sizeof(magic), 1, f) == 1 &&
+                   fwrite(&contentLength, sizeof(contentLength), 1, f) == 1 &&
+                   fwrite(&count, sizeof(count), 1, f) == 1;
+    for (auto &r : ranges) {
+        if (!success) {
+            break;
+        }
+        int64_t v[2] = {r.first, r.second};
+        success = fwrite(v, sizeof(int64_t), 2, f) == 2;
+    }
+    // Ranges in index must be on disk.
+    fdatasync(dataFd);
+    success = fclose(f) == 0 && success;
+    if (success) {
+        rename(tmpPath.c_str(), indexPath.c_str());
+        unsavedBytes = 0;
+    } else {
+        unlink(tmpPath.c_str());
+    }
+    flock(lockFd, LOCK_UN);
+    close(lockFd);
+}
+
+bool tMediaCacheIO::resetCache() {
+    ranges.clear();
+    unsavedBytes = 0;
+    if (dataFd < 0) {
+        return true;
+    }
+    // Each opened cache io holds a shared lock, exclusive lock fails if others use the data.
+    if (flock(dataFd, LOCK_EX | LOCK_NB) != 0) {
+        LOGE("Cache io reset skipped, data file used by other players.");
+        return false;
+    }
+    ftruncate(dataFd, 0);
+    unlink((cacheDir + "/" + key + CACHE_INDEX_FILE_SUFFIX).c_str());
+    flock(dataFd, LOCK_SH);
+    return true;
+}
+
+void tMediaCacheIO::release() {
+    if (avio != nullptr) {
+        LOGD("Cache io stats: key=%s, hit=%.2fMB, miss=%.2fMB",
+             key.c_str(), (double) hitBytes / (1024.0 * 1024.0), (double) missBytes / (1024.0 * 1024.0));
+        av_freep(&avio->buffer);
+        avio_context_free(&avio);
+        avio = nullptr;
+    }
+    if (upstream != nullptr) {
+        avio_closep(&upstream);
+    }
+    if (dataFd >= 0) {
+        if (unsavedBytes > 0) {
+            saveIndex();
+        }
+        // Not cached data is deleted, unless other players still open the file.
+        if (!cacheEnabled && flock(dataFd, LOCK_EX | LOCK_NB) == 0) {
+            unlink((cacheDir + "/" + key + CACHE_DATA_FILE_SUFFIX).c_str());
+            unlink((cacheDir + "/" + key + CACHE_INDEX_FILE_SUFFIX).c_str());
+        }
+        close(dataFd);
+        dataFd = -1;
+    }
+    if (upstreamOptions != nullptr) {
+        av_dict_free(&upstreamOptions);
+    }
+    if (!key.empty()) {
+        {
+            std::lock_guard<std::mutex> l(cacheLock);
+            auto it = cacheKeysInUse.find(key);
+            if (it != cacheKeysInUse.end()) {
+                cacheKeysInUse.erase(it);
+            }
+        }
+        evictMediaCache(cacheDir.c_str(), maxCacheSize);
+        key.clear();
+    }
+}
@@ -0,0 +1,495 @@
+#include <cerrno>
+#include <chrono>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "tmediaplayer.h"
+#include "tmediaio.h"
+
+static int64_t ioNowInMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const char * localFilePath(const char *url) {
+    if (url == nullptr) {
+        return nullptr;
+    }
+    if (url[0] == '/') {
+        return url;
+    }
+    if (!strncmp(url, "file://", 7) && url[7] == '/') {
+        return url + 7;
+    }
+    if (!strncmp(url, "file:", 5) && url[5] == '/') {
+        return url + 5;
+    }
+    return nullptr;
+}
+
+// region AVIOContext callbacks
+static int localIORead(void *opaque, uint8_t *buf, int size) {
+    auto io = static_cast<tMediaLocalIO *>(opaque);
+    return io->read(buf, size);
+}
+
+static int64_t localIOSeek(void *opaque, int64_t offset, int whence) {
+    auto io = static_cast<tMediaLocalIO *>(opaque);
+    return io->seek(offset, whence);
+}
+// endregion
+
+bool tMediaLocalIO::open(const char *path, int32_t bufferSize_, bool enableMmap) {
+    fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOGE("Local io open %s fail: %d", path, errno);
+        return false;
+    }
+    struct stat st {};
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        LOGE("Local io %s is not regular file.", path);
+        release();
+        return false;
+    }
+    fileSize = st.st_size;
+    position = 0;
+    stats = tMediaIOStats();
+    stats.openTimeInMicros = ioNowInMicros();
+
+    if (enableMmap && fileSize > 0 && (sizeof(void *) >= 8 || fileSize <= LOCAL_IO_MAX_MMAP_SIZE_32BITS)) {
+        void *addr = mmap(nullptr, (size_t) fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            mapped = static_cast<uint8_t *>(addr);
+            madvise(mapped, (size_t) fileSize, MADV_SEQUENTIAL);
+            stats.syscallCount += 2;
+            readAheadEnd = 0;
+            hintReadAhead();
+        } else {
+            LOGE("Local io mmap fail: %d, fallback to buffered read.", errno);
+        }
+    }
+    int32_t avioBufferSize;
+    if (mapped != nullptr) {
+        avioBufferSize = LOCAL_IO_MMAP_AVIO_BUFFER_SIZE;
+    } else {
+        this->bufferSize = bufferSize_ < LOCAL_IO_MIN_BUFFER_SIZE ? LOCAL_IO_MIN_BUFFER_SIZE : bufferSize_;
+        avioBufferSize = this->bufferSize;
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        stats.syscallCount ++;
+    }
+    auto avioBuffer = static_cast<uint8_t *>(av_malloc(avioBufferSize));
+    if (avioBuffer == nullptr) {
+        release();
+        return false;
+    }
+    avio = avio_alloc_context(avioBuffer, avioBufferSize, 0, this, localIORead, nullptr, localIOSeek);
+    if (avio == nullptr) {
+        av_free(avioBuffer);
+        release();
+        return false;
+    }
+    avio->seekable = AVIO_SEEKABLE_NORMAL;
+    LOGD("Local io opened: %s, size=%lld, mmap=%d, bufferSize=%d", path, (long long) fileSize, mapped != nullptr, avioBufferSize);
+    return true;
+}
+
+int tMediaLocalIO::read(uint8_t *buf, int size) {
+    if (position >= fileSize) {
+        return AVERROR_EOF;
+    }
+    int64_t start = ioNowInMicros();
+    int64_t remain = fileSize - position;
+    int readSize = remain < size ? (int) remain : size;
+    if (mapped != nullptr) {
+        memcpy(buf, mapped + position, readSize);
+        position += readSize;
+        hintReadAhead();
+    } else {
+        ssize_t ret;
+        do {
+            ret = pread(fd, buf, readSize, position);
+            stats.syscallCount ++;
+        } while (ret < 0 && errno == EINTR);
+        if (ret < 0) {
+            LOGE("Local io read fail: %d", errno);
+            return AVERROR(errno);
+        }
+        if (ret == 0) {
+            return AVERROR_EOF;
+        }
+        readSize = (int) ret;
+        position += readSize;
+    }
+    stats.bytesRead += readSize;
+    stats.readCount ++;
+    stats.readCostInMicros += ioNowInMicros() - start;
+    return readSize;
+}
+
+int64_t tMediaLocalIO::seek(int64_t offset, int whence) {
+    if (whence == AVSEEK_SIZE) {
+        return fileSize;
+    }
+    int64_t target;
+    switch (whence & ~AVSEEK_FORCE) {
+        case SEEK_SET:
+            target = offset;
+            break;
+        case SEEK_CUR:
+            target = position + offset;
+            break;
+        case SEEK_END:
+            target = fileSize + offset;
+            break;
+        default:
+            return AVERROR(EINVAL);
+    }
+    if (target < 0) {
+        return AVERROR(EINVAL);
+    }
+    stats.seekCount ++;
+    position = target;
+    if (mapped != nullptr) {
+        // New read position, restart read ahead hint.
+        readAheadEnd = 0;
+        hintReadAhead();
+    }
+    return position;
+}
+
+void tMediaLocalIO::hintReadAhead() {
+    if (mapped == nullptr || position >= fileSize) {
+        return;
+    }
+    // Hint again when half of the window consumed, no more hint after file end hinted.
+    if (readAheadEnd > 0 && (readAheadEnd >= fileSize || readAheadEnd - position > LOCAL_IO_READ_AHEAD_WINDOW / 2)) {
+        return;
+    }
+    static const int64_t pageSize = sysconf(_SC_PAGESIZE);
+    int64_t start = (position > readAheadEnd ? position : readAheadEnd) & ~(pageSize - 1);
+    int64_t end = position + LOCAL_IO_READ_AHEAD_WINDOW;
+    if (end > fileSize) {
+        end = fileSize;
+    }
+    if (end > start) {
+        madvise(mapped + start, (size_t) (end - start), MADV_WILLNEED);
+        stats.syscallCount ++;
+    }
+    readAheadEnd = end;
+}
+
+void tMediaLocalIO::logStats() const {
+    double wallSeconds = (double) (ioNowInMicros() - stats.openTimeInMicros) / 1000000.0;
+    double readSeconds = (double) stats.readCostInMicros / 1000000.0;
+    double mb = (double) stats.bytesRead / (1024.0 * 1024.0);
+    LOGD("Local io stats: mmap=%d, read=%.2fMB, reads=%lld, seeks=%lld, syscalls=%lld, throughput=%.2fMB/s, syscalls/s=%.2f",
+         mapped != nullptr,
+         mb,
+         (long long) stats.readCount,
+         (long long) stats.seekCount,
+         (long long) stats.syscallCount,
+         readSeconds > 0.0 ? mb / readSeconds : 0.0,
+         wallSeconds > 0.0 ? (double) stats.syscallCount / wallSeconds : 0.0);
+}
+
+void tMediaLocalIO::release() {
+    if (avio != nullptr) {
+        logStats();
+        av_freep(&avio->buffer);
+        avio_context_free(&avio);
+        avio = nullptr;
+    }
+    if (mapped != nullptr) {
+        munmap(mapped, (size_t) fileSize);
+        mapped = nullptr;
+    }
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+    fileSize = 0;
+    position = 0;
+}
+
+// region Read ahead io
+bool isReadAheadUrl(const char *url) {
+    if (url == nullptr) {
+        return false;
+    }
+    if (strncmp(url, "http://", 7) != 0 && strncmp(url, "https://", 8) != 0) {
+        return false;
+    }
+    return strstr(url, ".m3u8") == nullptr;
+}
+
+static int readAheadInterrupt(void *opaque) {
+    auto io = static_cast<tMediaReadAheadIO *>(opaque);
+    return io->isInterrupted();
+}
+
+static int readAheadIORead(void *opaque, uint8_t *buf, int size) {
+    auto io = static_cast<tMediaReadAheadIO *>(opaque);
+    return io->read(buf, size);
+}
+
+static int64_t readAheadIOSeek(void *opaque, int64_t offset, int whence) {
+    auto io = static_cast<tMediaReadAheadIO *>(opaque);
+    return io->seek(offset, whence);
+}
+
+AVIOInterruptCB tMediaReadAheadIO::sourceInterruptCallback() {
+    return {readAheadInterrupt, this};
+}
+
+bool tMediaReadAheadIO::open(const char *url, AVIOContext *externalSource, const AVIOInterruptCB *cb, AVDictionary **options, int64_t bufferSize, int64_t lowWatermark_, int64_t highWatermark_) {
+    if (cb != nullptr) {
+        interruptCb = *cb;
+    }
+    stats = tMediaIOStats();
+    stats.openTimeInMicros = ioNowInMicros();
+    if (externalSource != nullptr) {
+        source = externalSource;
+        ownSource = false;
+    } else {
+        AVIOInterruptCB sourceCb = sourceInterruptCallback();
+        AVDictionary *sourceOpts = nullptr;
+        if (options != nullptr) {
+            av_dict_copy(&sourceOpts, *options, 0);
+        }
+        int ret = avio_open2(&source, url, AVIO_FLAG_READ, &sourceCb, &sourceOpts);
+        av_dict_free(&sourceOpts);
+        if (ret < 0) {
+            LOGE("Read ahead io open source fail: %d", ret);
+            source = nullptr;
+            return false;
+        }
+        ownSource = true;
+    }
+    sourceSize = avio_size(source);
+
+    capacity = bufferSize < READ_AHEAD_MIN_BUFFER_SIZE ? READ_AHEAD_MIN_BUFFER_SIZE : bufferSize;
+    highWatermark = highWatermark_ <= 0 || highWatermark_ > capacity ? capacity : highWatermark_;
+    lowWatermark = lowWatermark_ < 0 || lowWatermark_ > highWatermark ? highWatermark : lowWatermark_;
+    ring = static_cast<uint8_t *>(av_malloc(capacity));
+    auto avioBuffer = static_cast<uint8_t *>(av_malloc(READ_AHEAD_AVIO_BUFFER_SIZE));
+    if (ring == nullptr || avioBuffer == nullptr) {
+        av_free(avioBuffer);
+        release();
+        return false;
+    }
+    avio = avio_alloc_context(avioBuffer, READ_AHEAD_AVIO_BUFFER_SIZE, 0, this, readAheadIORead, nullptr, readAheadIOSeek);
+    if (avio == nullptr) {
+        av_free(avioBuffer);
+        release();
+        return false;
+    }
+    avio->seekable = source->seekable;
+    validStart = readPos = writePos = 0;
+    ioThread = std::thread([this] {
+        pthread_setname_np(pthread_self(), "tMP_ReadAhead");
+        ioLoop();
+    });
+    LOGD("Read ahead io opened: size=%lld, buffer=%lld, lowWatermark=%lld, highWatermark=%lld",
+         (long long) sourceSize, (long long) capacity, (long long) lowWatermark, (long long) highWatermark);
+    return true;
+}
+
+void tMediaReadAheadIO::ioLoop() {
+    // Source reads accumulated as one throughput sample.
+    int64_t sampleBytes = 0;
+    int64_t sampleCostInMicros = 0;
+    std::unique_lock<std::mutex> l(lock);
+    while (!stopped) {
+        if (seekDoneSerial != seekRequestSerial) {
+            int64_t serial = seekRequestSerial;
+            int64_t target = seekTarget;
+            l.unlock();
+            int64_t ret = avio_seek(source, target, SEEK_SET);
+            l.lock();
+            stats.syscallCount ++;
+            stats.seekCount ++;
+            if (ret >= 0) {
+                validStart = readPos = writePos = target;
+                eof = false;
+                error = 0;
+                filling = true;
+            }
+            seekResult = ret;
+            seekDoneSerial = serial;
+            readerCond.notify_all();
+            continue;
+        }
+        int64_t buffered = writePos - readPos;
+        if (buffered >= highWatermark) {
+            filling = false;
+        } else if (buffered < lowWatermark) {
+            filling = true;
+        }
+        if (!filling || eof || error != 0) {
+            writerCond.wait(l);
+            continue;
+        }
+        int64_t index = writePos % capacity;
+        int64_t n = capacity - buffered;
+        if (n > capacity - index) {
+            n = capacity - index;
+        }
+        if (n > READ_AHEAD_CHUNK_SIZE) {
+            n = READ_AHEAD_CHUNK_SIZE;
+        }
+        // Bytes will be overwritten, backward seek can't use them.
+        if (writePos + n - capacity > validStart) {
+            validStart = writePos + n - capacity;
+        }
+        l.unlock();
+        int64_t readStart = ioNowInMicros();
+        int ret = avio_read_partial(source, ring + index, (int) n);
+        if (ret > 0 && buffering != nullptr) {
+            sampleBytes += ret;
+            sampleCostInMicros += ioNowInMicros() - readStart;
+            if (sampleBytes >= BUFFERING_IO_MIN_SAMPLE_BYTES) {
+                buffering->onIORead(sampleBytes, sampleCostInMicros);
+                sampleBytes = 0;
+                sampleCostInMicros = 0;
+            }
+        }
+        l.lock();
+        stats.syscallCount ++;
+        if (ret > 0) {
+            writePos += ret;
+            stats.bytesRead += ret;
+            stats.readCount ++;
+        } else if (ret == AVERROR_EOF || (ret == 0 && avio_feof(source))) {
+            eof = true;
+        } else if (ret < 0) {
+            LOGE("Read ahead io read source fail: %d", ret);
+            error = ret;
+        }
+        readerCond.notify_all();
+    }
+}
+
+int tMediaReadAheadIO::read(uint8_t *buf, int size) {
+    int64_t start = ioNowInMicros();
+    std::unique_lock<std::mutex> l(lock);
+    while (readPos >= writePos) {
+        if (eof) {
+            return AVERROR_EOF;
+        }
+        if (error != 0) {
+            return error;
+        }
+        if (isInterrupted()) {
+            return AVERROR_EXIT;
+        }
+        readerCond.wait_for(l, std::chrono::milliseconds(READ_AHEAD_WAIT_INTERVAL_IN_MILLIS));
+    }
+    int64_t index = readPos % capacity;
+    int64_t n = writePos - readPos;
+    if (n > capacity - index) {
+        n = capacity - index;
+    }
+    if (n > size) {
+        n = size;
+    }
+    // Writer never writes unread bytes, copy without lock.
+    l.unlock();
+    memcpy(buf, ring + index, n);
+    l.lock();
+    readPos += n;
+    if (!filling && writePos - readPos < lowWatermark) {
+        writerCond.notify_one();
+    }
+    stats.readCostInMicros += ioNowInMicros() - start;
+    return (int) n;
+}
+
+int64_t tMediaReadAheadIO::seek(int64_t offset, int whence) {
+    if (whence == AVSEEK_SIZE) {
+        return sourceSize;
+    }
+    std::unique_lock<std::mutex> l(lock);
+    int64_t target;
+    switch (whence & ~AVSEEK_FORCE) {
+        case SEEK_SET:
+            target = offset;
+            break;
+        case SEEK_CUR:
+            target = readPos + offset;
+            break;
+        case SEEK_END:
+            if (sourceSize < 0) {
+                return AVERROR(ENOSYS);
+            }
+            target = sourceSize + offset;
+            break;
+        default:
+            return AVERROR(EINVAL);
+    }
+    if (target < 0) {
+        return AVERROR(EINVAL);
+    }
+    if (target >= validStart && target <= writePos) {
+        // Buffered, no network request.
+        readPos = target;
+        writerCond.notify_one();
+        return target;
+    }
+    seekTarget = target;
+    int64_t serial = ++ seekRequestSerial;
+    writerCond.notify_one();
+    while (seekDoneSerial < serial) {
+        if (isInterrupted()) {
+            return AVERROR_EXIT;
+        }
+        readerCond.wait_for(l, std::chrono::milliseconds(READ_AHEAD_WAIT_INTERVAL_IN_MILLIS));
+    }
+    return seekResult;
+}
+
+int64_t tMediaReadAheadIO::bufferedBytes() {
+    std::lock_guard<std::mutex> l(lock);
+    return writePos - readPos;
+}
+
+bool tMediaReadAheadIO::isInterrupted() const {
+    if (stopped) {
+        return true;
+    }
+    return interruptCb.callback != nullptr && interruptCb.callback(interruptCb.opaque);
+}
+
+void tMediaReadAheadIO::release() {
+    {
+        std::lock_guard<std::mutex> l(lock);
+        stopped = true;
+        writerCond.notify_all();
+        readerCond.notify_all();
+    }
+    if (ioThread.joinable()) {
+        ioThread.join();
+    }
+    if (avio != nullptr) {
+        double wallSeconds = (double) (ioNowInMicros() - stats.openTimeInMicros) / 1000000.0;
+        LOGD("Read ahead io stats: read=%.2fMB, sourceReads=%lld, seeks=%lld, waitAndCopy=%lldms, duration=%.2fs",
+             (double) stats.bytesRead / (1024.0 * 1024.0),
+             (long long) stats.readCount,
+             (long long) stats.seekCount,
+             (long long) (stats.readCostInMicros / 1000),
+             wallSeconds);
+        av_freep(&avio->buffer);
+        avio_context_free(&avio);
+        avio = nullptr;
+    }
+    if (source != nullptr) {
+        if (ownSource) {
+            avio_closep(&source);
+        }
+        source = nullptr;
+    }
+    if (ring != nullptr) {
+        av_freep(&ring);
+    }
+}
+// endregion
@@ -0,0 +1,102 @@
+#include <algorithm>
+#include "tmediakeyframeindex.h"
+
+static bool comparePts(const KeyframeEntry &e, int64_t pts) {
+    return e.pts < pts;
+}
+
+static void addCoveredRange(std::vector<KeyframeRange> &ranges, int64_t start, int64_t end) {
+    // First range ends at or after start.
+    auto it = std::lower_bound(ranges.begin(), ranges.end(), start, [](const KeyframeRange &r, int64_t v) { return r.end < v; });
+    if (it == ranges.end() || it->start > end) {
+        KeyframeRange range;
+        range.start = start;
+        range.end = end;
+        ranges.insert(it, range);
+        return;
+    }
+    it->start = std::min(it->start, start);
+    it->end = std::max(it->end, end);
+    auto next = it + 1;
+    while (next != ranges.end() && next->start <= it->end) {
+        it->end = std::max(it->end, next->end);
+        next = ranges.erase(next);
+    }
+}
+
+void tMediaKeyframeIndex::add(int64_t pts, int64_t pos, int32_t size_) {
+    std::lock_guard<std::mutex> lockGuard(lock);
+    // Coverage counts keyframes not indexed because of min interval or max size, they were read.
+    if (runLastPts >= 0 && pts > runLastPts) {
+        addCoveredRange(coveredRanges, runLastPts, pts);
+    }
+    runLastPts = pts;
+    if (entries.size() >= KEYFRAME_INDEX_MAX_SIZE) {
+        return;
+    }
+    KeyframeEntry entry;
+    entry.pts = pts;
+    entry.pos = pos;
+    entry.size = size_;
+    // Most packets are read in order.
+    if (entries.empty() || pts > entries.back().pts) {
+        if (!entries.empty() && pts - entries.back().pts < KEYFRAME_INDEX_MIN_INTERVAL_IN_MILLIS) {
+            return;
+        }
+        entries.push_back(entry);
+        return;
+    }
+    // Read again after seeking.
+    auto it = std::lower_bound(entries.begin(), entries.end(), pts, comparePts);
+    if (it != entries.end() && it->pts - pts < KEYFRAME_INDEX_MIN_INTERVAL_IN_MILLIS) {
+        return;
+    }
+    if (it != entries.begin() && pts - (it - 1)->pts < KEYFRAME_INDEX_MIN_INTERVAL_IN_MILLIS) {
+        return;
+    }
+    entries.insert(it, entry);
+}
+
+bool tMediaKeyframeIndex::findBefore(int64_t pts, KeyframeEntry *out) {
+    std::lock_guard<std::mutex> lockGuard(lock);
+    auto it = std::lower_bound(entries.begin(), entries.end(), pts, comparePts);
+    if (it != entries.end() && it->pts == pts) {
+        *out = *it;
+        return true;
+    }
+    if (it == entries.begin()) {
+        return false;
+    }
+    *out = *(it - 1);
+    return true;
+}
+
+bool tMediaKeyframeIndex::findAfter(int64_t pts, KeyframeEntry *out) {
+    std::lock_guard<std::mutex> lockGuard(lock);
+    auto it = std::lower_bound(entries.begin(), entries.end(), pts, comparePts);
+    if (it == entries.end()) {
+        return false;
+    }
+    *out = *it;
+    return true;
+}
+
+void tMediaKeyframeIndex::onDiscontinuity() {
+    std::lock_guard<std::mutex> lockGuard(lock);
+    runLastPts = -1L;
+}
+
+bool tMediaKeyframeIndex::isCovered(int64_t startPts, int64_t endPts) {
+    std::lock_guard<std::mutex> lockGuard(lock);
+    // Last range starts at or before startPts.
+    auto it = std::upper_bound(coveredRanges.begin(), coveredRanges.end(), startPts, [](int64_t v, const KeyframeRange &r) { return v < r.start; });
+    if (it == coveredRanges.begin()) {
+        return false;
+    }
+    return (it - 1)->end >= endPts;
+}
+
+int32_t tMediaKeyframeIndex::size() {
+    std::lock_guard<std::mutex> lockGuard(lock);
+    return (int32_t) entries.size();
+}
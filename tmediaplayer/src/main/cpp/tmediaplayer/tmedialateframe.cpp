@@ -0,0 +1,89 @@
+#include "tmedialateframe.h"
+
+static AVDiscard stageToDiscard(int32_t stage) {
+    switch (stage) {
+        case LateFrameStageSkipNonRef:
+            return AVDISCARD_NONREF;
+        case LateFrameStageSkipBidir:
+            return AVDISCARD_BIDIR;
+        default:
+            return AVDISCARD_DEFAULT;
+    }
+}
+
+void tMediaLateFrame::reportLateness(int64_t masterClock, int64_t latenessInMillis) {
+    masterClockInMillis.store(masterClock);
+    int32_t s = stage.load();
+    if (latenessInMillis > LATE_FRAME_BEHIND_THRESHOLD_IN_MILLIS) {
+        behindReports ++;
+        farBehindReports = latenessInMillis > LATE_FRAME_FAR_BEHIND_THRESHOLD_IN_MILLIS ? farBehindReports + 1 : 0;
+        onTimeReports = 0;
+    } else if (latenessInMillis < LATE_FRAME_ON_TIME_THRESHOLD_IN_MILLIS) {
+        behindReports = 0;
+        farBehindReports = 0;
+        onTimeReports ++;
+    }
+    if (s == LateFrameStageNone && behindReports >= LATE_FRAME_NONREF_REPORTS) {
+        s = LateFrameStageSkipNonRef;
+        behindReports = 0;
+    } else if (s == LateFrameStageSkipNonRef && farBehindReports >= LATE_FRAME_BIDIR_REPORTS) {
+        s = LateFrameStageSkipBidir;
+        farBehindReports = 0;
+    } else if (s != LateFrameStageNone && onTimeReports >= LATE_FRAME_RECOVER_REPORTS) {
+        s --;
+        onTimeReports = 0;
+    }
+    stage.store(s);
+}
+
+void tMediaLateFrame::applyToDecoder(AVCodecContext *ctx, bool sendPacket) {
+    int32_t s = stage.load();
+    auto discard = stageToDiscard(s);
+    // Keep live mode's skip_frame if it skips more.
+    if (discard > ctx->skip_frame) {
+        ctx->skip_frame = discard;
+    }
+    if (sendPacket) {
+        stagePackets[s] ++;
+    }
+}
+
+bool tMediaLateFrame::onFrameDecoded(int64_t framePtsInMillis) {
+    int32_t s = stage.load();
+    stageFrames[s] ++;
+    if (s != LateFrameStageNone && stagePackets[s] > stageFrames[s]) {
+        int64_t skipped = stagePackets[s] - stageFrames[s];
+        stagePackets[s] = 0;
+        stageFrames[s] = 0;
+        if (s == LateFrameStageSkipNonRef) {
+            skippedNonRef.fetch_add(skipped);
+        } else {
+            skippedBidir.fetch_add(skipped);
+        }
+    }
+    int64_t clock = masterClockInMillis.load();
+    if (clock >= 0 && framePtsInMillis >= 0 && framePtsInMillis + LATE_FRAME_DROP_THRESHOLD_IN_MILLIS < clock &&
+        continuousDrops < LATE_FRAME_MAX_CONTINUOUS_DROPS) {
+        continuousDrops ++;
+        droppedBeforeConvert.fetch_add(1);
+        return true;
+    }
+    continuousDrops = 0;
+    return false;
+}
+
+void tMediaLateFrame::reset() {
+    masterClockInMillis.store(-1);
+    continuousDrops = 0;
+    for (int i = 0; i < 3; i ++) {
+        stagePackets[i] = 0;
+        stageFrames[i] = 0;
+    }
+}
+
+void tMediaLateFrame::exportTo(int64_t *dst) {
+    dst[0] = stage.load();
+    dst[1] = droppedBeforeConvert.load();
+    dst[2] = skippedNonRef.load();
+    dst[3] = skippedBidir.load();
+}
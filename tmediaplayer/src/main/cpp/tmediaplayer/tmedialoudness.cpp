@@ -0,0 +1,287 @@
+#include <cmath>
+#include "tmedialoudness.h"
+
+// region Sample convert
+template <typename T>
+struct SampleTraits;
+
+template <>
+struct SampleTraits<uint8_t> {
+    static inline float toFloat(uint8_t v) { return ((float) v - 128.0f) * (1.0f / 128.0f); }
+    static inline uint8_t fromFloat(float v) {
+        float s = v * 128.0f + 128.0f;
+        s = s < 0.0f ? 0.0f : (s > 255.0f ? 255.0f : s);
+        return (uint8_t) lrintf(s);
+    }
+};
+
+template <>
+struct SampleTraits<int16_t> {
+    static inline float toFloat(int16_t v) { return (float) v * (1.0f / 32768.0f); }
+    static inline int16_t fromFloat(float v) {
+        float s = v * 32768.0f;
+        s = s < -32768.0f ? -32768.0f : (s > 32767.0f ? 32767.0f : s);
+        return (int16_t) lrintf(s);
+    }
+};
+
+template <>
+struct SampleTraits<int32_t> {
+    static inline float toFloat(int32_t v) { return (float) ((double) v * (1.0 / 2147483648.0)); }
+    static inline int32_t fromFloat(float v) {
+        double s = (double) v * 2147483648.0;
+        s = s < -2147483648.0 ? -2147483648.0 : (s > 2147483647.0 ? 2147483647.0 : s);
+        return (int32_t) llrint(s);
+    }
+};
+// endregion
+
+static inline double energyToLufs(double energy) {
+    return -0.691 + 10.0 * log10(energy);
+}
+
+static inline double lufsToEnergy(double lufs) {
+    return pow(10.0, (lufs + 0.691) / 10.0);
+}
+
+// Energy of each histogram bin center.
+static const double *histogramEnergies() {
+    static double energies[LOUDNESS_HISTOGRAM_SIZE];
+    static bool inited = [] {
+        for (int i = 0; i < LOUDNESS_HISTOGRAM_SIZE; i ++) {
+            energies[i] = lufsToEnergy(LOUDNESS_HISTOGRAM_MIN_LUFS + ((double) i + 0.5) * LOUDNESS_HISTOGRAM_BIN_LU);
+        }
+        return true;
+    }();
+    (void) inited;
+    return energies;
+}
+
+void tMediaLoudness::prepare(int32_t sampleRate_, int32_t channels_, AVSampleFormat sampleFmt_) {
+    this->sampleRate = sampleRate_;
+    this->channels = channels_ > LOUDNESS_MAX_CHANNELS ? LOUDNESS_MAX_CHANNELS : channels_;
+    this->sampleFmt = sampleFmt_;
+    this->subBlockSamples = sampleRate_ / 10;
+
+    // K weighting filter coefficients (ITU-R BS.1770), computed for any sample rate.
+    double rate = (double) sampleRate_;
+    double f0 = 1681.974450955533;
+    double G = 3.999843853973347;
+    double Q = 0.7071752369554196;
+    double K = tan(M_PI * f0 / rate);
+    double Vh = pow(10.0, G / 20.0);
+    double Vb = pow(Vh, 0.4996667741545416);
+    double a0 = 1.0 + K / Q + K * K;
+    kWeighting.b1[0] = (float) ((Vh + Vb * K / Q + K * K) / a0);
+    kWeighting.b1[1] = (float) (2.0 * (K * K - Vh) / a0);
+    kWeighting.b1[2] = (float) ((Vh - Vb * K / Q + K * K) / a0);
+    kWeighting.a1[0] = 1.0f;
+    kWeighting.a1[1] = (float) (2.0 * (K * K - 1.0) / a0);
+    kWeighting.a1[2] = (float) ((1.0 - K / Q + K * K) / a0);
+
+    f0 = 38.13547087602444;
+    Q = 0.5003270373238773;
+    K = tan(M_PI * f0 / rate);
+    a0 = 1.0 + K / Q + K * K;
+    kWeighting.b2[0] = 1.0f;
+    kWeighting.b2[1] = -2.0f;
+    kWeighting.b2[2] = 1.0f;
+    kWeighting.a2[0] = 1.0f;
+    kWeighting.a2[1] = (float) (2.0 * (K * K - 1.0) / a0);
+    kWeighting.a2[2] = (float) ((1.0 - K / Q + K * K) / a0);
+    histogramEnergies();
+    reset();
+}
+
+void tMediaLoudness::reset() {
+    hasTagGain = false;
+    tagGainDb = 0.0;
+    for (int c = 0; c < LOUDNESS_MAX_CHANNELS; c ++) {
+        kWeighting.z1[c][0] = kWeighting.z1[c][1] = 0.0f;
+        kWeighting.z2[c][0] = kWeighting.z2[c][1] = 0.0f;
+    }
+    subBlockFill = 0;
+    subBlockEnergy = 0.0;
+    subBlockCount = 0;
+    for (auto &e : subBlockEnergies) {
+        e = 0.0;
+    }
+    for (auto &h : histogram) {
+        h = 0;
+    }
+    blockCount = 0;
+    integratedLufs = LOUDNESS_HISTOGRAM_MIN_LUFS;
+    // Keep currentGain, gain ramps to new target.
+}
+
+void tMediaLoudness::setTagGain(double gainDb) {
+    hasTagGain = true;
+    tagGainDb = gainDb;
+}
+
+double tMediaLoudness::getTargetGainDb() const {
+    double gainDb;
+    if (hasTagGain) {
+        gainDb = tagGainDb;
+    } else if (blockCount >= LOUDNESS_MIN_BLOCKS && integratedLufs > LOUDNESS_HISTOGRAM_MIN_LUFS) {
+        gainDb = LOUDNESS_TARGET_LUFS - integratedLufs;
+    } else {
+        return 20.0 * log10((double) currentGain);
+    }
+    if (gainDb > LOUDNESS_MAX_GAIN_DB) {
+        gainDb = LOUDNESS_MAX_GAIN_DB;
+    }
+    if (gainDb < LOUDNESS_MIN_GAIN_DB) {
+        gainDb = LOUDNESS_MIN_GAIN_DB;
+    }
+    return gainDb;
+}
+
+void tMediaLoudness::finishSubBlock() {
+    subBlockEnergies[subBlockCount % LOUDNESS_SUB_BLOCKS_PER_BLOCK] = subBlockEnergy / (double) subBlockSamples;
+    subBlockCount ++;
+    subBlockEnergy = 0.0;
+    subBlockFill = 0;
+    if (subBlockCount < LOUDNESS_SUB_BLOCKS_PER_BLOCK) {
+        return;
+    }
+    // New 400ms gating block.
+    double blockEnergy = 0.0;
+    for (double e : subBlockEnergies) {
+        blockEnergy += e;
+    }
+    blockEnergy /= LOUDNESS_SUB_BLOCKS_PER_BLOCK;
+    if (blockEnergy <= 0.0) {
+        return;
+    }
+    double blockLufs = energyToLufs(blockEnergy);
+    // Absolute gate.
+    if (blockLufs < LOUDNESS_HISTOGRAM_MIN_LUFS) {
+        return;
+    }
+    int bin = (int) ((blockLufs - LOUDNESS_HISTOGRAM_MIN_LUFS) / LOUDNESS_HISTOGRAM_BIN_LU);
+    if (bin >= LOUDNESS_HISTOGRAM_SIZE) {
+        bin = LOUDNESS_HISTOGRAM_SIZE - 1;
+    }
+    histogram[bin] ++;
+    blockCount ++;
+
+    // Relative gate, -10 LU below absolute gated loudness.
+    auto energies = histogramEnergies();
+    double sum = 0.0;
+    uint64_t count = 0;
+    for (int i = 0; i < LOUDNESS_HISTOGRAM_SIZE; i ++) {
+        sum += (double) histogram[i] * energies[i];
+        count += histogram[i];
+    }
+    double relativeGate = energyToLufs(sum / (double) count) - 10.0;
+    int startBin = (int) ceil((relativeGate - LOUDNESS_HISTOGRAM_MIN_LUFS) / LOUDNESS_HISTOGRAM_BIN_LU);
+    if (startBin < 0) {
+        startBin = 0;
+    }
+    sum = 0.0;
+    count = 0;
+    for (int i = startBin; i < LOUDNESS_HISTOGRAM_SIZE; i ++) {
+        sum += (double) histogram[i] * energies[i];
+        count += histogram[i];
+    }
+    if (count > 0) {
+        integratedLufs = energyToLufs(sum / (double) count);
+    }
+}
+
+/**
+ * One pass over the buffer: K weighting energy and gain ramp. Inner loops are split at sub block boundaries
+ * and keep filter state in registers. K weighting biquads depend on previous output, so measuring is serial per channel.
+ */
+template <typename T, bool measure>
+static void processSamples(tMediaLoudness *loudness, T *samples, int32_t nbSamples, float gain, float gainStep) {
+    const int32_t channels = loudness->channels;
+    auto &k = loudness->kWeighting;
+    int32_t offset = 0;
+    while (offset < nbSamples) {
+        int32_t chunk = nbSamples - offset;
+        if (measure && chunk > loudness->subBlockSamples - loudness->subBlockFill) {
+            chunk = loudness->subBlockSamples - loudness->subBlockFill;
+        }
+        T *p = samples + (int64_t) offset * channels;
+        double chunkEnergy = 0.0;
+        for (int32_t c = 0; c < channels; c ++) {
+            float g = gain;
+            float z10 = k.z1[c][0], z11 = k.z1[c][1];
+            float z20 = k.z2[c][0], z21 = k.z2[c][1];
+            float energy = 0.0f;
+            for (int32_t i = 0; i < chunk; i ++) {
+                T *s = p + (int64_t) i * channels + c;
+                float x = SampleTraits<T>::toFloat(*s);
+                if (measure) {
+                    float y1 = k.b1[0] * x + z10;
+                    z10 = k.b1[1] * x - k.a1[1] * y1 + z11;
+                    z11 = k.b1[2] * x - k.a1[2] * y1;
+                    float y2 = k.b2[0] * y1 + z20;
+                    z20 = k.b2[1] * y1 - k.a2[1] * y2 + z21;
+                    z21 = k.b2[2] * y1 - k.a2[2] * y2;
+                    energy += y2 * y2;
+                }
+                *s = SampleTraits<T>::fromFloat(x * g);
+                g += gainStep;
+            }
+            k.z1[c][0] = z10; k.z1[c][1] = z11;
+            k.z2[c][0] = z20; k.z2[c][1] = z21;
+            chunkEnergy += energy;
+        }
+        gain += gainStep * (float) chunk;
+        offset += chunk;
+        if (measure) {
+            loudness->subBlockEnergy += chunkEnergy;
+            loudness->subBlockFill += chunk;
+            if (loudness->subBlockFill >= loudness->subBlockSamples) {
+                loudness->finishSubBlock();
+            }
+        }
+    }
+}
+
+template <typename T>
+static void processSamples(tMediaLoudness *loudness, T *samples, int32_t nbSamples, float gain, float gainStep, bool measure) {
+    if (measure) {
+        processSamples<T, true>(loudness, samples, nbSamples, gain, gainStep);
+    } else {
+        processSamples<T, false>(loudness, samples, nbSamples, gain, gainStep);
+    }
+}
+
+void tMediaLoudness::process(uint8_t *pcm, int32_t nbSamples, bool enabled) {
+    if (pcm == nullptr || nbSamples <= 0 || subBlockSamples <= 0) {
+        return;
+    }
+    if (!enabled && currentGain == 1.0f) {
+        return;
+    }
+    float targetGain = enabled ? (float) pow(10.0, getTargetGainDb() / 20.0) : 1.0f;
+    // Move gain to target smoothly, linear ramp in this buffer.
+    double smooth = (double) nbSamples / ((double) sampleRate * LOUDNESS_GAIN_SMOOTH_SECONDS);
+    if (smooth > 1.0) {
+        smooth = 1.0;
+    }
+    float nextGain = currentGain + (targetGain - currentGain) * (float) smooth;
+    if (fabsf(nextGain - targetGain) < 1e-4f) {
+        nextGain = targetGain;
+    }
+    float gainStep = (nextGain - currentGain) / (float) nbSamples;
+    bool measure = enabled && !hasTagGain;
+    switch (sampleFmt) {
+        case AV_SAMPLE_FMT_U8:
+            processSamples<uint8_t>(this, pcm, nbSamples, currentGain, gainStep, measure);
+            break;
+        case AV_SAMPLE_FMT_S16:
+            processSamples<int16_t>(this, reinterpret_cast<int16_t *>(pcm), nbSamples, currentGain, gainStep, measure);
+            break;
+        case AV_SAMPLE_FMT_S32:
+            processSamples<int32_t>(this, reinterpret_cast<int32_t *>(pcm), nbSamples, currentGain, gainStep, measure);
+            break;
+        default:
+            return;
+    }
+    currentGain = nextGain;
+}
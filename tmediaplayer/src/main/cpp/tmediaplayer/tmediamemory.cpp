@@ -0,0 +1,57 @@
+#include "tmediamemory.h"
+
+static std::atomic<int64_t> processBytes[MEMORY_TYPE_COUNT]{};
+static std::atomic<int64_t> processBudget{0};
+
+void tMediaMemoryTracker::add(tMediaMemoryType type, int64_t delta) {
+    if (delta == 0) {
+        return;
+    }
+    bytes[type].fetch_add(delta, std::memory_order_relaxed);
+    processBytes[type].fetch_add(delta, std::memory_order_relaxed);
+}
+
+void tMediaMemoryTracker::set(tMediaMemoryType type, int64_t value) {
+    int64_t last = bytes[type].exchange(value, std::memory_order_relaxed);
+    if (value != last) {
+        processBytes[type].fetch_add(value - last, std::memory_order_relaxed);
+    }
+}
+
+void tMediaMemoryTracker::exportTo(int64_t *dst) const {
+    for (int i = 0; i < MEMORY_TYPE_COUNT; i ++) {
+        dst[i] = bytes[i].load(std::memory_order_relaxed);
+        dst[MEMORY_TYPE_COUNT + i] = processBytes[i].load(std::memory_order_relaxed);
+    }
+    dst[MEMORY_TYPE_COUNT * 2] = processBudget.load(std::memory_order_relaxed);
+}
+
+void tMediaMemoryTracker::release() {
+    for (int i = 0; i < MEMORY_TYPE_COUNT; i ++) {
+        set(static_cast<tMediaMemoryType>(i), 0);
+    }
+}
+
+int64_t getProcessMemoryBytes() {
+    int64_t total = 0;
+    for (const auto &b : processBytes) {
+        total += b.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void setProcessMemoryBudget(int64_t budget) {
+    processBudget.store(budget > 0 ? budget : 0, std::memory_order_relaxed);
+}
+
+int64_t getProcessMemoryBudget() {
+    return processBudget.load(std::memory_order_relaxed);
+}
+
+int64_t getPacketMemoryLimit(int64_t packetBytes) {
+    int64_t budget = processBudget.load(std::memory_order_relaxed);
+    if (budget <= 0) {
+        return INT64_MAX;
+    }
+    return packetBytes + budget - getProcessMemoryBytes();
+}
@@ -1,18 +1,20 @@
 //
 // Created by pengcheng.tan on 2024/5/27.
 //
+#include <algorithm>
+#include <chrono>
 #include "tmediaplayer.h"
 #include "libavutil/hwcontext_mediacodec.h"
 
 
-AVPixelFormat hw_pix_fmt_i = AV_PIX_FMT_NONE;
-
+// Codec ctx's opaque is the VideoDecoder, multiple players could prepare decoders at the same time.
 static enum AVPixelFormat get_hw_format(AVCodecContext *ctx,
                                         const enum AVPixelFormat *pix_fmts) {
     const enum AVPixelFormat *p;
+    auto videoDecoder = static_cast<VideoDecoder *>(ctx->opaque);
 
     for (p = pix_fmts; *p != -1; p++) {
-        if (*p == hw_pix_fmt_i) {
+        if (videoDecoder != nullptr && *p == videoDecoder->hw_pix_fmt) {
             return *p;
         }
     }
@@ -20,6 +22,44 @@ static enum AVPixelFormat get_hw_format(AVCodecContext *ctx,
     return AV_PIX_FMT_NONE;
 }
 
+// region Buffers info
+void tMediaVideoBuffer::exportInfo(int64_t *dst) const {
+    bool isYuv420p = type == Yuv420p;
+    bool isNv = type == Nv12 || type == Nv21;
+    int32_t ratioBits = 0;
+    memcpy(&ratioBits, &displayRatio, sizeof(ratioBits));
+    dst[0] = pts;
+    dst[1] = duration;
+    dst[2] = type;
+    dst[3] = width;
+    dst[4] = height;
+    dst[5] = displayRotation;
+    // Java side reads it by Float.fromBits().
+    dst[6] = ratioBits;
+    dst[7] = type == Rgba ? rgbaContentSize : 0;
+    dst[8] = isYuv420p || isNv ? yContentSize : 0;
+    dst[9] = isYuv420p ? uContentSize : 0;
+    dst[10] = isYuv420p ? vContentSize : 0;
+    dst[11] = isNv ? uvContentSize : 0;
+}
+
+int64_t tMediaVideoBuffer::allocatedBytes() const {
+    int64_t bytes = 0;
+    bytes += rgbaBuffer != nullptr ? rgbaBufferSize : 0;
+    bytes += yBuffer != nullptr ? yBufferSize : 0;
+    bytes += uBuffer != nullptr ? uBufferSize : 0;
+    bytes += vBuffer != nullptr ? vBufferSize : 0;
+    bytes += uvBuffer != nullptr ? uvBufferSize : 0;
+    return bytes;
+}
+
+void tMediaAudioBuffer::exportInfo(int64_t *dst) const {
+    dst[0] = pts;
+    dst[1] = duration;
+    dst[2] = contentSize;
+}
+// endregion
+
 static void readMetadata(AVDictionary *src, Metadata *dst) {
     AVDictionaryEntry *metadataLocal = nullptr;
     int metadataCountLocal = 0;
@@ -63,14 +103,112 @@ static void releaseMetadata(Metadata *src) {
     src->metadata = nullptr;
 }
 
+static int64_t nowInMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int64_t ptsToMillis(int64_t pts, AVRational timeBase) {
+    return (int64_t) ((double) pts * av_q2d(timeBase) * 1000.0);
+}
+
+static bool isLiveUrl(const char *url) {
+    return !strncmp(url, "rtsp:", 5) ||
+           !strncmp(url, "rtsps:", 6) ||
+           !strncmp(url, "rtp:", 4) ||
+           !strncmp(url, "udp:", 4) ||
+           !strncmp(url, "srt:", 4);
+}
+
 static int decode_interrupt_cb(void *ctx)
 {
     auto *player_ctx = static_cast<tMediaPlayerContext *>(ctx);
     return player_ctx->interruptReadPkt;
 }
 
-static tMediaOptResult prepareVideoDecoder(JNIEnv * jniEnv, AVStream *videoStream, bool isRequestHw, jobject hwSurface, VideoDecoder* videoDecoder) {
-    auto codecParams = videoStream->codecpar;
+static bool isExtraDataMatch(AVCodecParameters *a, AVCodecParameters *b) {
+    if (a->extradata_size != b->extradata_size) {
+        return false;
+    }
+    return a->extradata_size <= 0 || memcmp(a->extradata, b->extradata, a->extradata_size) == 0;
+}
+
+static bool isVideoCodecParamsMatch(AVCodecParameters *a, AVCodecParameters *b) {
+    return a->codec_id == b->codec_id &&
+           a->format == b->format &&
+           a->width == b->width &&
+           a->height == b->height &&
+           a->profile == b->profile &&
+           isExtraDataMatch(a, b);
+}
+
+static bool isAudioCodecParamsMatch(AVCodecParameters *a, AVCodecParameters *b) {
+    return a->codec_id == b->codec_id &&
+           a->format == b->format &&
+           a->sample_rate == b->sample_rate &&
+           av_channel_layout_compare(&a->ch_layout, &b->ch_layout) == 0 &&
+           isExtraDataMatch(a, b);
+}
+
+// Live streams: output frames as soon as possible, frame threads add one frame delay per thread.
+static void setLowDelay(AVCodecContext *codecCtx, bool lowDelay) {
+    if (lowDelay) {
+        codecCtx->flags |= AV_CODEC_FLAG_LOW_DELAY;
+        codecCtx->thread_type = FF_THREAD_SLICE;
+    }
+}
+
+/**
+ * Compute frame size after downscaling to render surface.
+ */
+static void computeVideoOutputSize(VideoDecoder *videoDecoder, int w, int h, int rotation, int *outW, int *outH) {
+    *outW = w;
+    *outH = h;
+    int32_t targetW = videoDecoder->output_width.load();
+    int32_t targetH = videoDecoder->output_height.load();
+    if (targetW <= 0 || targetH <= 0 || w <= 0 || h <= 0) {
+        return;
+    }
+    if (rotation == 90 || rotation == 270) {
+        std::swap(targetW, targetH);
+    }
+    double scaleX = (double) targetW / (double) w;
+    double scaleY = (double) targetH / (double) h;
+    double scale = videoDecoder->output_crop.load() ? std::max(scaleX, scaleY) : std::min(scaleX, scaleY);
+    if (scale > VIDEO_OUTPUT_MAX_SCALE_RATIO) {
+        return;
+    }
+    *outW = std::max(2, ((int) (w * scale + 0.5)) & ~1);
+    *outH = std::max(2, ((int) (h * scale + 0.5)) & ~1);
+}
+
+/**
+ * Codecs support lowres (e.g. mjpeg) decode at 1/2, 1/4 or 1/8 size directly, only set when opening decoder.
+ */
+static void setVideoLowres(VideoDecoder *videoDecoder, AVCodecParameters *codecParams) {
+    int maxLowres = videoDecoder->video_decoder->max_lowres;
+    if (maxLowres <= 0) {
+        return;
+    }
+    int outW, outH;
+    computeVideoOutputSize(videoDecoder, codecParams->width, codecParams->height, 0, &outW, &outH);
+    if (outW >= codecParams->width) {
+        return;
+    }
+    int lowres = 0;
+    // Lowres frame is not smaller than output size, scale the rest when converting.
+    while (lowres < maxLowres && (codecParams->width >> (lowres + 1)) >= outW && (codecParams->height >> (lowres + 1)) >= outH) {
+        lowres ++;
+    }
+    if (lowres > 0) {
+        videoDecoder->video_decoder_ctx->lowres = lowres;
+        LOGD("Set video decoder lowres: %d", lowres);
+    }
+}
+
+static tMediaOptResult prepareVideoDecoder(JNIEnv * jniEnv, AVCodecParameters *codecParams, bool isRequestHw, jobject hwSurface, bool lowDelay, VideoDecoder* videoDecoder) {
+    videoDecoder->request_hw = isRequestHw;
+    videoDecoder->low_delay = lowDelay;
+    videoDecoder->hw_pix_fmt = AV_PIX_FMT_NONE;
 
     int result = 0;
     //region Hardware Decoder
@@ -112,11 +250,11 @@ static tMediaOptResult prepareVideoDecoder(JNIEnv * jniEnv, AVStream *videoStrea
                         break;
                     }
                     if (config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX && config->device_type == hwDeviceType) {
-                        hw_pix_fmt_i = config->pix_fmt;
+                        videoDecoder->hw_pix_fmt = config->pix_fmt;
                         break;
                     }
                 }
-                if (hw_pix_fmt_i != AV_PIX_FMT_NONE) {
+                if (videoDecoder->hw_pix_fmt != AV_PIX_FMT_NONE) {
                     videoDecoder->video_decoder = hwDecoder;
                     result = av_hwdevice_ctx_create(&videoDecoder->hardware_ctx, hwDeviceType, nullptr,
                                                     nullptr, 0);
@@ -126,12 +264,16 @@ static tMediaOptResult prepareVideoDecoder(JNIEnv * jniEnv, AVStream *videoStrea
                         if (videoDecoder->video_decoder_ctx) {
                             result = avcodec_parameters_to_context(videoDecoder->video_decoder_ctx, codecParams);
                             if (result >= 0) {
+                                videoDecoder->video_decoder_ctx->opaque = videoDecoder;
                                 videoDecoder->video_decoder_ctx->get_format = get_hw_format;
                                 videoDecoder->video_decoder_ctx->hw_device_ctx = av_buffer_ref(videoDecoder->hardware_ctx);
                                 if (hwSurface != nullptr) {
                                     videoDecoder->media_codec_ctx = av_mediacodec_alloc_context();
                                     result = av_mediacodec_default_init(videoDecoder->video_decoder_ctx, videoDecoder->media_codec_ctx, hwSurface);
                                     LOGD("MediaCodec context init: %d", result);
+                                    if (videoDecoder->hw_surface == nullptr) {
+                                        videoDecoder->hw_surface = jniEnv->NewGlobalRef(hwSurface);
+                                    }
 //                                    auto window = ANativeWindow_fromSurface(jniEnv, hwSurface);
 //                                    videoDecoder->hw_native_window = window;
 //                                    auto deviceCtx = (AVHWDeviceContext *) videoDecoder->hardware_ctx->data;
@@ -141,6 +283,7 @@ static tMediaOptResult prepareVideoDecoder(JNIEnv * jniEnv, AVStream *videoStrea
 //                                    result = av_hwdevice_ctx_init(videoDecoder->hardware_ctx);
 //                                    LOGD("HW init result: %d", result);
                                 }
+                                setLowDelay(videoDecoder->video_decoder_ctx, lowDelay);
                                 result = avcodec_open2(videoDecoder->video_decoder_ctx, hwDecoder, nullptr);
                                 if (result >= 0) {
                                     LOGD("Open %s video hw decoder ctx success.", hwCodecName);
@@ -172,6 +315,7 @@ static tMediaOptResult prepareVideoDecoder(JNIEnv * jniEnv, AVStream *videoStrea
     //endregion
 
     //region Software Decoder
+    videoDecoder->hw_pix_fmt = AV_PIX_FMT_NONE;
     videoDecoder->video_decoder = avcodec_find_decoder(codecParams->codec_id);
     if (!videoDecoder->video_decoder) {
         LOGE("Didn't find sw video decoder, codec_id=%d", codecParams->codec_id);
@@ -187,6 +331,8 @@ static tMediaOptResult prepareVideoDecoder(JNIEnv * jniEnv, AVStream *videoStrea
         LOGE("Attach video params to sw decoder ctx fail: %d", result);
         return OptFail;
     }
+    setLowDelay(videoDecoder->video_decoder_ctx, lowDelay);
+    setVideoLowres(videoDecoder, codecParams);
     result = avcodec_open2(videoDecoder->video_decoder_ctx, videoDecoder->video_decoder, nullptr);
     if (result < 0) {
         LOGE("Open video sw decoder ctx fail: %d", result);
@@ -220,6 +366,7 @@ static tMediaOptResult prepareVideoDecoder(JNIEnv * jniEnv, AVStream *videoStrea
 }
 
 static void releaseVideoDecoder(VideoDecoder *videoDecoder) {
+    videoDecoder->decoded_frames.release();
     if (videoDecoder->video_frame != nullptr) {
         av_frame_unref(videoDecoder->video_frame);
         av_frame_free(&videoDecoder->video_frame);
@@ -254,16 +401,98 @@ static void releaseVideoDecoder(VideoDecoder *videoDecoder) {
         av_buffer_unref(&videoDecoder->hardware_ctx);
         videoDecoder->hardware_ctx = nullptr;
     }
+    if (videoDecoder->hw_surface != nullptr) {
+        auto jvm = static_cast<JavaVM *>(av_jni_get_java_vm(nullptr));
+        JNIEnv *jniEnv = nullptr;
+        if (jvm != nullptr && jvm->GetEnv(reinterpret_cast<void **>(&jniEnv), JNI_VERSION_1_6) == JNI_OK) {
+            jniEnv->DeleteGlobalRef(videoDecoder->hw_surface);
+        }
+        videoDecoder->hw_surface = nullptr;
+    }
+}
+
+/**
+ * Reopen decoder with new codec params, frames inside the old codec are dropped.
+ * Called by decode thread.
+ */
+static void reopenVideoDecoder(VideoDecoder *videoDecoder, AVCodecParameters *params) {
+    auto jvm = static_cast<JavaVM *>(av_jni_get_java_vm(nullptr));
+    JNIEnv *jniEnv = nullptr;
+    if (jvm == nullptr || jvm->GetEnv(reinterpret_cast<void **>(&jniEnv), JNI_VERSION_1_6) != JNI_OK) {
+        LOGE("Reopen video decoder fail, no jni env.");
+        return;
+    }
+    jobject surface = videoDecoder->hw_surface != nullptr ? jniEnv->NewLocalRef(videoDecoder->hw_surface) : nullptr;
+    // Surface only can be used by one codec, release old codec first.
+    releaseVideoDecoder(videoDecoder);
+    auto result = prepareVideoDecoder(jniEnv, params, videoDecoder->request_hw, surface, videoDecoder->low_delay, videoDecoder);
+    if (surface != nullptr) {
+        jniEnv->DeleteLocalRef(surface);
+    }
+    if (result != OptSuccess) {
+        LOGE("Reopen video decoder fail.");
+        releaseVideoDecoder(videoDecoder);
+    } else {
+        LOGD("Reopen video decoder: %s", videoDecoder->videoDecoderName);
+    }
+}
+
+// MediaCodec decoders ignore new extradata in packets, reopen decoder with it.
+static void reopenHwVideoDecoder(VideoDecoder *videoDecoder, const uint8_t *extradata, size_t extradataSize) {
+    auto params = avcodec_parameters_alloc();
+    avcodec_parameters_from_context(params, videoDecoder->video_decoder_ctx);
+    av_freep(&params->extradata);
+    params->extradata = static_cast<uint8_t *>(av_mallocz(extradataSize + AV_INPUT_BUFFER_PADDING_SIZE));
+    memcpy(params->extradata, extradata, extradataSize);
+    params->extradata_size = (int) extradataSize;
+    // New resolution is read from sps.
+    params->width = 0;
+    params->height = 0;
+    reopenVideoDecoder(videoDecoder, params);
+    avcodec_parameters_free(&params);
+}
+
+static void prepareAudioLoudness(AudioDecoder *audioDecoder, AVFormatContext *formatCtx, AVStream *audioStream) {
+    auto loudness = &audioDecoder->loudness;
+    loudness->prepare(audioDecoder->audio_output_sample_rate, audioDecoder->audio_output_channels, audioDecoder->audio_output_sample_fmt);
+    // ReplayGain tags are parsed by demuxer to side data, gain reference is -18 LUFS.
+    auto params = audioStream->codecpar;
+    auto sideData = av_packet_side_data_get(params->coded_side_data, params->nb_coded_side_data, AV_PKT_DATA_REPLAYGAIN);
+    if (sideData != nullptr && sideData->size >= sizeof(AVReplayGain)) {
+        auto replayGain = reinterpret_cast<const AVReplayGain *>(sideData->data);
+        if (replayGain->track_gain != INT32_MIN) {
+            // Microbels to dB.
+            double gainDb = (double) replayGain->track_gain / 100000.0 + (LOUDNESS_TARGET_LUFS - (-18.0));
+            loudness->setTagGain(gainDb);
+            LOGD("Audio loudness use ReplayGain: %f dB", gainDb);
+            return;
+        }
+    }
+    // Opus R128 tag, Q7.8 dB relative to -23 LUFS.
+    AVDictionaryEntry *r128 = av_dict_get(audioStream->metadata, "R128_TRACK_GAIN", nullptr, 0);
+    if (r128 == nullptr && formatCtx != nullptr) {
+        r128 = av_dict_get(formatCtx->metadata, "R128_TRACK_GAIN", nullptr, 0);
+    }
+    if (r128 != nullptr && r128->value != nullptr) {
+        double gainDb = (double) strtol(r128->value, nullptr, 10) / 256.0 + (LOUDNESS_TARGET_LUFS - (-23.0));
+        loudness->setTagGain(gainDb);
+        LOGD("Audio loudness use R128 gain: %f dB", gainDb);
+        return;
+    }
+    LOGD("Audio loudness no tags, measure while playing.");
 }
 
 static tMediaOptResult prepareAudioDecoder(
-        AVStream *audioStream,
+        AVCodecParameters *params,
+        AVRational timeBase,
         int target_audio_channels,
         int target_audio_sample_rate,
         int target_audio_sample_bit_depth,
+        bool lowDelay,
         AudioDecoder *audioDecoder) {
 
     int result = 0;
+    audioDecoder->low_delay = lowDelay;
 
     // audio channels
     if (target_audio_channels == 1) {
@@ -308,7 +537,6 @@ static tMediaOptResult prepareAudioDecoder(
         }
     }
 
-    auto params = audioStream->codecpar;
     audioDecoder->audio_decoder = avcodec_find_decoder(params->codec_id);
     if (! audioDecoder->audio_decoder) {
         LOGE("Didn't find audio decoder, codec_id=%d", params->codec_id);
@@ -324,6 +552,9 @@ static tMediaOptResult prepareAudioDecoder(
         LOGE("Attach params to audio ctx fail: %d", result);
         return OptFail;
     }
+    // Decoder need pkt time base to trim skip samples (encoder delay and padding).
+    audioDecoder->audio_decoder_ctx->pkt_timebase = timeBase;
+    setLowDelay(audioDecoder->audio_decoder_ctx, lowDelay);
     result = avcodec_open2(audioDecoder->audio_decoder_ctx, audioDecoder->audio_decoder, nullptr);
     if (result < 0) {
         LOGE("Open audio ctx fail: %d", result);
@@ -360,7 +591,85 @@ static tMediaOptResult prepareAudioDecoder(
     return OptSuccess;
 }
 
+static void releaseAudioTempoFilter(AudioDecoder *audioDecoder) {
+    if (audioDecoder->tempo_graph != nullptr) {
+        avfilter_graph_free(&audioDecoder->tempo_graph);
+        audioDecoder->tempo_graph = nullptr;
+        audioDecoder->tempo_src_ctx = nullptr;
+        audioDecoder->tempo_filter_ctx = nullptr;
+        audioDecoder->tempo_sink_ctx = nullptr;
+    }
+    if (audioDecoder->tempo_in_frame != nullptr) {
+        av_frame_free(&audioDecoder->tempo_in_frame);
+        audioDecoder->tempo_in_frame = nullptr;
+    }
+    audioDecoder->tempo_in_capacity = 0;
+    for (auto &f : audioDecoder->tempo_out_frames) {
+        av_frame_free(&f);
+    }
+    audioDecoder->tempo_out_frames.clear();
+    audioDecoder->tempo_start_pts = AV_NOPTS_VALUE;
+    audioDecoder->tempo_in_samples = 0;
+    audioDecoder->tempo_next_pts = -1.0;
+}
+
+static tMediaOptResult prepareAudioTempoFilter(AudioDecoder *audioDecoder) {
+    releaseAudioTempoFilter(audioDecoder);
+    audioDecoder->tempo_graph = avfilter_graph_alloc();
+    if (audioDecoder->tempo_graph == nullptr) {
+        LOGE("Alloc tempo filter graph fail.");
+        return OptFail;
+    }
+    // Filter input is swr output.
+    char chLayoutDesc[64];
+    av_channel_layout_describe(&audioDecoder->audio_output_ch_layout, chLayoutDesc, sizeof(chLayoutDesc));
+    char srcArgs[256];
+    snprintf(srcArgs, sizeof(srcArgs), "time_base=1/%d:sample_rate=%d:sample_fmt=%s:channel_layout=%s",
+             audioDecoder->audio_output_sample_rate, audioDecoder->audio_output_sample_rate,
+             av_get_sample_fmt_name(audioDecoder->audio_output_sample_fmt), chLayoutDesc);
+    int result = avfilter_graph_create_filter(&audioDecoder->tempo_src_ctx, avfilter_get_by_name("abuffer"), "in", srcArgs, nullptr, audioDecoder->tempo_graph);
+    if (result < 0) {
+        LOGE("Create tempo src filter fail: %d", result);
+        releaseAudioTempoFilter(audioDecoder);
+        return OptFail;
+    }
+    char tempoArgs[32];
+    snprintf(tempoArgs, sizeof(tempoArgs), "tempo=%f", audioDecoder->tempo);
+    result = avfilter_graph_create_filter(&audioDecoder->tempo_filter_ctx, avfilter_get_by_name("atempo"), "atempo", tempoArgs, nullptr, audioDecoder->tempo_graph);
+    if (result < 0) {
+        LOGE("Create atempo filter fail: %d", result);
+        releaseAudioTempoFilter(audioDecoder);
+        return OptFail;
+    }
+    result = avfilter_graph_create_filter(&audioDecoder->tempo_sink_ctx, avfilter_get_by_name("abuffersink"), "out", nullptr, nullptr, audioDecoder->tempo_graph);
+    if (result < 0) {
+        LOGE("Create tempo sink filter fail: %d", result);
+        releaseAudioTempoFilter(audioDecoder);
+        return OptFail;
+    }
+    result = avfilter_link(audioDecoder->tempo_src_ctx, 0, audioDecoder->tempo_filter_ctx, 0);
+    if (result >= 0) {
+        result = avfilter_link(audioDecoder->tempo_filter_ctx, 0, audioDecoder->tempo_sink_ctx, 0);
+    }
+    if (result < 0) {
+        LOGE("Link tempo filters fail: %d", result);
+        releaseAudioTempoFilter(audioDecoder);
+        return OptFail;
+    }
+    result = avfilter_graph_config(audioDecoder->tempo_graph, nullptr);
+    if (result < 0) {
+        LOGE("Config tempo filter graph fail: %d", result);
+        releaseAudioTempoFilter(audioDecoder);
+        return OptFail;
+    }
+    audioDecoder->tempo_in_frame = av_frame_alloc();
+    LOGD("Prepare audio tempo filter success: %s", tempoArgs);
+    return OptSuccess;
+}
+
 static void releaseAudioDecoder(AudioDecoder *audioDecoder) {
+    releaseAudioTempoFilter(audioDecoder);
+    audioDecoder->decoded_frames.release();
     if (audioDecoder->audio_frame != nullptr) {
         av_frame_unref(audioDecoder->audio_frame);
         av_frame_free(&audioDecoder->audio_frame);
@@ -385,6 +694,93 @@ static void releaseAudioDecoder(AudioDecoder *audioDecoder) {
     }
 }
 
+/**
+ * Reopen decoder and resampler for new track, output format is not changed.
+ * Called by decode thread.
+ */
+static tMediaOptResult reopenAudioDecoder(AudioDecoder *audioDecoder, AVCodecParameters *params, AVRational timeBase) {
+    int channels = audioDecoder->audio_output_channels;
+    int sampleRate = audioDecoder->audio_output_sample_rate;
+    int bitDepth;
+    switch (audioDecoder->audio_output_sample_fmt) {
+        case AV_SAMPLE_FMT_S16:
+            bitDepth = 16;
+            break;
+        case AV_SAMPLE_FMT_S32:
+            bitDepth = 32;
+            break;
+        default:
+            bitDepth = 8;
+            break;
+    }
+    releaseAudioDecoder(audioDecoder);
+    auto result = prepareAudioDecoder(params, timeBase, channels, sampleRate, bitDepth, audioDecoder->low_delay, audioDecoder);
+    if (result != OptSuccess) {
+        LOGE("Reopen audio decoder fail.");
+        releaseAudioDecoder(audioDecoder);
+    } else {
+        LOGD("Reopen audio decoder: %s", audioDecoder->audioDecoderName);
+    }
+    return result;
+}
+
+static void freeRequestedParams(std::atomic<AVCodecParameters *> *requested) {
+    auto params = requested->exchange(nullptr);
+    if (params != nullptr) {
+        avcodec_parameters_free(&params);
+    }
+}
+
+bool TrackSwitchFilter::filterPacket(AVPacket *pkt) {
+    auto index = (size_t) pkt->stream_index;
+    if (index >= lastReadDts.size()) {
+        lastReadDts.resize(index + 1, AV_NOPTS_VALUE);
+        skipUntilDts.resize(index + 1, AV_NOPTS_VALUE);
+    }
+    int64_t dts = pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts;
+    if (skipUntilDts[index] != AV_NOPTS_VALUE) {
+        if (dts != AV_NOPTS_VALUE && dts <= skipUntilDts[index]) {
+            return false;
+        }
+        skipUntilDts[index] = AV_NOPTS_VALUE;
+    }
+    lastReadDts[index] = dts;
+    return true;
+}
+
+void TrackSwitchFilter::onSwitch(int switchedStreamIndex) {
+    for (size_t i = 0; i < lastReadDts.size(); i ++) {
+        skipUntilDts[i] = (int) i == switchedStreamIndex ? AV_NOPTS_VALUE : lastReadDts[i];
+    }
+}
+
+static VideoDecoder *openVideoDecoder(JavaVM *jvm, AVStream *stream, bool isRequestHw, jobject hwSurface, bool lowDelay, int32_t outputWidth, int32_t outputHeight, bool outputCrop) {
+    auto decoder = new VideoDecoder;
+    decoder->output_width.store(outputWidth);
+    decoder->output_height.store(outputHeight);
+    decoder->output_crop.store(outputCrop);
+    JNIEnv *jniEnv = nullptr;
+    jvm->GetEnv(reinterpret_cast<void **>(&jniEnv), JNI_VERSION_1_6);
+    if (prepareVideoDecoder(jniEnv, stream->codecpar, isRequestHw, hwSurface, lowDelay, decoder) == OptSuccess) {
+        return decoder;
+    }
+    releaseVideoDecoder(decoder);
+    delete decoder;
+    return nullptr;
+}
+
+static AudioDecoder *openAudioDecoder(AVFormatContext *formatCtx, AVStream *stream, int channels, int sampleRate, int sampleBitDepth, bool lowDelay) {
+    auto decoder = new AudioDecoder;
+    if (prepareAudioDecoder(stream->codecpar, stream->time_base, channels, sampleRate, sampleBitDepth, lowDelay, decoder) == OptSuccess) {
+        prepareAudioLoudness(decoder, formatCtx, stream);
+        decoder->pcm_stats_start_in_micros = nowInMicros();
+        return decoder;
+    }
+    releaseAudioDecoder(decoder);
+    delete decoder;
+    return nullptr;
+}
+
 tMediaOptResult tMediaPlayerContext::prepare(
         const char *media_file_p,
         bool is_request_hw,
@@ -392,6 +788,120 @@ tMediaOptResult tMediaPlayerContext::prepare(
         int target_audio_channels,
         int target_audio_sample_rate,
         int target_audio_sample_bit_depth) {
+    if (openMedia(media_file_p) != OptSuccess) {
+        return OptFail;
+    }
+    return prepareDecoders(nullptr, is_request_hw, hwSurface, target_audio_channels, target_audio_sample_rate, target_audio_sample_bit_depth);
+}
+
+tMediaOptResult tMediaPlayerContext::prepareNext(
+        const char *media_file_p,
+        bool is_request_hw,
+        jobject hwSurface,
+        int target_audio_channels,
+        int target_audio_sample_rate,
+        int target_audio_sample_bit_depth) {
+    if (openMedia(media_file_p) != OptSuccess) {
+        return OptFail;
+    }
+    // Hw decoder bound to surface is opened when switching, the surface is used by current media's decoder.
+    if (video_stream != nullptr && !(is_request_hw && hwSurface != nullptr)) {
+        videoDecoder = openVideoDecoder(jvm, video_stream, is_request_hw, nullptr, lowLatency, videoOutputWidth, videoOutputHeight, videoOutputCrop);
+    }
+    if (audio_stream != nullptr) {
+        audioDecoder = openAudioDecoder(format_ctx, audio_stream, target_audio_channels, target_audio_sample_rate, target_audio_sample_bit_depth, lowLatency);
+    }
+    LOGD("Prepare next media: videoDecoder=%d, audioDecoder=%d", videoDecoder != nullptr, audioDecoder != nullptr);
+    return OptSuccess;
+}
+
+void tMediaPlayerContext::setLocalIOConfig(int32_t bufferSize, bool enableMmap) {
+    this->localIOBufferSize = bufferSize;
+    this->localIOMmap = enableMmap;
+}
+
+void tMediaPlayerContext::setReadAheadConfig(int64_t bufferSize, int64_t lowWatermark, int64_t highWatermark) {
+    this->readAheadBufferSize = bufferSize;
+    this->readAheadLowWatermark = lowWatermark;
+    this->readAheadHighWatermark = highWatermark;
+}
+
+void tMediaPlayerContext::setCacheConfig(const char *cacheDir_, int64_t maxCacheSize_) {
+    if (this->cacheDir != nullptr) {
+        free(this->cacheDir);
+        this->cacheDir = nullptr;
+    }
+    if (cacheDir_ != nullptr) {
+        this->cacheDir = strdup(cacheDir_);
+    }
+    this->maxCacheSize = maxCacheSize_;
+}
+
+int64_t tMediaPlayerContext::getReadAheadBufferedBytes() const {
+    if (readAheadIO == nullptr) {
+        return -1L;
+    }
+    return readAheadIO->bufferedBytes();
+}
+
+int64_t tMediaPlayerContext::getReadAheadBufferedDuration() const {
+    int64_t bytes = getReadAheadBufferedBytes();
+    if (bytes < 0 || format_ctx == nullptr || format_ctx->bit_rate <= 0) {
+        return -1L;
+    }
+    return bytes * 8L * 1000L / format_ctx->bit_rate;
+}
+
+int32_t tMediaPlayerContext::updateBuffering(int64_t audioDuration, int64_t videoDuration, int64_t bytes, bool eof) const {
+    recordStats(StatsPacketQueueBytes, bytes / 1024);
+    if (memoryTracker != nullptr) {
+        memoryTracker->set(MemoryPacket, bytes);
+    }
+    if (buffering == nullptr) {
+        return 0;
+    }
+    auto flags = buffering->update(audioDuration, videoDuration, bytes, eof);
+    recordStats(StatsPacketQueueDuration, buffering->bufferedDurationInMillis);
+    return flags;
+}
+
+bool tMediaPlayerContext::bufferingUnderrun(bool eof) const {
+    return buffering != nullptr && buffering->onUnderrun(eof);
+}
+
+void tMediaPlayerContext::exportBufferingStats(int64_t *dst) const {
+    if (buffering != nullptr) {
+        buffering->exportTo(dst);
+    }
+}
+
+void tMediaPlayerContext::setAbrConfig(bool enable) {
+    requestAbr = enable;
+}
+
+bool tMediaPlayerContext::exportAbrStats(int64_t *dst) const {
+    if (abr == nullptr) {
+        return false;
+    }
+    abr->exportTo(dst);
+    return true;
+}
+
+void tMediaPlayerContext::setLowLatency(bool enable) {
+    this->requestLowLatency = enable;
+}
+
+int64_t tMediaPlayerContext::getLiveLatency(int64_t playPtsInMillis) const {
+    // Wall clock of stream start is known by RTCP sender report.
+    if (!lowLatency || format_ctx == nullptr || format_ctx->start_time_realtime == AV_NOPTS_VALUE || format_ctx->start_time_realtime <= 0) {
+        return -1L;
+    }
+    int64_t start = startTime > 0 ? startTime : 0L;
+    int64_t captureTimeInMillis = format_ctx->start_time_realtime / 1000L + (playPtsInMillis - start);
+    return av_gettime() / 1000L - captureTimeInMillis;
+}
+
+tMediaOptResult tMediaPlayerContext::openMedia(const char *media_file_p) {
 
     LOGD("Prepare media file: %s", media_file_p);
     this->format_ctx = avformat_alloc_context();
@@ -401,6 +911,58 @@ tMediaOptResult tMediaPlayerContext::prepare(
     av_dict_set(&fmt_opts, "scan_all_pmts", "1", AV_DICT_DONT_OVERWRITE);
     // Timeout 5 seconds.
     av_dict_set(&fmt_opts, "rw_timeout", "5000000", AV_DICT_DONT_OVERWRITE);
+    if (requestLowLatency && isLiveUrl(media_file_p)) {
+        lowLatency = true;
+        // Don't buffer packets in demuxer, probe as little as possible.
+        format_ctx->flags |= AVFMT_FLAG_NOBUFFER | AVFMT_FLAG_FLUSH_PACKETS;
+        format_ctx->probesize = LIVE_PROBE_SIZE;
+        format_ctx->max_analyze_duration = LIVE_MAX_ANALYZE_DURATION;
+        av_dict_set(&fmt_opts, "fflags", "nobuffer+flush_packets", 0);
+        av_dict_set(&fmt_opts, "max_delay", LIVE_MAX_DELAY, 0);
+        LOGD("Live low latency mode.");
+    }
+    const char *localPath = localFilePath(media_file_p);
+    if (localPath != nullptr) {
+        localIO = new tMediaLocalIO;
+        if (localIO->open(localPath, localIOBufferSize, localIOMmap)) {
+            format_ctx->pb = localIO->avio;
+        } else {
+            LOGE("Open local io fail, fallback to file protocol.");
+            delete localIO;
+            localIO = nullptr;
+        }
+    } else if (isReadAheadUrl(media_file_p)) {
+        if (readAheadBufferSize > 0) {
+            readAheadIO = new tMediaReadAheadIO;
+            readAheadIO->interruptCb = format_ctx->interrupt_callback;
+            // Throughput is sampled while demuxer probes, buffering is prepared after opening.
+            buffering = new tMediaBuffering;
+            readAheadIO->buffering = buffering;
+        }
+        if (cacheDir != nullptr) {
+            // Cache io reads network, read ahead io reads cache io.
+            cacheIO = new tMediaCacheIO;
+            AVIOInterruptCB cacheInterruptCb = readAheadIO != nullptr ? readAheadIO->sourceInterruptCallback() : format_ctx->interrupt_callback;
+            if (cacheIO->open(media_file_p, &cacheInterruptCb, &fmt_opts, cacheDir, maxCacheSize)) {
+                format_ctx->pb = cacheIO->avio;
+            } else {
+                LOGE("Open cache io fail, fallback to network protocol.");
+                delete cacheIO;
+                cacheIO = nullptr;
+            }
+        }
+        if (readAheadIO != nullptr) {
+            AVIOContext *source = cacheIO != nullptr ? cacheIO->avio : nullptr;
+            if (readAheadIO->open(media_file_p, source, &format_ctx->interrupt_callback, &fmt_opts, readAheadBufferSize, readAheadLowWatermark, readAheadHighWatermark)) {
+                format_ctx->pb = readAheadIO->avio;
+            } else {
+                LOGE("Open read ahead io fail, fallback to network protocol.");
+                readAheadIO->release();
+                delete readAheadIO;
+                readAheadIO = nullptr;
+            }
+        }
+    }
     int result = avformat_open_input(&format_ctx, media_file_p, nullptr, &fmt_opts);
     av_dict_free(&fmt_opts);
     if (result < 0) {
@@ -419,8 +981,10 @@ tMediaOptResult tMediaPlayerContext::prepare(
     if (!strcmp(format_ctx->iformat->name, "rtp")
         || !strcmp(format_ctx->iformat->name, "rtsp")
         || !strcmp(format_ctx->iformat->name, "sdp")
-        || (format_ctx->pb && (!strncmp(format_ctx->url, "rtp:", 4) || !strncmp(format_ctx->url, "udp:", 4)))) {
+        || (format_ctx->pb && (!strncmp(format_ctx->url, "rtp:", 4) || !strncmp(format_ctx->url, "udp:", 4) || !strncmp(format_ctx->url, "srt:", 4)))) {
         isRealTime = true;
+        // e.g. sdp file.
+        lowLatency = requestLowLatency;
     } else {
         isRealTime = false;
     }
@@ -437,6 +1001,19 @@ tMediaOptResult tMediaPlayerContext::prepare(
     }
     LOGD("Format=%s, isRealTime=%d, startTime=%lld, duration=%lld", format_ctx->iformat->name, isRealTime, startTime, duration);
 
+    if (buffering == nullptr) {
+        buffering = new tMediaBuffering;
+    }
+    BufferingSourceType sourceType;
+    if (isRealTime) {
+        sourceType = BufferingSourceRealTime;
+    } else if (localFilePath(media_file_p) != nullptr) {
+        sourceType = BufferingSourceLocal;
+    } else {
+        sourceType = BufferingSourceNetwork;
+    }
+    buffering->prepare(sourceType, format_ctx->bit_rate);
+
     // Read metadata
     fileMetadata = new Metadata;
     readMetadata(format_ctx->metadata, fileMetadata);
@@ -464,13 +1041,18 @@ tMediaOptResult tMediaPlayerContext::prepare(
 
     // Find out first audio stream, video stream and all subtitle streams.
     int subtitleStreamCountLocal = 0;
+    int videoTrackCountLocal = 0;
+    int audioTrackCountLocal = 0;
     for (int i = 0; i < format_ctx->nb_streams; i ++) {
         auto s = format_ctx->streams[i];
         auto codec_type = s->codecpar->codec_type;
         switch (codec_type) {
             case AVMEDIA_TYPE_VIDEO:
+                if (!(s->disposition & AV_DISPOSITION_ATTACHED_PIC)) {
+                    videoTrackCountLocal ++;
+                }
                 if (this->video_stream != nullptr && !videoIsAttachPic) {
-                    LOGE("Find multiple video stream, skip it.");
+                    LOGD("Find video track: %d", s->index);
                 } else {
                     this->video_stream = s;
                     videoIsAttachPic = s->disposition & AV_DISPOSITION_ATTACHED_PIC; // Is music files' picture, only have one frame.
@@ -482,8 +1064,9 @@ tMediaOptResult tMediaPlayerContext::prepare(
                 }
                 break;
             case AVMEDIA_TYPE_AUDIO:
+                audioTrackCountLocal ++;
                 if (this->audio_stream != nullptr) {
-                    LOGE("Find multiple audio stream, skip it.");
+                    LOGD("Find audio track: %d", s->index);
                 } else {
                     this->audio_stream = s;
                     this->audio_duration = 0L;
@@ -529,7 +1112,42 @@ tMediaOptResult tMediaPlayerContext::prepare(
         }
     }
 
-    // Video
+    // Audio and video tracks, only active tracks are read by demuxer.
+    this->videoTrackCount = videoTrackCountLocal;
+    this->audioTrackCount = audioTrackCountLocal;
+    if (videoTrackCountLocal > 0) {
+        this->videoTracks = static_cast<MediaTrack **>(malloc(sizeof(MediaTrack *) * videoTrackCountLocal));
+    }
+    if (audioTrackCountLocal > 0) {
+        this->audioTracks = static_cast<MediaTrack **>(malloc(sizeof(MediaTrack *) * audioTrackCountLocal));
+    }
+    int videoTrackIndex = 0;
+    int audioTrackIndex = 0;
+    for (unsigned int i = 0; i < format_ctx->nb_streams; i ++) {
+        auto s = format_ctx->streams[i];
+        auto codec_type = s->codecpar->codec_type;
+        MediaTrack *track = nullptr;
+        if (codec_type == AVMEDIA_TYPE_VIDEO && !(s->disposition & AV_DISPOSITION_ATTACHED_PIC)) {
+            track = new MediaTrack;
+            videoTracks[videoTrackIndex ++] = track;
+        } else if (codec_type == AVMEDIA_TYPE_AUDIO) {
+            track = new MediaTrack;
+            audioTracks[audioTrackIndex ++] = track;
+        }
+        if (track != nullptr) {
+            track->stream = s;
+            readMetadata(s->metadata, &track->streamMetadata);
+            if (s != video_stream && s != audio_stream) {
+                s->discard = AVDISCARD_ALL;
+            }
+        }
+    }
+    selectedVideoStreamIndex.store(video_stream != nullptr && !videoIsAttachPic ? video_stream->index : -1);
+    selectedAudioStreamIndex.store(audio_stream != nullptr ? audio_stream->index : -1);
+    trackSwitchFilter = new TrackSwitchFilter;
+    LOGD("Find %d video tracks, %d audio tracks", videoTrackCountLocal, audioTrackCountLocal);
+
+    // Video info
     if (video_stream != nullptr) {
         AVCodecParameters *params = video_stream->codecpar;
         this->video_width = params->width;
@@ -563,22 +1181,9 @@ tMediaOptResult tMediaPlayerContext::prepare(
         }
         videoMetaData = new Metadata;
         readMetadata(video_stream->metadata, videoMetaData);
-
-        auto decoder = new VideoDecoder;
-        this->requestHwVideoDecoder = is_request_hw;
-        JNIEnv *jniEnv = nullptr;
-        jvm->GetEnv(reinterpret_cast<void **>(&jniEnv), JNI_VERSION_1_6);
-        if (prepareVideoDecoder(jniEnv, video_stream, is_request_hw, hwSurface, decoder) == OptSuccess) {
-            this->videoDecoder = decoder;
-        } else {
-            releaseVideoDecoder(decoder);
-            free(decoder);
-            this->videoDecoder = nullptr;
-        }
-
     }
 
-    // Audio
+    // Audio info
     if (audio_stream != nullptr) {
         auto params = audio_stream->codecpar;
         this->audio_codec_id = params->codec_id;
@@ -590,30 +1195,159 @@ tMediaOptResult tMediaPlayerContext::prepare(
         this->audio_per_sample_bytes = av_get_bytes_per_sample(this->audio_sample_format);
         audioMetadata = new Metadata;
         readMetadata(audio_stream->metadata, audioMetadata);
+    }
 
-        auto decoder = new AudioDecoder;
-        if (prepareAudioDecoder(audio_stream, target_audio_channels, target_audio_sample_rate, target_audio_sample_bit_depth, decoder) == OptSuccess) {
-            this->audioDecoder = decoder;
+    // Abr, demuxer opens all variants, only the playing one is downloaded.
+    if (requestAbr && !isRealTime && (!strcmp(format_ctx->iformat->name, "hls") || !strcmp(format_ctx->iformat->name, "dash"))) {
+        abr = new tMediaAbr;
+        abr->buffering = buffering;
+        if (!abr->prepare(format_ctx, video_stream, audio_stream)) {
+            abr->release();
+            delete abr;
+            abr = nullptr;
+        }
+    }
+
+    // Keyframe index, prefer video stream.
+    keyframeIndex = new tMediaKeyframeIndex;
+    if (video_stream != nullptr && !videoIsAttachPic) {
+        keyframe_index_stream = video_stream;
+    } else {
+        keyframe_index_stream = audio_stream;
+    }
+    if (keyframe_index_stream != nullptr) {
+        int entriesCount = avformat_index_get_entries_count(keyframe_index_stream);
+        containerHasKeyframeIndex = entriesCount > 0;
+        for (int i = 0; i < entriesCount; i ++) {
+            auto entry = avformat_index_get_entry(keyframe_index_stream, i);
+            if (entry != nullptr && (entry->flags & AVINDEX_KEYFRAME) && entry->timestamp != AV_NOPTS_VALUE) {
+                keyframeIndex->add(ptsToMillis(entry->timestamp, keyframe_index_stream->time_base), entry->pos, entry->size);
+            }
+        }
+        LOGD("Keyframe index: container entries=%d, keyframes=%d", entriesCount, keyframeIndex->size());
+    }
+
+    // decode need buffer.
+    this->pkt = av_packet_alloc();
+
+    return OptSuccess;
+}
+
+tMediaOptResult tMediaPlayerContext::prepareDecoders(
+        tMediaPlayerContext *previous,
+        bool is_request_hw,
+        jobject hwSurface,
+        int target_audio_channels,
+        int target_audio_sample_rate,
+        int target_audio_sample_bit_depth) {
+    // Video
+    if (video_stream != nullptr) {
+        this->requestHwVideoDecoder = is_request_hw;
+        if (this->videoDecoder != nullptr && this->videoDecoder->request_hw != is_request_hw) {
+            // Opened by prepareNext with other settings.
+            releaseVideoDecoder(this->videoDecoder);
+            delete this->videoDecoder;
+            this->videoDecoder = nullptr;
+        }
+        if (this->videoDecoder != nullptr) {
+            // Opened by prepareNext.
+            this->videoDecoder->output_width.store(videoOutputWidth);
+            this->videoDecoder->output_height.store(videoOutputHeight);
+            this->videoDecoder->output_crop.store(videoOutputCrop);
+            LOGD("Use prepared video decoder: %s", this->videoDecoder->videoDecoderName);
+        } else if (previous != nullptr && previous->videoDecoder != nullptr && previous->video_stream != nullptr &&
+            previous->requestHwVideoDecoder == is_request_hw &&
+            previous->lowLatency == lowLatency &&
+            isVideoCodecParamsMatch(previous->video_stream->codecpar, video_stream->codecpar)) {
+            // Reuse previous media's decoder, skip open codec.
+            auto decoder = previous->videoDecoder;
+            previous->videoDecoder = nullptr;
+            avcodec_flush_buffers(decoder->video_decoder_ctx);
+            decoder->decoded_frames.flush();
+            av_packet_unref(decoder->video_pkt);
+            av_frame_unref(decoder->video_frame);
+            decoder->late_frame.reset();
+            decoder->output_width.store(videoOutputWidth);
+            decoder->output_height.store(videoOutputHeight);
+            decoder->output_crop.store(videoOutputCrop);
+            this->videoDecoder = decoder;
+            LOGD("Reuse previous video decoder: %s", decoder->videoDecoderName);
         } else {
-            releaseAudioDecoder(decoder);
-            free(decoder);
+            if (previous != nullptr && previous->videoDecoder != nullptr && hwSurface != nullptr) {
+                // Hw surface only can be used by one codec.
+                releaseVideoDecoder(previous->videoDecoder);
+                delete previous->videoDecoder;
+                previous->videoDecoder = nullptr;
+            }
+            this->videoDecoder = openVideoDecoder(jvm, video_stream, is_request_hw, hwSurface, lowLatency, videoOutputWidth, videoOutputHeight, videoOutputCrop);
+        }
+    }
+
+    // Audio
+    if (audio_stream != nullptr) {
+        if (this->audioDecoder != nullptr &&
+            (this->audioDecoder->audio_output_channels != target_audio_channels || this->audioDecoder->audio_output_sample_rate != target_audio_sample_rate)) {
+            // Opened by prepareNext with other settings.
+            releaseAudioDecoder(this->audioDecoder);
+            delete this->audioDecoder;
             this->audioDecoder = nullptr;
         }
+        if (this->audioDecoder != nullptr) {
+            // Opened by prepareNext.
+            LOGD("Use prepared audio decoder: %s", this->audioDecoder->audioDecoderName);
+        } else if (previous != nullptr && previous->audioDecoder != nullptr && previous->audio_stream != nullptr &&
+            previous->audioDecoder->audio_output_channels == target_audio_channels &&
+            previous->audioDecoder->audio_output_sample_rate == target_audio_sample_rate &&
+            previous->lowLatency == lowLatency &&
+            isAudioCodecParamsMatch(previous->audio_stream->codecpar, audio_stream->codecpar)) {
+            // Reuse previous media's decoder and resampler, skip open codec and init swr.
+            auto decoder = previous->audioDecoder;
+            previous->audioDecoder = nullptr;
+            avcodec_flush_buffers(decoder->audio_decoder_ctx);
+            decoder->decoded_frames.flush();
+            decoder->audio_decoder_ctx->pkt_timebase = audio_stream->time_base;
+            av_packet_unref(decoder->audio_pkt);
+            av_frame_unref(decoder->audio_frame);
+            releaseAudioTempoFilter(decoder);
+            // Drop resampler delay samples of previous media.
+            swr_init(decoder->audio_swr_ctx);
+            prepareAudioLoudness(decoder, format_ctx, audio_stream);
+            decoder->pcm_output_bytes.store(0);
+            decoder->pcm_copied_bytes.store(0);
+            decoder->pcm_stats_start_in_micros = nowInMicros();
+            this->audioDecoder = decoder;
+            LOGD("Reuse previous audio decoder: %s", decoder->audioDecoderName);
+        } else {
+            this->audioDecoder = openAudioDecoder(format_ctx, audio_stream, target_audio_channels, target_audio_sample_rate, target_audio_sample_bit_depth, lowLatency);
+        }
     }
 
     if (this->videoDecoder == nullptr && this->audioDecoder == nullptr) {
         LOGE("Prepare decoder fail.");
         return OptFail;
     }
-
-    // decode need buffer.
-    this->pkt = av_packet_alloc();
-
+    if (this->videoDecoder != nullptr) {
+        videoDecoder->stream_index = video_stream->index;
+        videoDecoder->time_base = video_stream->time_base;
+        freeRequestedParams(&videoDecoder->requested_params);
+    }
+    if (this->audioDecoder != nullptr) {
+        audioDecoder->stream_index = audio_stream->index;
+        audioDecoder->time_base = audio_stream->time_base;
+        freeRequestedParams(&audioDecoder->requested_params);
+    }
     return OptSuccess;
 }
 
 tMediaReadPktResult tMediaPlayerContext::readPacket() const {
+    if (abr != nullptr) {
+        abr->update(buffering != nullptr ? buffering->bufferedDurationInMillis : 0);
+    }
+    int64_t readStart = nowInMicros();
     int ret = av_read_frame(format_ctx, pkt);
+    if (ret >= 0) {
+        recordStats(StatsDemuxReadTime, nowInMicros() - readStart);
+    }
     if (ret < 0) {
         if (ret == AVERROR_EOF || avio_feof(format_ctx->pb)) {
             return ReadEof;
@@ -621,6 +1355,17 @@ tMediaReadPktResult tMediaPlayerContext::readPacket() const {
             return ReadFail;
         }
     } else {
+        if (abr != nullptr) {
+            abr->routePacket(pkt);
+        }
+        if (trackSwitchFilter != nullptr && !trackSwitchFilter->filterPacket(pkt)) {
+            av_packet_unref(pkt);
+            return UnknownPkt;
+        }
+        if (keyframe_index_stream != nullptr && pkt->stream_index == keyframe_index_stream->index &&
+            (pkt->flags & AV_PKT_FLAG_KEY) && pkt->pos >= 0 && pkt->pts != AV_NOPTS_VALUE) {
+            keyframeIndex->add(ptsToMillis(pkt->pts, keyframe_index_stream->time_base), pkt->pos, pkt->size);
+        }
         if (video_stream && pkt->stream_index == video_stream->index) {
             pkt->time_base = video_stream->time_base;
             // video
@@ -653,6 +1398,15 @@ void tMediaPlayerContext::movePacketRef(AVPacket *target) const {
     av_packet_move_ref(target, pkt);
 }
 
+int64_t tMediaPlayerContext::findNearestKeyframe(int64_t targetPosInMillis, bool before) const {
+    if (keyframeIndex == nullptr) {
+        return -1L;
+    }
+    KeyframeEntry entry;
+    bool found = before ? keyframeIndex->findBefore(targetPosInMillis, &entry) : keyframeIndex->findAfter(targetPosInMillis, &entry);
+    return found ? entry.pts : -1L;
+}
+
 tMediaOptResult tMediaPlayerContext::pauseReadPacket() const {
     av_read_pause(format_ctx);
     return OptSuccess;
@@ -663,58 +1417,450 @@ tMediaOptResult tMediaPlayerContext::resumeReadPacket() const {
     return OptSuccess;
 }
 
-tMediaOptResult tMediaPlayerContext::seekTo(int64_t targetPosInMillis) const {
-    int64_t seekTs = targetPosInMillis * AV_TIME_BASE / 1000L;
+// region Accurate seek
+static void requestAccurateSeek(AccurateSeek *seek, int64_t targetPts, int64_t seekTimeInMicros) {
+    seek->pendingSeekTimeInMicros.store(seekTimeInMicros);
+    seek->pendingTargetPts.store(targetPts);
+}
+
+// Called when decoder flushed by new serial packets.
+static void activeAccurateSeek(AccurateSeek *seek, AVCodecContext *codecCtx) {
+    if (seek->targetPts >= 0) {
+        // Last accurate seek not finished.
+        codecCtx->skip_frame = seek->savedSkipFrame;
+        codecCtx->skip_loop_filter = seek->savedSkipLoopFilter;
+    }
+    seek->targetPts = seek->pendingTargetPts.exchange(-1);
+    seek->seekTimeInMicros = seek->pendingSeekTimeInMicros.load();
+    seek->droppedFrames = 0;
+    seek->decodeCostInMicros = 0;
+    if (seek->targetPts >= 0) {
+        seek->savedSkipFrame = codecCtx->skip_frame;
+        seek->savedSkipLoopFilter = codecCtx->skip_loop_filter;
+    }
+}
+
+static void finishAccurateSeek(AccurateSeek *seek, AVCodecContext *codecCtx, tMediaPlayerStats *stats, const char *type) {
+    int64_t firstFrameCost = nowInMicros() - seek->seekTimeInMicros;
+    LOGD("Accurate seek %s finished: target=%lld ms, dropped frames=%d, drop decode cost=%lld us, first frame after seek=%lld us",
+         type,
+         (long long) seek->targetPts,
+         seek->droppedFrames,
+         (long long) seek->decodeCostInMicros,
+         (long long) firstFrameCost);
+    if (stats != nullptr) {
+        stats->record(StatsAccurateSeekDroppedFrames, seek->droppedFrames);
+        stats->record(StatsAccurateSeekDecodeTime, seek->decodeCostInMicros);
+        stats->record(StatsAccurateSeekFirstFrameTime, firstFrameCost);
+    }
+    seek->targetPts = -1;
+    codecCtx->skip_frame = seek->savedSkipFrame;
+    codecCtx->skip_loop_filter = seek->savedSkipLoopFilter;
+}
+// endregion
+
+tMediaOptResult tMediaPlayerContext::selectTrack(int32_t streamIndex, int64_t positionInMillis) {
+    if (abr != nullptr) {
+        LOGE("Select track fail, streams are selected by abr.");
+        return OptFail;
+    }
+    if (format_ctx == nullptr || streamIndex < 0 || (unsigned int) streamIndex >= format_ctx->nb_streams) {
+        LOGE("Select track fail, wrong stream index: %d", streamIndex);
+        return OptFail;
+    }
+    auto stream = format_ctx->streams[streamIndex];
+    auto type = stream->codecpar->codec_type;
+    AVStream *lastStream;
+    std::atomic<AVCodecParameters *> *requestedParams;
+    AccurateSeek *accurateSeek;
+    if (type == AVMEDIA_TYPE_VIDEO && !(stream->disposition & AV_DISPOSITION_ATTACHED_PIC) && videoDecoder != nullptr && !videoIsAttachPic) {
+        lastStream = video_stream;
+        requestedParams = &videoDecoder->requested_params;
+        accurateSeek = &videoDecoder->accurate_seek;
+    } else if (type == AVMEDIA_TYPE_AUDIO && audioDecoder != nullptr) {
+        lastStream = audio_stream;
+        requestedParams = &audioDecoder->requested_params;
+        accurateSeek = &audioDecoder->accurate_seek;
+    } else {
+        LOGE("Select track fail, stream %d is not a playing audio or video track.", streamIndex);
+        return OptFail;
+    }
+    if (lastStream == stream) {
+        return OptSuccess;
+    }
+    int64_t switchStart = nowInMicros();
+    lastStream->discard = AVDISCARD_ALL;
+    stream->discard = AVDISCARD_DEFAULT;
+    if (type == AVMEDIA_TYPE_VIDEO) {
+        video_stream = stream;
+        selectedVideoStreamIndex.store(streamIndex);
+    } else {
+        audio_stream = stream;
+        selectedAudioStreamIndex.store(streamIndex);
+    }
+    auto params = avcodec_parameters_alloc();
+    avcodec_parameters_copy(params, stream->codecpar);
+    auto lastParams = requestedParams->exchange(params);
+    if (lastParams != nullptr) {
+        avcodec_parameters_free(&lastParams);
+    }
+    // Read new track from current position, packets of other tracks read before are dropped.
+    trackSwitchFilter->onSwitch(streamIndex);
+    int64_t seekTs = positionInMillis * AV_TIME_BASE / 1000L;
     int ret = avformat_seek_file(format_ctx, -1, INT64_MIN, seekTs, INT64_MAX, AVSEEK_FLAG_BACKWARD);
+    if (ret < 0) {
+        LOGE("Select track seek fail: %d, new track starts at demuxer position.", ret);
+    } else {
+        if (keyframeIndex != nullptr) {
+            keyframeIndex->onDiscontinuity();
+        }
+        requestAccurateSeek(accurateSeek, positionInMillis, switchStart);
+    }
+    LOGD("Select %s track: %d -> %d, position=%lld ms", type == AVMEDIA_TYPE_VIDEO ? "video" : "audio", lastStream->index, streamIndex, (long long) positionInMillis);
+    return OptSuccess;
+}
+
+tMediaOptResult tMediaPlayerContext::seekTo(int64_t targetPosInMillis, bool accurate) const {
+    int64_t seekStart = nowInMicros();
+    int ret = -1;
+    // Container without index (e.g. ts, flv) need read a lot of data to find target, use byte seek if target is in keyframe index.
+    if (!containerHasKeyframeIndex && keyframeIndex != nullptr && !(format_ctx->iformat->flags & AVFMT_NO_BYTE_SEEK)) {
+        KeyframeEntry before;
+        KeyframeEntry after;
+        // Keyframes around target must be adjacent in file: index has gaps where packets were skipped by seeking,
+        // a keyframe before the gap could be far earlier than target.
+        if (keyframeIndex->findBefore(targetPosInMillis, &before) && keyframeIndex->findAfter(targetPosInMillis, &after) &&
+            after.pts - before.pts <= KEYFRAME_INDEX_MAX_BYTE_SEEK_GAP_IN_MILLIS &&
+            keyframeIndex->isCovered(before.pts, after.pts)) {
+            ret = av_seek_frame(format_ctx, -1, before.pos, AVSEEK_FLAG_BYTE);
+            if (ret >= 0) {
+                LOGD("Seek by keyframe index: target=%lld ms, keyframe=%lld ms, pos=%lld", (long long) targetPosInMillis, (long long) before.pts, (long long) before.pos);
+            }
+        }
+    }
+    if (ret < 0) {
+        int64_t seekTs = targetPosInMillis * AV_TIME_BASE / 1000L;
+        ret = avformat_seek_file(format_ctx, -1, INT64_MIN, seekTs, INT64_MAX, AVSEEK_FLAG_BACKWARD);
+    }
     if (ret < 0) {
         return OptFail;
     } else {
+        if (keyframeIndex != nullptr) {
+            keyframeIndex->onDiscontinuity();
+        }
+        int64_t target = accurate ? targetPosInMillis : -1L;
+        if (videoDecoder != nullptr) {
+            requestAccurateSeek(&videoDecoder->accurate_seek, target, seekStart);
+        }
+        if (audioDecoder != nullptr) {
+            requestAccurateSeek(&audioDecoder->accurate_seek, target, seekStart);
+        }
+        if (buffering != nullptr) {
+            buffering->onSeek();
+        }
+        if (accurate) {
+            LOGD("Accurate seek to %lld ms, format seek cost %lld us", (long long) targetPosInMillis, (long long) (nowInMicros() - seekStart));
+        }
         return OptSuccess;
     }
 }
 
-tMediaDecodeResult decode(AVCodecContext *codec_ctx, AVFrame* frame, AVPacket *pkt) {
+bool DecodedFrameQueue::isFull() const {
+    return count >= DECODED_FRAME_QUEUE_SIZE;
+}
 
-    int ret;
-    ret = avcodec_send_packet(codec_ctx, pkt);
-    if (ret != AVERROR(EAGAIN)) {
-        av_packet_unref(pkt);
+bool DecodedFrameQueue::isEmpty() const {
+    return count <= 0;
+}
+
+AVFrame *DecodedFrameQueue::writable() {
+    int index = (head + count) % DECODED_FRAME_QUEUE_SIZE;
+    if (frames[index] == nullptr) {
+        frames[index] = av_frame_alloc();
     }
-    bool skipNextReadPkt = ret == AVERROR(EAGAIN);
-    if (ret < 0 && ret != AVERROR(EAGAIN)) {
-        LOGE("%s send packet fail: %d", codec_ctx->codec->name ,ret);
-        return DecodeFail;
+    return frames[index];
+}
+
+void DecodedFrameQueue::commitWritable() {
+    count ++;
+    receivedFrames.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool DecodedFrameQueue::pop(AVFrame *dst) {
+    if (isEmpty()) {
+        return false;
     }
-    av_frame_unref(frame);
-    ret = avcodec_receive_frame(codec_ctx, frame);
+    av_frame_unref(dst);
+    av_frame_move_ref(dst, frames[head]);
+    head = (head + 1) % DECODED_FRAME_QUEUE_SIZE;
+    count --;
+    return true;
+}
+
+void DecodedFrameQueue::flush() {
+    for (auto &f : frames) {
+        if (f != nullptr) {
+            av_frame_unref(f);
+        }
+    }
+    head = 0;
+    count = 0;
+}
+
+void DecodedFrameQueue::release() {
+    for (auto &f : frames) {
+        if (f != nullptr) {
+            av_frame_free(&f);
+        }
+    }
+    head = 0;
+    count = 0;
+}
+
+static tMediaHistogram *statsHistogram(tMediaPlayerStats *stats, tMediaStatsHistogramType type) {
+    return stats != nullptr ? &stats->histograms[type] : nullptr;
+}
+
+static bool isPacketPending(AVPacket *pkt) {
+    return pkt->data != nullptr || pkt->side_data_elems > 0;
+}
+
+/**
+ * @return false if decoder refused packet, packet is kept if decoder is full (EAGAIN).
+ */
+static bool sendPacket(AVCodecContext *codec_ctx, AVPacket *pkt) {
+    if (!isPacketPending(pkt)) {
+        return true;
+    }
+    int ret = avcodec_send_packet(codec_ctx, pkt);
+    if (ret == AVERROR(EAGAIN)) {
+        return true;
+    }
+    av_packet_unref(pkt);
     if (ret < 0) {
-        if (ret == AVERROR(EAGAIN)) {
-            if (skipNextReadPkt) {
-                return decode(codec_ctx, frame, pkt);
-            } else {
-                return DecodeFailAndNeedMorePkt;
+        LOGE("%s send packet fail: %d", codec_ctx->codec->name ,ret);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Send packet and drain all ready frames to queue, then output first queued frame.
+ * Packet is kept if decoder can't accept it now, it's sent again after decoder drained.
+ * @param decodeTime nullable, frames drained together share the cost.
+ * @return DecodeSuccessAndSkipNextPkt if queue has more frames or packet not sent, call again without new packet.
+ */
+tMediaDecodeResult decode(AVCodecContext *codec_ctx, DecodedFrameQueue *queue, AVFrame* frame, AVPacket *pkt, tMediaHistogram *decodeTime) {
+    bool sendFail = false;
+    bool receiveFail = false;
+    bool eof = false;
+    if (queue->isEmpty()) {
+        int64_t decodeStart = decodeTime != nullptr ? nowInMicros() : 0L;
+        sendFail = !sendPacket(codec_ctx, pkt);
+        while (!queue->isFull()) {
+            int ret = avcodec_receive_frame(codec_ctx, queue->writable());
+            if (ret < 0) {
+                if (ret == AVERROR_EOF) {
+                    eof = true;
+                } else if (ret != AVERROR(EAGAIN)) {
+                    LOGE("%s receive frame fail: %d", codec_ctx->codec->name, ret);
+                    receiveFail = true;
+                }
+                break;
             }
+            queue->commitWritable();
         }
-        if (ret == AVERROR_EOF) {
-            return DecodeEnd;
+        if (decodeTime != nullptr && queue->count > 0) {
+            int64_t frameCost = (nowInMicros() - decodeStart) / queue->count;
+            for (int i = 0; i < queue->count; i ++) {
+                decodeTime->record(frameCost);
+            }
         }
-        LOGE("%s receive frame fail: %d", codec_ctx->codec->name, ret);
-        return DecodeFail;
-    } else {
-        if (skipNextReadPkt) {
+    }
+    // Decoder has room after drained, send pending packet now, decoder threads keep working while queued frames output.
+    if (!sendPacket(codec_ctx, pkt)) {
+        sendFail = true;
+    }
+    if (queue->pop(frame)) {
+        if (isPacketPending(pkt) || !queue->isEmpty()) {
             return DecodeSuccessAndSkipNextPkt;
         } else {
             return DecodeSuccess;
         }
     }
+    if (isPacketPending(pkt)) {
+        // Decoder neither accepts packet nor outputs frame, drop it.
+        LOGE("%s can't accept packet, drop it.", codec_ctx->codec->name);
+        av_packet_unref(pkt);
+        return DecodeFail;
+    }
+    if (sendFail || receiveFail) {
+        return DecodeFail;
+    }
+    if (eof) {
+        return DecodeEnd;
+    }
+    return DecodeFailAndNeedMorePkt;
 }
 
-tMediaDecodeResult tMediaPlayerContext::decodeVideo(AVPacket *targetPkt) const {
+// Scrub preview, don't send non key packets, drain decoder to get the keyframe immediately,
+// otherwise decoder holds frames for reordering and frame threads.
+static tMediaDecodeResult decodeVideoKeyframe(VideoDecoder *videoDecoder) {
+    auto codecCtx = videoDecoder->video_decoder_ctx;
+    auto pkt = videoDecoder->video_pkt;
+    auto frame = videoDecoder->video_frame;
+    videoDecoder->decoded_frames.flush();
+    codecCtx->skip_frame = AVDISCARD_NONKEY;
+    if (videoDecoder->scrub_drained) {
+        // Last keyframe was moved to buffer, drop draining state, next keyframe is independent.
+        avcodec_flush_buffers(codecCtx);
+        videoDecoder->scrub_drained = false;
+    }
+    if (pkt->data == nullptr || !(pkt->flags & AV_PKT_FLAG_KEY)) {
+        av_packet_unref(pkt);
+        return DecodeFailAndNeedMorePkt;
+    }
+    int ret = avcodec_send_packet(codecCtx, pkt);
+    av_packet_unref(pkt);
+    if (ret < 0 && ret != AVERROR(EAGAIN)) {
+        LOGE("%s scrub send packet fail: %d", codecCtx->codec->name, ret);
+        return DecodeFail;
+    }
+    avcodec_send_packet(codecCtx, nullptr);
+    videoDecoder->scrub_drained = true;
+    av_frame_unref(frame);
+    ret = avcodec_receive_frame(codecCtx, frame);
+    if (ret < 0) {
+        return DecodeFailAndNeedMorePkt;
+    }
+    return DecodeSuccess;
+}
+
+tMediaDecodeResult tMediaPlayerContext::decodeVideo(AVPacket *targetPkt, bool late) const {
     if (videoDecoder != nullptr) {
+        videoDecoder->decoded_frames.decodeCalls.fetch_add(1, std::memory_order_relaxed);
+        if (targetPkt != nullptr && videoDecoder->video_decoder_ctx != nullptr && videoDecoder->video_decoder_ctx->hw_device_ctx != nullptr) {
+            size_t extradataSize = 0;
+            auto extradata = av_packet_get_side_data(targetPkt, AV_PKT_DATA_NEW_EXTRADATA, &extradataSize);
+            if (extradata != nullptr && extradataSize > 0) {
+                // Abr switched to a variant with different extradata.
+                reopenHwVideoDecoder(videoDecoder, extradata, extradataSize);
+            }
+        }
+        if (targetPkt != nullptr && targetPkt->data != nullptr && targetPkt->stream_index != videoDecoder->stream_index) {
+            // First packet of new track.
+            auto params = videoDecoder->requested_params.exchange(nullptr);
+            if (params != nullptr) {
+                auto current = avcodec_parameters_alloc();
+                if (videoDecoder->video_decoder_ctx != nullptr) {
+                    avcodec_parameters_from_context(current, videoDecoder->video_decoder_ctx);
+                }
+                if (videoDecoder->video_decoder_ctx == nullptr || !isVideoCodecParamsMatch(current, params)) {
+                    reopenVideoDecoder(videoDecoder, params);
+                }
+                avcodec_parameters_free(&current);
+                avcodec_parameters_free(&params);
+            }
+            videoDecoder->stream_index = targetPkt->stream_index;
+            videoDecoder->time_base = targetPkt->time_base;
+        }
+        if (videoDecoder->video_decoder_ctx == nullptr) {
+            LOGE("Decode video fail, decoder ctx is null.");
+            return DecodeFail;
+        }
+        bool newPacket = targetPkt != nullptr && targetPkt->data != nullptr;
         if (targetPkt != nullptr) {
             av_packet_move_ref(videoDecoder->video_pkt, targetPkt);
         }
-        return decode(videoDecoder->video_decoder_ctx, videoDecoder->video_frame, videoDecoder->video_pkt);
+        auto seek = &videoDecoder->accurate_seek;
+        auto codecCtx = videoDecoder->video_decoder_ctx;
+        if (videoDecoder->requested_scrub.load()) {
+            videoDecoder->scrub_active = true;
+            return decodeVideoKeyframe(videoDecoder);
+        }
+        if (videoDecoder->scrub_active) {
+            videoDecoder->scrub_active = false;
+            codecCtx->skip_frame = AVDISCARD_DEFAULT;
+            if (videoDecoder->scrub_drained) {
+                avcodec_flush_buffers(codecCtx);
+                videoDecoder->scrub_drained = false;
+            }
+        }
+        if (seek->targetPts < 0) {
+            if (lowLatency) {
+                auto pkt = videoDecoder->video_pkt;
+                if (late && pkt->data != nullptr && (pkt->flags & (AV_PKT_FLAG_DISPOSABLE | AV_PKT_FLAG_DISCARD))) {
+                    // Late and no frames depend on it, drop before decoding.
+                    av_packet_unref(pkt);
+                    videoDecoder->live_dropped_packets ++;
+                    increaseStats(StatsDropDecodeLate);
+                    return DecodeFailAndNeedMorePkt;
+                }
+                // Late: decoder skips non reference frames.
+                codecCtx->skip_frame = late ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+            } else {
+                codecCtx->skip_frame = AVDISCARD_DEFAULT;
+            }
+            auto lateFrame = &videoDecoder->late_frame;
+            lateFrame->applyToDecoder(codecCtx, newPacket);
+            while (true) {
+                auto result = decode(codecCtx, &videoDecoder->decoded_frames, videoDecoder->video_frame, videoDecoder->video_pkt, statsHistogram(stats, StatsVideoDecodeTime));
+                if (result != DecodeSuccess && result != DecodeSuccessAndSkipNextPkt) {
+                    return result;
+                }
+                auto frame = videoDecoder->video_frame;
+                int64_t framePts = frame->pts != AV_NOPTS_VALUE ? ptsToMillis(frame->pts, videoDecoder->time_base) : -1L;
+                if (lateFrame->onFrameDecoded(framePts)) {
+                    // Late frame, skip converting.
+                    av_frame_unref(frame);
+                    increaseStats(StatsDropDecodeLate);
+                    if (result == DecodeSuccess) {
+                        return DecodeFailAndNeedMorePkt;
+                    } else {
+                        // Current packet not send to decoder, retry it.
+                        continue;
+                    }
+                }
+                return result;
+            }
+        }
+        auto time_base = videoDecoder->time_base;
+        auto pkt = videoDecoder->video_pkt;
+        // Packet before target: skip non reference frames, they are not needed by later frames.
+        // Reference frames are decoded completely, otherwise frames after target are broken.
+        if (pkt->data != nullptr && pkt->pts != AV_NOPTS_VALUE && ptsToMillis(pkt->pts, time_base) < seek->targetPts) {
+            codecCtx->skip_frame = AVDISCARD_NONREF;
+            codecCtx->skip_loop_filter = AVDISCARD_NONREF;
+        } else {
+            codecCtx->skip_frame = AVDISCARD_DEFAULT;
+            codecCtx->skip_loop_filter = AVDISCARD_DEFAULT;
+        }
+        while (true) {
+            int64_t decodeStart = nowInMicros();
+            auto result = decode(codecCtx, &videoDecoder->decoded_frames, videoDecoder->video_frame, pkt, statsHistogram(stats, StatsVideoDecodeTime));
+            seek->decodeCostInMicros += nowInMicros() - decodeStart;
+            if (result != DecodeSuccess && result != DecodeSuccessAndSkipNextPkt) {
+                return result;
+            }
+            auto frame = videoDecoder->video_frame;
+            if (frame->pts != AV_NOPTS_VALUE) {
+                int64_t frameEnd = ptsToMillis(frame->pts + (frame->duration > 0 ? frame->duration : 0), time_base);
+                if (frameEnd <= seek->targetPts) {
+                    // Drop frame before target.
+                    av_frame_unref(frame);
+                    seek->droppedFrames ++;
+                    increaseStats(StatsDropAccurateSeek);
+                    if (result == DecodeSuccess) {
+                        return DecodeFailAndNeedMorePkt;
+                    } else {
+                        // Current packet not send to decoder, retry it.
+                        continue;
+                    }
+                }
+            }
+            finishAccurateSeek(seek, codecCtx, stats, "video");
+            return result;
+        }
     } else {
         LOGE("Decode video fail, decoder is null.");
         return DecodeFail;
@@ -722,12 +1868,63 @@ tMediaDecodeResult tMediaPlayerContext::decodeVideo(AVPacket *targetPkt) const {
 }
 
 void tMediaPlayerContext::flushVideoCodecBuffer() const {
-    if (videoDecoder != nullptr) {
+    if (videoDecoder != nullptr && videoDecoder->video_decoder_ctx != nullptr) {
         avcodec_flush_buffers(videoDecoder->video_decoder_ctx);
+        videoDecoder->scrub_drained = false;
+        videoDecoder->decoded_frames.flush();
+        activeAccurateSeek(&videoDecoder->accurate_seek, videoDecoder->video_decoder_ctx);
+        videoDecoder->late_frame.reset();
+    }
+}
+
+void tMediaPlayerContext::reportVideoLateness(int64_t masterClockInMillis, int64_t latenessInMillis) const {
+    if (videoDecoder != nullptr) {
+        videoDecoder->late_frame.reportLateness(masterClockInMillis, latenessInMillis);
+    }
+}
+
+void tMediaPlayerContext::exportDecodeStats(int64_t *dst) const {
+    if (videoDecoder != nullptr) {
+        dst[0] = videoDecoder->decoded_frames.decodeCalls.load(std::memory_order_relaxed);
+        dst[1] = videoDecoder->decoded_frames.receivedFrames.load(std::memory_order_relaxed);
+    }
+    if (audioDecoder != nullptr) {
+        dst[2] = audioDecoder->decoded_frames.decodeCalls.load(std::memory_order_relaxed);
+        dst[3] = audioDecoder->decoded_frames.receivedFrames.load(std::memory_order_relaxed);
+        dst[4] = audioDecoder->pcm_output_bytes.load(std::memory_order_relaxed);
+        dst[5] = audioDecoder->pcm_copied_bytes.load(std::memory_order_relaxed);
+        dst[6] = (nowInMicros() - audioDecoder->pcm_stats_start_in_micros) / 1000L;
+    }
+}
+
+void tMediaPlayerContext::exportLateFrameStats(int64_t *dst) const {
+    if (videoDecoder != nullptr) {
+        videoDecoder->late_frame.exportTo(dst);
     }
 }
 
 tMediaOptResult tMediaPlayerContext::moveDecodedVideoFrameToBuffer(tMediaVideoBuffer *videoBuffer) {
+    int64_t convertStart = nowInMicros();
+    uint8_t *lastBuffers[] = {videoBuffer->rgbaBuffer, videoBuffer->yBuffer, videoBuffer->uBuffer, videoBuffer->vBuffer, videoBuffer->uvBuffer};
+    int64_t lastBytes = videoBuffer->allocatedBytes();
+    auto result = convertVideoFrame(videoBuffer);
+    videoBuffer->memoryTracker = memoryTracker;
+    if (memoryTracker != nullptr) {
+        memoryTracker->add(MemoryVideoBuffer, videoBuffer->allocatedBytes() - lastBytes);
+    }
+    if (result == OptSuccess) {
+        recordStats(StatsVideoConvertTime, nowInMicros() - convertStart);
+        uint8_t *buffers[] = {videoBuffer->rgbaBuffer, videoBuffer->yBuffer, videoBuffer->uBuffer, videoBuffer->vBuffer, videoBuffer->uvBuffer};
+        for (size_t i = 0; i < sizeof(buffers) / sizeof(buffers[0]); i ++) {
+            if (buffers[i] != lastBuffers[i]) {
+                increaseStats(StatsVideoBufferAlloc);
+            }
+        }
+    }
+    return result;
+}
+
+tMediaOptResult tMediaPlayerContext::convertVideoFrame(tMediaVideoBuffer *videoBuffer) {
     if (videoDecoder != nullptr) {
         auto video_frame = videoDecoder->video_frame;
         int w = video_frame->width;
@@ -762,10 +1959,14 @@ tMediaOptResult tMediaPlayerContext::moveDecodedVideoFrameToBuffer(tMediaVideoBu
         if (frameDisplayRatio == 0.0f) {
             frameDisplayRatio = (float_t) w / (float_t) h;
         }
+        int outW, outH;
+        computeVideoOutputSize(videoDecoder, w, h, frameDisplayRotation, &outW, &outH);
+        // Downscaled frames are converted to yuv420p by sws in one pass.
+        bool downscale = outW != w || outH != h;
 //        auto colorRange = video_frame->color_range;
 //        auto colorPrimaries = video_frame->color_primaries;
 //        auto colorSpace = video_frame->colorspace;
-        if (format == AV_PIX_FMT_YUV420P) {
+        if (format == AV_PIX_FMT_YUV420P && !downscale) {
             if (w % YUV_ALIGN_SIZE == 0) {
                 videoBuffer->width = w;
             } else {
@@ -816,7 +2017,7 @@ tMediaOptResult tMediaPlayerContext::moveDecodedVideoFrameToBuffer(tMediaVideoBu
             videoBuffer->uContentSize = uSize;
             videoBuffer->vContentSize = vSize;
             videoBuffer->type = Yuv420p;
-        } else if ((format == AV_PIX_FMT_NV12 || format == AV_PIX_FMT_NV21)) {
+        } else if ((format == AV_PIX_FMT_NV12 || format == AV_PIX_FMT_NV21) && !downscale) {
             if (w % YUV_ALIGN_SIZE == 0) {
                 videoBuffer->width = w;
             } else {
@@ -867,7 +2068,7 @@ tMediaOptResult tMediaPlayerContext::moveDecodedVideoFrameToBuffer(tMediaVideoBu
             } else {
                 videoBuffer->type = Nv21;
             }
-        } else if (format == AV_PIX_FMT_RGBA) {
+        } else if (format == AV_PIX_FMT_RGBA && !downscale) {
             videoBuffer->width = w;
             videoBuffer->height = h;
             int rgbaSize = av_image_get_buffer_size(AV_PIX_FMT_RGBA, w, h, 1);
@@ -887,7 +2088,7 @@ tMediaOptResult tMediaPlayerContext::moveDecodedVideoFrameToBuffer(tMediaVideoBu
             // copyFrameData(rgbaBuffer, frame->data[0], w, h, frame->linesize[0], 4);
             videoBuffer->rgbaContentSize = rgbaSize;
             videoBuffer->type = Rgba;
-        } else if (hw_pix_fmt_i != AV_PIX_FMT_NONE && format == hw_pix_fmt_i) {
+        } else if (videoDecoder->hw_pix_fmt != AV_PIX_FMT_NONE && format == videoDecoder->hw_pix_fmt) {
             int ret = av_mediacodec_release_buffer((AVMediaCodecBuffer *)video_frame->data[3], 1);
             if (ret < 0) {
                 LOGE("MediaCodec release buffer error: %d", ret);
@@ -896,11 +2097,14 @@ tMediaOptResult tMediaPlayerContext::moveDecodedVideoFrameToBuffer(tMediaVideoBu
             videoBuffer->height = h;
             videoBuffer->type = HwSurface;
         } else {
-            // Others format need to convert to Yuv420p.
-            if (w != video_width ||
-                h != video_height ||
+            // Others format or downscaled frame need to convert to Yuv420p.
+            if (w != videoDecoder->sws_src_width ||
+                h != videoDecoder->sws_src_height ||
+                format != videoDecoder->sws_src_format ||
+                outW != videoDecoder->sws_dst_width ||
+                outH != videoDecoder->sws_dst_height ||
                 videoDecoder->video_sws_ctx == nullptr) {
-                LOGD("Decode video change rgbaSize, recreate sws ctx.");
+                LOGD("Decode video size changed, recreate sws ctx: %dx%d -> %dx%d", w, h, outW, outH);
                 if (videoDecoder->video_sws_ctx != nullptr) {
                     sws_freeContext(videoDecoder->video_sws_ctx);
                 }
@@ -908,10 +2112,10 @@ tMediaOptResult tMediaPlayerContext::moveDecodedVideoFrameToBuffer(tMediaVideoBu
                         w,
                         h,
                         (AVPixelFormat) video_frame->format,
-                        w,
-                        h,
+                        outW,
+                        outH,
                         AV_PIX_FMT_YUV420P,
-                        SWS_BICUBIC,
+                        downscale ? SWS_BILINEAR : SWS_BICUBIC,
                         nullptr,
                         nullptr,
                         nullptr);
@@ -919,14 +2123,19 @@ tMediaOptResult tMediaPlayerContext::moveDecodedVideoFrameToBuffer(tMediaVideoBu
                     LOGE("Decode video fail, sws ctx create fail: %d, %d, %d, %d", video_frame->format == AV_PIX_FMT_MEDIACODEC, video_frame->linesize[0], video_frame->linesize[1], video_frame->linesize[2]);
                     return OptFail;
                 }
+                videoDecoder->sws_src_width = w;
+                videoDecoder->sws_src_height = h;
+                videoDecoder->sws_src_format = format;
+                videoDecoder->sws_dst_width = outW;
+                videoDecoder->sws_dst_height = outH;
             }
 
-            if (w % YUV_ALIGN_SIZE == 0) {
-                videoBuffer->width = w;
+            if (outW % YUV_ALIGN_SIZE == 0) {
+                videoBuffer->width = outW;
             } else {
-                videoBuffer->width = w + (YUV_ALIGN_SIZE - (w % YUV_ALIGN_SIZE));
+                videoBuffer->width = outW + (YUV_ALIGN_SIZE - (outW % YUV_ALIGN_SIZE));
             }
-            videoBuffer->height = h;
+            videoBuffer->height = outH;
             int yuvSize = av_image_get_buffer_size(AV_PIX_FMT_YUV420P, videoBuffer->width, videoBuffer->height, 1);
             int ySize = av_image_get_buffer_size(AV_PIX_FMT_GRAY8, videoBuffer->width, videoBuffer->height, 1);
             int uSize = (yuvSize - ySize) / 2;
@@ -975,7 +2184,7 @@ tMediaOptResult tMediaPlayerContext::moveDecodedVideoFrameToBuffer(tMediaVideoBu
             videoBuffer->vContentSize = vSize;
             videoBuffer->type = Yuv420p;
         }
-        auto time_base = video_stream->time_base;
+        auto time_base = videoDecoder->time_base;
         if (time_base.den > 0 && video_frame->pts != AV_NOPTS_VALUE) {
             videoBuffer->pts = (int64_t) ((double)video_frame->pts * av_q2d(time_base) * 1000.0);
         } else {
@@ -1001,10 +2210,83 @@ tMediaOptResult tMediaPlayerContext::moveDecodedVideoFrameToBuffer(tMediaVideoBu
 
 tMediaDecodeResult tMediaPlayerContext::decodeAudio(AVPacket *targetPkt) const {
     if (audioDecoder != nullptr) {
+        audioDecoder->decoded_frames.decodeCalls.fetch_add(1, std::memory_order_relaxed);
+        if (targetPkt != nullptr && targetPkt->data != nullptr && targetPkt->stream_index != audioDecoder->stream_index) {
+            // First packet of new track.
+            auto params = audioDecoder->requested_params.exchange(nullptr);
+            if (params != nullptr) {
+                auto current = avcodec_parameters_alloc();
+                if (audioDecoder->audio_decoder_ctx != nullptr) {
+                    avcodec_parameters_from_context(current, audioDecoder->audio_decoder_ctx);
+                }
+                if (audioDecoder->audio_decoder_ctx == nullptr || !isAudioCodecParamsMatch(current, params)) {
+                    reopenAudioDecoder(audioDecoder, params, targetPkt->time_base);
+                } else {
+                    audioDecoder->audio_decoder_ctx->pkt_timebase = targetPkt->time_base;
+                }
+                avcodec_parameters_free(&current);
+                avcodec_parameters_free(&params);
+                if (audioDecoder->audio_decoder_ctx != nullptr) {
+                    prepareAudioLoudness(audioDecoder, format_ctx, format_ctx->streams[targetPkt->stream_index]);
+                }
+            }
+            audioDecoder->stream_index = targetPkt->stream_index;
+            audioDecoder->time_base = targetPkt->time_base;
+        }
+        if (audioDecoder->audio_decoder_ctx == nullptr) {
+            LOGE("Decode audio fail, decoder ctx is null.");
+            return DecodeFail;
+        }
         if (targetPkt != nullptr) {
             av_packet_move_ref(audioDecoder->audio_pkt, targetPkt);
         }
-        return decode(audioDecoder->audio_decoder_ctx, audioDecoder->audio_frame, audioDecoder->audio_pkt);
+        if (audioDecoder->requested_scrub.load()) {
+            av_packet_unref(audioDecoder->audio_pkt);
+            return DecodeFailAndNeedMorePkt;
+        }
+        auto seek = &audioDecoder->accurate_seek;
+        auto codecCtx = audioDecoder->audio_decoder_ctx;
+        if (seek->targetPts < 0) {
+            return decode(codecCtx, &audioDecoder->decoded_frames, audioDecoder->audio_frame, audioDecoder->audio_pkt, statsHistogram(stats, StatsAudioDecodeTime));
+        }
+        auto time_base = audioDecoder->time_base;
+        while (true) {
+            int64_t decodeStart = nowInMicros();
+            auto result = decode(codecCtx, &audioDecoder->decoded_frames, audioDecoder->audio_frame, audioDecoder->audio_pkt, statsHistogram(stats, StatsAudioDecodeTime));
+            seek->decodeCostInMicros += nowInMicros() - decodeStart;
+            if (result != DecodeSuccess && result != DecodeSuccessAndSkipNextPkt) {
+                return result;
+            }
+            auto frame = audioDecoder->audio_frame;
+            if (frame->pts != AV_NOPTS_VALUE && frame->sample_rate > 0) {
+                int64_t framePts = ptsToMillis(frame->pts, time_base);
+                int64_t frameEnd = framePts + (int64_t) frame->nb_samples * 1000L / frame->sample_rate;
+                if (frameEnd <= seek->targetPts) {
+                    // Drop frame before target.
+                    av_frame_unref(frame);
+                    seek->droppedFrames ++;
+                    increaseStats(StatsDropAccurateSeek);
+                    if (result == DecodeSuccess) {
+                        return DecodeFailAndNeedMorePkt;
+                    } else {
+                        continue;
+                    }
+                }
+                // Trim samples before target, align audio to video target.
+                int skipSamples = (int) ((seek->targetPts - framePts) * frame->sample_rate / 1000L);
+                if (skipSamples > 0 && skipSamples < frame->nb_samples && av_frame_make_writable(frame) >= 0) {
+                    int remainSamples = frame->nb_samples - skipSamples;
+                    av_samples_copy(frame->extended_data, frame->extended_data, 0, skipSamples, remainSamples, frame->ch_layout.nb_channels, (AVSampleFormat) frame->format);
+                    frame->nb_samples = remainSamples;
+                    frame->pts += av_rescale_q(skipSamples, AVRational{1, frame->sample_rate}, time_base);
+                    if (frame->duration > 0) {
+                        frame->duration = av_rescale_q(remainSamples, AVRational{1, frame->sample_rate}, time_base);
+                    }
+                }
+            }
+            finishAccurateSeek(seek, codecCtx, stats, "audio");
+            return result;
+        }
     } else {
         LOGE("Decode audio fail, decoder is null.");
         return DecodeFail;
@@ -1012,16 +2294,178 @@ tMediaDecodeResult tMediaPlayerContext::decodeAudio(AVPacket *targetPkt) const {
 }
 
 void tMediaPlayerContext::flushAudioCodecBuffer() const {
-    if (audioDecoder != nullptr) {
+    if (audioDecoder != nullptr && audioDecoder->audio_decoder_ctx != nullptr) {
         avcodec_flush_buffers(audioDecoder->audio_decoder_ctx);
+        audioDecoder->decoded_frames.flush();
+        // Filter graph can't flush, drop it and recreate at next frame if need.
+        releaseAudioTempoFilter(audioDecoder);
+        activeAccurateSeek(&audioDecoder->accurate_seek, audioDecoder->audio_decoder_ctx);
+    }
+}
+
+void tMediaPlayerContext::setVideoOutputSize(int32_t width, int32_t height, bool crop) {
+    videoOutputWidth = width;
+    videoOutputHeight = height;
+    videoOutputCrop = crop;
+    if (videoDecoder != nullptr) {
+        videoDecoder->output_width.store(width);
+        videoDecoder->output_height.store(height);
+        videoDecoder->output_crop.store(crop);
+    }
+}
+
+void tMediaPlayerContext::setAudioTempo(double tempo) const {
+    if (audioDecoder != nullptr) {
+        audioDecoder->requested_tempo.store(tempo);
+    }
+}
+
+void tMediaPlayerContext::setScrubMode(bool enable) const {
+    if (videoDecoder != nullptr) {
+        videoDecoder->requested_scrub.store(enable);
+    }
+    if (audioDecoder != nullptr) {
+        audioDecoder->requested_scrub.store(enable);
+    }
+}
+
+void tMediaPlayerContext::setAudioNormalization(bool enable) const {
+    if (audioDecoder != nullptr) {
+        audioDecoder->requested_normalization.store(enable);
+    }
+}
+
+static double tempoOutputMediaPts(AudioDecoder *audioDecoder, const AVFrame *frame) {
+    if (frame->pts == AV_NOPTS_VALUE || audioDecoder->tempo_start_pts == AV_NOPTS_VALUE) {
+        return audioDecoder->tempo_next_pts;
     }
+    // atempo stamps output in output time since its first input, scale it back to media time by graph's tempo.
+    int64_t outPts = av_rescale_q(frame->pts, av_buffersink_get_time_base(audioDecoder->tempo_sink_ctx), AVRational{1, audioDecoder->audio_output_sample_rate});
+    double mediaSamples = (double) audioDecoder->tempo_start_pts + (double) (outPts - audioDecoder->tempo_start_pts) * audioDecoder->tempo;
+    return mediaSamples * 1000.0 / (double) audioDecoder->audio_output_sample_rate;
+}
+
+/**
+ * Move all ready filter outputs to audio buffer after contentOffset bytes, buffer's pts is set if contentOffset is 0.
+ */
+static tMediaOptResult moveTempoFilterOutputToBuffer(AudioDecoder *audioDecoder, tMediaAudioBuffer *audioBuffer, int contentOffset) {
+    auto &out_frames = audioDecoder->tempo_out_frames;
+    size_t frameCount = 0;
+    int outputSize = 0;
+    while (true) {
+        if (frameCount >= out_frames.size()) {
+            out_frames.push_back(av_frame_alloc());
+        }
+        auto out_frame = out_frames[frameCount];
+        int result = av_buffersink_get_frame(audioDecoder->tempo_sink_ctx, out_frame);
+        if (result == AVERROR(EAGAIN) || result == AVERROR_EOF) {
+            break;
+        }
+        if (result < 0) {
+            LOGE("Get tempo filter output frame fail: %d", result);
+            for (size_t i = 0; i < frameCount; i ++) {
+                av_frame_unref(out_frames[i]);
+            }
+            return OptFail;
+        }
+        // Output format is packed, all samples in data[0].
+        outputSize += av_samples_get_buffer_size(nullptr, audioDecoder->audio_output_channels, out_frame->nb_samples, audioDecoder->audio_output_sample_fmt, 1);
+        frameCount ++;
+    }
+    int newBufferSize = contentOffset + outputSize;
+    if (audioBuffer->bufferSize < newBufferSize || audioBuffer->pcmBuffer == nullptr) {
+        LOGD("Tempo audio change bufferSize, outBufferSize=%d, need bufferSize=%d", audioBuffer->bufferSize, newBufferSize);
+        auto newBuffer = static_cast<uint8_t *>(malloc(newBufferSize));
+        if (audioBuffer->pcmBuffer != nullptr) {
+            if (contentOffset > 0) {
+                memcpy(newBuffer, audioBuffer->pcmBuffer, contentOffset);
+                audioDecoder->pcm_copied_bytes.fetch_add(contentOffset, std::memory_order_relaxed);
+            }
+            free(audioBuffer->pcmBuffer);
+        }
+        audioBuffer->pcmBuffer = newBuffer;
+        audioBuffer->bufferSize = newBufferSize;
+    }
+    int contentSize = contentOffset;
+    for (size_t i = 0; i < frameCount; i ++) {
+        auto out_frame = out_frames[i];
+        int frameSize = av_samples_get_buffer_size(nullptr, audioDecoder->audio_output_channels, out_frame->nb_samples, audioDecoder->audio_output_sample_fmt, 1);
+        double framePts = tempoOutputMediaPts(audioDecoder, out_frame);
+        if (contentSize == 0) {
+            audioBuffer->pts = (int64_t) framePts;
+        }
+        memcpy(audioBuffer->pcmBuffer + contentSize, out_frame->data[0], frameSize);
+        audioDecoder->pcm_copied_bytes.fetch_add(frameSize, std::memory_order_relaxed);
+        contentSize += frameSize;
+        // Each output sample contains tempo samples of media.
+        audioDecoder->tempo_next_pts = framePts + (double) out_frame->nb_samples * audioDecoder->tempo * 1000.0 / (double) audioDecoder->audio_output_sample_rate;
+        av_frame_unref(out_frame);
+    }
+    if (contentSize == 0) {
+        audioBuffer->pts = (int64_t) audioDecoder->tempo_next_pts;
+    }
+    audioBuffer->contentSize = contentSize;
+    audioDecoder->pcm_output_bytes.fetch_add(contentSize - contentOffset, std::memory_order_relaxed);
+    int64_t duration = (int64_t) audioDecoder->tempo_next_pts - audioBuffer->pts;
+    audioBuffer->duration = duration > 0 ? duration : 0;
+    return OptSuccess;
 }
 
 tMediaOptResult tMediaPlayerContext::moveDecodedAudioFrameToBuffer(tMediaAudioBuffer *audioBuffer) const {
+    int64_t convertStart = nowInMicros();
+    auto lastPcmBuffer = audioBuffer->pcmBuffer;
+    int64_t lastBytes = lastPcmBuffer != nullptr ? audioBuffer->bufferSize : 0;
+    auto result = convertAudioFrame(audioBuffer);
+    audioBuffer->memoryTracker = memoryTracker;
+    if (memoryTracker != nullptr) {
+        memoryTracker->add(MemoryAudioBuffer, (audioBuffer->pcmBuffer != nullptr ? audioBuffer->bufferSize : 0) - lastBytes);
+    }
+    if (result == OptSuccess) {
+        recordStats(StatsAudioConvertTime, nowInMicros() - convertStart);
+        if (audioBuffer->pcmBuffer != lastPcmBuffer) {
+            increaseStats(StatsAudioBufferAlloc);
+        }
+    }
+    return result;
+}
+
+tMediaOptResult tMediaPlayerContext::convertAudioFrame(tMediaAudioBuffer *audioBuffer) const {
     if (audioDecoder != nullptr) {
         auto audio_frame = audioDecoder->audio_frame;
         int in_nb_samples = audio_frame->nb_samples;
 
+        // Apply new tempo: drain samples buffered by atempo at old tempo to this buffer, new graph starts from current frame's pts.
+        double requestedTempo = audioDecoder->requested_tempo.load();
+        int tempoContentOffset = 0;
+        if (requestedTempo != audioDecoder->tempo) {
+            LOGD("Audio tempo changed: %f -> %f", audioDecoder->tempo, requestedTempo);
+            if (audioDecoder->tempo_graph != nullptr) {
+                int result = av_buffersrc_add_frame_flags(audioDecoder->tempo_src_ctx, nullptr, 0);
+                if (result >= 0 && moveTempoFilterOutputToBuffer(audioDecoder, audioBuffer, 0) == OptSuccess) {
+                    tempoContentOffset = audioBuffer->contentSize;
+                } else {
+                    LOGE("Drain tempo filter fail: %d", result);
+                }
+            }
+            audioDecoder->tempo = requestedTempo;
+            // Drained output is in buffer, filter current frame even at 1.0 to append it, graph is dropped at next flush.
+            if (requestedTempo != 1.0 || tempoContentOffset > 0) {
+                prepareAudioTempoFilter(audioDecoder);
+            } else {
+                releaseAudioTempoFilter(audioDecoder);
+            }
+            if (audioDecoder->tempo_graph == nullptr && tempoContentOffset > 0) {
+                // Keep drained output, drop current frame.
+                av_frame_unref(audio_frame);
+                return OptSuccess;
+            }
+        }
+        if (audioDecoder->tempo_graph == nullptr && audioDecoder->tempo != 1.0) {
+            prepareAudioTempoFilter(audioDecoder);
+        }
+        auto time_base = audioDecoder->time_base;
+        bool useTempoFilter = audioDecoder->tempo_graph != nullptr;
+
         // Get current output frame contains sample bufferSize per channel.
         int out_nb_samples = (int) av_rescale_rnd( swr_get_delay(audioDecoder->audio_swr_ctx, audio_frame->sample_rate) + in_nb_samples, audioDecoder->audio_output_sample_rate, audioDecoder->audio_decoder_ctx->sample_rate, AV_ROUND_UP); // swr_get_out_samples(swr_ctx, in_nb_samples);
 
@@ -1029,6 +2473,57 @@ tMediaOptResult tMediaPlayerContext::moveDecodedAudioFrameToBuffer(tMediaAudioBu
             LOGE("Get out put nb samples fail: %d", out_nb_samples);
             return OptFail;
         }
+        if (useTempoFilter) {
+            // Convert to filter input frame, tempo filter output is moved to audio buffer.
+            auto in_frame = audioDecoder->tempo_in_frame;
+            int result;
+            if (in_frame->buf[0] == nullptr || audioDecoder->tempo_in_capacity < out_nb_samples) {
+                av_frame_unref(in_frame);
+                in_frame->nb_samples = out_nb_samples;
+                in_frame->format = audioDecoder->audio_output_sample_fmt;
+                in_frame->sample_rate = audioDecoder->audio_output_sample_rate;
+                av_channel_layout_copy(&in_frame->ch_layout, &audioDecoder->audio_output_ch_layout);
+                result = av_frame_get_buffer(in_frame, 0);
+                audioDecoder->tempo_in_capacity = out_nb_samples;
+            } else {
+                // atempo copies input to its own buffer, last input's buffer is not referenced by filter, no copy here.
+                in_frame->nb_samples = audioDecoder->tempo_in_capacity;
+                result = av_frame_make_writable(in_frame);
+            }
+            if (result < 0) {
+                LOGE("Alloc tempo input frame fail: %d", result);
+                av_frame_unref(in_frame);
+                return OptFail;
+            }
+            int real_out_nb_samples = swr_convert(audioDecoder->audio_swr_ctx, in_frame->data, out_nb_samples, (const uint8_t **)(audio_frame->data), in_nb_samples);
+            if (real_out_nb_samples < 0) {
+                LOGE("Decode audio swr convert fail: %d", real_out_nb_samples);
+                return OptFail;
+            }
+            in_frame->nb_samples = real_out_nb_samples;
+            // Normalize before time stretch, loudness is measured at media time.
+            audioDecoder->loudness.process(in_frame->data[0], real_out_nb_samples, audioDecoder->requested_normalization.load());
+            if (audioDecoder->tempo_start_pts == AV_NOPTS_VALUE) {
+                if (time_base.den > 0 && audio_frame->pts != AV_NOPTS_VALUE) {
+                    audioDecoder->tempo_start_pts = av_rescale_q(audio_frame->pts, time_base, AVRational{1, audioDecoder->audio_output_sample_rate});
+                } else {
+                    audioDecoder->tempo_start_pts = 0;
+                }
+                audioDecoder->tempo_next_pts = (double) audioDecoder->tempo_start_pts * 1000.0 / (double) audioDecoder->audio_output_sample_rate;
+            }
+            // Filter input carries media pts, continuous from graph's first input.
+            in_frame->pts = audioDecoder->tempo_start_pts + audioDecoder->tempo_in_samples;
+            audioDecoder->tempo_in_samples += real_out_nb_samples;
+            av_frame_unref(audio_frame);
+            result = av_buffersrc_add_frame_flags(audioDecoder->tempo_src_ctx, in_frame, AV_BUFFERSRC_FLAG_KEEP_REF);
+            if (result < 0) {
+                LOGE("Add frame to tempo filter fail: %d", result);
+                return OptFail;
+            }
+            // Output maybe empty, atempo need more input samples.
+            return moveTempoFilterOutputToBuffer(audioDecoder, audioBuffer, tempoContentOffset);
+        }
+
         // Get current output audio frame need buffer bufferSize.
         int lineSize = 0;
         int out_audio_buffer_size = av_samples_get_buffer_size(&lineSize, audioDecoder->audio_output_channels, out_nb_samples, audioDecoder->audio_output_sample_fmt, 1);
@@ -1048,7 +2543,7 @@ tMediaOptResult tMediaPlayerContext::moveDecodedAudioFrameToBuffer(tMediaAudioBu
             LOGE("Decode audio swr convert fail: %d", real_out_nb_samples);
             return OptFail;
         }
-        auto time_base = audio_stream->time_base;
+        audioDecoder->loudness.process(audioBuffer->pcmBuffer, real_out_nb_samples, audioDecoder->requested_normalization.load());
         if (time_base.den > 0 && audio_frame->pts != AV_NOPTS_VALUE) {
             audioBuffer->pts = (int64_t) ((double)audio_frame->pts * av_q2d(time_base) * 1000.0);
         } else {
@@ -1061,6 +2556,7 @@ tMediaOptResult tMediaPlayerContext::moveDecodedAudioFrameToBuffer(tMediaAudioBu
         }
         int contentBufferSize = av_samples_get_buffer_size(&lineSize, audioDecoder->audio_output_channels, real_out_nb_samples, audioDecoder->audio_output_sample_fmt, 1);
         audioBuffer->contentSize = lineSize;
+        audioDecoder->pcm_output_bytes.fetch_add(lineSize, std::memory_order_relaxed);
         if (contentBufferSize != lineSize) {
             LOGE("output lineSize=%d, contentBufferSize=%d", lineSize, contentBufferSize);
         }
@@ -1071,6 +2567,18 @@ tMediaOptResult tMediaPlayerContext::moveDecodedAudioFrameToBuffer(tMediaAudioBu
     }
 }
 
+void tMediaPlayerContext::increaseStats(tMediaStatsCounterType type, int64_t count) const {
+    if (stats != nullptr) {
+        stats->increase(type, count);
+    }
+}
+
+void tMediaPlayerContext::recordStats(tMediaStatsHistogramType type, int64_t value) const {
+    if (stats != nullptr) {
+        stats->record(type, value);
+    }
+}
+
 void tMediaPlayerContext::requestInterruptReadPkt() {
     this->interruptReadPkt = true;
 }
@@ -1081,11 +2589,48 @@ void tMediaPlayerContext::release() {
         av_packet_free(&pkt);
         pkt = nullptr;
     }
+    if (keyframeIndex != nullptr) {
+        delete keyframeIndex;
+        keyframeIndex = nullptr;
+    }
+    keyframe_index_stream = nullptr;
     if (format_ctx != nullptr) {
         avformat_close_input(&format_ctx);
         avformat_free_context(format_ctx);
         format_ctx = nullptr;
     }
+    // After demuxer closed segments.
+    if (abr != nullptr) {
+        abr->release();
+        delete abr;
+        abr = nullptr;
+    }
+    // Custom io is not closed by avformat_close_input.
+    if (localIO != nullptr) {
+        localIO->release();
+        delete localIO;
+        localIO = nullptr;
+    }
+    if (readAheadIO != nullptr) {
+        readAheadIO->release();
+        delete readAheadIO;
+        readAheadIO = nullptr;
+    }
+    // After read ahead io thread stopped.
+    if (cacheIO != nullptr) {
+        cacheIO->release();
+        delete cacheIO;
+        cacheIO = nullptr;
+    }
+    // After abr and read ahead io stopped reporting throughput.
+    if (buffering != nullptr) {
+        delete buffering;
+        buffering = nullptr;
+    }
+    if (cacheDir != nullptr) {
+        free(cacheDir);
+        cacheDir = nullptr;
+    }
 
     // File Metadata
     if (fileMetadata != nullptr) {
@@ -1108,7 +2653,8 @@ void tMediaPlayerContext::release() {
     }
     if (videoDecoder != nullptr) {
         releaseVideoDecoder(videoDecoder);
-        free(videoDecoder);
+        freeRequestedParams(&videoDecoder->requested_params);
+        delete videoDecoder;
         videoDecoder = nullptr;
     }
 
@@ -1120,10 +2666,35 @@ void tMediaPlayerContext::release() {
     }
     if (audioDecoder != nullptr) {
         releaseAudioDecoder(audioDecoder);
-        free(audioDecoder);
+        freeRequestedParams(&audioDecoder->requested_params);
+        delete audioDecoder;
         audioDecoder = nullptr;
     }
 
+    // Tracks free
+    if (videoTracks != nullptr) {
+        for (int i = 0; i < videoTrackCount; i ++) {
+            releaseMetadata(&videoTracks[i]->streamMetadata);
+            delete videoTracks[i];
+        }
+        free(videoTracks);
+        videoTrackCount = 0;
+        videoTracks = nullptr;
+    }
+    if (audioTracks != nullptr) {
+        for (int i = 0; i < audioTrackCount; i ++) {
+            releaseMetadata(&audioTracks[i]->streamMetadata);
+            delete audioTracks[i];
+        }
+        free(audioTracks);
+        audioTrackCount = 0;
+        audioTracks = nullptr;
+    }
+    if (trackSwitchFilter != nullptr) {
+        delete trackSwitchFilter;
+        trackSwitchFilter = nullptr;
+    }
+
     // Subtitle free
     if (subtitleStreams != nullptr) {
         for (int i = 0; i < subtitleStreamCount; i ++) {
@@ -0,0 +1,67 @@
+#include "tmediastats.h"
+
+void tMediaHistogram::record(int64_t value) {
+    if (value < 0) {
+        value = -value;
+    }
+    int32_t bucket = 0;
+    int64_t v = value;
+    while (v > 0 && bucket < STATS_HISTOGRAM_BUCKET_COUNT - 1) {
+        v >>= 1;
+        bucket ++;
+    }
+    buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    sampleCount.fetch_add(1, std::memory_order_relaxed);
+    sampleSum.fetch_add(value, std::memory_order_relaxed);
+    int64_t lastMax = maxValue.load(std::memory_order_relaxed);
+    while (value > lastMax && !maxValue.compare_exchange_weak(lastMax, value, std::memory_order_relaxed)) {}
+}
+
+void tMediaHistogram::reset() {
+    for (auto &b : buckets) {
+        b.store(0, std::memory_order_relaxed);
+    }
+    sampleCount.store(0, std::memory_order_relaxed);
+    sampleSum.store(0, std::memory_order_relaxed);
+    maxValue.store(0, std::memory_order_relaxed);
+}
+
+void tMediaHistogram::exportTo(int64_t *dst) const {
+    dst[0] = sampleCount.load(std::memory_order_relaxed);
+    dst[1] = sampleSum.load(std::memory_order_relaxed);
+    dst[2] = maxValue.load(std::memory_order_relaxed);
+    for (int i = 0; i < STATS_HISTOGRAM_BUCKET_COUNT; i ++) {
+        dst[3 + i] = buckets[i].load(std::memory_order_relaxed);
+    }
+}
+
+static_assert(StatsAccurateSeekFirstFrameTime + 1 == STATS_HISTOGRAM_TYPE_COUNT, "Histogram type count mismatch.");
+static_assert(StatsAudioBufferAlloc + 1 == STATS_COUNTER_TYPE_COUNT, "Counter type count mismatch.");
+
+void tMediaPlayerStats::increase(tMediaStatsCounterType type, int64_t count) {
+    counters[type].fetch_add(count, std::memory_order_relaxed);
+}
+
+void tMediaPlayerStats::record(tMediaStatsHistogramType type, int64_t value) {
+    histograms[type].record(value);
+}
+
+void tMediaPlayerStats::reset() {
+    for (auto &c : counters) {
+        c.store(0, std::memory_order_relaxed);
+    }
+    for (auto &h : histograms) {
+        h.reset();
+    }
+}
+
+void tMediaPlayerStats::exportTo(int64_t *dst) const {
+    for (int i = 0; i < STATS_COUNTER_TYPE_COUNT; i ++) {
+        dst[i] = counters[i].load(std::memory_order_relaxed);
+    }
+    int64_t *histogramDst = dst + STATS_COUNTER_TYPE_COUNT;
+    for (const auto &h : histograms) {
+        h.exportTo(histogramDst);
+        histogramDst += STATS_HISTOGRAM_EXPORT_SIZE;
+    }
+}
@@ -17,6 +17,12 @@ typedef struct tMediaSubtitleBuffer {
     int32_t bufferSize = 0;
     int64_t start_pts = 0;
     int64_t end_pts = 0;
+    // Tracker of player which last wrote this buffer, nullable.
+    tMediaMemoryTracker *memoryTracker = nullptr;
+
+    int64_t allocatedBytes() const {
+        return rgbaBuffer != nullptr ? bufferSize : 0;
+    }
 } tMediaSubtitleBuffer;
 
 typedef struct tMediaSubtitleContext {
@@ -28,6 +34,9 @@ typedef struct tMediaSubtitleContext {
     int32_t frame_width = 0;
     int32_t frame_height = 0;
 
+    // Tracker of player, owned by java player and outlive this context, nullable.
+    tMediaMemoryTracker *memoryTracker = nullptr;
+
     // Ass
     ASS_Library *ass_library = nullptr;
     ASS_Renderer *ass_renderer = nullptr;
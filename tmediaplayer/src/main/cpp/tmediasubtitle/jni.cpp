@@ -10,8 +10,10 @@
 extern "C" JNIEXPORT jlong JNICALL
 Java_com_tans_tmediaplayer_subtitle_tMediaSubtitle_createSubtitleNative(
         JNIEnv * env,
-        jobject j_subtitle) {
+        jobject j_subtitle,
+        jlong native_memory_tracker) {
     auto ctx = new tMediaSubtitleContext ;
+    ctx->memoryTracker = reinterpret_cast<tMediaMemoryTracker *>(native_memory_tracker);
     return reinterpret_cast<jlong>(ctx);
 }
 
@@ -82,7 +84,13 @@ Java_com_tans_tmediaplayer_subtitle_tMediaSubtitle_moveDecodedSubtitleFrameToBuf
         jlong native_subtitle_buffer) {
     auto subtitle = reinterpret_cast<tMediaSubtitleContext *>(native_subtitle);
     auto subtitleBuffer = reinterpret_cast<tMediaSubtitleBuffer *>(native_subtitle_buffer);
-    return subtitle->moveDecodedSubtitleFrameToBuffer(subtitleBuffer);
+    int64_t lastBytes = subtitleBuffer->allocatedBytes();
+    auto result = subtitle->moveDecodedSubtitleFrameToBuffer(subtitleBuffer);
+    subtitleBuffer->memoryTracker = subtitle->memoryTracker;
+    if (subtitle->memoryTracker != nullptr) {
+        subtitle->memoryTracker->add(MemorySubtitleBuffer, subtitleBuffer->allocatedBytes() - lastBytes);
+    }
+    return result;
 }
 
 
@@ -159,6 +167,9 @@ Java_com_tans_tmediaplayer_subtitle_tMediaSubtitle_releaseSubtitleBufferNative(
         jobject j_subtitle,
         jlong native_buffer) {
     auto buffer = reinterpret_cast<tMediaSubtitleBuffer *>(native_buffer);
+    if (buffer->memoryTracker != nullptr) {
+        buffer->memoryTracker->add(MemorySubtitleBuffer, -buffer->allocatedBytes());
+    }
     if (buffer->rgbaBuffer != nullptr) {
         free(buffer->rgbaBuffer);
         buffer->rgbaBuffer = nullptr;
@@ -1,5 +1,6 @@
 package com.tans.tmediaplayer.audiotrack
 
+import android.os.SystemClock
 import androidx.annotation.Keep
 import com.tans.tmediaplayer.tMediaPlayerLog
 import com.tans.tmediaplayer.player.model.AudioChannel
@@ -22,6 +23,7 @@ internal class tMediaAudioTrack(
     private val nativeAudioTrack: AtomicReference<Long?> = AtomicReference(null)
 
     init {
+        val startTime = SystemClock.uptimeMillis()
         val nativeAudioTrack = createAudioTrackNative()
         val result = prepareNative(
             nativeAudioTrack = nativeAudioTrack,
@@ -34,7 +36,7 @@ internal class tMediaAudioTrack(
             releaseNative(nativeAudioTrack)
             tMediaPlayerLog.e(TAG) { "Prepare audio track fail." }
         } else {
-            tMediaPlayerLog.d(TAG) { "Prepare audio track success." }
+            tMediaPlayerLog.d(TAG) { "Prepare audio track success, cost ${SystemClock.uptimeMillis() - startTime} ms." }
             this.nativeAudioTrack.set(nativeAudioTrack)
         }
     }
@@ -61,6 +63,18 @@ internal class tMediaAudioTrack(
         }
     }
 
+    /**
+     * Media pts of the sample which is playing by sink, -1 if no buffer played.
+     */
+    fun getPlaybackPts(): Long {
+        val nativeAudioTrack = this.nativeAudioTrack.get()
+        return if (nativeAudioTrack != null) {
+            getPlaybackPtsNative(nativeAudioTrack)
+        } else {
+            -1L
+        }
+    }
+
     fun clearBuffers(): OptResult {
         val nativeAudioTrack = this.nativeAudioTrack.get()
         val result = if (nativeAudioTrack == null) {
@@ -133,6 +147,8 @@ internal class tMediaAudioTrack(
 
     private external fun getBufferQueueCountNative(nativeAudioTrack: Long): Int
 
+    private external fun getPlaybackPtsNative(nativeAudioTrack: Long): Long
+
     private external fun clearBuffersNative(nativeAudioTrack: Long): Int
 
     private external fun playNative(nativeAudioTrack: Long): Int
@@ -15,8 +15,8 @@ internal class Clock {
     private var packetQueue: PacketQueue? = null
 
     @Synchronized
-    fun initClock(pktQueue: PacketQueue?) {
-        speed = 1.0
+    fun initClock(pktQueue: PacketQueue?, speed: Double = 1.0) {
+        this.speed = speed
         paused = true
         packetQueue = pktQueue
         pts = -1
@@ -34,7 +34,12 @@ internal class Clock {
     }
 
 
+    @Synchronized
     fun setSpeed(s: Double) {
+        // Update pts with old speed before change speed.
+        if (pts >= 0L) {
+            setClock(getClock(), serial)
+        }
         this.speed = s
     }
 
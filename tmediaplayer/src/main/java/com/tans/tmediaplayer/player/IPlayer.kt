@@ -3,8 +3,15 @@ package com.tans.tmediaplayer.player
 import android.view.SurfaceView
 import android.view.TextureView
 import androidx.annotation.FloatRange
+import com.tans.tmediaplayer.player.model.AbrStats
+import com.tans.tmediaplayer.player.model.BufferingStats
+import com.tans.tmediaplayer.player.model.DecodeStats
+import com.tans.tmediaplayer.player.model.LateFrameStats
 import com.tans.tmediaplayer.player.model.MediaInfo
+import com.tans.tmediaplayer.player.model.MediaTrackInfo
+import com.tans.tmediaplayer.player.model.MemoryStats
 import com.tans.tmediaplayer.player.model.OptResult
+import com.tans.tmediaplayer.player.model.PlayerStats
 import com.tans.tmediaplayer.player.model.SubtitleStreamInfo
 import com.tans.tmediaplayer.player.playerview.ScaleType
 import com.tans.tmediaplayer.player.playerview.filter.ImageFilter
@@ -13,18 +20,99 @@ internal interface IPlayer {
 
     fun prepare(file: String): OptResult
 
+    /**
+     * Prepare next media in background, when current media play end, switch to next media without gap.
+     * Set null to clear next media.
+     */
+    fun setNextMedia(file: String?)
+
+    fun getNextMedia(): String?
+
     fun play(): OptResult
 
     fun pause(): OptResult
 
     fun seekTo(position: Long): OptResult
 
+    /**
+     * If enabled, seek to the exact position instead of the key frame before it, cost more decoding time.
+     */
+    fun setAccurateSeek(enable: Boolean)
+
+    fun isAccurateSeekEnabled(): Boolean
+
+    /**
+     * Nearest keyframe position before or after target position, seeking to keyframe is cheap.
+     * Keyframes are read from container index or collected while playing, null if unknown.
+     */
+    fun getNearestKeyframe(position: Long, before: Boolean): Long?
+
+    /**
+     * Scrub preview while dragging seek bar: only keyframes are decoded and audio is not decoded,
+     * seeking requests are coalesced. When scrubbing finished, seek to the last position normally.
+     */
+    fun setScrubbing(enable: Boolean)
+
+    fun isScrubbing(): Boolean
+
+    /**
+     * Network stream bytes read ahead and not demuxed yet, null if media is not read ahead.
+     */
+    fun getNetworkBufferedBytes(): Long?
+
+    /**
+     * Millis of network stream read ahead, estimated by media bitrate, null if unknown.
+     */
+    fun getNetworkBufferedDuration(): Long?
+
+    /**
+     * Buffering targets, buffer health and rebuffering stats of current media.
+     */
+    fun getBufferingStats(): BufferingStats?
+
+    /**
+     * Video frames dropped by decoder because renderer is behind master clock.
+     */
+    fun getLateFrameStats(): LateFrameStats?
+
+    /**
+     * Decode calls and frames received from decoders, frames per call shows decoder batching.
+     */
+    fun getDecodeStats(): DecodeStats?
+
+    /**
+     * Variants and bandwidth estimation of hls / dash media, null if media has no variants to switch.
+     */
+    fun getAbrStats(): AbrStats?
+
+    /**
+     * Live low latency mode (rtsp / rtp / udp / srt): play slightly faster when buffered latency exceeds target millis.
+     */
+    fun setLiveTargetLatency(latency: Long)
+
+    /**
+     * Live stream latency in millis, glass to glass if stream has wall clock (RTCP), otherwise buffered latency.
+     * Null if not live stream.
+     */
+    fun getLiveLatency(): Long?
+
     fun stop(): OptResult
 
     fun release(): OptResult
 
     fun getProgress(): Long
 
+    fun setPlaySpeed(@FloatRange(0.5, 3.0) speed: Float): OptResult
+
+    fun getPlaySpeed(): Float
+
+    /**
+     * Normalize audio loudness, use ReplayGain / R128 tags if media contains, otherwise measure loudness while playing.
+     */
+    fun setAudioNormalization(enable: Boolean)
+
+    fun isAudioNormalizationEnabled(): Boolean
+
     fun getState(): tMediaPlayerState
 
     fun getMediaInfo(): MediaInfo?
@@ -35,6 +123,20 @@ internal interface IPlayer {
 
     fun attachPlayerView(view: SurfaceView?)
 
+    /**
+     * Switch audio track at current position, not supported while hls / dash variants are switched by abr.
+     */
+    fun selectAudioTrack(track: MediaTrackInfo): OptResult
+
+    fun getSelectedAudioTrack(): MediaTrackInfo?
+
+    /**
+     * Switch video track at current position, not supported while hls / dash variants are switched by abr.
+     */
+    fun selectVideoTrack(track: MediaTrackInfo): OptResult
+
+    fun getSelectedVideoTrack(): MediaTrackInfo?
+
     fun selectSubtitleStream(subtitle: SubtitleStreamInfo?)
 
     fun getSelectedSubtitleStream(): SubtitleStreamInfo?
@@ -60,4 +162,13 @@ internal interface IPlayer {
     fun getSubtitleYOffset(): Float
 
     fun refreshVideoFrame()
+
+    fun getStats(): PlayerStats?
+
+    /**
+     * Native buffers held by this player and by all players in process.
+     */
+    fun getMemoryStats(): MemoryStats?
+
+    fun resetStats()
 }
\ No newline at end of file
@@ -1,17 +1,18 @@
 package com.tans.tmediaplayer.player.decoder
 
-import android.os.Handler
-import android.os.HandlerThread
 import android.os.Message
 import com.tans.tmediaplayer.tMediaPlayerLog
+import com.tans.tmediaplayer.player.looper.SharedLooper
+import com.tans.tmediaplayer.player.looper.SharedLooperHandler
+import com.tans.tmediaplayer.player.looper.SharedLoopers
 import com.tans.tmediaplayer.player.model.DecodeResult
+import com.tans.tmediaplayer.player.model.LooperPriority
 import com.tans.tmediaplayer.player.model.OptResult
 import com.tans.tmediaplayer.player.rwqueue.AudioFrame
 import com.tans.tmediaplayer.player.rwqueue.AudioFrameQueue
 import com.tans.tmediaplayer.player.rwqueue.PacketQueue
 import com.tans.tmediaplayer.player.rwqueue.ReadWriteQueueListener
 import com.tans.tmediaplayer.player.tMediaPlayer
-import java.util.concurrent.atomic.AtomicBoolean
 import java.util.concurrent.atomic.AtomicReference
 
 internal class AudioFrameDecoder(
@@ -22,18 +23,8 @@ internal class AudioFrameDecoder(
 
     private val state: AtomicReference<DecoderState> = AtomicReference(DecoderState.NotInit)
 
-    // Is read thread ready?
-    private val isLooperPrepared: AtomicBoolean by lazy { AtomicBoolean(false) }
-
-    // Audio decode thread.
-    private val audioDecoderThread: HandlerThread by lazy {
-        object : HandlerThread("tMP_AudioDecoder", MAX_PRIORITY) {
-            override fun onLooperPrepared() {
-                super.onLooperPrepared()
-                isLooperPrepared.set(true)
-            }
-        }.apply { start() }
-    }
+    // Audio decode thread, shared with other players' audio stages.
+    private val sharedLooper: SharedLooper = SharedLoopers.acquire(LooperPriority.Audio)
 
     private val packetQueueListener: ReadWriteQueueListener = object : ReadWriteQueueListener {
         override fun onNewWriteableFrame() { }
@@ -52,8 +43,8 @@ internal class AudioFrameDecoder(
 
     private val activeStates = arrayOf(DecoderState.Ready, DecoderState.Eof, DecoderState.WaitingWritableFrameBuffer, DecoderState.WaitingReadablePacketBuffer)
 
-    private val audioDecoderHandler: Handler by lazy {
-        object : Handler(audioDecoderThread.looper) {
+    private val audioDecoderHandler: SharedLooperHandler by lazy {
+        object : SharedLooperHandler(sharedLooper) {
 
             private var skipNextPktRead: Boolean = false
 
@@ -104,8 +95,13 @@ internal class AudioFrameDecoder(
                                                         frame.serial = packetSerial
                                                         val moveResult = player.moveDecodedAudioFrameToBufferInternal(nativePlayer, frame)
                                                         if (moveResult == OptResult.Success) {
-                                                            audioFrame = frame
-                                                            audioFrameQueue.enqueueReadable(frame)
+                                                            if (player.getAudioFrameSizeInternal(frame.nativeFrame) > 0) {
+                                                                audioFrame = frame
+                                                                audioFrameQueue.enqueueReadable(frame)
+                                                            } else {
+                                                                // Time stretch filter need more samples to output.
+                                                                audioFrameQueue.enqueueWritable(frame)
+                                                            }
                                                         } else {
                                                             audioFrameQueue.enqueueWritable(frame)
                                                             tMediaPlayerLog.e(TAG) { "Move audio frame fail." }
@@ -140,6 +136,7 @@ internal class AudioFrameDecoder(
                                 } else {
                                     // tMediaPlayerLog.d(TAG) { "Waiting packet queue readable buffer." }
                                     this@AudioFrameDecoder.state.set(DecoderState.WaitingReadablePacketBuffer)
+                                    player.packetQueueUnderrun(isVideo = false)
                                 }
                             }
                         }
@@ -150,8 +147,6 @@ internal class AudioFrameDecoder(
     }
 
     init {
-        audioDecoderThread
-        while (!isLooperPrepared.get()) {}
         audioDecoderHandler
         audioPacketQueue.addListener(packetQueueListener)
         audioFrameQueue.addListener(frameQueueListener)
@@ -193,8 +188,8 @@ internal class AudioFrameDecoder(
             val oldState = getState()
             if (oldState != DecoderState.NotInit && oldState != DecoderState.Released) {
                 state.set(DecoderState.Released)
-                audioDecoderThread.quit()
-                audioDecoderThread.quitSafely()
+                audioDecoderHandler.detach()
+                SharedLoopers.release(sharedLooper)
                 audioPacketQueue.removeListener(packetQueueListener)
                 audioFrameQueue.removeListener(frameQueueListener)
                 tMediaPlayerLog.d(TAG) { "Video decoder released." }
@@ -1,11 +1,13 @@
 package com.tans.tmediaplayer.player.decoder
 
-import android.os.Handler
-import android.os.HandlerThread
 import android.os.Message
 import com.tans.tmediaplayer.tMediaPlayerLog
+import com.tans.tmediaplayer.player.looper.SharedLooper
+import com.tans.tmediaplayer.player.looper.SharedLooperHandler
+import com.tans.tmediaplayer.player.looper.SharedLoopers
 import com.tans.tmediaplayer.player.model.DecodeResult
 import com.tans.tmediaplayer.player.model.ImageRawType
+import com.tans.tmediaplayer.player.model.LooperPriority
 import com.tans.tmediaplayer.player.model.OptResult
 import com.tans.tmediaplayer.player.model.VIDEO_FRAME_QUEUE_SIZE
 import com.tans.tmediaplayer.player.playerview.GLRenderer
@@ -15,7 +17,6 @@ import com.tans.tmediaplayer.player.rwqueue.VideoFrame
 import com.tans.tmediaplayer.player.rwqueue.VideoFrameQueue
 import com.tans.tmediaplayer.player.tMediaPlayer
 import java.util.concurrent.LinkedBlockingDeque
-import java.util.concurrent.atomic.AtomicBoolean
 import java.util.concurrent.atomic.AtomicReference
 
 internal class VideoFrameDecoder(
@@ -26,18 +27,8 @@ internal class VideoFrameDecoder(
 
     private val state: AtomicReference<DecoderState> = AtomicReference(DecoderState.NotInit)
 
-    // Is read thread ready?
-    private val isLooperPrepared: AtomicBoolean by lazy { AtomicBoolean(false) }
-
-    // Video decode thread.
-    private val videoDecoderThread: HandlerThread by lazy {
-        object : HandlerThread("tMP_VideoDecoder", Thread.MAX_PRIORITY) {
-            override fun onLooperPrepared() {
-                super.onLooperPrepared()
-                isLooperPrepared.set(true)
-            }
-        }.apply { start() }
-    }
+    // Video decode thread, shared with other players' video stages.
+    private val sharedLooper: SharedLooper = SharedLoopers.acquire(LooperPriority.Video)
 
     private val packetQueueListener: ReadWriteQueueListener = object : ReadWriteQueueListener {
         override fun onNewWriteableFrame() { }
@@ -105,8 +96,8 @@ internal class VideoFrameDecoder(
     private val waitingGLRendererFramesLazyDelete = lazy { LinkedBlockingDeque<VideoFrame>() }
     private val waitingGLRendererFrames: LinkedBlockingDeque<VideoFrame> by waitingGLRendererFramesLazyDelete
 
-    private val videoDecoderHandler: Handler by lazy {
-        object : Handler(videoDecoderThread.looper) {
+    private val videoDecoderHandler: SharedLooperHandler by lazy {
+        object : SharedLooperHandler(sharedLooper) {
 
             private var skipNextPktRead: Boolean = false
 
@@ -199,12 +190,8 @@ internal class VideoFrameDecoder(
                                                             )
                                                         if (moveResult == OptResult.Success) {
                                                             videoFrame = frame
-                                                            val type = player.getVideoFrameTypeNativeInternal(frame.nativeFrame)
-                                                            if (type == ImageRawType.HwSurface) { // OES texture image
-                                                                frame.imageType = ImageRawType.HwSurface
-                                                                frame.width = player.getVideoWidthNativeInternal(frame.nativeFrame)
-                                                                frame.height = player.getVideoHeightNativeInternal(frame.nativeFrame)
-                                                                frame.pts = player.getVideoPtsInternal(frame.nativeFrame)
+                                                            videoFrameQueue.loadFrameInfo(frame)
+                                                            if (frame.imageType == ImageRawType.HwSurface) { // OES texture image
                                                                 val surfaceTexture = player.getHwSurfaces()?.second
                                                                 val oesTexture = oesTextureAndBufferTextures?.first
                                                                 val textureBuffers = oesTextureAndBufferTextures?.second
@@ -253,6 +240,7 @@ internal class VideoFrameDecoder(
                                 } else { // Waiting for packet reader
                                     // tMediaPlayerLog.d(TAG) { "Waiting packet queue readable buffer." }
                                     this@VideoFrameDecoder.state.set(DecoderState.WaitingReadablePacketBuffer)
+                                    player.packetQueueUnderrun(isVideo = true)
                                 }
                             }
                         }
@@ -263,8 +251,6 @@ internal class VideoFrameDecoder(
     }
 
     init {
-        videoDecoderThread
-        while (!isLooperPrepared.get()) {}
         videoDecoderHandler
         videoPacketQueue.addListener(packetQueueListener)
         videoFrameQueue.addListener(frameQueueListener)
@@ -312,8 +298,8 @@ internal class VideoFrameDecoder(
             val oldState = getState()
             if (oldState != DecoderState.NotInit && oldState != DecoderState.Released) {
                 state.set(DecoderState.Released)
-                videoDecoderThread.quit()
-                videoDecoderThread.quitSafely()
+                videoDecoderHandler.detach()
+                SharedLoopers.release(sharedLooper)
                 videoPacketQueue.removeListener(packetQueueListener)
                 videoFrameQueue.removeListener(frameQueueListener)
                 player.getGLRenderer().removeGLContextListener(glContextListener)
@@ -0,0 +1,134 @@
+package com.tans.tmediaplayer.player.looper
+
+import android.os.Handler
+import android.os.HandlerThread
+import android.os.Looper
+import android.os.Message
+import android.os.Process
+import android.os.SystemClock
+import com.tans.tmediaplayer.tMediaPlayerLog
+import com.tans.tmediaplayer.player.model.LooperPriority
+import com.tans.tmediaplayer.player.model.SharedLooperStats
+import java.util.concurrent.atomic.AtomicLong
+
+internal class SharedLooper(val priority: LooperPriority, val threadName: String) {
+
+    // Guarded by SharedLoopers.
+    var thread: HandlerThread? = null
+    var attachedStages: Int = 0
+
+    val handledTasks: AtomicLong = AtomicLong(0L)
+    val busyTimeInNanos: AtomicLong = AtomicLong(0L)
+
+    val looper: Looper
+        get() = thread!!.looper
+}
+
+/**
+ * Handler of a pipeline stage on a [SharedLooper], messages are dropped after [detach].
+ * Stages must not block the looper (e.g. Thread.sleep), other players' stages are waiting, use delayed messages instead.
+ */
+internal open class SharedLooperHandler(private val sharedLooper: SharedLooper) : Handler(sharedLooper.looper) {
+
+    @Volatile
+    private var isDetached: Boolean = false
+
+    override fun dispatchMessage(msg: Message) {
+        if (isDetached) {
+            return
+        }
+        val start = SystemClock.elapsedRealtimeNanos()
+        super.dispatchMessage(msg)
+        sharedLooper.handledTasks.incrementAndGet()
+        sharedLooper.busyTimeInNanos.addAndGet(SystemClock.elapsedRealtimeNanos() - start)
+    }
+
+    /**
+     * Stage released, remove pending messages, the shared looper keeps running for other stages.
+     */
+    fun detach() {
+        isDetached = true
+        removeCallbacksAndMessages(null)
+    }
+}
+
+/**
+ * Process-wide looper threads shared by all players' decoders and renderers, instead of a thread per stage per player.
+ * Stages are woken by queue state changes (queue listeners send messages), each message handles a frame and yields the thread.
+ * Packet readers keep own threads, demuxer reading blocks on io.
+ */
+internal object SharedLoopers {
+
+    private const val TAG = "SharedLoopers"
+
+    private val loopers: Map<LooperPriority, Array<SharedLooper>> by lazy {
+        LooperPriority.entries.associateWith { priority ->
+            Array(threadCount(priority)) { i -> SharedLooper(priority, "tMP_${priority.name}_$i") }
+        }
+    }
+
+    private fun threadCount(priority: LooperPriority): Int {
+        // Stages attach to the least loaded thread, so a slow stream (software video decoding, audio resampling,
+        // time stretching and loudness) only delays stages sharing its thread, and one player's audio decoder and
+        // audio renderer run on different threads.
+        val perCore = (Runtime.getRuntime().availableProcessors() / 2).coerceIn(1, 4)
+        return when (priority) {
+            LooperPriority.Audio -> perCore.coerceAtLeast(2)
+            LooperPriority.Video -> perCore
+            LooperPriority.Subtitle -> 1
+        }
+    }
+
+    private fun threadPriority(priority: LooperPriority): Int {
+        return when (priority) {
+            LooperPriority.Audio -> Process.THREAD_PRIORITY_AUDIO
+            LooperPriority.Video -> Process.THREAD_PRIORITY_DISPLAY
+            LooperPriority.Subtitle -> Process.THREAD_PRIORITY_DEFAULT
+        }
+    }
+
+    /**
+     * Attach a stage to the least loaded thread of [priority], thread is started if needed.
+     */
+    @Synchronized
+    fun acquire(priority: LooperPriority): SharedLooper {
+        val sharedLooper = loopers[priority]!!.minBy { it.attachedStages }
+        if (sharedLooper.thread == null) {
+            sharedLooper.thread = HandlerThread(sharedLooper.threadName, threadPriority(priority)).apply { start() }
+            sharedLooper.handledTasks.set(0L)
+            sharedLooper.busyTimeInNanos.set(0L)
+            tMediaPlayerLog.d(TAG) { "Start shared looper: ${sharedLooper.threadName}" }
+        }
+        sharedLooper.attachedStages ++
+        return sharedLooper
+    }
+
+    /**
+     * Detach a stage, thread quits when no stage attached.
+     */
+    @Synchronized
+    fun release(sharedLooper: SharedLooper) {
+        sharedLooper.attachedStages --
+        if (sharedLooper.attachedStages <= 0) {
+            sharedLooper.attachedStages = 0
+            sharedLooper.thread?.quitSafely()
+            sharedLooper.thread = null
+            tMediaPlayerLog.d(TAG) { "Quit shared looper: ${sharedLooper.threadName}" }
+        }
+    }
+
+    @Synchronized
+    fun getStats(): List<SharedLooperStats> {
+        return loopers.values.flatMap { it.asIterable() }
+            .filter { it.thread != null }
+            .map {
+                SharedLooperStats(
+                    priority = it.priority,
+                    threadName = it.threadName,
+                    attachedStages = it.attachedStages,
+                    handledTasks = it.handledTasks.get(),
+                    busyTimeInMillis = it.busyTimeInNanos.get() / 1_000_000L
+                )
+            }
+    }
+}
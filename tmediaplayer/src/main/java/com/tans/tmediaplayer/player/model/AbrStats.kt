@@ -0,0 +1,43 @@
+package com.tans.tmediaplayer.player.model
+
+data class AbrVariant(
+    /**
+     * Declared bitrate of variant in bits per second.
+     */
+    val bitrate: Long,
+    val width: Int,
+    val height: Int
+)
+
+data class AbrStats(
+    /**
+     * Sorted by bitrate.
+     */
+    val variants: List<AbrVariant>,
+    val currentVariant: Int,
+    /**
+     * Estimated network bandwidth in bits per second by segments download time, 0 if unknown.
+     */
+    val bandwidth: Long,
+    val switchCount: Long
+) {
+
+    companion object {
+        internal fun fromNativeValues(values: LongArray): AbrStats {
+            val count = values[0].toInt().coerceIn(0, ABR_MAX_VARIANTS)
+            val variants = List(count) { i ->
+                AbrVariant(
+                    bitrate = values[4 + i * 3],
+                    width = values[4 + i * 3 + 1].toInt(),
+                    height = values[4 + i * 3 + 2].toInt()
+                )
+            }
+            return AbrStats(
+                variants = variants,
+                currentVariant = values[1].toInt(),
+                bandwidth = values[2],
+                switchCount = values[3]
+            )
+        }
+    }
+}
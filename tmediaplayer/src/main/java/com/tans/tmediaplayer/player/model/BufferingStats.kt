@@ -0,0 +1,61 @@
+package com.tans.tmediaplayer.player.model
+
+enum class BufferingSourceType {
+    Local,
+    Network,
+    RealTime
+}
+
+data class BufferingStats(
+    val sourceType: BufferingSourceType,
+    /**
+     * Media bitrate in bits per second, estimated by packet queues, 0 if unknown.
+     */
+    val bitrate: Long,
+    /**
+     * Network download bytes per second, 0 if unknown.
+     */
+    val throughput: Long,
+    /**
+     * Buffered millis to start playing or finish rebuffering.
+     */
+    val minBufferDuration: Long,
+    /**
+     * Packet reading stops when all streams buffered this millis, -1 is unlimited.
+     */
+    val maxBufferDuration: Long,
+    /**
+     * Packet reading stops when buffered bytes reach this, -1 is unlimited.
+     */
+    val maxBufferBytes: Long,
+    /**
+     * Min buffered millis of audio and video packet queues.
+     */
+    val bufferedDuration: Long,
+    val bufferedBytes: Long,
+    val isRebuffering: Boolean,
+    val rebufferCount: Long,
+    /**
+     * Total rebuffering millis.
+     */
+    val rebufferDuration: Long
+) {
+
+    companion object {
+        internal fun fromNativeValues(values: LongArray): BufferingStats {
+            return BufferingStats(
+                sourceType = BufferingSourceType.entries.getOrElse(values[0].toInt()) { BufferingSourceType.Local },
+                bitrate = values[1],
+                throughput = values[2],
+                minBufferDuration = values[3],
+                maxBufferDuration = values[4],
+                maxBufferBytes = values[5],
+                bufferedDuration = values[6],
+                bufferedBytes = values[7],
+                isRebuffering = values[8] != 0L,
+                rebufferCount = values[9],
+                rebufferDuration = values[10]
+            )
+        }
+    }
+}
@@ -17,6 +17,82 @@ internal const val AUDIO_FRAME_QUEUE_SIZE = 10
 
 internal const val AUDIO_TRACK_QUEUE_SIZE = 11
 
+const val MIN_PLAY_SPEED = 0.5f
+
+const val MAX_PLAY_SPEED = 3.0f
+
 internal const val SUBTITLE_MAX_PKT_SIZE = 8
 
-internal const val SUBTITLE_MAX_FRAME_SIZE = 8
\ No newline at end of file
+internal const val SUBTITLE_MAX_FRAME_SIZE = 8
+
+internal const val STATS_HISTOGRAM_BUCKET_COUNT = 20
+
+// sampleCount, sampleSum, maxValue and buckets.
+internal const val STATS_HISTOGRAM_EXPORT_SIZE = 3 + STATS_HISTOGRAM_BUCKET_COUNT
+
+// Player stats histogram types, same order as native tMediaStatsHistogramType.
+internal const val STATS_SYNC_ERROR = 0
+internal const val STATS_SEEK_LATENCY = 1
+internal const val STATS_DEMUX_READ_TIME = 2
+internal const val STATS_PACKET_QUEUE_BYTES = 3
+internal const val STATS_PACKET_QUEUE_DURATION = 4
+internal const val STATS_VIDEO_DECODE_TIME = 5
+internal const val STATS_AUDIO_DECODE_TIME = 6
+internal const val STATS_VIDEO_CONVERT_TIME = 7
+internal const val STATS_AUDIO_CONVERT_TIME = 8
+internal const val STATS_ACCURATE_SEEK_DROPPED_FRAMES = 9
+internal const val STATS_ACCURATE_SEEK_DECODE_TIME = 10
+internal const val STATS_ACCURATE_SEEK_FIRST_FRAME_TIME = 11
+internal const val STATS_HISTOGRAM_TYPE_COUNT = 12
+
+// Player stats counter types, same order as native tMediaStatsCounterType.
+internal const val STATS_DROP_DECODE_LATE = 0
+internal const val STATS_DROP_ACCURATE_SEEK = 1
+internal const val STATS_DROP_RENDER_LATE = 2
+internal const val STATS_DROP_RENDER_FAIL = 3
+internal const val STATS_DROP_SERIAL_CHANGED = 4
+internal const val STATS_AUDIO_UNDERRUN = 5
+internal const val STATS_VIDEO_BUFFER_ALLOC = 6
+internal const val STATS_AUDIO_BUFFER_ALLOC = 7
+internal const val STATS_COUNTER_TYPE_COUNT = 8
+
+// Counters, then histograms.
+internal const val PLAYER_STATS_EXPORT_SIZE = STATS_COUNTER_TYPE_COUNT + STATS_HISTOGRAM_TYPE_COUNT * STATS_HISTOGRAM_EXPORT_SIZE
+
+internal const val BUFFERING_STATS_EXPORT_SIZE = 12
+
+internal const val LATE_FRAME_STATS_EXPORT_SIZE = 4
+
+internal const val DECODE_STATS_EXPORT_SIZE = 7
+
+// Bytes of packet, video buffer, audio buffer and subtitle buffer of player, then of process, then process budget.
+internal const val MEMORY_STATS_EXPORT_SIZE = 4 * 2 + 1
+
+// streamIndex, sizeInBytes, duration and pts.
+internal const val PACKET_INFO_EXPORT_SIZE = 4
+
+// pts, duration, type, width, height, displayRotation, displayRatio bits and content size of rgba, y, u, v, uv.
+internal const val VIDEO_FRAME_INFO_EXPORT_SIZE = 12
+
+// pts, duration and content size.
+internal const val AUDIO_FRAME_INFO_EXPORT_SIZE = 3
+
+internal const val BUFFERING_UPDATE_FULL = 1
+
+internal const val BUFFERING_UPDATE_REBUFFER_END = 2
+
+// Live low latency.
+internal const val LIVE_DEFAULT_TARGET_LATENCY = 300L
+
+internal const val LIVE_CATCH_UP_HYSTERESIS = 200L
+
+internal const val LIVE_CATCH_UP_SPEED = 1.1
+
+internal const val LIVE_LATE_THRESHOLD = 100L
+
+internal const val LIVE_LATENCY_CHECK_INTERVAL = 200L
+
+// Abr, same as native.
+internal const val ABR_MAX_VARIANTS = 16
+
+internal const val ABR_STATS_EXPORT_SIZE = 4 + ABR_MAX_VARIANTS * 3
@@ -0,0 +1,50 @@
+package com.tans.tmediaplayer.player.model
+
+data class DecodeStats(
+    /**
+     * Video decode calls from decoder thread.
+     */
+    val videoDecodeCalls: Long,
+    /**
+     * Video frames received from decoder.
+     */
+    val videoFrames: Long,
+    val audioDecodeCalls: Long,
+    val audioFrames: Long,
+    /**
+     * Pcm bytes written to audio buffers, audio track plays audio buffers in place.
+     */
+    val audioPcmOutputBytes: Long,
+    /**
+     * Pcm bytes copied again after written, only time stretched audio is copied.
+     */
+    val audioPcmCopiedBytes: Long,
+    /**
+     * Duration of audio pcm stats since audio decoder prepared.
+     */
+    val audioPcmStatsDurationInMillis: Long
+) {
+
+    val videoFramesPerCall: Double
+        get() = if (videoDecodeCalls > 0) videoFrames.toDouble() / videoDecodeCalls.toDouble() else 0.0
+
+    val audioFramesPerCall: Double
+        get() = if (audioDecodeCalls > 0) audioFrames.toDouble() / audioDecodeCalls.toDouble() else 0.0
+
+    val audioPcmCopiedBytesPerSecond: Long
+        get() = if (audioPcmStatsDurationInMillis > 0) audioPcmCopiedBytes * 1000L / audioPcmStatsDurationInMillis else 0L
+
+    companion object {
+        internal fun fromNativeValues(values: LongArray): DecodeStats {
+            return DecodeStats(
+                videoDecodeCalls = values[0],
+                videoFrames = values[1],
+                audioDecodeCalls = values[2],
+                audioFrames = values[3],
+                audioPcmOutputBytes = values[4],
+                audioPcmCopiedBytes = values[5],
+                audioPcmStatsDurationInMillis = values[6]
+            )
+        }
+    }
+}
@@ -0,0 +1,54 @@
+package com.tans.tmediaplayer.player.model
+
+/**
+ * Log2 histogram: bucket 0 holds value 0, bucket n holds [2^(n-1), 2^n), last bucket holds all bigger values.
+ */
+data class Histogram(
+    val sampleCount: Long,
+    val sampleSum: Long,
+    val maxValue: Long,
+    val buckets: List<Long>
+) {
+
+    val mean: Double
+        get() = if (sampleCount > 0) sampleSum.toDouble() / sampleCount.toDouble() else 0.0
+
+    /**
+     * Upper bound (exclusive) of bucket, last bucket return [Long.MAX_VALUE].
+     */
+    fun bucketUpperBound(index: Int): Long {
+        return if (index >= buckets.size - 1) {
+            Long.MAX_VALUE
+        } else {
+            1L shl index
+        }
+    }
+
+    /**
+     * Approximate percentile, return the upper bound of the bucket which contains the percentile.
+     */
+    fun percentile(p: Double): Long {
+        if (sampleCount <= 0) return 0L
+        val target = (sampleCount.toDouble() * p.coerceIn(0.0, 1.0)).toLong().coerceAtLeast(1L)
+        var count = 0L
+        for ((index, bucketCount) in buckets.withIndex()) {
+            count += bucketCount
+            if (count >= target) {
+                return bucketUpperBound(index).coerceAtMost(maxValue)
+            }
+        }
+        return maxValue
+    }
+
+    companion object {
+
+        internal fun fromNativeValues(values: LongArray): Histogram {
+            return Histogram(
+                sampleCount = values[0],
+                sampleSum = values[1],
+                maxValue = values[2],
+                buckets = values.drop(3)
+            )
+        }
+    }
+}
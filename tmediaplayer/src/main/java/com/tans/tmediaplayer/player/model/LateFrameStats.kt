@@ -0,0 +1,46 @@
+package com.tans.tmediaplayer.player.model
+
+enum class LateFrameStage {
+    /**
+     * Only late decoded frames are dropped before converting.
+     */
+    None,
+
+    /**
+     * Decoder skips non reference frames.
+     */
+    SkipNonRef,
+
+    /**
+     * Decoder skips bidirectional frames.
+     */
+    SkipBidir
+}
+
+data class LateFrameStats(
+    val stage: LateFrameStage,
+    /**
+     * Decoded frames dropped before converting to video buffer.
+     */
+    val droppedBeforeConvert: Long,
+    /**
+     * Frames skipped by decoder at [LateFrameStage.SkipNonRef] stage, estimated.
+     */
+    val skippedNonRef: Long,
+    /**
+     * Frames skipped by decoder at [LateFrameStage.SkipBidir] stage, estimated.
+     */
+    val skippedBidir: Long
+) {
+
+    companion object {
+        internal fun fromNativeValues(values: LongArray): LateFrameStats {
+            return LateFrameStats(
+                stage = LateFrameStage.entries.getOrElse(values[0].toInt()) { LateFrameStage.None },
+                droppedBeforeConvert = values[1],
+                skippedNonRef = values[2],
+                skippedBidir = values[3]
+            )
+        }
+    }
+}
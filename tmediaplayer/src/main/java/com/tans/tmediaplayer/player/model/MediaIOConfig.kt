@@ -0,0 +1,37 @@
+package com.tans.tmediaplayer.player.model
+
+data class MediaIOConfig(
+    /**
+     * Local file buffered read size in bytes, used when mmap is disabled or failed.
+     */
+    val localBufferSize: Int = 1024 * 1024,
+    /**
+     * mmap local file, read data from page cache without read syscalls.
+     */
+    val enableLocalMmap: Boolean = true,
+    /**
+     * Http / https streams are read ahead of demuxer by an io thread, 0 disables read ahead.
+     */
+    val readAheadBufferSize: Long = 16L * 1024L * 1024L,
+    /**
+     * IO thread restarts reading when buffered bytes below low watermark.
+     */
+    val readAheadLowWatermark: Long = 4L * 1024L * 1024L,
+    /**
+     * IO thread stops reading when buffered bytes reach high watermark, the rest of buffer keeps read data for backward seeking.
+     */
+    val readAheadHighWatermark: Long = 12L * 1024L * 1024L,
+    /**
+     * Disk cache directory for progressive http / https medias, null disables cache.
+     * Fetched byte ranges are kept in cache, seeking back or replaying only downloads missing ranges.
+     */
+    val cacheDir: String? = null,
+    /**
+     * Total size of all medias cache, least recently used medias are evicted.
+     */
+    val maxCacheSize: Long = 512L * 1024L * 1024L,
+    /**
+     * Hls / dash medias with multiple variants switch variant by estimated network bandwidth.
+     */
+    val enableAbr: Boolean = true
+)
@@ -11,5 +11,10 @@ data class MediaInfo(
     val startTime: Long,
     val audioStreamInfo: AudioStreamInfo?,
     val videoStreamInfo: VideoStreamInfo?,
-    val subtitleStreams: List<SubtitleStreamInfo>
+    val subtitleStreams: List<SubtitleStreamInfo>,
+    /**
+     * All audio / video tracks, [audioStreamInfo] and [videoStreamInfo] describe the initial selected tracks.
+     */
+    val audioTracks: List<MediaTrackInfo>,
+    val videoTracks: List<MediaTrackInfo>
 )
@@ -0,0 +1,9 @@
+package com.tans.tmediaplayer.player.model
+
+/**
+ * Audio or video track of media, selected by [com.tans.tmediaplayer.player.IPlayer.selectAudioTrack] / [com.tans.tmediaplayer.player.IPlayer.selectVideoTrack].
+ */
+data class MediaTrackInfo(
+    val streamId: Int,
+    val metadata: Map<String, String>
+)
@@ -0,0 +1,54 @@
+package com.tans.tmediaplayer.player.model
+
+data class MemoryStats(
+    /**
+     * Bytes of this player's packets in packet queues.
+     */
+    val packetBytes: Long,
+    /**
+     * Bytes of this player's native video frame buffers.
+     */
+    val videoBufferBytes: Long,
+    /**
+     * Bytes of this player's native audio pcm buffers.
+     */
+    val audioBufferBytes: Long,
+    /**
+     * Bytes of this player's native subtitle rgba buffers.
+     */
+    val subtitleBufferBytes: Long,
+    /**
+     * Same as above, sum of all players in process.
+     */
+    val processPacketBytes: Long,
+    val processVideoBufferBytes: Long,
+    val processAudioBufferBytes: Long,
+    val processSubtitleBufferBytes: Long,
+    /**
+     * Process memory budget, 0 is unlimited, see [com.tans.tmediaplayer.player.tMediaPlayer.setMemoryBudget].
+     */
+    val processBudget: Long
+) {
+
+    val totalBytes: Long
+        get() = packetBytes + videoBufferBytes + audioBufferBytes + subtitleBufferBytes
+
+    val processTotalBytes: Long
+        get() = processPacketBytes + processVideoBufferBytes + processAudioBufferBytes + processSubtitleBufferBytes
+
+    companion object {
+        internal fun fromNativeValues(values: LongArray): MemoryStats {
+            return MemoryStats(
+                packetBytes = values[0],
+                videoBufferBytes = values[1],
+                audioBufferBytes = values[2],
+                subtitleBufferBytes = values[3],
+                processPacketBytes = values[4],
+                processVideoBufferBytes = values[5],
+                processAudioBufferBytes = values[6],
+                processSubtitleBufferBytes = values[7],
+                processBudget = values[8]
+            )
+        }
+    }
+}
@@ -0,0 +1,103 @@
+package com.tans.tmediaplayer.player.model
+
+data class PlayerStats(
+    /**
+     * |video frame pts - master clock| in millis, recorded when video frame rendered.
+     */
+    val syncError: Histogram,
+    /**
+     * Millis from seek request to first video frame displayed.
+     */
+    val seekLatency: Histogram,
+    /**
+     * Micros of reading a packet from demuxer.
+     */
+    val demuxReadTime: Histogram,
+    /**
+     * Packet queues bytes in KB, recorded before reading packet.
+     */
+    val packetQueueBytes: Histogram,
+    /**
+     * Packet queues buffered duration in millis, recorded before reading packet.
+     */
+    val packetQueueDuration: Histogram,
+    /**
+     * Micros of decoding a frame.
+     */
+    val videoDecodeTime: Histogram,
+    val audioDecodeTime: Histogram,
+    /**
+     * Micros of moving a decoded frame to player's buffer, include scaling and resampling.
+     */
+    val videoConvertTime: Histogram,
+    val audioConvertTime: Histogram,
+    /**
+     * Accurate seek breakdown, recorded by video and audio decoders when their first frame at seek target decoded:
+     * frames decoded and dropped before target, micros of decoding them and micros from seek request to the first frame at target.
+     */
+    val accurateSeekDroppedFramesPerSeek: Histogram,
+    val accurateSeekDecodeTime: Histogram,
+    val accurateSeekFirstFrameTime: Histogram,
+    /**
+     * Frames dropped by decoder because video is late (live low latency and late frame dropping).
+     */
+    val decodeLateDroppedFrames: Long,
+    /**
+     * Frames before accurate seeking target.
+     */
+    val accurateSeekDroppedFrames: Long,
+    /**
+     * Frames dropped by video renderer because they are out of date.
+     */
+    val renderLateDroppedFrames: Long,
+    /**
+     * Frames gl renderer can't render: bad frame, surface not ready or replaced by newer frame.
+     */
+    val renderFailDroppedFrames: Long,
+    /**
+     * Frames of old serial skipped by renderers after seeking or switching media.
+     */
+    val serialChangedDroppedFrames: Long,
+    /**
+     * Times of audio renderer has no frame to render while playing.
+     */
+    val audioUnderruns: Long,
+    /**
+     * Native video / audio buffers allocated or grown.
+     */
+    val videoBufferAllocations: Long,
+    val audioBufferAllocations: Long
+) {
+
+    companion object {
+
+        internal fun fromNativeValues(values: LongArray): PlayerStats {
+            fun histogram(type: Int): Histogram {
+                val start = STATS_COUNTER_TYPE_COUNT + type * STATS_HISTOGRAM_EXPORT_SIZE
+                return Histogram.fromNativeValues(values.copyOfRange(start, start + STATS_HISTOGRAM_EXPORT_SIZE))
+            }
+            return PlayerStats(
+                syncError = histogram(STATS_SYNC_ERROR),
+                seekLatency = histogram(STATS_SEEK_LATENCY),
+                demuxReadTime = histogram(STATS_DEMUX_READ_TIME),
+                packetQueueBytes = histogram(STATS_PACKET_QUEUE_BYTES),
+                packetQueueDuration = histogram(STATS_PACKET_QUEUE_DURATION),
+                videoDecodeTime = histogram(STATS_VIDEO_DECODE_TIME),
+                audioDecodeTime = histogram(STATS_AUDIO_DECODE_TIME),
+                videoConvertTime = histogram(STATS_VIDEO_CONVERT_TIME),
+                audioConvertTime = histogram(STATS_AUDIO_CONVERT_TIME),
+                accurateSeekDroppedFramesPerSeek = histogram(STATS_ACCURATE_SEEK_DROPPED_FRAMES),
+                accurateSeekDecodeTime = histogram(STATS_ACCURATE_SEEK_DECODE_TIME),
+                accurateSeekFirstFrameTime = histogram(STATS_ACCURATE_SEEK_FIRST_FRAME_TIME),
+                decodeLateDroppedFrames = values[STATS_DROP_DECODE_LATE],
+                accurateSeekDroppedFrames = values[STATS_DROP_ACCURATE_SEEK],
+                renderLateDroppedFrames = values[STATS_DROP_RENDER_LATE],
+                renderFailDroppedFrames = values[STATS_DROP_RENDER_FAIL],
+                serialChangedDroppedFrames = values[STATS_DROP_SERIAL_CHANGED],
+                audioUnderruns = values[STATS_AUDIO_UNDERRUN],
+                videoBufferAllocations = values[STATS_VIDEO_BUFFER_ALLOC],
+                audioBufferAllocations = values[STATS_AUDIO_BUFFER_ALLOC]
+            )
+        }
+    }
+}
@@ -0,0 +1,35 @@
+package com.tans.tmediaplayer.player.model
+
+/**
+ * Pipeline stages of all players share looper threads by priority, higher priority threads get more cpu time.
+ */
+enum class LooperPriority {
+    /**
+     * Audio decoders and renderers.
+     */
+    Audio,
+
+    /**
+     * Video decoders and renderers.
+     */
+    Video,
+
+    /**
+     * Subtitle decoders and renderers.
+     */
+    Subtitle
+}
+
+data class SharedLooperStats(
+    val priority: LooperPriority,
+    val threadName: String,
+    /**
+     * Pipeline stages (decoders, renderers) running on this thread.
+     */
+    val attachedStages: Int,
+    /**
+     * Messages handled by attached stages since thread started.
+     */
+    val handledTasks: Long,
+    val busyTimeInMillis: Long
+)
@@ -5,6 +5,7 @@ import android.os.HandlerThread
 import android.os.Message
 import android.os.SystemClock
 import com.tans.tmediaplayer.tMediaPlayerLog
+import com.tans.tmediaplayer.player.model.MediaInfo
 import com.tans.tmediaplayer.player.model.ReadPacketResult
 import com.tans.tmediaplayer.player.model.OptResult
 import com.tans.tmediaplayer.player.rwqueue.PacketQueue
@@ -57,18 +58,8 @@ internal class PacketReader(
                     if (nativePlayer != null && state in activeStates) {
                         when (msg.what) {
                             HandlerMsg.RequestReadPkt.ordinal -> {
-                                val audioSizeInBytes = audioPacketQueue.getSizeInBytes()
-                                val videoSizeInBytes = videoPacketQueue.getSizeInBytes()
-                                val audioDuration = audioPacketQueue.getDuration()
-                                val videoDuration = videoPacketQueue.getDuration()
-
-                                val audioQueueIsFull = mediaInfo.audioStreamInfo == null || audioDuration > MAX_QUEUE_DURATION
-                                val videoQueueIsFull = mediaInfo.videoStreamInfo == null || mediaInfo.videoStreamInfo.isAttachment || videoDuration > MAX_QUEUE_DURATION
-                                if (!mediaInfo.isRealTime && (videoSizeInBytes + audioSizeInBytes > MAX_QUEUE_SIZE_IN_BYTES || (audioQueueIsFull && videoQueueIsFull))) {
+                                if (updateBuffering(nativePlayer, mediaInfo, eof = false)) {
                                     // queue full, waiting for decoder.
-//                                    tMediaPlayerLog.d(TAG) {
-//                                        "Packet queue full, audioSize=${String.format(Locale.US, "%.2f", audioSizeInBytes.toFloat() / 1024.0f)}KB, videoSize=${String.format(Locale.US, "%.2f", videoSizeInBytes.toFloat() / 1024.0f)}KB, audioDuration=$audioDuration, videoDuration=$videoDuration"
-//                                    }
                                     this@PacketReader.state.set(ReaderState.WaitingWritableBuffer)
                                 } else {
                                     if (state == ReaderState.WaitingWritableBuffer) {
@@ -122,6 +113,7 @@ internal class PacketReader(
                                             }
                                             tMediaPlayerLog.d(TAG) { "Read pkt eof." }
                                             this@PacketReader.state.set(ReaderState.Eof)
+                                            updateBuffering(nativePlayer, mediaInfo, eof = true)
                                         }
                                         ReadPacketResult.ReadFail -> {
                                             tMediaPlayerLog.e(TAG) { "Read pkt fail." }
@@ -156,6 +148,27 @@ internal class PacketReader(
                                     requestReadPkt()
                                 }
                             }
+
+                            HandlerMsg.RequestSelectTrack.ordinal -> {
+                                val streamId = msg.arg1
+                                val isVideo = msg.arg2 == 1
+                                val position = player.getProgress()
+                                val result = player.selectTrackInternal(nativePlayer, streamId, position)
+                                if (result == OptResult.Success) {
+                                    // Packets of old track are dropped, demuxer reads new track from current position.
+                                    if (isVideo) {
+                                        videoPacketQueue.flushReadableBuffer()
+                                    } else {
+                                        audioPacketQueue.flushReadableBuffer()
+                                    }
+                                    this@PacketReader.state.compareAndSet(ReaderState.Eof, ReaderState.Ready)
+                                    tMediaPlayerLog.d(TAG) { "Select track $streamId at $position success." }
+                                } else {
+                                    tMediaPlayerLog.e(TAG) { "Select track $streamId fail." }
+                                }
+                                player.selectTrackResult(isVideo, position, result)
+                                requestReadPkt()
+                            }
                         }
                     }
                 }
@@ -163,6 +176,17 @@ internal class PacketReader(
         }
     }
 
+    /**
+     * Update buffering controller with packet queues.
+     * @return true if packet queues are full.
+     */
+    private fun updateBuffering(nativePlayer: Long, mediaInfo: MediaInfo, eof: Boolean): Boolean {
+        val audioDuration = if (mediaInfo.audioStreamInfo == null) -1L else audioPacketQueue.getDuration()
+        val videoDuration = if (mediaInfo.videoStreamInfo == null || mediaInfo.videoStreamInfo.isAttachment) -1L else videoPacketQueue.getDuration()
+        val bytes = audioPacketQueue.getSizeInBytes() + videoPacketQueue.getSizeInBytes()
+        return player.updateBufferingInternal(nativePlayer, audioDuration, videoDuration, bytes, eof)
+    }
+
     init {
         pktReaderThread
         while (!isLooperPrepared.get()) {}
@@ -196,6 +220,19 @@ internal class PacketReader(
         }
     }
 
+    fun requestSelectTrack(streamId: Int, isVideo: Boolean) {
+        val state = getState()
+        if (state in activeStates) {
+            val msg = pktReaderHandler.obtainMessage()
+            msg.what = HandlerMsg.RequestSelectTrack.ordinal
+            msg.arg1 = streamId
+            msg.arg2 = if (isVideo) 1 else 0
+            pktReaderHandler.sendMessage(msg)
+        } else {
+            tMediaPlayerLog.e(TAG) { "Request select track fail, wrong state: $state" }
+        }
+    }
+
     fun requestAttachment() {
         requestAttachment.set(true)
     }
@@ -209,6 +246,13 @@ internal class PacketReader(
         }
     }
 
+    /**
+     * Media changed without prepare, e.g. switch to next media, start reading again.
+     */
+    fun resetEof() {
+        state.compareAndSet(ReaderState.Eof, ReaderState.Ready)
+    }
+
     fun getState(): ReaderState = state.get()
 
     fun release() {
@@ -231,15 +275,10 @@ internal class PacketReader(
 
         private enum class HandlerMsg {
             RequestReadPkt,
-            RequestSeek
+            RequestSeek,
+            RequestSelectTrack
         }
 
         private const val TAG = "PacketReader"
-
-        // 15 mb
-        private const val MAX_QUEUE_SIZE_IN_BYTES = 15L * 1024L * 1024L
-
-        // 1s
-        private const val MAX_QUEUE_DURATION = 1000L
     }
 }
\ No newline at end of file
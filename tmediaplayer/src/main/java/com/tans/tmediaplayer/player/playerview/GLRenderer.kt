@@ -37,11 +37,13 @@ internal class GLRenderer {
                 tMediaPlayerLog.d(TAG) { "Android surface created: ${surface.isValid}, ${width}x$height" }
                 glThread.requestAttachSurface(surface)
                 glThread.requestSizeChange(width, height)
+                dispatchSurfaceSizeChanged(width, height)
             }
 
             override fun onSurfaceSizeChanged(width: Int, height: Int) {
                 tMediaPlayerLog.d(TAG) { "Android surface size changed: ${width}x$height" }
                 glThread.requestSizeChange(width, height)
+                dispatchSurfaceSizeChanged(width, height)
             }
 
             override fun onSurfaceDestroyed() {
@@ -73,6 +75,10 @@ internal class GLRenderer {
         LinkedBlockingDeque()
     }
 
+    private val surfaceSizeListeners: LinkedBlockingDeque<SurfaceSizeListener> by lazy {
+        LinkedBlockingDeque()
+    }
+
     // region Opt
     fun setScaleType(scaleType: ScaleType) {
         this.realRenderer.scaleType.set(scaleType)
@@ -288,6 +294,24 @@ internal class GLRenderer {
         subtitleOutOfDateListeners.remove(l)
     }
 
+    fun addSurfaceSizeListener(l: SurfaceSizeListener) {
+        if (!isReleased) {
+            if (!surfaceSizeListeners.contains(l)) {
+                surfaceSizeListeners.add(l)
+            }
+        }
+    }
+
+    fun removeSurfaceSizeListener(l: SurfaceSizeListener) {
+        surfaceSizeListeners.remove(l)
+    }
+
+    private fun dispatchSurfaceSizeChanged(width: Int, height: Int) {
+        for (l in surfaceSizeListeners) {
+            l.onSurfaceSizeChanged(width, height)
+        }
+    }
+
     private fun dispatchFrameRenderState(frame: VideoFrame, isRendered: Boolean) {
         for (l in renderListeners) {
             l.onFrameRenderStateUpdate(frame, isRendered)
@@ -1538,6 +1562,11 @@ internal class GLRenderer {
             fun onFrameOutOfDate(subtitleFrame: SubtitleFrame)
         }
 
+        interface SurfaceSizeListener {
+
+            fun onSurfaceSizeChanged(width: Int, height: Int)
+        }
+
         private const val TAG = "GLRenderer"
     }
 }
\ No newline at end of file
@@ -1,22 +1,26 @@
 package com.tans.tmediaplayer.player.renderer
 
-import android.os.Handler
-import android.os.HandlerThread
 import android.os.Message
+import android.os.SystemClock
 import com.tans.tmediaplayer.tMediaPlayerLog
 import com.tans.tmediaplayer.audiotrack.tMediaAudioTrack
+import com.tans.tmediaplayer.player.looper.SharedLooper
+import com.tans.tmediaplayer.player.looper.SharedLooperHandler
+import com.tans.tmediaplayer.player.looper.SharedLoopers
 import com.tans.tmediaplayer.player.model.AUDIO_TRACK_QUEUE_SIZE
 import com.tans.tmediaplayer.player.model.AudioChannel
 import com.tans.tmediaplayer.player.model.AudioSampleBitDepth
 import com.tans.tmediaplayer.player.model.AudioSampleRate
+import com.tans.tmediaplayer.player.model.LooperPriority
 import com.tans.tmediaplayer.player.model.OptResult
+import com.tans.tmediaplayer.player.model.STATS_AUDIO_UNDERRUN
+import com.tans.tmediaplayer.player.model.STATS_DROP_SERIAL_CHANGED
 import com.tans.tmediaplayer.player.rwqueue.AudioFrame
 import com.tans.tmediaplayer.player.rwqueue.AudioFrameQueue
 import com.tans.tmediaplayer.player.rwqueue.PacketQueue
 import com.tans.tmediaplayer.player.rwqueue.ReadWriteQueueListener
 import com.tans.tmediaplayer.player.tMediaPlayer
 import java.util.concurrent.LinkedBlockingDeque
-import java.util.concurrent.atomic.AtomicBoolean
 import java.util.concurrent.atomic.AtomicReference
 import kotlin.math.max
 
@@ -42,18 +46,8 @@ internal class AudioRenderer(
 
     private val state: AtomicReference<RendererState> = AtomicReference(RendererState.NotInit)
 
-    // Is read thread ready?
-    private val isLooperPrepared: AtomicBoolean by lazy { AtomicBoolean(false) }
-
-    // Audio renderer thread.
-    private val audioRendererThread: HandlerThread by lazy {
-        object : HandlerThread("tMP_AudioRenderer", MAX_PRIORITY) {
-            override fun onLooperPrepared() {
-                super.onLooperPrepared()
-                isLooperPrepared.set(true)
-            }
-        }.apply { start() }
-    }
+    // Audio renderer thread, shared with other players' audio stages.
+    private val sharedLooper: SharedLooper = SharedLoopers.acquire(LooperPriority.Audio)
 
     private val frameQueueListener: ReadWriteQueueListener = object : ReadWriteQueueListener {
         override fun onNewWriteableFrame() { }
@@ -69,8 +63,22 @@ internal class AudioRenderer(
         LinkedBlockingDeque()
     }
 
-    private val audioRendererHandler: Handler by lazy {
-        object : Handler(audioRendererThread.looper) {
+    // Frame dequeued but not finished: audio track queue is full or eof frame waiting track to finish.
+    // Handled again when audio track finishes a buffer, or at the deadline if the track stops calling back.
+    private var pendingFrame: AudioFrame? = null
+    private var pendingDeadline: Long = 0
+
+    private fun clearPendingFrame() {
+        pendingFrame = null
+        pendingDeadline = 0
+    }
+
+    // Called once audio track finishes queued frames, see waitSinkDrained().
+    private var sinkDrainedCallback: (() -> Unit)? = null
+    private var sinkDrainedDeadline: Long = 0
+
+    private val audioRendererHandler: SharedLooperHandler by lazy {
+        object : SharedLooperHandler(sharedLooper) {
 
             private val lastRenderedFrame = LastRenderedFrame()
 
@@ -83,10 +91,13 @@ internal class AudioRenderer(
                             val state = getState()
                             val mediaInfo = player.getMediaInfo()
                             if (mediaInfo != null && state in canRenderStates) {
-                                val frame = audioFrameQueue.dequeueReadable()
+                                val retryFrame = pendingFrame
+                                val frame = retryFrame ?: audioFrameQueue.dequeueReadable()
                                 if (frame != null) { // Contain frame to render.
                                     if (frame.serial != audioPacketQueue.getSerial()) { // Frame serial changed cause seeking or change files, skip render this frame.
+                                        clearPendingFrame()
                                         enqueueWritableFrame(frame)
+                                        player.increaseStatsCounter(STATS_DROP_SERIAL_CHANGED)
                                         tMediaPlayerLog.d(TAG) { "Serial changed, skip render." }
                                         requestRender()
                                         return@synchronized
@@ -95,64 +106,57 @@ internal class AudioRenderer(
                                     if (!frame.isEof) { // Not eof frame
 
                                         if (audioTrack.enqueueBuffer(frame.nativeFrame) == OptResult.Success) { // Send frame to audio track success and add frame to waiting
+                                            if (retryFrame != null) {
+                                                tMediaPlayerLog.d(TAG) { "Retry audio frame enqueue success, audio track queue count: ${audioTrack.getBufferQueueCount()}" }
+                                            }
+                                            clearPendingFrame()
                                             waitingRenderFrames.addLast(frame)
                                         } else { // Send frame to audio track fail, maybe buffer queue is full.
                                             tMediaPlayerLog.e(TAG) { "Audio frame enqueue fail, audio track queue count: ${audioTrack.getBufferQueueCount()}" }
-                                            var retryTimes = 5
-                                            var retryEnqueueSuccess = false
-                                            // Retry send frame to audio track.
-                                            while (retryTimes > 0) {
-                                                try {
-                                                    Thread.sleep(6)
-                                                } catch (e: Throwable) {
-                                                    tMediaPlayerLog.e(
-                                                        tag = TAG,
-                                                        msgGetter = { "Sleep error: ${e.message}" },
-                                                        errorGetter = { e }
-                                                    )
-                                                    break
-                                                }
-                                                retryTimes --
-                                                if (audioTrack.enqueueBuffer(frame.nativeFrame) == OptResult.Success) {
-                                                    retryEnqueueSuccess = true
-                                                    waitingRenderFrames.addLast(frame)
-                                                    tMediaPlayerLog.d(TAG) { "Retry audio frame enqueue success, audio track queue count: ${audioTrack.getBufferQueueCount()}" }
-                                                    break
-                                                } else {
-                                                    tMediaPlayerLog.e(TAG) { "Retry audio frame enqueue fail, audio track queue count: ${audioTrack.getBufferQueueCount()}" }
-                                                }
+                                            val time = SystemClock.uptimeMillis()
+                                            if (retryFrame == null) {
+                                                pendingDeadline = time + ENQUEUE_RETRY_TIMEOUT
                                             }
-                                            if (!retryEnqueueSuccess) {
-                                                tMediaPlayerLog.e(TAG) { "After retry enqueue audio frame fail." }
-                                                enqueueWritableFrame(frame)
-                                            } else {
-                                                tMediaPlayerLog.d(TAG) { "After retry enqueue audio frame success." }
+                                            if (time < pendingDeadline) {
+                                                // Retry when audio track finishes a buffer, don't block the shared looper.
+                                                pendingFrame = frame
+                                                requestRender(pendingDeadline - time)
+                                                return@synchronized
                                             }
+                                            tMediaPlayerLog.e(TAG) { "After retry enqueue audio frame fail." }
+                                            clearPendingFrame()
+                                            enqueueWritableFrame(frame)
                                         }
                                         if (state == RendererState.WaitingReadableFrameBuffer || state == RendererState.Eof) {
                                             this@AudioRenderer.state.set(RendererState.Playing)
                                         }
                                         requestRender()
                                     } else { // eof frame
-                                        var bufferCount = audioTrack.getBufferQueueCount()
-                                        var checkTimes = 0
-                                        // Waiting audio track finish all frames.
-                                        val maxCheckTimes = bufferCount
-                                        while (bufferCount > 0) {
-                                            checkTimes++
-                                            tMediaPlayerLog.d(TAG) { "Waiting audio track buffer finish, queueCount$bufferCount, checkTimes=$checkTimes" }
-                                            try {
-                                                Thread.sleep(max(lastRenderedFrame.duration, 6))
-                                            } catch (e: Throwable) {
-                                                tMediaPlayerLog.e(tag = TAG, msgGetter = { "Sleep error: ${e.message}" }, errorGetter = { e })
-                                                break
-                                            }
-                                            bufferCount = audioTrack.getBufferQueueCount()
-                                            if (checkTimes >= maxCheckTimes) {
-                                                tMediaPlayerLog.e(TAG) { "Waiting audio track max times $maxCheckTimes, bufferCount=$bufferCount" }
-                                                break
-                                            }
+                                        if (player.isNextMediaReady()) {
+                                            // Next media will be appended to the audio track, don't wait and keep waiting frames,
+                                            // the frames still playing would be recycled by rendered callback.
+                                            clearPendingFrame()
+                                            this@AudioRenderer.state.set(RendererState.Eof)
+                                            enqueueWritableFrame(frame)
+                                            tMediaPlayerLog.d(TAG) { "Render audio eof, next media ready." }
+                                            return@synchronized
+                                        }
+                                        val bufferCount = audioTrack.getBufferQueueCount()
+                                        val time = SystemClock.uptimeMillis()
+                                        if (retryFrame == null) {
+                                            pendingDeadline = time + (bufferCount + 1) * max(lastRenderedFrame.duration, ENQUEUE_RETRY_TIMEOUT)
+                                        }
+                                        // Waiting audio track finish all frames, checked again by every finished buffer.
+                                        if (bufferCount > 0 && time < pendingDeadline) {
+                                            pendingFrame = frame
+                                            tMediaPlayerLog.d(TAG) { "Waiting audio track buffer finish, queueCount$bufferCount" }
+                                            requestRender(pendingDeadline - time)
+                                            return@synchronized
                                         }
+                                        if (bufferCount > 0) {
+                                            tMediaPlayerLog.e(TAG) { "Waiting audio track buffer finish timeout, bufferCount=$bufferCount" }
+                                        }
+                                        clearPendingFrame()
                                         // Recycle all waiting frames.
                                         while (waitingRenderFrames.isNotEmpty()) {
                                             val b = waitingRenderFrames.pollFirst()
@@ -167,6 +171,7 @@ internal class AudioRenderer(
                                 } else {
                                     if (state == RendererState.Playing) {
                                         this@AudioRenderer.state.set(RendererState.WaitingReadableFrameBuffer)
+                                        player.increaseStatsCounter(STATS_AUDIO_UNDERRUN)
                                     }
                                     // tMediaPlayerLog.d(TAG) { "Waiting readable audio frame." }
                                 }
@@ -181,7 +186,11 @@ internal class AudioRenderer(
                             val frame: AudioFrame? = waitingRenderFrames.pollFirst()
                             // Update clock and recycle finished frames.
                             if (frame != null) {
-                                val fixedPts = if (lastRenderedFrame.serial == frame.serial) {
+                                // Prefer sink playback position, the buffer finished callback is earlier than real playing.
+                                val playbackPts = audioTrack.getPlaybackPts()
+                                val fixedPts = if (playbackPts >= 0L) {
+                                    playbackPts
+                                } else if (lastRenderedFrame.serial == frame.serial) {
                                     lastRenderedFrame.pts + lastRenderedFrame.duration
                                 } else {
                                     frame.pts
@@ -189,23 +198,57 @@ internal class AudioRenderer(
                                 lastRenderedFrame.serial = frame.serial
                                 lastRenderedFrame.pts = frame.pts
                                 lastRenderedFrame.duration = frame.duration
-                                // tMediaPlayerLog.d(TAG) { "Rendered audio frame: fixedPts=$fixedPts, originPts=${frame.pts}, audioTrackBufferCount=$audioTrackBufferCount, waitingBufferCount=$waitingBufferCount" }
-                                player.audioClock.setClock(fixedPts, frame.serial)
-                                player.externalClock.syncToClock(player.audioClock)
+                                // tMediaPlayerLog.d(TAG) { "Rendered audio frame: fixedPts=$fixedPts, playbackPts=$playbackPts, originPts=${frame.pts}, audioTrackBufferCount=$audioTrackBufferCount, waitingBufferCount=$waitingBufferCount" }
+                                // Frames of previous media still playing after switching media, don't update clock.
+                                if (frame.serial == audioPacketQueue.getSerial()) {
+                                    player.audioClock.setClock(fixedPts, frame.serial)
+                                    player.externalClock.syncToClock(player.audioClock)
+                                }
                                 enqueueWritableFrame(frame)
                             } else {
                                 tMediaPlayerLog.d(TAG) { "No waiting audio buffer, audioTrackBufferCount=$audioTrackBufferCount, waitingBufferCount=$waitingBufferCount" }
                             }
+                            // Audio track has free buffer now, wake up pending frame.
+                            if (pendingFrame != null && getState() in canRenderStates) {
+                                requestRender()
+                            }
+                            checkSinkDrained()
+                        }
+
+                        RendererHandlerMsg.CheckSinkDrained.ordinal -> {
+                            checkSinkDrained()
                         }
                     }
                 }
             }
+
+            private fun checkSinkDrained() {
+                val callback = sinkDrainedCallback ?: return
+                val bufferCount = audioTrack.getBufferQueueCount()
+                if (bufferCount > 0 && getState() == RendererState.Paused) {
+                    // Audio track stops playing, checked again by finished buffers after resuming.
+                    sinkDrainedDeadline = 0
+                    return
+                }
+                val time = SystemClock.uptimeMillis()
+                if (sinkDrainedDeadline <= 0) {
+                    sinkDrainedDeadline = time + (bufferCount + 1) * max(lastRenderedFrame.duration, ENQUEUE_RETRY_TIMEOUT)
+                }
+                // Checked again by every finished buffer, or at the deadline if the track stops calling back.
+                if (bufferCount > 0 && time < sinkDrainedDeadline) {
+                    removeMessages(RendererHandlerMsg.CheckSinkDrained.ordinal)
+                    sendEmptyMessageDelayed(RendererHandlerMsg.CheckSinkDrained.ordinal, sinkDrainedDeadline - time)
+                    return
+                }
+                removeMessages(RendererHandlerMsg.CheckSinkDrained.ordinal)
+                sinkDrainedCallback = null
+                sinkDrainedDeadline = 0
+                callback()
+            }
         }
     }
 
     init {
-        audioRendererThread
-        while (!isLooperPrepared.get()) {}
         audioRendererHandler
         audioFrameQueue.addListener(frameQueueListener)
         state.set(RendererState.Paused)
@@ -254,11 +297,27 @@ internal class AudioRenderer(
             if (isAddWritingBuffer) {
                 player.renderedAudioFrame()
             }
+            if (sinkDrainedCallback != null) {
+                // Cleared buffers never call back.
+                audioRendererHandler.sendEmptyMessage(RendererHandlerMsg.CheckSinkDrained.ordinal)
+            }
         } else {
             tMediaPlayerLog.e(TAG) { "Flush error, because of state: $state" }
         }
     }
 
+    /**
+     * Eof was reported without waiting audio track because next media was ready, but switching failed:
+     * call [onDrained] in renderer thread after audio track finishes queued frames.
+     */
+    fun waitSinkDrained(onDrained: () -> Unit) {
+        synchronized(this) {
+            sinkDrainedCallback = onDrained
+            sinkDrainedDeadline = 0
+            audioRendererHandler.sendEmptyMessage(RendererHandlerMsg.CheckSinkDrained.ordinal)
+        }
+    }
+
     fun readableFrameReady() {
         val state = getState()
         if (state == RendererState.WaitingReadableFrameBuffer) {
@@ -274,14 +333,19 @@ internal class AudioRenderer(
             if (state != RendererState.NotInit && state != RendererState.Released) {
                 this.state.set(RendererState.Released)
                 audioTrack.release()
+                val pending = pendingFrame
+                if (pending != null) {
+                    clearPendingFrame()
+                    audioFrameQueue.enqueueWritable(pending)
+                }
                 while (waitingRenderFrames.isNotEmpty()) {
                     val b = waitingRenderFrames.pollFirst()
                     if (b != null) {
                         audioFrameQueue.enqueueWritable(b)
                     }
                 }
-                audioRendererThread.quit()
-                audioRendererThread.quitSafely()
+                audioRendererHandler.detach()
+                SharedLoopers.release(sharedLooper)
                 audioFrameQueue.removeListener(frameQueueListener)
                 tMediaPlayerLog.d(TAG) { "Audio renderer released." }
             } else {
@@ -292,11 +356,11 @@ internal class AudioRenderer(
 
     fun getState(): RendererState = state.get()
 
-    private fun requestRender() {
+    private fun requestRender(delay: Long = 0) {
         val state = getState()
         if (state in canRenderStates) {
             audioRendererHandler.removeMessages(RendererHandlerMsg.RequestRender.ordinal)
-            audioRendererHandler.sendEmptyMessage(RendererHandlerMsg.RequestRender.ordinal)
+            audioRendererHandler.sendEmptyMessageDelayed(RendererHandlerMsg.RequestRender.ordinal, delay)
         } else {
             tMediaPlayerLog.e(TAG) { "Request render error, because of state: $state" }
         }
@@ -309,6 +373,9 @@ internal class AudioRenderer(
 
     companion object {
 
+        // Audio track full and no buffer finished in this time, drop the frame.
+        private const val ENQUEUE_RETRY_TIMEOUT = 30L
+
         private class LastRenderedFrame {
             var pts: Long = 0
             var serial: Int = -1
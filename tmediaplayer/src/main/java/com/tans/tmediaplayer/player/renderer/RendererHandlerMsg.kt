@@ -3,5 +3,6 @@ package com.tans.tmediaplayer.player.renderer
 
 enum class RendererHandlerMsg {
     RequestRender,
-    Rendered
+    Rendered,
+    CheckSinkDrained
 }
\ No newline at end of file
@@ -1,10 +1,15 @@
 package com.tans.tmediaplayer.player.renderer
 
-import android.os.Handler
-import android.os.HandlerThread
 import android.os.Message
 import android.os.SystemClock
 import com.tans.tmediaplayer.tMediaPlayerLog
+import com.tans.tmediaplayer.player.looper.SharedLooper
+import com.tans.tmediaplayer.player.looper.SharedLooperHandler
+import com.tans.tmediaplayer.player.looper.SharedLoopers
+import com.tans.tmediaplayer.player.model.LooperPriority
+import com.tans.tmediaplayer.player.model.STATS_DROP_RENDER_FAIL
+import com.tans.tmediaplayer.player.model.STATS_DROP_RENDER_LATE
+import com.tans.tmediaplayer.player.model.STATS_DROP_SERIAL_CHANGED
 import com.tans.tmediaplayer.player.model.SYNC_FRAMEDUP_THRESHOLD
 import com.tans.tmediaplayer.player.model.SYNC_THRESHOLD_MAX
 import com.tans.tmediaplayer.player.model.SYNC_THRESHOLD_MIN
@@ -18,6 +23,7 @@ import com.tans.tmediaplayer.player.rwqueue.VideoFrame
 import com.tans.tmediaplayer.player.rwqueue.VideoFrameQueue
 import com.tans.tmediaplayer.player.tMediaPlayer
 import java.util.concurrent.atomic.AtomicBoolean
+import java.util.concurrent.atomic.AtomicInteger
 import java.util.concurrent.atomic.AtomicReference
 import kotlin.math.max
 import kotlin.math.min
@@ -29,18 +35,8 @@ internal class VideoRenderer(
 ) {
     private val state: AtomicReference<RendererState> = AtomicReference(RendererState.NotInit)
 
-    // Is read thread ready?
-    private val isLooperPrepared: AtomicBoolean by lazy { AtomicBoolean(false) }
-
-    // Video renderer thread.
-    private val videoRendererThread: HandlerThread by lazy {
-        object : HandlerThread("tMP_VideoRenderer", MAX_PRIORITY) {
-            override fun onLooperPrepared() {
-                super.onLooperPrepared()
-                isLooperPrepared.set(true)
-            }
-        }.apply { start() }
-    }
+    // Video renderer thread, shared with other players' video stages.
+    private val sharedLooper: SharedLooper = SharedLoopers.acquire(LooperPriority.Video)
 
     private val frameQueueListener: ReadWriteQueueListener = object : ReadWriteQueueListener {
         override fun onNewWriteableFrame() { }
@@ -58,11 +54,16 @@ internal class VideoRenderer(
 
     private val renderForce: AtomicBoolean = AtomicBoolean(false)
 
-    private val videoRendererHandler: Handler by lazy {
-        object : Handler(videoRendererThread.looper), GLRenderer.Companion.RenderListener {
+    private val videoRendererHandler: SharedLooperHandler by lazy {
+        object : SharedLooperHandler(sharedLooper), GLRenderer.Companion.RenderListener {
 
             val lastRenderedFrame: LastRenderedFrame = LastRenderedFrame()
             var frameTimer: Long = 0
+            // Deadline to finish rendering the eof frame, 0 if no eof frame waiting.
+            @Volatile
+            var eofRenderTime: Long = 0
+            // Frames sent to gl renderer and not returned.
+            val renderingFrames: AtomicInteger = AtomicInteger(0)
 
             override fun handleMessage(msg: Message) {
                 super.handleMessage(msg)
@@ -79,6 +80,7 @@ internal class VideoRenderer(
                                         return@synchronized
                                     }
                                     renderForce.set(false)
+                                    eofRenderTime = 0L
                                     if (!frame.isEof) {
                                         player.videoClock.setClock(frame.pts, frame.serial)
                                         player.externalClock.syncToClock(player.videoClock)
@@ -99,6 +101,7 @@ internal class VideoRenderer(
                                     val frame = videoFrameQueue.peekReadable()
                                     if (frame != null) { // Has a frame to render
                                         if (frame.serial != videoPacketQueue.getSerial()) { // Frame serial changed cause seeking or change files, skip render this frame.
+                                            eofRenderTime = 0L
                                             val frameToCheck = videoFrameQueue.dequeueReadable()
                                             if (frameToCheck === frame) {
                                                 enqueueWriteableFrame(frame)
@@ -108,6 +111,7 @@ internal class VideoRenderer(
                                                 }
                                                 tMediaPlayerLog.e(TAG) { "Wrong render frame: $frame" }
                                             }
+                                            player.increaseStatsCounter(STATS_DROP_SERIAL_CHANGED)
                                             tMediaPlayerLog.d(TAG) { "Serial changed, skip render." }
                                             requestRender()
                                             return@synchronized
@@ -127,7 +131,8 @@ internal class VideoRenderer(
                                                 nextSerial = frame.serial,
                                                 nextPts = frame.pts,
                                             )
-                                            val delay = computeTargetDelay(lastDuration)
+                                            // Delay is media time, convert to real time with play speed.
+                                            val delay = (computeTargetDelay(lastDuration).toDouble() / player.getPlaySpeed().toDouble()).toLong()
                                             val time = SystemClock.uptimeMillis()
                                             if (time < frameTimer + delay) {  // Need wait to render.
                                                 val realDelay = frameTimer + delay - time
@@ -158,13 +163,18 @@ internal class VideoRenderer(
                                             renderVideoFrame(frame) // render frame
                                             requestRender()
                                         } else { // Eof frame
+                                            // Waiting all frames finish rendering, woken up by the last returned frame, don't block the shared looper.
+                                            val time = SystemClock.uptimeMillis()
+                                            if (eofRenderTime <= 0L) {
+                                                eofRenderTime = time + max(VIDEO_FRAME_QUEUE_SIZE * lastRenderedFrame.duration, 10)
+                                            }
+                                            if (renderingFrames.get() > 0 && time < eofRenderTime) {
+                                                requestRender(eofRenderTime - time)
+                                                return@synchronized
+                                            }
+                                            eofRenderTime = 0L
                                             val frameToCheck = videoFrameQueue.dequeueReadable()
                                             if (frameToCheck === frame) {
-                                                try { // Waiting all frames finish rendering.
-                                                    Thread.sleep(max(VIDEO_FRAME_QUEUE_SIZE * lastRenderedFrame.duration, 10))
-                                                } catch (e: Throwable) {
-                                                    tMediaPlayerLog.e(TAG, { "Waiting all frame finish rendering error: ${e.message}" }, { e })
-                                                }
                                                 this@VideoRenderer.state.set(RendererState.Eof)
                                                 enqueueWriteableFrame(frame)
                                                 tMediaPlayerLog.d(TAG) { "Render video frame eof." }
@@ -193,6 +203,13 @@ internal class VideoRenderer(
                                 lastRenderedFrame.duration = renderedFrame.duration
                                 player.videoClock.setClock(renderedFrame.pts, renderedFrame.serial)
                                 player.externalClock.syncToClock(player.videoClock)
+                                if (player.getSyncType() != SyncType.VideoMaster) {
+                                    val masterClock = player.getMasterClock()
+                                    if (masterClock >= 0L) {
+                                        player.recordSyncError(renderedFrame.pts - masterClock)
+                                        player.reportVideoLatenessInternal(masterClock, masterClock - renderedFrame.pts)
+                                    }
+                                }
 
                                 val time = SystemClock.uptimeMillis()
                                 val nextFrame = videoFrameQueue.peekReadable()
@@ -204,8 +221,10 @@ internal class VideoRenderer(
                                         nextSerial = nextFrame.serial,
                                         nextPts = nextFrame.pts
                                     )
-                                    if (player.getSyncType() != SyncType.VideoMaster && time > frameTimer + duration) {
+                                    val realDuration = (duration.toDouble() / player.getPlaySpeed().toDouble()).toLong()
+                                    if (player.getSyncType() != SyncType.VideoMaster && time > frameTimer + realDuration) {
                                         tMediaPlayerLog.e(TAG) { "Drop next frame: ${nextFrame.pts}" }
+                                        player.increaseStatsCounter(STATS_DROP_RENDER_LATE)
                                         val nextFrameToCheck = videoFrameQueue.dequeueReadable()
                                         if (nextFrameToCheck === nextFrame) {
                                             enqueueWriteableFrame(nextFrame)
@@ -233,12 +252,20 @@ internal class VideoRenderer(
                     sendMessage(msg)
                 }
                 enqueueWriteableFrame(frame)
+                if (!isRendered) {
+                    player.increaseStatsCounter(STATS_DROP_RENDER_FAIL)
+                }
+                if (renderingFrames.decrementAndGet() <= 0 && eofRenderTime > 0L) {
+                    requestRender()
+                }
             }
 
             val renderedFrame: LastRenderedFrame = LastRenderedFrame() // For Message use.
             fun renderVideoFrame(frame: VideoFrame) {
                 val glRenderer = player.getGLRenderer()
+                renderingFrames.incrementAndGet()
                 glRenderer.requestRender(frame)
+                player.videoFrameDisplayed(frame.serial)
             }
 
             fun frameDuration(
@@ -288,8 +315,6 @@ internal class VideoRenderer(
     }
 
     init {
-        videoRendererThread
-        while (!isLooperPrepared.get()) {}
         videoRendererHandler
         videoFrameQueue.addListener(frameQueueListener)
         player.getGLRenderer().addRenderListener(videoRendererHandler as GLRenderer.Companion.RenderListener)
@@ -349,8 +374,8 @@ internal class VideoRenderer(
             val state = getState()
             if (state != RendererState.NotInit && state != RendererState.Released) {
                 this.state.set(RendererState.Released)
-                videoRendererThread.quit()
-                videoRendererThread.quitSafely()
+                videoRendererHandler.detach()
+                SharedLoopers.release(sharedLooper)
                 videoFrameQueue.removeListener(frameQueueListener)
                 player.getGLRenderer().removeRenderListener(videoRendererHandler as GLRenderer.Companion.RenderListener)
                 tMediaPlayerLog.d(TAG) { "Video renderer released." }
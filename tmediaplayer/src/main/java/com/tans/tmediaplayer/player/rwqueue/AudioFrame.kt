@@ -1,6 +1,10 @@
 package com.tans.tmediaplayer.player.rwqueue
 
+import com.tans.tmediaplayer.player.model.AUDIO_FRAME_INFO_EXPORT_SIZE
+
 internal class AudioFrame(val nativeFrame: Long) {
+    // Frame info fetched from native by one jni call.
+    val nativeInfo: LongArray = LongArray(AUDIO_FRAME_INFO_EXPORT_SIZE)
     var pts: Long = 0L
     var duration: Long = 0L
     var serial: Int = 0
@@ -26,8 +26,10 @@ internal class AudioFrameQueue(private val player: tMediaPlayer) : BaseReadWrite
      * Need update serial and eof.
      */
     override fun enqueueReadable(b: AudioFrame) {
-        b.pts = player.getAudioPtsInternal(b.nativeFrame)
-        b.duration = player.getAudioDurationInternal(b.nativeFrame)
+        val info = b.nativeInfo
+        player.getAudioFrameInfoInternal(b.nativeFrame, info)
+        b.pts = info[0]
+        b.duration = info[1]
         super.enqueueReadable(b)
     }
 
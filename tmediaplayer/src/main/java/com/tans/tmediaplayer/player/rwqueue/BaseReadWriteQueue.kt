@@ -124,6 +124,19 @@ internal abstract class BaseReadWriteQueue<T : Any> {
         }
     }
 
+    /**
+     * Release pooled writable buffers to free memory, they are allocated again when needed.
+     */
+    fun trimWritableBuffer() {
+        if (!isReleased.get()) {
+            while (true) {
+                val b = writeableQueue.pollFirst() ?: break
+                recycleBuffer(b)
+                currentQueueSize.decrementAndGet()
+            }
+        }
+    }
+
     open fun flushReadableBuffer() {
         if (!isReleased.get()) {
             val needNotifyWrite = readableQueue.isNotEmpty()
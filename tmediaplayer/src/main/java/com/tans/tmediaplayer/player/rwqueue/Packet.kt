@@ -1,6 +1,10 @@
 package com.tans.tmediaplayer.player.rwqueue
 
+import com.tans.tmediaplayer.player.model.PACKET_INFO_EXPORT_SIZE
+
 internal class Packet(val nativePacket: Long) {
+    // Packet info fetched from native by one jni call.
+    val nativeInfo: LongArray = LongArray(PACKET_INFO_EXPORT_SIZE)
     var streamIndex: Int = -1
     var pts: Long = 0L
     var duration: Long = 0L
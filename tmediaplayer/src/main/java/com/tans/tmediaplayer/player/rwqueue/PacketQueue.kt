@@ -42,10 +42,12 @@ internal class PacketQueue(
     }
 
     override fun enqueueReadable(b: Packet) {
-        b.streamIndex = player.getPacketStreamIndexInternal(b.nativePacket)
-        b.sizeInBytes = player.getPacketBytesSizeInternal(b.nativePacket)
-        b.duration = player.getPacketDurationInternal(b.nativePacket)
-        b.pts = player.getPacketPtsInternal(b.nativePacket)
+        val info = b.nativeInfo
+        player.getPacketInfoInternal(b.nativePacket, info)
+        b.streamIndex = info[0].toInt()
+        b.sizeInBytes = info[1].toInt()
+        b.duration = info[2]
+        b.pts = info[3]
         b.serial = serial.get()
         sizeInBytes.addAndGet(b.sizeInBytes.toLong())
         duration.addAndGet(b.duration)
@@ -1,8 +1,11 @@
 package com.tans.tmediaplayer.player.rwqueue
 
 import com.tans.tmediaplayer.player.model.ImageRawType
+import com.tans.tmediaplayer.player.model.VIDEO_FRAME_INFO_EXPORT_SIZE
 
 internal class VideoFrame(val nativeFrame: Long) {
+    // Frame info fetched from native by one jni call.
+    val nativeInfo: LongArray = LongArray(VIDEO_FRAME_INFO_EXPORT_SIZE)
     var pts: Long = 0L
     var duration: Long = 0L
     var serial: Int = 0
@@ -3,6 +3,7 @@ package com.tans.tmediaplayer.player.rwqueue
 import com.tans.tmediaplayer.tMediaPlayerLog
 import com.tans.tmediaplayer.player.model.ImageRawType
 import com.tans.tmediaplayer.player.model.VIDEO_FRAME_QUEUE_SIZE
+import com.tans.tmediaplayer.player.model.toImageRawType
 import com.tans.tmediaplayer.player.tMediaPlayer
 import java.util.concurrent.atomic.AtomicInteger
 
@@ -30,22 +31,34 @@ internal class VideoFrameQueue(private val player: tMediaPlayer) : BaseReadWrite
         tMediaPlayerLog.d(TAG) { "Recycle video frame, size=${frameSize.get()}" }
     }
 
+    /**
+     * Fetch frame info from native buffer by one jni call, planes' bytes are not copied.
+     */
+    fun loadFrameInfo(b: VideoFrame) {
+        val info = b.nativeInfo
+        player.getVideoFrameInfoInternal(b.nativeFrame, info)
+        b.pts = info[0]
+        b.duration = info[1]
+        if (!b.isEof) {
+            b.imageType = info[2].toInt().toImageRawType()
+            b.width = info[3].toInt()
+            b.height = info[4].toInt()
+            b.displayRotation = info[5].toInt()
+            b.displayRatio = Float.fromBits(info[6].toInt())
+        }
+    }
+
     /**
      * Need update serial and eof.
      */
     override fun enqueueReadable(b: VideoFrame) {
-        b.pts = player.getVideoPtsInternal(b.nativeFrame)
-        b.duration = player.getVideoDurationInternal(b.nativeFrame)
+        loadFrameInfo(b)
         if (!b.isEof) {
-            b.imageType = player.getVideoFrameTypeNativeInternal(b.nativeFrame)
-            b.width = player.getVideoWidthNativeInternal(b.nativeFrame)
-            b.height = player.getVideoHeightNativeInternal(b.nativeFrame)
-            b.displayRotation = player.getVideoFrameDisplayRotationInternal(b.nativeFrame)
-            b.displayRatio = player.getVideoFrameDisplayRatioInternal(b.nativeFrame)
+            val info = b.nativeInfo
             when (b.imageType) {
                 ImageRawType.Yuv420p -> {
                     // Y
-                    val ySize = player.getVideoFrameYSizeNativeInternal(b.nativeFrame)
+                    val ySize = info[8].toInt()
                     if (b.yBuffer?.size != ySize) {
                         b.yBuffer = ByteArray(ySize)
                         tMediaPlayerLog.d(TAG) { "Alloc Y buffer: $ySize" }
@@ -53,7 +66,7 @@ internal class VideoFrameQueue(private val player: tMediaPlayer) : BaseReadWrite
                     player.getVideoFrameYBytesNativeInternal(b.nativeFrame, b.yBuffer!!)
 
                     // U
-                    val uSize = player.getVideoFrameUSizeNativeInternal(b.nativeFrame)
+                    val uSize = info[9].toInt()
                     if (b.uBuffer?.size != uSize) {
                         b.uBuffer = ByteArray(uSize)
                         tMediaPlayerLog.d(TAG) { "Alloc U buffer: $uSize" }
@@ -61,7 +74,7 @@ internal class VideoFrameQueue(private val player: tMediaPlayer) : BaseReadWrite
                     player.getVideoFrameUBytesNativeInternal(b.nativeFrame, b.uBuffer!!)
 
                     // V
-                    val vSize = player.getVideoFrameVSizeNativeInternal(b.nativeFrame)
+                    val vSize = info[10].toInt()
                     if (b.vBuffer?.size != vSize) {
                         b.vBuffer = ByteArray(vSize)
                         tMediaPlayerLog.d(TAG) { "Alloc V buffer: $vSize" }
@@ -70,7 +83,7 @@ internal class VideoFrameQueue(private val player: tMediaPlayer) : BaseReadWrite
                 }
                 ImageRawType.Nv12, ImageRawType.Nv21 -> {
                     // Y
-                    val ySize = player.getVideoFrameYSizeNativeInternal(b.nativeFrame)
+                    val ySize = info[8].toInt()
                     if (b.yBuffer?.size != ySize) {
                         b.yBuffer = ByteArray(ySize)
                         tMediaPlayerLog.d(TAG) { "Alloc Y buffer: $ySize" }
@@ -78,7 +91,7 @@ internal class VideoFrameQueue(private val player: tMediaPlayer) : BaseReadWrite
                     player.getVideoFrameYBytesNativeInternal(b.nativeFrame, b.yBuffer!!)
 
                     // UV/VU
-                    val uvSize = player.getVideoFrameUVSizeNativeInternal(b.nativeFrame)
+                    val uvSize = info[11].toInt()
                     if (b.uvBuffer?.size != uvSize) {
                         b.uvBuffer = ByteArray(uvSize)
                         tMediaPlayerLog.d(TAG) { "Alloc UV buffer: $uvSize" }
@@ -87,7 +100,7 @@ internal class VideoFrameQueue(private val player: tMediaPlayer) : BaseReadWrite
                 }
                 ImageRawType.Rgba -> {
                     // Rgba
-                    val rgbaSize = player.getVideoFrameRgbaSizeNativeInternal(b.nativeFrame)
+                    val rgbaSize = info[7].toInt()
                     if (b.rgbaBuffer?.size != rgbaSize) {
                         b.rgbaBuffer = ByteArray(rgbaSize)
                         tMediaPlayerLog.d(TAG) { "Alloc RGBA buffer: $rgbaSize" }
@@ -1,5 +1,6 @@
 package com.tans.tmediaplayer.player
 
+import android.content.ComponentCallbacks2
 import android.graphics.SurfaceTexture
 import android.os.Build
 import android.os.SystemClock
@@ -8,29 +9,58 @@ import android.view.SurfaceView
 import android.view.TextureView
 import androidx.annotation.FloatRange
 import androidx.annotation.Keep
+import dalvik.annotation.optimization.FastNative
 import com.tans.tmediaplayer.tMediaPlayerLog
 import com.tans.tmediaplayer.player.decoder.AudioFrameDecoder
 import com.tans.tmediaplayer.player.decoder.VideoFrameDecoder
 import com.tans.tmediaplayer.player.model.SyncType.*
 import com.tans.tmediaplayer.player.model.AudioChannel
+import com.tans.tmediaplayer.player.model.ABR_STATS_EXPORT_SIZE
+import com.tans.tmediaplayer.player.model.AbrStats
+import com.tans.tmediaplayer.player.model.AUDIO_FRAME_INFO_EXPORT_SIZE
+import com.tans.tmediaplayer.player.model.BUFFERING_STATS_EXPORT_SIZE
+import com.tans.tmediaplayer.player.model.BUFFERING_UPDATE_FULL
+import com.tans.tmediaplayer.player.model.BUFFERING_UPDATE_REBUFFER_END
+import com.tans.tmediaplayer.player.model.BufferingStats
 import com.tans.tmediaplayer.player.model.AudioSampleBitDepth
 import com.tans.tmediaplayer.player.model.AudioSampleFormat
 import com.tans.tmediaplayer.player.model.AudioSampleRate
 import com.tans.tmediaplayer.player.model.AudioStreamInfo
+import com.tans.tmediaplayer.player.model.DECODE_STATS_EXPORT_SIZE
 import com.tans.tmediaplayer.player.model.DecodeResult
+import com.tans.tmediaplayer.player.model.DecodeStats
 import com.tans.tmediaplayer.player.model.FFmpegCodec
-import com.tans.tmediaplayer.player.model.ImageRawType
+import com.tans.tmediaplayer.player.model.LATE_FRAME_STATS_EXPORT_SIZE
+import com.tans.tmediaplayer.player.model.LateFrameStats
+import com.tans.tmediaplayer.player.model.LIVE_CATCH_UP_HYSTERESIS
+import com.tans.tmediaplayer.player.model.LIVE_CATCH_UP_SPEED
+import com.tans.tmediaplayer.player.model.LIVE_DEFAULT_TARGET_LATENCY
+import com.tans.tmediaplayer.player.model.LIVE_LATE_THRESHOLD
+import com.tans.tmediaplayer.player.model.LIVE_LATENCY_CHECK_INTERVAL
+import com.tans.tmediaplayer.player.model.MediaIOConfig
+import com.tans.tmediaplayer.player.model.MAX_PLAY_SPEED
+import com.tans.tmediaplayer.player.model.MIN_PLAY_SPEED
 import com.tans.tmediaplayer.player.model.MediaInfo
+import com.tans.tmediaplayer.player.model.MediaTrackInfo
+import com.tans.tmediaplayer.player.model.MEMORY_STATS_EXPORT_SIZE
+import com.tans.tmediaplayer.player.model.MemoryStats
 import com.tans.tmediaplayer.player.model.OptResult
+import com.tans.tmediaplayer.player.model.PACKET_INFO_EXPORT_SIZE
+import com.tans.tmediaplayer.player.model.PLAYER_STATS_EXPORT_SIZE
+import com.tans.tmediaplayer.player.model.PlayerStats
 import com.tans.tmediaplayer.player.model.ReadPacketResult
+import com.tans.tmediaplayer.player.model.STATS_SEEK_LATENCY
+import com.tans.tmediaplayer.player.model.STATS_SYNC_ERROR
+import com.tans.tmediaplayer.player.model.SharedLooperStats
 import com.tans.tmediaplayer.player.model.SubtitleStreamInfo
 import com.tans.tmediaplayer.player.model.SyncType
+import com.tans.tmediaplayer.player.model.VIDEO_FRAME_INFO_EXPORT_SIZE
 import com.tans.tmediaplayer.player.model.VideoPixelFormat
 import com.tans.tmediaplayer.player.model.VideoStreamInfo
 import com.tans.tmediaplayer.player.model.toDecodeResult
-import com.tans.tmediaplayer.player.model.toImageRawType
 import com.tans.tmediaplayer.player.model.toOptResult
 import com.tans.tmediaplayer.player.model.toReadPacketResult
+import com.tans.tmediaplayer.player.looper.SharedLoopers
 import com.tans.tmediaplayer.player.pktreader.PacketReader
 import com.tans.tmediaplayer.player.pktreader.ReaderState
 import com.tans.tmediaplayer.player.playerview.GLRenderer
@@ -47,7 +77,13 @@ import com.tans.tmediaplayer.player.rwqueue.VideoFrame
 import com.tans.tmediaplayer.player.rwqueue.VideoFrameQueue
 import com.tans.tmediaplayer.subtitle.ExternalSubtitle
 import com.tans.tmediaplayer.subtitle.InternalSubtitle
+import java.util.WeakHashMap
+import java.util.concurrent.ExecutorService
 import java.util.concurrent.Executors
+import java.util.concurrent.RejectedExecutionException
+import java.util.concurrent.atomic.AtomicBoolean
+import java.util.concurrent.atomic.AtomicInteger
+import java.util.concurrent.atomic.AtomicLong
 import java.util.concurrent.atomic.AtomicReference
 import kotlin.math.max
 import kotlin.math.min
@@ -59,7 +95,9 @@ class tMediaPlayer(
     private val audioOutputSampleRate: AudioSampleRate = AudioSampleRate.Rate48000,
     private val audioOutputSampleBitDepth: AudioSampleBitDepth = AudioSampleBitDepth.SixteenBits,
     private val enableVideoHardwareDecoder: Boolean = true,
-    private val enableHwSurface: Boolean = true
+    private val enableHwSurface: Boolean = true,
+    private val ioConfig: MediaIOConfig = MediaIOConfig(),
+    private val enableLiveLowLatency: Boolean = true
 ) : IPlayer {
 
     private val listener: AtomicReference<tMediaPlayerListener?> by lazy {
@@ -112,6 +150,30 @@ class tMediaPlayer(
 
     private val syncType: SyncType = AudioMaster
 
+    private val playSpeed: AtomicReference<Float> = AtomicReference(1.0f)
+
+    private val audioNormalization: AtomicBoolean = AtomicBoolean(false)
+
+    private val accurateSeek: AtomicBoolean = AtomicBoolean(false)
+
+    private val scrubbing: AtomicBoolean = AtomicBoolean(false)
+
+    // Latest requested seek position, out of date seek results are skipped.
+    private val pendingSeekPosition: AtomicLong = AtomicLong(-1L)
+
+    // For seek to display latency.
+    private val seekRequestTime: AtomicLong = AtomicLong(-1L)
+    private val seekDisplaySerial: AtomicInteger = AtomicInteger(-1)
+
+    // Rebuffering notified to listener.
+    private val isBuffering: AtomicBoolean = AtomicBoolean(false)
+
+    // Live low latency, play faster to catch up when latency exceeds target.
+    private val liveTargetLatency: AtomicLong = AtomicLong(LIVE_DEFAULT_TARGET_LATENCY)
+    @Volatile
+    private var liveCatchUpSpeed: Double = 1.0
+    private var lastLiveLatencyCheckTime: Long = 0L
+
     internal val videoClock: Clock by lazy {
         Clock()
     }
@@ -160,10 +222,54 @@ class tMediaPlayer(
     private val hwSurfaces: Pair<Surface, SurfaceTexture>? by hwSurfaceProxy
 
     private val glRendererProxy = lazy {
-        GLRenderer()
+        GLRenderer().apply { addSurfaceSizeListener(surfaceSizeListener) }
     }
     private val glRenderer: GLRenderer by glRendererProxy
 
+    // Render surface size, decoded video frames are downscaled to it.
+    private val renderSurfaceSize: AtomicReference<Pair<Int, Int>?> by lazy {
+        AtomicReference(null)
+    }
+
+    private val surfaceSizeListener: GLRenderer.Companion.SurfaceSizeListener by lazy {
+        object : GLRenderer.Companion.SurfaceSizeListener {
+            override fun onSurfaceSizeChanged(width: Int, height: Int) {
+                renderSurfaceSize.set(width to height)
+                val nativePlayer = getMediaInfo()?.nativePlayer
+                if (nativePlayer != null) {
+                    updateVideoOutputSize(nativePlayer)
+                }
+            }
+        }
+    }
+
+    // Native stats live with player, not with media file.
+    private val nativeStats: Long = createStatsNative()
+    // Native buffers' bytes of this player, released after all buffers released.
+    private val nativeMemoryTracker: Long = createMemoryTrackerNative()
+    // References of native stats / memory tracker: 1 of player until release, plus threads using them.
+    // Render threads record every frame, so no lock, the last reference frees them.
+    private val nativeStatsRefs: AtomicInteger = AtomicInteger(1)
+
+    init {
+        synchronized(livePlayers) {
+            livePlayers[this] = Unit
+        }
+    }
+
+    private val nextMedia: AtomicReference<NextMedia?> = AtomicReference(null)
+
+    // Opens, switches and releases this player's next medias, a slow open doesn't block other players.
+    private val nextMediaExecutorProxy = lazy {
+        Executors.newSingleThreadExecutor {
+            Thread(it, "tMP_NextMedia")
+        }
+    }
+
+    private val nextMediaExecutor: ExecutorService by nextMediaExecutorProxy
+
+    private val isSwitchingMedia: AtomicBoolean = AtomicBoolean(false)
+
     // region public methods
     @Synchronized
     override fun prepare(file: String): OptResult {
@@ -178,6 +284,7 @@ class tMediaPlayer(
                     }
                     val lastMediaInfo = getMediaInfo()
                     dispatchNewState(new = tMediaPlayerState.NoInit, old = lastState)
+                    dispatchBuffering(false)
                     if (lastMediaInfo != null) {
                         // Release last nativePlayer.
                         releaseNative(lastMediaInfo.nativePlayer)
@@ -192,11 +299,13 @@ class tMediaPlayer(
 
 
                     // Reset clocks
-                    videoClock.initClock(videoPacketQueue)
-                    audioClock.initClock(audioPacketQueue)
-                    externalClock.initClock(null)
+                    liveCatchUpSpeed = 1.0
+                    val speed = playSpeed.get().toDouble()
+                    videoClock.initClock(videoPacketQueue, speed)
+                    audioClock.initClock(audioPacketQueue, speed)
+                    externalClock.initClock(null, speed)
 
-                    val nativePlayer = createPlayerNative()
+                    val nativePlayer = newNativePlayer()
                     val result = prepareNative(
                         nativePlayer = nativePlayer,
                         file = file,
@@ -207,6 +316,9 @@ class tMediaPlayer(
                         targetAudioSampleBitDepth = audioOutputSampleBitDepth.depth
                     ).toOptResult().let {
                         if (it == OptResult.Success) {
+                            setAudioTempoNative(nativePlayer, speed)
+                            setAudioNormalizationNative(nativePlayer, audioNormalization.get())
+                            setScrubModeNative(nativePlayer, scrubbing.get())
                             val mediaInfo = getMediaInfo(nativePlayer, file)
                             if (dispatchNewState(new = tMediaPlayerState.Prepared(mediaInfo), old = tMediaPlayerState.NoInit)) {
                                 OptResult.Success
@@ -255,6 +367,40 @@ class tMediaPlayer(
 
     }
 
+    override fun setNextMedia(file: String?) {
+        if (getState() == tMediaPlayerState.Released) {
+            tMediaPlayerLog.e(TAG) { "Set next media fail, player has released." }
+            return
+        }
+        val next = if (file != null) NextMedia(file = file, nativePlayer = newNativePlayer()) else null
+        val lastNext = nextMedia.getAndSet(next)
+        if (lastNext != null) {
+            releaseNextMedia(lastNext)
+        }
+        if (next != null) {
+            nextMediaExecutor.execute {
+                // Open file and decoders, hw decoder bound to surface is created when switching.
+                val result = prepareNextNative(
+                    nativePlayer = next.nativePlayer,
+                    file = next.file,
+                    requestHw = enableVideoHardwareDecoder,
+                    hwSurface = hwSurfaces?.first,
+                    targetAudioChannels = audioOutputChannel.channel,
+                    targetAudioSampleRate = audioOutputSampleRate.rate,
+                    targetAudioSampleBitDepth = audioOutputSampleBitDepth.depth
+                ).toOptResult()
+                next.prepareResult = result
+                if (result == OptResult.Success) {
+                    tMediaPlayerLog.d(TAG) { "Prepare next media success: ${next.file}" }
+                } else {
+                    tMediaPlayerLog.e(TAG) { "Prepare next media fail: ${next.file}" }
+                }
+            }
+        }
+    }
+
+    override fun getNextMedia(): String? = nextMedia.get()?.file
+
     @Synchronized
     override fun play(): OptResult {
         val state = getState()
@@ -359,10 +505,18 @@ class tMediaPlayer(
     }
 
     @Synchronized
-    override fun seekTo(position: Long): OptResult {
+    override fun seekTo(position: Long): OptResult = requestSeek(position, coalesce = scrubbing.get())
+
+    /**
+     * @param coalesce if true and player is seeking, replace seeking target, only the latest target is serviced.
+     */
+    private fun requestSeek(position: Long, coalesce: Boolean): OptResult {
         val mediaInfo = getMediaInfo()
         return if (mediaInfo?.isSeekable == true) {
             val state = getState()
+            if (coalesce && state is tMediaPlayerState.Seeking && state.targetProgress == position) {
+                return OptResult.Success
+            }
             val seekingState: tMediaPlayerState.Seeking? = when (state) {
                 is tMediaPlayerState.Error -> null
                 tMediaPlayerState.NoInit -> null
@@ -371,13 +525,15 @@ class tMediaPlayer(
                 is tMediaPlayerState.Playing -> state.seek(position)
                 is tMediaPlayerState.Prepared -> state.seek(position)
                 is tMediaPlayerState.Stopped -> state.seek(position)
-                is tMediaPlayerState.Seeking -> null
+                is tMediaPlayerState.Seeking -> if (coalesce) tMediaPlayerState.Seeking(state.lastState, position) else null
                 tMediaPlayerState.Released -> null
             }
             if (seekingState != null) {
                 if (dispatchNewState(new = seekingState, old = state)) {
                     val fixedPosition = min(max(mediaInfo.startTime, position), mediaInfo.startTime + mediaInfo.duration)
                     tMediaPlayerLog.d(TAG) { "RequestSeek=$position, FixedSeek=$fixedPosition" }
+                    pendingSeekPosition.set(fixedPosition)
+                    seekRequestTime.set(SystemClock.uptimeMillis())
                     packetReader.requestSeek(fixedPosition)
                     OptResult.Success
                 } else {
@@ -459,6 +615,11 @@ class tMediaPlayer(
                         if (mediaInfo != null) {
                             releaseNative(mediaInfo.nativePlayer)
                         }
+                        nextMedia.getAndSet(null)?.let { releaseNextMedia(it) }
+                        if (nextMediaExecutorProxy.isInitialized()) {
+                            // Waiting tasks still run.
+                            nextMediaExecutor.shutdown()
+                        }
                         listener.set(null)
 
                         // Hw Surface.
@@ -493,6 +654,12 @@ class tMediaPlayer(
                         internalSubtitle.set(null)
                         externalSubtitle.get()?.release()
                         externalSubtitle.set(null)
+
+                        // Stats
+                        releaseNativeStatsRef()
+                        synchronized(livePlayers) {
+                            livePlayers.remove(this)
+                        }
                         tMediaPlayerLog.d(TAG) { "Release player" }
 
                         return OptResult.Success
@@ -513,6 +680,161 @@ class tMediaPlayer(
         }
     }
 
+    @Synchronized
+    override fun setPlaySpeed(@FloatRange(0.5, 3.0) speed: Float): OptResult {
+        val state = getState()
+        if (state == tMediaPlayerState.Released) {
+            tMediaPlayerLog.e(TAG) { "Set play speed fail, player has released." }
+            return OptResult.Fail
+        }
+        val fixedSpeed = speed.coerceIn(MIN_PLAY_SPEED, MAX_PLAY_SPEED)
+        val lastSpeed = playSpeed.getAndSet(fixedSpeed)
+        if (lastSpeed != fixedSpeed) {
+            applyPlaySpeed()
+            tMediaPlayerLog.d(TAG) { "Play speed changed: $lastSpeed -> $fixedSpeed" }
+        }
+        return OptResult.Success
+    }
+
+    private fun applyPlaySpeed() {
+        val speed = (playSpeed.get().toDouble() * liveCatchUpSpeed).coerceIn(MIN_PLAY_SPEED.toDouble(), MAX_PLAY_SPEED.toDouble())
+        // Clocks
+        videoClock.setSpeed(speed)
+        audioClock.setSpeed(speed)
+        externalClock.setSpeed(speed)
+        // Audio time stretch, applied at next decoded audio frame.
+        getMediaInfo()?.let { setAudioTempoNative(it.nativePlayer, speed) }
+    }
+
+    override fun getPlaySpeed(): Float = playSpeed.get()
+
+    @Synchronized
+    override fun setAudioNormalization(enable: Boolean) {
+        audioNormalization.set(enable)
+        getMediaInfo()?.let { setAudioNormalizationNative(it.nativePlayer, enable) }
+    }
+
+    override fun isAudioNormalizationEnabled(): Boolean = audioNormalization.get()
+
+    override fun setAccurateSeek(enable: Boolean) {
+        accurateSeek.set(enable)
+    }
+
+    override fun isAccurateSeekEnabled(): Boolean = accurateSeek.get()
+
+    @Synchronized
+    override fun setScrubbing(enable: Boolean) {
+        if (scrubbing.getAndSet(enable) == enable) {
+            return
+        }
+        val mediaInfo = getMediaInfo() ?: return
+        setScrubModeNative(mediaInfo.nativePlayer, enable)
+        tMediaPlayerLog.d(TAG) { "Scrubbing: $enable" }
+        if (!enable) {
+            // Decode exact frame and audio at final position.
+            val target = pendingSeekPosition.get()
+            if (target >= 0L) {
+                requestSeek(target, coalesce = true)
+            }
+        }
+    }
+
+    override fun isScrubbing(): Boolean = scrubbing.get()
+
+    override fun getNearestKeyframe(position: Long, before: Boolean): Long? {
+        val mediaInfo = getMediaInfo() ?: return null
+        val keyframe = findNearestKeyframeNative(mediaInfo.nativePlayer, position, before)
+        return if (keyframe >= 0L) keyframe else null
+    }
+
+    override fun getNetworkBufferedBytes(): Long? {
+        val mediaInfo = getMediaInfo() ?: return null
+        val bytes = getReadAheadBufferedBytesNative(mediaInfo.nativePlayer)
+        return if (bytes >= 0L) bytes else null
+    }
+
+    override fun getNetworkBufferedDuration(): Long? {
+        val mediaInfo = getMediaInfo() ?: return null
+        val duration = getReadAheadBufferedDurationNative(mediaInfo.nativePlayer)
+        return if (duration >= 0L) duration else null
+    }
+
+    override fun setLiveTargetLatency(latency: Long) {
+        liveTargetLatency.set(max(latency, 0L))
+    }
+
+    override fun getLiveLatency(): Long? {
+        val mediaInfo = getMediaInfo() ?: return null
+        if (!mediaInfo.isRealTime) return null
+        val latency = getLiveLatencyNative(mediaInfo.nativePlayer, getMasterClock())
+        return if (latency >= 0L) latency else getLiveBufferedLatency(mediaInfo)
+    }
+
+    /**
+     * Packets buffered behind live edge.
+     */
+    private fun getLiveBufferedLatency(mediaInfo: MediaInfo): Long {
+        val audioDuration = if (mediaInfo.audioStreamInfo != null) audioPacketQueue.getDuration() else 0L
+        val videoDuration = if (mediaInfo.videoStreamInfo != null && !mediaInfo.videoStreamInfo.isAttachment) videoPacketQueue.getDuration() else 0L
+        return max(audioDuration, videoDuration)
+    }
+
+    private fun isLiveLowLatency(mediaInfo: MediaInfo): Boolean = enableLiveLowLatency && mediaInfo.isRealTime
+
+    private fun checkLiveLatency(mediaInfo: MediaInfo) {
+        if (!isLiveLowLatency(mediaInfo) || getState() !is tMediaPlayerState.Playing) {
+            return
+        }
+        val now = SystemClock.uptimeMillis()
+        if (now - lastLiveLatencyCheckTime < LIVE_LATENCY_CHECK_INTERVAL) {
+            return
+        }
+        lastLiveLatencyCheckTime = now
+        val latency = getLiveBufferedLatency(mediaInfo)
+        val target = liveTargetLatency.get()
+        val newCatchUpSpeed = when {
+            latency > target + LIVE_CATCH_UP_HYSTERESIS -> LIVE_CATCH_UP_SPEED
+            latency <= target -> 1.0
+            else -> liveCatchUpSpeed
+        }
+        if (newCatchUpSpeed != liveCatchUpSpeed) {
+            liveCatchUpSpeed = newCatchUpSpeed
+            applyPlaySpeed()
+            tMediaPlayerLog.d(TAG) { "Live latency: buffered=${latency}ms, glassToGlass=${getLiveLatencyNative(mediaInfo.nativePlayer, getMasterClock())}ms, target=${target}ms, catchUpSpeed=$newCatchUpSpeed" }
+        }
+    }
+
+    override fun getBufferingStats(): BufferingStats? {
+        val mediaInfo = getMediaInfo() ?: return null
+        val values = LongArray(BUFFERING_STATS_EXPORT_SIZE)
+        getBufferingStatsNative(mediaInfo.nativePlayer, values)
+        return BufferingStats.fromNativeValues(values)
+    }
+
+    override fun getLateFrameStats(): LateFrameStats? {
+        val mediaInfo = getMediaInfo() ?: return null
+        val values = LongArray(LATE_FRAME_STATS_EXPORT_SIZE)
+        getLateFrameStatsNative(mediaInfo.nativePlayer, values)
+        return LateFrameStats.fromNativeValues(values)
+    }
+
+    override fun getDecodeStats(): DecodeStats? {
+        val mediaInfo = getMediaInfo() ?: return null
+        val values = LongArray(DECODE_STATS_EXPORT_SIZE)
+        getDecodeStatsNative(mediaInfo.nativePlayer, values)
+        return DecodeStats.fromNativeValues(values)
+    }
+
+    override fun getAbrStats(): AbrStats? {
+        val mediaInfo = getMediaInfo() ?: return null
+        val values = LongArray(ABR_STATS_EXPORT_SIZE)
+        return if (getAbrStatsNative(mediaInfo.nativePlayer, values)) {
+            AbrStats.fromNativeValues(values)
+        } else {
+            null
+        }
+    }
+
     override fun getState(): tMediaPlayerState = state.get()
 
     override fun getMediaInfo(): MediaInfo? {
@@ -540,6 +862,36 @@ class tMediaPlayer(
         }
     }
 
+    override fun selectAudioTrack(track: MediaTrackInfo): OptResult = requestSelectTrack(track, isVideo = false)
+
+    override fun getSelectedAudioTrack(): MediaTrackInfo? = getSelectedTrack(isVideo = false)
+
+    override fun selectVideoTrack(track: MediaTrackInfo): OptResult = requestSelectTrack(track, isVideo = true)
+
+    override fun getSelectedVideoTrack(): MediaTrackInfo? = getSelectedTrack(isVideo = true)
+
+    @Synchronized
+    private fun requestSelectTrack(track: MediaTrackInfo, isVideo: Boolean): OptResult {
+        val mediaInfo = getMediaInfo()
+        val tracks = if (isVideo) mediaInfo?.videoTracks else mediaInfo?.audioTracks
+        return if (mediaInfo != null && tracks?.contains(track) == true) {
+            if (getSelectedTrack(isVideo) != track) {
+                packetReader.requestSelectTrack(track.streamId, isVideo)
+            }
+            OptResult.Success
+        } else {
+            tMediaPlayerLog.e(TAG) { "Wrong track info: $track" }
+            OptResult.Fail
+        }
+    }
+
+    private fun getSelectedTrack(isVideo: Boolean): MediaTrackInfo? {
+        val mediaInfo = getMediaInfo() ?: return null
+        val streamId = getSelectedTrackNative(mediaInfo.nativePlayer, isVideo)
+        val tracks = if (isVideo) mediaInfo.videoTracks else mediaInfo.audioTracks
+        return tracks.find { it.streamId == streamId }
+    }
+
     @Synchronized
     override fun selectSubtitleStream(subtitle: SubtitleStreamInfo?) {
         val info = getMediaInfo()
@@ -619,6 +971,10 @@ class tMediaPlayer(
 
     override fun setScaleType(scaleType: ScaleType) {
         glRenderer.setScaleType(scaleType)
+        val nativePlayer = getMediaInfo()?.nativePlayer
+        if (nativePlayer != null) {
+            updateVideoOutputSize(nativePlayer)
+        }
     }
 
     override fun getScaleType(): ScaleType {
@@ -646,13 +1002,39 @@ class tMediaPlayer(
     override fun refreshVideoFrame() {
         glRenderer.refreshFrame()
     }
+
+    override fun getStats(): PlayerStats? = useNativeStats { nativeStats ->
+        val values = LongArray(PLAYER_STATS_EXPORT_SIZE)
+        getStatsNative(nativeStats, values)
+        PlayerStats.fromNativeValues(values)
+    }
+
+    override fun getMemoryStats(): MemoryStats? = useNativeStats {
+        val values = LongArray(MEMORY_STATS_EXPORT_SIZE)
+        getMemoryStatsNative(nativeMemoryTracker, values)
+        MemoryStats.fromNativeValues(values)
+    }
+
+    override fun resetStats() {
+        useNativeStats { nativeStats ->
+            resetStatsNative(nativeStats)
+        }
+    }
     // endregion
 
     // region Player internal methods.
 
     internal fun seekResult(position: Long, result: OptResult) {
+        if (position != pendingSeekPosition.get()) {
+            // Coalesced seeking, wait the latest seek result.
+            tMediaPlayerLog.d(TAG) { "Skip out of date seek result: $position" }
+            return
+        }
         val state = getState()
         if (result == OptResult.Success) {
+            seekDisplaySerial.set(videoPacketQueue.getSerial())
+            // Rebuffering finished by seeking.
+            dispatchBuffering(false)
             // Audio renderer
             audioRenderer.flush()
             // Frame queues
@@ -699,6 +1081,23 @@ class tMediaPlayer(
         }
     }
 
+    internal fun selectTrackResult(isVideo: Boolean, position: Long, result: OptResult) {
+        if (result != OptResult.Success) {
+            return
+        }
+        if (isVideo) {
+            videoFrameQueue.flushReadableBuffer()
+            videoClock.setClock(position, videoPacketQueue.getSerial())
+            videoDecoder.requestDecode()
+        } else {
+            audioRenderer.flush()
+            audioFrameQueue.flushReadableBuffer()
+            audioClock.setClock(position, audioPacketQueue.getSerial())
+            externalClock.setClock(position, audioPacketQueue.getSerial())
+            audioDecoder.requestDecode()
+        }
+    }
+
     internal fun getSyncType(): SyncType {
         val mediaInfo = getMediaInfo()
         return if (mediaInfo == null) {
@@ -815,6 +1214,21 @@ class tMediaPlayer(
             }
             tMediaPlayerLog.d(TAG) { "Find subtitle streams: $subTitleStreams" }
         }
+        val audioTracks = List(audioTrackCountNative(nativePlayer)) { index ->
+            MediaTrackInfo(
+                streamId = audioTrackIdNative(nativePlayer, index),
+                metadata = convertMetadataToMap(audioTrackMetadataNative(nativePlayer, index))
+            )
+        }
+        val videoTracks = List(videoTrackCountNative(nativePlayer)) { index ->
+            MediaTrackInfo(
+                streamId = videoTrackIdNative(nativePlayer, index),
+                metadata = convertMetadataToMap(videoTrackMetadataNative(nativePlayer, index))
+            )
+        }
+        if (audioTracks.size > 1 || videoTracks.size > 1) {
+            tMediaPlayerLog.d(TAG) { "Find audio tracks: $audioTracks, video tracks: $videoTracks" }
+        }
         val duration = max(durationNative(nativePlayer), 0L)
         val isRealtime = isRealTimeNative(nativePlayer)
         val startTime = max(getStartTimeNative(nativePlayer), 0L)
@@ -829,7 +1243,9 @@ class tMediaPlayer(
             startTime = startTime,
             audioStreamInfo = audioStreamInfo,
             videoStreamInfo = videoStreamInfo,
-            subtitleStreams = subTitleStreams)
+            subtitleStreams = subTitleStreams,
+            audioTracks = audioTracks,
+            videoTracks = videoTracks)
     }
 
     private fun dispatchNewState(new: tMediaPlayerState, old: tMediaPlayerState): Boolean {
@@ -881,7 +1297,12 @@ class tMediaPlayer(
         checkPlayEnd()
     }
 
+    internal fun isNextMediaReady(): Boolean = isSwitchingMedia.get() || nextMedia.get()?.prepareResult == OptResult.Success
+
     private fun checkPlayEnd() {
+        if (isSwitchingMedia.get()) {
+            return
+        }
         val state = getState()
         if ((state is tMediaPlayerState.Playing ||
             state is tMediaPlayerState.Paused)) {
@@ -895,6 +1316,21 @@ class tMediaPlayer(
                 (mediaInfo.videoStreamInfo == null || mediaInfo.videoStreamInfo.isAttachment || videoRenderer.getState() == RendererState.Eof) &&
                 (mediaInfo.audioStreamInfo == null || audioRenderer.getState() == RendererState.Eof)
             ) {
+                val next = nextMedia.get()
+                if (next != null && next.prepareResult == OptResult.Success && isSwitchingMedia.compareAndSet(false, true)) {
+                    if (nextMedia.compareAndSet(next, null)) {
+                        // Called by renderer thread, switch at other thread to keep locks order same as prepare().
+                        try {
+                            nextMediaExecutor.execute { switchToNextMedia(next) }
+                        } catch (e: RejectedExecutionException) {
+                            // Player released.
+                            releaseNextMedia(next)
+                        }
+                        return
+                    } else {
+                        isSwitchingMedia.set(false)
+                    }
+                }
                 tMediaPlayerLog.d(TAG) { "Play end." }
                 if (dispatchNewState(new = tMediaPlayerState.PlayEnd(mediaInfo), old = state)) {
                     // Clocks
@@ -918,13 +1354,291 @@ class tMediaPlayer(
         }
     }
 
+    /**
+     * Replace current media with prepared next media, reuse decoders if codec params match and keep audio track playing,
+     * the tail of current media and the head of next media play without gap.
+     */
+    @Synchronized
+    private fun switchToNextMedia(next: NextMedia) {
+        synchronized(packetReader) {
+            synchronized(audioDecoder) {
+                synchronized(videoDecoder) {
+                    val lastState = getState()
+                    val lastMediaInfo = when (lastState) {
+                        is tMediaPlayerState.Playing -> lastState.mediaInfo
+                        is tMediaPlayerState.Paused -> lastState.mediaInfo
+                        else -> null
+                    }
+                    if (lastMediaInfo == null) {
+                        // State changed before switching, e.g. seeking or stopped, keep next media.
+                        tMediaPlayerLog.d(TAG) { "Skip switch next media, because of state: $lastState" }
+                        if (!nextMedia.compareAndSet(null, next)) {
+                            releaseNextMedia(next)
+                        }
+                        isSwitchingMedia.set(false)
+                        return
+                    }
+
+                    val result = takeOverDecodersNative(
+                        nativePlayer = next.nativePlayer,
+                        previousNativePlayer = lastMediaInfo.nativePlayer,
+                        requestHw = enableVideoHardwareDecoder,
+                        hwSurface = hwSurfaces?.first,
+                        targetAudioChannels = audioOutputChannel.channel,
+                        targetAudioSampleRate = audioOutputSampleRate.rate,
+                        targetAudioSampleBitDepth = audioOutputSampleBitDepth.depth
+                    ).toOptResult()
+                    if (result != OptResult.Success) {
+                        tMediaPlayerLog.e(TAG) { "Switch next media fail, prepare decoders fail: ${next.file}" }
+                        releaseNextMedia(next)
+                        // Audio renderer reached eof without waiting audio track, current media plays end after audio track finishes.
+                        audioRenderer.waitSinkDrained {
+                            isSwitchingMedia.set(false)
+                            checkPlayEnd()
+                        }
+                        return
+                    }
+                    liveCatchUpSpeed = 1.0
+                    val speed = playSpeed.get().toDouble()
+                    setAudioTempoNative(next.nativePlayer, speed)
+                    setAudioNormalizationNative(next.nativePlayer, audioNormalization.get())
+                    setScrubModeNative(next.nativePlayer, scrubbing.get())
+                    val mediaInfo = getMediaInfo(next.nativePlayer, next.file)
+                    val isPlaying = lastState is tMediaPlayerState.Playing
+                    val newState = if (isPlaying) tMediaPlayerState.Playing(mediaInfo) else tMediaPlayerState.Paused(mediaInfo)
+                    if (!dispatchNewState(new = newState, old = lastState)) {
+                        tMediaPlayerLog.e(TAG) { "Update switch next media state fail, currentState=${getState()}" }
+                        releaseNextMedia(next)
+                        isSwitchingMedia.set(false)
+                        return
+                    }
+                    // Decoders may be moved to next media.
+                    releaseNative(lastMediaInfo.nativePlayer)
+
+                    // Flush pkt and frame queues, audio frames sent to audio track are not affected.
+                    audioPacketQueue.flushReadableBuffer()
+                    videoPacketQueue.flushReadableBuffer()
+                    audioFrameQueue.flushReadableBuffer()
+                    videoFrameQueue.flushReadableBuffer()
+
+                    // Reset clocks
+                    videoClock.initClock(videoPacketQueue, speed)
+                    audioClock.initClock(audioPacketQueue, speed)
+                    externalClock.initClock(null, speed)
+
+                    // Start reader and decoders
+                    packetReader.resetEof()
+                    packetReader.requestReadPkt()
+                    packetReader.requestAttachment()
+                    audioDecoder.requestDecode()
+                    videoDecoder.requestDecode()
+
+                    // Subtitle
+                    internalSubtitle.get()?.resetSubtitle()
+                    val lastExternalSubtitle = externalSubtitle.get()
+                    if (lastExternalSubtitle != null) {
+                        lastExternalSubtitle.release()
+                        externalSubtitle.set(null)
+                    }
+
+                    if (isPlaying) {
+                        playReadPacketNative(next.nativePlayer)
+                        videoClock.play()
+                        audioClock.play()
+                        externalClock.play()
+                        // Renderers are eof, don't flush audio track.
+                        audioRenderer.play()
+                        videoRenderer.play()
+                        internalSubtitle.get()?.play()
+                    } else {
+                        pauseReadPacketNative(next.nativePlayer)
+                    }
+                    dispatchBuffering(false)
+                    tMediaPlayerLog.d(TAG) { "Switch to next media: $mediaInfo" }
+                }
+            }
+        }
+        isSwitchingMedia.set(false)
+    }
+
+    private fun releaseNextMedia(next: NextMedia) {
+        interruptPacketReadNative(next.nativePlayer)
+        // Waiting preparing finish.
+        try {
+            nextMediaExecutor.execute {
+                releaseNative(next.nativePlayer)
+            }
+        } catch (e: RejectedExecutionException) {
+            // Executor shut down by player releasing, called by its last tasks, no preparing is running.
+            releaseNative(next.nativePlayer)
+        }
+    }
+
+    /**
+     * @return true if packet queues are full.
+     */
+    internal fun updateBufferingInternal(nativePlayer: Long, audioDuration: Long, videoDuration: Long, bytes: Long, eof: Boolean): Boolean {
+        val flags = updateBufferingNative(nativePlayer, audioDuration, videoDuration, bytes, eof)
+        if (flags and BUFFERING_UPDATE_REBUFFER_END != 0) {
+            dispatchBuffering(false)
+        }
+        getMediaInfo()?.let { checkLiveLatency(it) }
+        return flags and BUFFERING_UPDATE_FULL != 0
+    }
+
+    internal fun packetQueueUnderrun(isVideo: Boolean) {
+        if (getState() !is tMediaPlayerState.Playing) {
+            return
+        }
+        val mediaInfo = getMediaInfo() ?: return
+        if (isVideo && mediaInfo.videoStreamInfo?.isAttachment != false) {
+            return
+        }
+        if (bufferingUnderrunNative(mediaInfo.nativePlayer, packetReader.getState() == ReaderState.Eof)) {
+            tMediaPlayerLog.d(TAG) { "Rebuffering start, isVideo=$isVideo" }
+            dispatchBuffering(true)
+        }
+    }
+
+    private fun dispatchBuffering(buffering: Boolean) {
+        if (isBuffering.compareAndSet(!buffering, buffering)) {
+            callbackExecutor.execute {
+                listener.get()?.onBuffering(buffering)
+            }
+        }
+    }
+
+    internal fun videoFrameDisplayed(serial: Int) {
+        val requestTime = seekRequestTime.get()
+        if (requestTime > 0L && serial == seekDisplaySerial.get() && seekRequestTime.compareAndSet(requestTime, -1L)) {
+            val latency = SystemClock.uptimeMillis() - requestTime
+            tMediaPlayerLog.d(TAG) { "Seek to display latency: $latency ms" }
+            useNativeStats { nativeStats ->
+                recordStatsNative(nativeStats, STATS_SEEK_LATENCY, latency)
+            }
+        }
+    }
+
+    internal fun recordSyncError(errorInMillis: Long) {
+        useNativeStats { nativeStats ->
+            recordStatsNative(nativeStats, STATS_SYNC_ERROR, errorInMillis)
+        }
+    }
+
+    /**
+     * @param counterType STATS_DROP_* or STATS_AUDIO_UNDERRUN.
+     */
+    internal fun increaseStatsCounter(counterType: Int) {
+        useNativeStats { nativeStats ->
+            increaseStatsCounterNative(nativeStats, counterType)
+        }
+    }
+
+    /**
+     * Native stats are lock free, only guard its lifetime: users hold a reference, no new reference after player released.
+     */
+    private inline fun <T> useNativeStats(block: (nativeStats: Long) -> T): T? {
+        while (true) {
+            val refs = nativeStatsRefs.get()
+            if (refs <= 0) {
+                return null
+            }
+            if (nativeStatsRefs.compareAndSet(refs, refs + 1)) {
+                break
+            }
+        }
+        try {
+            return block(nativeStats)
+        } finally {
+            releaseNativeStatsRef()
+        }
+    }
+
+    private fun releaseNativeStatsRef() {
+        if (nativeStatsRefs.decrementAndGet() == 0) {
+            releaseStatsNative(nativeStats)
+            releaseMemoryTrackerNative(nativeMemoryTracker)
+        }
+    }
+
+    internal fun getMemoryTrackerInternal(): Long = nativeMemoryTracker
+
+    /**
+     * Free pooled writable buffers of all queues, playing buffers are kept.
+     */
+    internal fun trimMemoryInternal() {
+        if (getState() == tMediaPlayerState.Released) {
+            return
+        }
+        audioPacketQueue.trimWritableBuffer()
+        videoPacketQueue.trimWritableBuffer()
+        audioFrameQueue.trimWritableBuffer()
+        videoFrameQueue.trimWritableBuffer()
+        internalSubtitle.get()?.trimMemory()
+        externalSubtitle.get()?.trimMemory()
+    }
+
     internal fun getInternalSubtitle(): InternalSubtitle? = internalSubtitle.get()
 
     internal fun getExternalSubtitle(): ExternalSubtitle? = externalSubtitle.get()
     // endregion
 
     // region Native player control methods.
-    private external fun createPlayerNative(): Long
+    private fun newNativePlayer(): Long {
+        val nativePlayer = createPlayerNative(nativeStats, nativeMemoryTracker)
+        setLocalIOConfigNative(nativePlayer, ioConfig.localBufferSize, ioConfig.enableLocalMmap)
+        setReadAheadConfigNative(nativePlayer, ioConfig.readAheadBufferSize, ioConfig.readAheadLowWatermark, ioConfig.readAheadHighWatermark)
+        setCacheConfigNative(nativePlayer, ioConfig.cacheDir, ioConfig.maxCacheSize)
+        setLowLatencyNative(nativePlayer, enableLiveLowLatency)
+        setAbrConfigNative(nativePlayer, ioConfig.enableAbr)
+        updateVideoOutputSize(nativePlayer)
+        return nativePlayer
+    }
+
+    private fun updateVideoOutputSize(nativePlayer: Long) {
+        val size = renderSurfaceSize.get() ?: return
+        val crop = glRenderer.getScaleType() == ScaleType.CenterCrop
+        setVideoOutputSizeNative(nativePlayer, size.first, size.second, crop)
+    }
+
+    private external fun setVideoOutputSizeNative(nativePlayer: Long, width: Int, height: Int, crop: Boolean)
+
+    private external fun createPlayerNative(nativeStats: Long, nativeMemoryTracker: Long): Long
+
+    private external fun setLocalIOConfigNative(nativePlayer: Long, bufferSize: Int, enableMmap: Boolean)
+
+    private external fun setReadAheadConfigNative(nativePlayer: Long, bufferSize: Long, lowWatermark: Long, highWatermark: Long)
+
+    private external fun updateBufferingNative(nativePlayer: Long, audioDuration: Long, videoDuration: Long, bytes: Long, eof: Boolean): Int
+
+    private external fun bufferingUnderrunNative(nativePlayer: Long, eof: Boolean): Boolean
+
+    private external fun getBufferingStatsNative(nativePlayer: Long, values: LongArray)
+
+    private external fun setAbrConfigNative(nativePlayer: Long, enable: Boolean)
+
+    private external fun getAbrStatsNative(nativePlayer: Long, values: LongArray): Boolean
+
+    internal fun reportVideoLatenessInternal(masterClock: Long, lateness: Long) {
+        val nativePlayer = getMediaInfo()?.nativePlayer ?: return
+        reportVideoLatenessNative(nativePlayer, masterClock, lateness)
+    }
+
+    private external fun reportVideoLatenessNative(nativePlayer: Long, masterClock: Long, lateness: Long)
+
+    private external fun getLateFrameStatsNative(nativePlayer: Long, values: LongArray)
+
+    private external fun getDecodeStatsNative(nativePlayer: Long, values: LongArray)
+
+    private external fun setLowLatencyNative(nativePlayer: Long, enable: Boolean)
+
+    private external fun getLiveLatencyNative(nativePlayer: Long, playPts: Long): Long
+
+    private external fun setCacheConfigNative(nativePlayer: Long, cacheDir: String?, maxCacheSize: Long)
+
+    private external fun getReadAheadBufferedBytesNative(nativePlayer: Long): Long
+
+    private external fun getReadAheadBufferedDurationNative(nativePlayer: Long): Long
 
     private external fun prepareNative(
         nativePlayer: Long,
@@ -937,6 +1651,24 @@ class tMediaPlayer(
 
     internal fun readPacketInternal(nativePlayer: Long): ReadPacketResult = readPacketNative(nativePlayer).toReadPacketResult()
 
+    private external fun prepareNextNative(
+        nativePlayer: Long,
+        file: String,
+        requestHw: Boolean,
+        hwSurface: Surface?,
+        targetAudioChannels: Int,
+        targetAudioSampleRate: Int,
+        targetAudioSampleBitDepth: Int): Int
+
+    private external fun takeOverDecodersNative(
+        nativePlayer: Long,
+        previousNativePlayer: Long,
+        requestHw: Boolean,
+        hwSurface: Surface?,
+        targetAudioChannels: Int,
+        targetAudioSampleRate: Int,
+        targetAudioSampleBitDepth: Int): Int
+
     private external fun readPacketNative(nativePlayer: Long): Int
 
     private external fun pauseReadPacketNative(nativePlayer: Long): Int
@@ -947,15 +1679,26 @@ class tMediaPlayer(
 
     private external fun movePacketRefNative(nativePlayer: Long, nativePacket: Long)
 
-    internal fun seekToInternal(nativePlayer: Long, targetPosInMillis: Long): OptResult = seekToNative(nativePlayer, targetPosInMillis).toOptResult()
+    internal fun seekToInternal(nativePlayer: Long, targetPosInMillis: Long): OptResult = seekToNative(nativePlayer, targetPosInMillis, accurateSeek.get()).toOptResult()
+
+    private external fun seekToNative(nativePlayer: Long, targetPosInMillis: Long, accurate: Boolean): Int
+
+    internal fun selectTrackInternal(nativePlayer: Long, streamId: Int, positionInMillis: Long): OptResult = selectTrackNative(nativePlayer, streamId, positionInMillis).toOptResult()
+
+    private external fun selectTrackNative(nativePlayer: Long, streamIndex: Int, positionInMillis: Long): Int
+
+    private external fun getSelectedTrackNative(nativePlayer: Long, isVideo: Boolean): Int
 
-    private external fun seekToNative(nativePlayer: Long, targetPosInMillis: Long): Int
+    private external fun findNearestKeyframeNative(nativePlayer: Long, targetPosInMillis: Long, before: Boolean): Long
 
     internal fun decodeVideoInternal(nativePlayer: Long, pkt: Packet?): DecodeResult {
-        return decodeVideoNative(nativePlayer, pkt?.nativePacket ?: 0L).toDecodeResult()
+        val mediaInfo = getMediaInfo()
+        val late = pkt != null && !pkt.isEof && mediaInfo != null && isLiveLowLatency(mediaInfo) &&
+                getState() is tMediaPlayerState.Playing && pkt.pts + LIVE_LATE_THRESHOLD < getMasterClock()
+        return decodeVideoNative(nativePlayer, pkt?.nativePacket ?: 0L, late).toDecodeResult()
     }
 
-    private external fun decodeVideoNative(nativePlayer: Long, nativeBuffer: Long): Int
+    private external fun decodeVideoNative(nativePlayer: Long, nativeBuffer: Long, late: Boolean): Int
 
     internal fun flushVideoCodecBufferInternal(nativePlayer: Long) = flushVideoCodecBufferNative(nativePlayer)
 
@@ -977,6 +1720,12 @@ class tMediaPlayer(
 
     private external fun flushAudioCodecBufferNative(nativePlayer: Long)
 
+    private external fun setAudioTempoNative(nativePlayer: Long, tempo: Double)
+
+    private external fun setAudioNormalizationNative(nativePlayer: Long, enable: Boolean)
+
+    private external fun setScrubModeNative(nativePlayer: Long, enable: Boolean)
+
     internal fun moveDecodedAudioFrameToBufferInternal(nativePlayer: Long, audioFrame: AudioFrame): OptResult {
         return moveDecodedAudioFrameToBufferNative(nativePlayer, audioFrame.nativeFrame).toOptResult()
     }
@@ -1064,18 +1813,33 @@ class tMediaPlayer(
     private external fun subtitleStreamMetadataNative(nativePlayer: Long, index: Int): Array<String>
     // endregion
 
+    // region Native audio and video tracks
+    private external fun audioTrackCountNative(nativePlayer: Long): Int
+
+    private external fun audioTrackIdNative(nativePlayer: Long, index: Int): Int
+
+    private external fun audioTrackMetadataNative(nativePlayer: Long, index: Int): Array<String>
+
+    private external fun videoTrackCountNative(nativePlayer: Long): Int
+
+    private external fun videoTrackIdNative(nativePlayer: Long, index: Int): Int
+
+    private external fun videoTrackMetadataNative(nativePlayer: Long, index: Int): Array<String>
+    // endregion
+
     // region Native packet buffer
     internal fun allocPacketInternal(): Long = allocPacketNative()
 
     private external fun allocPacketNative(): Long
     internal fun getPacketStreamIndexInternal(nativeBuffer: Long): Int = getPacketStreamIndexNative(nativeBuffer)
+    @FastNative
     private external fun getPacketStreamIndexNative(nativeBuffer: Long): Int
-    internal fun getPacketPtsInternal(nativeBuffer: Long): Long = getPacketPtsNative(nativeBuffer)
-    private external fun getPacketPtsNative(nativeBuffer: Long): Long
-    internal fun getPacketDurationInternal(nativeBuffer: Long): Long = getPacketDurationNative(nativeBuffer)
-    private external fun getPacketDurationNative(nativeBuffer: Long): Long
-    internal fun getPacketBytesSizeInternal(nativeBuffer: Long): Int = getPacketBytesSizeNative(nativeBuffer)
-    private external fun getPacketBytesSizeNative(nativeBuffer: Long): Int
+    /**
+     * Stream index, bytes size, duration and pts in one call, [values] size is [PACKET_INFO_EXPORT_SIZE].
+     */
+    internal fun getPacketInfoInternal(nativeBuffer: Long, values: LongArray) = getPacketInfoNative(nativeBuffer, values)
+    @FastNative
+    private external fun getPacketInfoNative(nativeBuffer: Long, values: LongArray)
     internal fun releasePacketInternal(nativeBuffer: Long) = releasePacketNative(nativeBuffer)
     private external fun releasePacketNative(nativeBuffer: Long)
     // endregion
@@ -1085,70 +1849,30 @@ class tMediaPlayer(
 
     private external fun allocVideoBufferNative(): Long
 
-    internal fun getVideoPtsInternal(nativeBuffer: Long): Long = getVideoPtsNative(nativeBuffer)
-
-    private external fun getVideoPtsNative(nativeBuffer: Long): Long
-
-    internal fun getVideoDurationInternal(nativeBuffer: Long): Long = getVideoDurationNative(nativeBuffer)
-
-    private external fun getVideoDurationNative(nativeBuffer: Long): Long
-
-    internal fun getVideoWidthNativeInternal(nativeBuffer: Long): Int = getVideoWidthNative(nativeBuffer)
+    /**
+     * Pts, duration, type, size, display info and planes' content size in one call, [values] size is [VIDEO_FRAME_INFO_EXPORT_SIZE].
+     */
+    internal fun getVideoFrameInfoInternal(nativeBuffer: Long, values: LongArray) = getVideoFrameInfoNative(nativeBuffer, values)
 
-    private external fun getVideoWidthNative(nativeBuffer: Long): Int
-
-    internal fun getVideoHeightNativeInternal(nativeBuffer: Long): Int = getVideoHeightNative(nativeBuffer)
-
-    private external fun getVideoHeightNative(nativeBuffer: Long): Int
-
-    internal fun getVideoFrameTypeNativeInternal(nativeBuffer: Long): ImageRawType = getVideoFrameTypeNative(nativeBuffer).toImageRawType()
-
-    private external fun getVideoFrameTypeNative(nativeBuffer: Long): Int
-
-    internal fun getVideoFrameDisplayRotationInternal(nativeBuffer: Long): Int = getVideoFrameDisplayRotationNative(nativeBuffer)
-
-    private external fun getVideoFrameDisplayRotationNative(nativeBuffer: Long): Int
-
-    internal fun getVideoFrameDisplayRatioInternal(nativeBuffer: Long): Float = getVideoFrameDisplayRatioNative(nativeBuffer)
-
-    private external fun getVideoFrameDisplayRatioNative(nativeBuffer: Long): Float
+    @FastNative
+    private external fun getVideoFrameInfoNative(nativeBuffer: Long, values: LongArray)
 
     internal fun getVideoFrameRgbaBytesNativeInternal(nativeBuffer: Long, bytes: ByteArray) = getVideoFrameRgbaBytesNative(nativeBuffer, bytes)
 
     private external fun getVideoFrameRgbaBytesNative(nativeBuffer: Long, bytes: ByteArray)
 
-    internal fun getVideoFrameRgbaSizeNativeInternal(nativeBuffer: Long): Int = getVideoFrameRgbaSizeNative(nativeBuffer)
-
-    private external fun getVideoFrameRgbaSizeNative(nativeBuffer: Long): Int
-
-    internal fun getVideoFrameYSizeNativeInternal(nativeBuffer: Long): Int = getVideoFrameYSizeNative(nativeBuffer)
-
-    private external fun getVideoFrameYSizeNative(nativeBuffer: Long): Int
-
     internal fun getVideoFrameYBytesNativeInternal(nativeBuffer: Long, bytes: ByteArray) = getVideoFrameYBytesNative(nativeBuffer, bytes)
 
     private external fun getVideoFrameYBytesNative(nativeBuffer: Long, bytes: ByteArray)
 
-    internal fun getVideoFrameUSizeNativeInternal(nativeBuffer: Long): Int = getVideoFrameUSizeNative(nativeBuffer)
-
-    private external fun getVideoFrameUSizeNative(nativeBuffer: Long): Int
-
     internal fun getVideoFrameUBytesNativeInternal(nativeBuffer: Long, bytes: ByteArray) = getVideoFrameUBytesNative(nativeBuffer, bytes)
 
     private external fun getVideoFrameUBytesNative(nativeBuffer: Long, bytes: ByteArray)
 
-    internal fun getVideoFrameVSizeNativeInternal(nativeBuffer: Long): Int = getVideoFrameVSizeNative(nativeBuffer)
-
-    private external fun getVideoFrameVSizeNative(nativeBuffer: Long): Int
-
     internal fun getVideoFrameVBytesNativeInternal(nativeBuffer: Long, bytes: ByteArray) = getVideoFrameVBytesNative(nativeBuffer, bytes)
 
     private external fun getVideoFrameVBytesNative(nativeBuffer: Long, bytes: ByteArray)
 
-    internal fun getVideoFrameUVSizeNativeInternal(nativeBuffer: Long): Int = getVideoFrameUVSizeNative(nativeBuffer)
-
-    private external fun getVideoFrameUVSizeNative(nativeBuffer: Long): Int
-
     internal fun getVideoFrameUVBytesNativeInternal(nativeBuffer: Long, bytes: ByteArray) = getVideoFrameUVBytesNative(nativeBuffer, bytes)
 
     private external fun getVideoFrameUVBytesNative(nativeBuffer: Long, bytes: ByteArray)
@@ -1163,16 +1887,17 @@ class tMediaPlayer(
 
     private external fun allocAudioBufferNative(): Long
 
-    internal fun getAudioPtsInternal(nativeBuffer: Long): Long = getAudioPtsNative(nativeBuffer)
-
-    private external fun getAudioPtsNative(nativeBuffer: Long): Long
-
-    internal fun getAudioDurationInternal(nativeBuffer: Long): Long = getAudioDurationNative(nativeBuffer)
+    /**
+     * Pts, duration and content size in one call, [values] size is [AUDIO_FRAME_INFO_EXPORT_SIZE].
+     */
+    internal fun getAudioFrameInfoInternal(nativeBuffer: Long, values: LongArray) = getAudioFrameInfoNative(nativeBuffer, values)
 
-    private external fun getAudioDurationNative(nativeBuffer: Long): Long
+    @FastNative
+    private external fun getAudioFrameInfoNative(nativeBuffer: Long, values: LongArray)
 
-    private external fun getAudioFrameBytesNative(nativeBuffer: Long, bytes: ByteArray)
+    internal fun getAudioFrameSizeInternal(nativeBuffer: Long): Int = getAudioFrameSizeNative(nativeBuffer)
 
+    @FastNative
     private external fun getAudioFrameSizeNative(nativeBuffer: Long): Int
 
     internal fun releaseAudioBufferInternal(nativeBuffer: Long) = releaseAudioBufferNative(nativeBuffer)
@@ -1180,6 +1905,34 @@ class tMediaPlayer(
     private external fun releaseAudioBufferNative(nativeBuffer: Long)
     // endregion
 
+    // region Native stats
+    private external fun createStatsNative(): Long
+
+    private external fun resetStatsNative(nativeStats: Long)
+
+    private external fun increaseStatsCounterNative(nativeStats: Long, counterType: Int)
+
+    private external fun recordStatsNative(nativeStats: Long, histogramType: Int, value: Long)
+
+    private external fun getStatsNative(nativeStats: Long, values: LongArray)
+
+    private external fun releaseStatsNative(nativeStats: Long)
+
+    private external fun createMemoryTrackerNative(): Long
+
+    private external fun getMemoryStatsNative(nativeMemoryTracker: Long, values: LongArray)
+
+    private external fun releaseMemoryTrackerNative(nativeMemoryTracker: Long)
+    // endregion
+
+
+    private class NextMedia(
+        val file: String,
+        val nativePlayer: Long
+    ) {
+        @Volatile
+        var prepareResult: OptResult? = null
+    }
 
     companion object {
         private const val TAG = "tMediaPlayer"
@@ -1196,5 +1949,43 @@ class tMediaPlayer(
                 Thread(it, "tMP_Callback")
             }
         }
+
+        /**
+         * Decoder and renderer threads are shared by all players, see [SharedLoopers].
+         */
+        @JvmStatic
+        fun getSharedLooperStats(): List<SharedLooperStats> = SharedLoopers.getStats()
+
+        // Players not released, weak keys, for trimming memory.
+        private val livePlayers: WeakHashMap<tMediaPlayer, Unit> = WeakHashMap()
+
+        /**
+         * Process-wide budget of all players' native buffers, 0 is unlimited.
+         * Over budget, players' packet buffering targets shrink to keep memory under budget.
+         */
+        @JvmStatic
+        fun setMemoryBudget(bytes: Long) {
+            setProcessMemoryBudgetNative(bytes)
+        }
+
+        /**
+         * Call from [android.content.ComponentCallbacks2.onTrimMemory], frees pooled buffers of all players.
+         */
+        @JvmStatic
+        fun onTrimMemory(level: Int) {
+            if (level < ComponentCallbacks2.TRIM_MEMORY_RUNNING_LOW) {
+                return
+            }
+            val players = synchronized(livePlayers) {
+                livePlayers.keys.toList()
+            }
+            tMediaPlayerLog.d(TAG) { "Trim memory: level=$level, players=${players.size}" }
+            for (p in players) {
+                p.trimMemoryInternal()
+            }
+        }
+
+        @JvmStatic
+        private external fun setProcessMemoryBudgetNative(budget: Long)
     }
 }
\ No newline at end of file
@@ -6,4 +6,9 @@ interface tMediaPlayerListener {
     fun onPlayerState(state: tMediaPlayerState)
 
     fun onProgressUpdate(progress: Long, duration: Long)
+
+    /**
+     * Packet queue underrun while playing (rebuffering), or buffered enough to continue playing.
+     */
+    fun onBuffering(isBuffering: Boolean) {}
 }
\ No newline at end of file
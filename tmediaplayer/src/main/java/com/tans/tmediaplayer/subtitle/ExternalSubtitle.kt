@@ -175,6 +175,10 @@ internal class ExternalSubtitle(val player: tMediaPlayer) {
         subtitle.pause()
     }
 
+    fun trimMemory() {
+        subtitle.trimMemory()
+    }
+
     fun release() {
         synchronized(this) {
             val readerNative = externalSubtitlePktReaderNative.get()
@@ -60,6 +60,10 @@ internal class InternalSubtitle(val player: tMediaPlayer) {
         subtitle.pause()
     }
 
+    fun trimMemory() {
+        subtitle.trimMemory()
+    }
+
     fun release() {
         subtitle.release()
         selectedSubtitleStream.set(null)
@@ -1,10 +1,10 @@
 package com.tans.tmediaplayer.subtitle
 
-import android.os.Handler
-import android.os.Looper
 import android.os.Message
 import com.tans.tmediaplayer.tMediaPlayerLog
 import com.tans.tmediaplayer.player.decoder.DecoderState
+import com.tans.tmediaplayer.player.looper.SharedLooper
+import com.tans.tmediaplayer.player.looper.SharedLooperHandler
 import com.tans.tmediaplayer.player.model.DecodeResult
 import com.tans.tmediaplayer.player.model.OptResult
 import com.tans.tmediaplayer.player.rwqueue.PacketQueue
@@ -13,7 +13,7 @@ import java.util.concurrent.atomic.AtomicReference
 
 internal class SubtitleFrameDecoder(
     private val subtitle: tMediaSubtitle,
-    looper: Looper
+    sharedLooper: SharedLooper
 ) {
     private val state: AtomicReference<DecoderState> = AtomicReference(DecoderState.WaitingReadablePacketBuffer)
 
@@ -43,7 +43,7 @@ internal class SubtitleFrameDecoder(
         override fun onNewReadableFrame() {  }
     }
 
-    private val decoderHandler: Handler = object : Handler(looper) {
+    private val decoderHandler: SharedLooperHandler = object : SharedLooperHandler(sharedLooper) {
 
         private var packetSerial: Int = 1
 
@@ -217,6 +217,7 @@ internal class SubtitleFrameDecoder(
             val oldState = getState()
             if (oldState != DecoderState.NotInit && oldState != DecoderState.Released) {
                 state.set(DecoderState.Released)
+                decoderHandler.detach()
                 packetQueue.removeListener(packetQueueListener)
                 frameQueue.removeListener(frameQueueListener)
                 tMediaPlayerLog.d(TAG) { "Subtitle decoder released." }
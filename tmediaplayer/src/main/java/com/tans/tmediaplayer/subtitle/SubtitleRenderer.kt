@@ -1,10 +1,10 @@
 package com.tans.tmediaplayer.subtitle
 
-import android.os.Handler
-import android.os.Looper
 import android.os.Message
 import com.tans.tmediaplayer.player.playerview.GLRenderer
 import com.tans.tmediaplayer.tMediaPlayerLog
+import com.tans.tmediaplayer.player.looper.SharedLooper
+import com.tans.tmediaplayer.player.looper.SharedLooperHandler
 import com.tans.tmediaplayer.player.renderer.RendererHandlerMsg
 import com.tans.tmediaplayer.player.renderer.RendererState
 import com.tans.tmediaplayer.player.rwqueue.ReadWriteQueueListener
@@ -16,7 +16,7 @@ import kotlin.math.min
 internal class SubtitleRenderer(
     private val player: tMediaPlayer,
     private val subtitle: tMediaSubtitle,
-    looper: Looper
+    sharedLooper: SharedLooper
 ) {
     private val state: AtomicReference<RendererState> = AtomicReference(RendererState.Paused)
 
@@ -45,7 +45,7 @@ internal class SubtitleRenderer(
         }
     }
 
-    private val rendererHandler: Handler = object : Handler(looper) {
+    private val rendererHandler: SharedLooperHandler = object : SharedLooperHandler(sharedLooper) {
         override fun handleMessage(msg: Message) {
             super.handleMessage(msg)
             synchronized(this@SubtitleRenderer) {
@@ -138,6 +138,7 @@ internal class SubtitleRenderer(
             val state = getState()
             if (state != RendererState.NotInit && state != RendererState.Released) {
                 this.state.set(RendererState.Released)
+                rendererHandler.detach()
                 frameQueue.removeListener(frameListener)
                 player.getGLRenderer().removeSubtitleOutOfDateListener(frameOutOfDateListener)
                 val iterator = waitingRendererFrames.iterator()
@@ -1,16 +1,17 @@
 package com.tans.tmediaplayer.subtitle
 
-import android.os.HandlerThread
 import androidx.annotation.Keep
 import com.tans.tmediaplayer.tMediaPlayerLog
+import com.tans.tmediaplayer.player.looper.SharedLooper
+import com.tans.tmediaplayer.player.looper.SharedLoopers
 import com.tans.tmediaplayer.player.model.DecodeResult
+import com.tans.tmediaplayer.player.model.LooperPriority
 import com.tans.tmediaplayer.player.model.OptResult
 import com.tans.tmediaplayer.player.model.SUBTITLE_MAX_PKT_SIZE
 import com.tans.tmediaplayer.player.model.toDecodeResult
 import com.tans.tmediaplayer.player.model.toOptResult
 import com.tans.tmediaplayer.player.rwqueue.PacketQueue
 import com.tans.tmediaplayer.player.tMediaPlayer
-import java.util.concurrent.atomic.AtomicBoolean
 import java.util.concurrent.atomic.AtomicReference
 
 @Suppress("ClassName")
@@ -27,27 +28,17 @@ internal class tMediaSubtitle(val player: tMediaPlayer) {
         SubtitleFrameQueue(this)
     }
 
-    private val isLooperPrepared: AtomicBoolean by lazy { AtomicBoolean(false) }
-
-    private val subtitleThread: HandlerThread by lazy {
-        object : HandlerThread("tMP_Subtitle", Thread.MAX_PRIORITY) {
-            override fun onLooperPrepared() {
-                super.onLooperPrepared()
-                isLooperPrepared.set(true)
-            }
-        }.apply { start() }
-    }
+    // Subtitle decoder and renderer thread, shared with other players' subtitles.
+    private val sharedLooper: SharedLooper = SharedLoopers.acquire(LooperPriority.Subtitle)
 
     val decoder: SubtitleFrameDecoder
 
     val renderer: SubtitleRenderer
 
     init {
-        subtitleNative.set(createSubtitleNative())
-        subtitleThread
-        while (!isLooperPrepared.get()) {}
-        decoder = SubtitleFrameDecoder(this, subtitleThread.looper)
-        renderer = SubtitleRenderer(player, this, subtitleThread.looper)
+        subtitleNative.set(createSubtitleNative(player.getMemoryTrackerInternal()))
+        decoder = SubtitleFrameDecoder(this, sharedLooper)
+        renderer = SubtitleRenderer(player, this, sharedLooper)
     }
 
     fun setupSubtitleStreamFromPlayer(streamIndex: Int): OptResult {
@@ -125,13 +116,17 @@ internal class tMediaSubtitle(val player: tMediaPlayer) {
                 packetQueue.release()
                 frameQueue.release()
                 releaseNative(native)
-                subtitleThread.quit()
-                subtitleThread.quitSafely()
+                SharedLoopers.release(sharedLooper)
             }
         }
     }
 
-    private external fun createSubtitleNative(): Long
+    fun trimMemory() {
+        packetQueue.trimWritableBuffer()
+        frameQueue.trimWritableBuffer()
+    }
+
+    private external fun createSubtitleNative(memoryTracker: Long): Long
 
     private external fun setupSubtitleStreamFromPlayerNative(subtitleNative: Long, playerNative: Long, streamIndex: Int, frameWidth: Int, frameHeight: Int): Int
 
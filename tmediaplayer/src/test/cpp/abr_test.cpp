@@ -0,0 +1,266 @@
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "host_ffmpeg.h"
+#include "tmediaabr.h"
+
+extern "C" {
+#include "libavutil/dict.h"
+}
+
+/**
+ * Format context like hls / dash demuxer opens, streams of all variants and io callbacks opening host sources.
+ */
+typedef struct FakeFormat {
+    AVFormatContext ctx {};
+    std::vector<AVStream *> streams;
+    std::vector<AVProgram *> programs;
+
+    AVStream *addStream(AVMediaType type, int64_t variantBitrate, int32_t height) {
+        auto s = new AVStream {};
+        s->codecpar = new AVCodecParameters {};
+        s->codecpar->codec_type = type;
+        s->codecpar->codec_id = type == AVMEDIA_TYPE_VIDEO ? AV_CODEC_ID_H264 : AV_CODEC_ID_AAC;
+        s->codecpar->width = height * 16 / 9;
+        s->codecpar->height = height;
+        s->codecpar->sample_rate = 48000;
+        s->codecpar->ch_layout.nb_channels = 2;
+        s->time_base = {1, 90000};
+        s->index = (int) streams.size();
+        if (variantBitrate > 0) {
+            av_dict_set(&s->metadata, "variant_bitrate", std::to_string(variantBitrate).c_str(), 0);
+        }
+        streams.push_back(s);
+        ctx.streams = streams.data();
+        ctx.nb_streams = (unsigned int) streams.size();
+        return s;
+    }
+
+    void addProgram(int64_t variantBitrate, const std::vector<int> &streamIndexes) {
+        auto p = new AVProgram {};
+        av_dict_set(&p->metadata, "variant_bitrate", std::to_string(variantBitrate).c_str(), 0);
+        p->stream_index = new unsigned int[streamIndexes.size()];
+        for (size_t i = 0; i < streamIndexes.size(); i ++) {
+            p->stream_index[i] = (unsigned int) streamIndexes[i];
+        }
+        p->nb_stream_indexes = (unsigned int) streamIndexes.size();
+        programs.push_back(p);
+        ctx.programs = programs.data();
+        ctx.nb_programs = (unsigned int) programs.size();
+    }
+
+    FakeFormat() {
+        ctx.io_open = [](AVFormatContext *s, AVIOContext **pb, const char *url, int flags, AVDictionary **options) {
+            return avio_open2(pb, url, flags, nullptr, options);
+        };
+        ctx.io_close2 = [](AVFormatContext *s, AVIOContext *pb) {
+            return avio_closep(&pb);
+        };
+    }
+
+    ~FakeFormat() {
+        for (auto s : streams) {
+            av_dict_free(&s->metadata);
+            delete s->codecpar;
+            delete s;
+        }
+        for (auto p : programs) {
+            av_dict_free(&p->metadata);
+            delete [] p->stream_index;
+            delete p;
+        }
+    }
+} FakeFormat;
+
+// Dash like: each video representation is a stream, one audio.
+static void createDash(FakeFormat &format) {
+    format.addStream(AVMEDIA_TYPE_VIDEO, 5000000, 1080);
+    format.addStream(AVMEDIA_TYPE_VIDEO, 1000000, 360);
+    format.addStream(AVMEDIA_TYPE_VIDEO, 2500000, 720);
+    format.addStream(AVMEDIA_TYPE_AUDIO, 0, 0);
+}
+
+TEST(AbrTest, BandwidthIsMovingAverageOfSegments) {
+    tMediaAbr abr;
+    // 1MB in 1s.
+    abr.onSegmentRead(1000000, 1000000);
+    EXPECT_EQ(abr.bandwidth, 8000000);
+    abr.onSegmentRead(1000000, 500000);
+    EXPECT_EQ(abr.bandwidth, (int64_t) (8000000 * (1.0 - ABR_EWMA_WEIGHT) + 16000000 * ABR_EWMA_WEIGHT));
+}
+
+TEST(AbrTest, ChooseVariantWithBufferHysteresis) {
+    tMediaAbr abr;
+    abr.variants.resize(3);
+    abr.variants[0].bandwidth = 1000000;
+    abr.variants[1].bandwidth = 2500000;
+    abr.variants[2].bandwidth = 5000000;
+    abr.currentVariant = 1;
+
+    // Bandwidth allows 5Mbps, switch up only with enough buffer.
+    EXPECT_EQ(abr.chooseVariant(10000000, ABR_MIN_BUFFER_FOR_UP_SWITCH_IN_MILLIS - 1), 1);
+    EXPECT_EQ(abr.chooseVariant(10000000, ABR_MIN_BUFFER_FOR_UP_SWITCH_IN_MILLIS), 2);
+    // Variant must fit in a fraction of bandwidth.
+    EXPECT_EQ(abr.chooseVariant(6000000, ABR_MIN_BUFFER_FOR_UP_SWITCH_IN_MILLIS), 1);
+    // Bandwidth drops, healthy buffer absorbs it.
+    EXPECT_EQ(abr.chooseVariant(2000000, ABR_MAX_BUFFER_FOR_DOWN_SWITCH_IN_MILLIS), 1);
+    EXPECT_EQ(abr.chooseVariant(2000000, ABR_MAX_BUFFER_FOR_DOWN_SWITCH_IN_MILLIS - 1), 0);
+    // Nothing fits, lowest.
+    EXPECT_EQ(abr.chooseVariant(100000, 0), 0);
+}
+
+TEST(AbrTest, PrepareDashVariants) {
+    FakeFormat format;
+    createDash(format);
+    tMediaAbr abr;
+    // FFmpeg picked the 720p stream.
+    ASSERT_TRUE(abr.prepare(&format.ctx, format.streams[2], format.streams[3]));
+    ASSERT_EQ(abr.variants.size(), 3u);
+    EXPECT_EQ(abr.variants[0].bandwidth, 1000000);
+    EXPECT_EQ(abr.variants[0].videoStreamIndex, 1);
+    EXPECT_EQ(abr.variants[2].height, 1080);
+    EXPECT_EQ(abr.currentVariant, 1);
+    EXPECT_EQ(format.streams[0]->discard, AVDISCARD_ALL);
+    EXPECT_EQ(format.streams[1]->discard, AVDISCARD_ALL);
+    EXPECT_EQ(format.streams[2]->discard, AVDISCARD_DEFAULT);
+    EXPECT_EQ(format.streams[3]->discard, AVDISCARD_DEFAULT);
+    EXPECT_EQ(format.ctx.opaque, &abr);
+
+    int64_t stats[ABR_STATS_EXPORT_SIZE] = {};
+    abr.exportTo(stats);
+    EXPECT_EQ(stats[0], 3);
+    EXPECT_EQ(stats[1], 1);
+    EXPECT_EQ(stats[4 + 1 * 3], 2500000);
+    EXPECT_EQ(stats[4 + 1 * 3 + 2], 720);
+    abr.release();
+}
+
+TEST(AbrTest, PrepareHlsVariantPrograms) {
+    FakeFormat format;
+    format.addStream(AVMEDIA_TYPE_VIDEO, 0, 360);
+    format.addStream(AVMEDIA_TYPE_AUDIO, 0, 0);
+    format.addStream(AVMEDIA_TYPE_VIDEO, 0, 720);
+    format.addStream(AVMEDIA_TYPE_AUDIO, 0, 0);
+    format.addProgram(800000, {0, 1});
+    format.addProgram(3000000, {2, 3});
+    tMediaAbr abr;
+    ASSERT_TRUE(abr.prepare(&format.ctx, format.streams[0], format.streams[1]));
+    ASSERT_EQ(abr.variants.size(), 2u);
+    EXPECT_EQ(abr.variants[1].streams, std::vector<int>({2, 3}));
+    EXPECT_EQ(abr.currentVariant, 0);
+    EXPECT_EQ(format.streams[2]->discard, AVDISCARD_ALL);
+    EXPECT_EQ(format.streams[3]->discard, AVDISCARD_ALL);
+    abr.release();
+}
+
+TEST(AbrTest, SingleVariantDoesNotNeedAbr) {
+    FakeFormat format;
+    format.addStream(AVMEDIA_TYPE_VIDEO, 2000000, 720);
+    format.addStream(AVMEDIA_TYPE_AUDIO, 0, 0);
+    tMediaAbr abr;
+    EXPECT_FALSE(abr.prepare(&format.ctx, format.streams[0], format.streams[1]));
+    EXPECT_TRUE(abr.variants.empty());
+    EXPECT_EQ(format.ctx.opaque, nullptr);
+}
+
+TEST(AbrTest, SwitchIsAppliedAtNextSegment) {
+    FakeFormat format;
+    createDash(format);
+    auto segment = hostCreateMemorySource(256 * 1024);
+    hostRegisterSource("http://host/video/seg1.m4s", segment);
+    hostRegisterSource("http://host/video.mpd", hostCreateMemorySource(1024));
+    tMediaAbr abr;
+    ASSERT_TRUE(abr.prepare(&format.ctx, format.streams[2], format.streams[3]));
+
+    abr.onSegmentRead(2000000, 1000000);
+    abr.update(ABR_MIN_BUFFER_FOR_UP_SWITCH_IN_MILLIS);
+    EXPECT_EQ(abr.pendingVariant, 2);
+    EXPECT_EQ(abr.currentVariant, 1);
+    abr.update(ABR_MIN_BUFFER_FOR_UP_SWITCH_IN_MILLIS);
+    EXPECT_EQ(abr.currentVariant, 1);
+
+    // Manifest reload is not a segment.
+    AVIOContext *pb = nullptr;
+    ASSERT_EQ(format.ctx.io_open(&format.ctx, &pb, "http://host/video.mpd", AVIO_FLAG_READ, nullptr), 0);
+    format.ctx.io_close2(&format.ctx, pb);
+    abr.update(ABR_MIN_BUFFER_FOR_UP_SWITCH_IN_MILLIS);
+    EXPECT_EQ(abr.currentVariant, 1);
+
+    ASSERT_EQ(format.ctx.io_open(&format.ctx, &pb, "http://host/video/seg1.m4s", AVIO_FLAG_READ, nullptr), 0);
+    abr.update(ABR_MIN_BUFFER_FOR_UP_SWITCH_IN_MILLIS);
+    EXPECT_EQ(abr.currentVariant, 2);
+    EXPECT_EQ(abr.pendingVariant, -1);
+    EXPECT_EQ(abr.switchCount, 1);
+    EXPECT_EQ(format.streams[0]->discard, AVDISCARD_DEFAULT);
+    EXPECT_EQ(format.streams[2]->discard, AVDISCARD_ALL);
+    format.ctx.io_close2(&format.ctx, pb);
+
+    abr.release();
+    hostUnregisterSource("http://host/video/seg1.m4s");
+    hostUnregisterSource("http://host/video.mpd");
+}
+
+TEST(AbrTest, SegmentDownloadIsMeasured) {
+    FakeFormat format;
+    createDash(format);
+    auto segment = hostCreateMemorySource(1024 * 1024);
+    // 2MB/s, 16Mbps.
+    segment->bytesPerSecond = 2 * 1024 * 1024;
+    hostRegisterSource("http://host/video/seg2.m4s", segment);
+    hostRegisterSource("http://host/video/init.m4s", hostCreateMemorySource(1024));
+    tMediaBuffering buffering;
+    tMediaAbr abr;
+    abr.buffering = &buffering;
+    ASSERT_TRUE(abr.prepare(&format.ctx, format.streams[2], format.streams[3]));
+
+    AVIOContext *pb = nullptr;
+    std::vector<uint8_t> buf(64 * 1024);
+    // Too small to be a bandwidth sample.
+    ASSERT_EQ(format.ctx.io_open(&format.ctx, &pb, "http://host/video/init.m4s", AVIO_FLAG_READ, nullptr), 0);
+    while (avio_read_partial(pb, buf.data(), (int) buf.size()) > 0) {}
+    format.ctx.io_close2(&format.ctx, pb);
+    EXPECT_EQ(abr.bandwidth, 0);
+
+    ASSERT_EQ(format.ctx.io_open(&format.ctx, &pb, "http://host/video/seg2.m4s", AVIO_FLAG_READ, nullptr), 0);
+    int64_t total = 0;
+    int ret;
+    while ((ret = avio_read_partial(pb, buf.data(), (int) buf.size())) > 0) {
+        total += ret;
+    }
+    EXPECT_EQ(total, 1024 * 1024);
+    format.ctx.io_close2(&format.ctx, pb);
+    // Loaded test machines sleep longer.
+    EXPECT_GT(abr.bandwidth, 4000000);
+    EXPECT_LT(abr.bandwidth, 18000000);
+    EXPECT_NEAR(buffering.throughput, abr.bandwidth / 8, 1);
+    EXPECT_TRUE(abr.segmentIOs.empty());
+
+    abr.release();
+    hostUnregisterSource("http://host/video/seg2.m4s");
+    hostUnregisterSource("http://host/video/init.m4s");
+}
+
+TEST(AbrTest, PacketsAreRoutedToBaseStreams) {
+    FakeFormat format;
+    createDash(format);
+    format.streams[2]->time_base = {1, 1000};
+    tMediaAbr abr;
+    ASSERT_TRUE(abr.prepare(&format.ctx, format.streams[2], format.streams[3]));
+    AVPacket pkt {};
+    pkt.stream_index = 0;
+    pkt.pts = 90000;
+    pkt.dts = 90000;
+    pkt.duration = 3000;
+    abr.routePacket(&pkt);
+    EXPECT_EQ(pkt.stream_index, 2);
+    EXPECT_EQ(pkt.pts, 1000);
+    EXPECT_EQ(pkt.duration, 33);
+    EXPECT_EQ(abr.lastVideoStreamIndex, 0);
+    // Base stream packets are not changed.
+    pkt.stream_index = 3;
+    pkt.pts = 90000;
+    abr.routePacket(&pkt);
+    EXPECT_EQ(pkt.stream_index, 3);
+    EXPECT_EQ(pkt.pts, 90000);
+    abr.release();
+}
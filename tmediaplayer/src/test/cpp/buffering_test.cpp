@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include "tmediabuffering.h"
+
+static const int64_t MB = 1024 * 1024;
+
+TEST(BufferingTest, LocalTargetsScaleWithBitrate) {
+    tMediaBuffering buffering;
+    // Bytes limit is 2s of media, at least 4MB.
+    buffering.prepare(BufferingSourceLocal, 2000000);
+    EXPECT_EQ(buffering.minDurationInMillis, 0);
+    EXPECT_EQ(buffering.maxDurationInMillis, BUFFERING_LOCAL_MAX_DURATION_IN_MILLIS);
+    EXPECT_EQ(buffering.maxBytes, BUFFERING_LOCAL_MIN_BYTES);
+
+    buffering.prepare(BufferingSourceLocal, 80000000);
+    EXPECT_EQ(buffering.maxBytes, 20000000);
+
+    buffering.prepare(BufferingSourceLocal, 800000000);
+    EXPECT_EQ(buffering.maxBytes, BUFFERING_LOCAL_MAX_BYTES);
+}
+
+TEST(BufferingTest, LocalStopsReadingAtMaxDuration) {
+    tMediaBuffering buffering;
+    buffering.prepare(BufferingSourceLocal, 8000000);
+    EXPECT_EQ(buffering.update(500, 400, 500000, false), 0);
+    // Audio queue is full but video queue is not, keep reading.
+    EXPECT_EQ(buffering.update(1500, 800, 1000000, false), 0);
+    EXPECT_EQ(buffering.bufferedDurationInMillis, 800);
+    EXPECT_EQ(buffering.update(1500, 1100, 1500000, false), BUFFERING_UPDATE_FULL);
+    // Audio only.
+    buffering.prepare(BufferingSourceLocal, 128000);
+    EXPECT_EQ(buffering.update(1100, -1, 20000, false), BUFFERING_UPDATE_FULL);
+}
+
+TEST(BufferingTest, BitrateIsMeasuredFromQueues) {
+    tMediaBuffering buffering;
+    // Container has no bitrate.
+    buffering.prepare(BufferingSourceNetwork, 0);
+    EXPECT_EQ(buffering.maxBytes, BUFFERING_NETWORK_MAX_BYTES);
+    // Too short to measure.
+    buffering.update(200, 200, 100000, false);
+    EXPECT_EQ(buffering.bitrate, 0);
+    // 4Mbps.
+    buffering.update(1000, 1000, 500000, false);
+    EXPECT_EQ(buffering.bitrate, 4000000);
+    // 30s of 4Mbps * 2.
+    EXPECT_EQ(buffering.maxBytes, 30000000);
+    buffering.update(2000, 2000, 2000000, false);
+    EXPECT_EQ(buffering.bitrate, 4400000);
+}
+
+TEST(BufferingTest, SlowNetworkBuffersMoreBeforeResuming) {
+    tMediaBuffering buffering;
+    buffering.prepare(BufferingSourceNetwork, 8000000);
+    EXPECT_EQ(buffering.minDurationInMillis, BUFFERING_NETWORK_MIN_DURATION_IN_MILLIS);
+    // Single reads are too short to time, summed by io layer.
+    buffering.onIORead(0, 100);
+    buffering.onIORead(1000, 0);
+    EXPECT_EQ(buffering.throughput, 0);
+    // 1.2MB/s for 1MB/s media.
+    buffering.onIORead(1200000, 1000000);
+    EXPECT_EQ(buffering.throughput, 1200000);
+    buffering.update(0, 0, 0, false);
+    EXPECT_EQ(buffering.minDurationInMillis, BUFFERING_NETWORK_SLOW_MIN_DURATION_IN_MILLIS);
+    // Network recovers, moving average passes 1.5x of bitrate.
+    for (int i = 0; i < 30; i ++) {
+        buffering.onIORead(4000000, 1000000);
+    }
+    buffering.update(0, 0, 0, false);
+    EXPECT_GT(buffering.throughput, 3500000);
+    EXPECT_EQ(buffering.minDurationInMillis, BUFFERING_NETWORK_MIN_DURATION_IN_MILLIS);
+    // Throughput is kept for next media.
+    buffering.prepare(BufferingSourceNetwork, 8000000);
+    EXPECT_GT(buffering.throughput, 3500000);
+}
+
+TEST(BufferingTest, RebufferStartsAfterStartupAndEndsAtMinDuration) {
+    tMediaBuffering buffering;
+    buffering.prepare(BufferingSourceNetwork, 8000000);
+    // Startup buffering is not rebuffering.
+    buffering.update(1000, 1000, 1000000, false);
+    EXPECT_FALSE(buffering.onUnderrun(false));
+    buffering.update(2600, 2600, 2600000, false);
+    EXPECT_TRUE(buffering.startupFinished);
+
+    EXPECT_TRUE(buffering.onUnderrun(false));
+    EXPECT_TRUE(buffering.rebuffering);
+    // Other stream underruns in same rebuffering.
+    EXPECT_FALSE(buffering.onUnderrun(false));
+    EXPECT_EQ(buffering.update(1000, 1000, 1000000, false), 0);
+    EXPECT_TRUE(buffering.rebuffering);
+    EXPECT_EQ(buffering.update(2500, 2600, 2500000, false), BUFFERING_UPDATE_REBUFFER_END);
+    EXPECT_FALSE(buffering.rebuffering);
+    EXPECT_EQ(buffering.rebufferCount, 1);
+
+    // Eof, remaining packets are all we have.
+    EXPECT_FALSE(buffering.onUnderrun(true));
+    EXPECT_TRUE(buffering.onUnderrun(false));
+    EXPECT_EQ(buffering.update(100, 100, 100000, true), BUFFERING_UPDATE_REBUFFER_END);
+    EXPECT_EQ(buffering.rebufferCount, 2);
+}
+
+TEST(BufferingTest, SeekRestartsStartupBuffering) {
+    tMediaBuffering buffering;
+    buffering.prepare(BufferingSourceNetwork, 8000000);
+    buffering.update(3000, 3000, 3000000, false);
+    EXPECT_TRUE(buffering.onUnderrun(false));
+    buffering.onSeek();
+    EXPECT_FALSE(buffering.rebuffering);
+    EXPECT_FALSE(buffering.startupFinished);
+    EXPECT_FALSE(buffering.onUnderrun(false));
+    EXPECT_EQ(buffering.rebufferCount, 1);
+}
+
+TEST(BufferingTest, RealTimeNeverStopsReading) {
+    tMediaBuffering buffering;
+    buffering.prepare(BufferingSourceRealTime, 8000000);
+    EXPECT_EQ(buffering.update(60000, 60000, 200 * MB, false), 0);
+    EXPECT_FALSE(buffering.onUnderrun(false));
+    int64_t stats[BUFFERING_STATS_EXPORT_SIZE];
+    buffering.exportTo(stats);
+    EXPECT_EQ(stats[0], BufferingSourceRealTime);
+    // Unlimited.
+    EXPECT_EQ(stats[4], -1);
+    EXPECT_EQ(stats[5], -1);
+}
+
+TEST(BufferingTest, ExportsStats) {
+    tMediaBuffering buffering;
+    buffering.prepare(BufferingSourceNetwork, 8000000);
+    buffering.onIORead(2000000, 1000000);
+    buffering.update(3000, 4000, 3500000, false);
+    buffering.onUnderrun(false);
+    int64_t stats[BUFFERING_STATS_EXPORT_SIZE];
+    buffering.exportTo(stats);
+    EXPECT_EQ(stats[0], BufferingSourceNetwork);
+    EXPECT_EQ(stats[2], 2000000);
+    EXPECT_EQ(stats[3], BUFFERING_NETWORK_MIN_DURATION_IN_MILLIS);
+    EXPECT_EQ(stats[4], BUFFERING_NETWORK_MAX_DURATION_IN_MILLIS);
+    EXPECT_EQ(stats[6], 3000);
+    EXPECT_EQ(stats[7], 3500000);
+    EXPECT_EQ(stats[8], 1);
+    EXPECT_EQ(stats[9], 1);
+    EXPECT_GE(stats[10], 0);
+    EXPECT_EQ(stats[11], 1);
+}
@@ -0,0 +1,242 @@
+#include <cstdlib>
+#include <fcntl.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include <gtest/gtest.h>
+#include "host_ffmpeg.h"
+#include "tmediacache.h"
+
+static const int64_t MB = 1024 * 1024;
+
+class CacheIOTest : public ::testing::Test {
+protected:
+    std::string cacheDir;
+    std::string url = "http://host/cache.mp4";
+    std::shared_ptr<HostMemorySource> source;
+
+    void SetUp() override {
+        char tmp[] = "/tmp/tmediaplayer_cache_XXXXXX";
+        ASSERT_NE(mkdtemp(tmp), nullptr);
+        cacheDir = tmp;
+        source = hostCreateMemorySource(6 * MB + 100);
+        hostRegisterSource(url, source);
+    }
+
+    void TearDown() override {
+        hostUnregisterSource(url);
+        system(("rm -rf " + cacheDir).c_str());
+    }
+
+    bool open(tMediaCacheIO &io, int64_t maxCacheSize = CACHE_DEFAULT_MAX_SIZE) {
+        return io.open(url.c_str(), nullptr, nullptr, cacheDir.c_str(), maxCacheSize);
+    }
+
+    std::string indexPath(const std::string &key) {
+        return cacheDir + "/" + key + CACHE_INDEX_FILE_SUFFIX;
+    }
+
+    std::string dataPath(const std::string &key) {
+        return cacheDir + "/" + key + CACHE_DATA_FILE_SUFFIX;
+    }
+
+    static bool fileExists(const std::string &path) {
+        struct stat st {};
+        return stat(path.c_str(), &st) == 0;
+    }
+
+    // Read and check content, size < 0 reads until eof.
+    static int64_t readAndCheck(tMediaCacheIO &io, int64_t offset, int64_t size) {
+        EXPECT_EQ(io.seek(offset, SEEK_SET), offset);
+        std::vector<uint8_t> buf(CACHE_AVIO_BUFFER_SIZE);
+        int64_t total = 0;
+        while (size < 0 || total < size) {
+            int want = (int) buf.size();
+            if (size >= 0 && size - total < want) {
+                want = (int) (size - total);
+            }
+            int ret = io.read(buf.data(), want);
+            if (ret == AVERROR_EOF) {
+                break;
+            }
+            EXPECT_GT(ret, 0);
+            if (ret <= 0) {
+                break;
+            }
+            for (int i = 0; i < ret; i ++) {
+                if (buf[i] != hostMemorySourceByte(offset + total + i)) {
+                    ADD_FAILURE() << "Wrong byte at " << offset + total + i;
+                    return -1;
+                }
+            }
+            total += ret;
+        }
+        return total;
+    }
+};
+
+TEST_F(CacheIOTest, AddRangeMergesOverlappingAndAdjacentRanges) {
+    tMediaCacheIO io;
+    io.addRange(100, 200);
+    io.addRange(300, 400);
+    io.addRange(500, 600);
+    EXPECT_EQ(io.ranges.size(), 3u);
+    // Adjacent to first.
+    io.addRange(200, 250);
+    // Covers second and overlaps third.
+    io.addRange(280, 550);
+    // Inside.
+    io.addRange(120, 130);
+    std::map<int64_t, int64_t> expect = {{100, 250}, {280, 600}};
+    EXPECT_EQ(io.ranges, expect);
+    io.addRange(0, 1000);
+    expect = {{0, 1000}};
+    EXPECT_EQ(io.ranges, expect);
+}
+
+TEST_F(CacheIOTest, SecondPlayIsServedFromCache) {
+    auto size = (int64_t) source->data.size();
+    tMediaCacheIO first;
+    ASSERT_TRUE(open(first));
+    EXPECT_TRUE(first.cacheEnabled);
+    EXPECT_EQ(first.contentLength, size);
+    EXPECT_EQ(first.avio->seekable, AVIO_SEEKABLE_NORMAL);
+    EXPECT_EQ(readAndCheck(first, 0, -1), size);
+    EXPECT_EQ(first.missBytes, size);
+    std::string key = first.key;
+    first.release();
+    EXPECT_TRUE(fileExists(indexPath(key)));
+    EXPECT_TRUE(fileExists(dataPath(key)));
+    EXPECT_EQ(source->openCount, 1);
+
+    tMediaCacheIO second;
+    ASSERT_TRUE(open(second));
+    EXPECT_EQ(second.contentLength, size);
+    EXPECT_EQ(readAndCheck(second, 0, -1), size);
+    EXPECT_EQ(second.missBytes, 0);
+    EXPECT_EQ(second.hitBytes, size);
+    // Full cached media plays without network.
+    EXPECT_EQ(source->openCount, 1);
+    second.release();
+}
+
+TEST_F(CacheIOTest, OnlyMissingRangesAreFetched) {
+    auto size = (int64_t) source->data.size();
+    tMediaCacheIO first;
+    ASSERT_TRUE(open(first));
+    EXPECT_EQ(readAndCheck(first, 0, MB), MB);
+    EXPECT_EQ(readAndCheck(first, 3 * MB, MB), MB);
+    first.release();
+
+    tMediaCacheIO second;
+    ASSERT_TRUE(open(second));
+    std::map<int64_t, int64_t> expect = {{0, MB}, {3 * MB, 4 * MB}};
+    EXPECT_EQ(second.ranges, expect);
+    int64_t fetched = source->readBytes;
+    EXPECT_EQ(readAndCheck(second, 0, -1), size);
+    EXPECT_EQ(second.hitBytes, 2 * MB);
+    EXPECT_EQ(second.missBytes, size - 2 * MB);
+    EXPECT_EQ(source->readBytes - fetched, size - 2 * MB);
+    second.release();
+}
+
+TEST_F(CacheIOTest, PlayersOfSameMediaMergeIndex) {
+    auto size = (int64_t) source->data.size();
+    tMediaCacheIO a;
+    tMediaCacheIO b;
+    ASSERT_TRUE(open(a));
+    ASSERT_TRUE(open(b));
+    EXPECT_EQ(readAndCheck(a, 0, 2 * MB), 2 * MB);
+    EXPECT_EQ(readAndCheck(b, 2 * MB, -1), size - 2 * MB);
+    // b saves first, a must not drop b's ranges.
+    b.release();
+    a.release();
+
+    tMediaCacheIO c;
+    ASSERT_TRUE(open(c));
+    std::map<int64_t, int64_t> expect = {{0, size}};
+    EXPECT_EQ(c.ranges, expect);
+    EXPECT_EQ(readAndCheck(c, 0, -1), size);
+    EXPECT_EQ(c.missBytes, 0);
+    c.release();
+}
+
+TEST_F(CacheIOTest, DataInUseIsNotTruncated) {
+    tMediaCacheIO a;
+    ASSERT_TRUE(open(a));
+    // Less than index save interval, no index on disk yet.
+    EXPECT_EQ(readAndCheck(a, 0, MB), MB);
+    ASSERT_FALSE(fileExists(indexPath(a.key)));
+
+    // No index, b would reset cache, a's data is kept.
+    tMediaCacheIO b;
+    ASSERT_TRUE(open(b));
+    EXPECT_FALSE(b.resetCache());
+    EXPECT_EQ(readAndCheck(a, 0, MB), MB);
+    EXPECT_EQ(a.hitBytes, MB);
+    b.release();
+    a.release();
+
+    // Not shared anymore.
+    tMediaCacheIO c;
+    ASSERT_TRUE(open(c));
+    EXPECT_TRUE(c.resetCache());
+    EXPECT_TRUE(c.ranges.empty());
+    c.release();
+}
+
+TEST_F(CacheIOTest, NotSeekableSourceIsReadThrough) {
+    source->seekable = false;
+    tMediaCacheIO io;
+    ASSERT_TRUE(open(io));
+    EXPECT_FALSE(io.cacheEnabled);
+    EXPECT_EQ(io.avio->seekable, 0);
+    EXPECT_EQ(readAndCheck(io, 0, MB), MB);
+    EXPECT_TRUE(io.ranges.empty());
+    std::string key = io.key;
+    io.release();
+    EXPECT_FALSE(fileExists(dataPath(key)));
+    EXPECT_FALSE(fileExists(indexPath(key)));
+}
+
+TEST_F(CacheIOTest, EvictsLeastRecentlyUsedMediaNotInUse) {
+    std::string inUseUrl = "http://host/in_use.mp4";
+    std::string newUrl = "http://host/new.mp4";
+    hostRegisterSource(inUseUrl, hostCreateMemorySource(2 * MB));
+    hostRegisterSource(newUrl, hostCreateMemorySource(2 * MB));
+    std::vector<uint8_t> buf(CACHE_AVIO_BUFFER_SIZE);
+    struct timespec longAgo[2] = {{1000, 0}, {1000, 0}};
+    struct timespec longerAgo[2] = {{10, 0}, {10, 0}};
+
+    tMediaCacheIO old;
+    ASSERT_TRUE(open(old));
+    std::string oldKey = old.key;
+    while (old.read(buf.data(), (int) buf.size()) > 0) {}
+    old.release();
+    ASSERT_EQ(utimensat(AT_FDCWD, indexPath(oldKey).c_str(), longAgo, 0), 0);
+
+    // Oldest, but still played.
+    tMediaCacheIO inUse;
+    ASSERT_TRUE(inUse.open(inUseUrl.c_str(), nullptr, nullptr, cacheDir.c_str(), 7 * MB));
+    while (inUse.read(buf.data(), (int) buf.size()) > 0) {}
+    inUse.saveIndex();
+    ASSERT_EQ(utimensat(AT_FDCWD, indexPath(inUse.key).c_str(), longerAgo, 0), 0);
+
+    // 10MB cached with this one, over 7MB cap.
+    tMediaCacheIO latest;
+    ASSERT_TRUE(latest.open(newUrl.c_str(), nullptr, nullptr, cacheDir.c_str(), 7 * MB));
+    std::string latestKey = latest.key;
+    while (latest.read(buf.data(), (int) buf.size()) > 0) {}
+    latest.release();
+
+    EXPECT_FALSE(fileExists(indexPath(oldKey)));
+    EXPECT_FALSE(fileExists(dataPath(oldKey)));
+    EXPECT_TRUE(fileExists(indexPath(inUse.key)));
+    EXPECT_TRUE(fileExists(indexPath(latestKey)));
+    EXPECT_TRUE(fileExists(dataPath(latestKey)));
+
+    inUse.release();
+    hostUnregisterSource(inUseUrl);
+    hostUnregisterSource(newUrl);
+}
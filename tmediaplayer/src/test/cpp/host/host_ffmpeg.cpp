@@ -0,0 +1,337 @@
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <thread>
+#include "host_ffmpeg.h"
+
+extern "C" {
+#include "libavutil/dict.h"
+#include "libavutil/error.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavcodec/packet.h"
+#include "libavutil/channel_layout.h"
+}
+
+static std::mutex sourcesLock;
+static std::map<std::string, std::shared_ptr<HostMemorySource>> sources;
+
+typedef struct HostSourceIO {
+    std::shared_ptr<HostMemorySource> source;
+    int64_t position = 0;
+    int64_t requestEnd = 0;
+    int64_t nextStall = 0;
+} HostSourceIO;
+
+int64_t hostNowInMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void sleepMicros(int64_t micros) {
+    if (micros > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(micros));
+    }
+}
+
+uint8_t hostMemorySourceByte(int64_t offset) {
+    return (uint8_t) ((offset * 31) ^ (offset >> 12));
+}
+
+std::shared_ptr<HostMemorySource> hostCreateMemorySource(int64_t size) {
+    auto source = std::make_shared<HostMemorySource>();
+    source->data.resize((size_t) size);
+    for (int64_t i = 0; i < size; i ++) {
+        source->data[i] = hostMemorySourceByte(i);
+    }
+    return source;
+}
+
+void hostRegisterSource(const std::string &url, const std::shared_ptr<HostMemorySource> &source) {
+    std::lock_guard<std::mutex> l(sourcesLock);
+    sources[url] = source;
+}
+
+void hostUnregisterSource(const std::string &url) {
+    std::lock_guard<std::mutex> l(sourcesLock);
+    sources.erase(url);
+}
+
+// region Source io callbacks
+static int hostSourceRead(void *opaque, uint8_t *buf, int size) {
+    auto io = static_cast<HostSourceIO *>(opaque);
+    auto &s = *io->source;
+    auto dataSize = (int64_t) s.data.size();
+    if (io->position >= dataSize) {
+        return AVERROR_EOF;
+    }
+    if (io->position >= io->requestEnd) {
+        sleepMicros(s.requestLatencyInMicros);
+        io->requestEnd = io->position + s.requestRangeBytes;
+    }
+    if (s.stallIntervalBytes > 0 && io->position >= io->nextStall) {
+        sleepMicros(s.stallInMicros);
+        io->nextStall += s.stallIntervalBytes;
+    }
+    int64_t n = dataSize - io->position;
+    if (n > size) {
+        n = size;
+    }
+    if (n > s.maxReadSize) {
+        n = s.maxReadSize;
+    }
+    if (s.bytesPerSecond > 0) {
+        sleepMicros(n * 1000000L / s.bytesPerSecond);
+    }
+    memcpy(buf, s.data.data() + io->position, (size_t) n);
+    io->position += n;
+    s.readBytes += n;
+    return (int) n;
+}
+
+static int64_t hostSourceSeek(void *opaque, int64_t offset, int whence) {
+    auto io = static_cast<HostSourceIO *>(opaque);
+    auto &s = *io->source;
+    auto dataSize = (int64_t) s.data.size();
+    if (whence & AVSEEK_SIZE) {
+        return s.seekable ? dataSize : AVERROR(ENOSYS);
+    }
+    int64_t target;
+    switch (whence & ~AVSEEK_FORCE) {
+        case SEEK_SET:
+            target = offset;
+            break;
+        case SEEK_CUR:
+            target = io->position + offset;
+            break;
+        case SEEK_END:
+            target = dataSize + offset;
+            break;
+        default:
+            return AVERROR(EINVAL);
+    }
+    if (target < 0) {
+        return AVERROR(EINVAL);
+    }
+    // Like FFmpeg, seeking to current position works on streams.
+    if (target == io->position) {
+        return target;
+    }
+    if (!s.seekable) {
+        return AVERROR(ENOSYS);
+    }
+    s.seekCount ++;
+    sleepMicros(s.requestLatencyInMicros);
+    io->position = target;
+    io->requestEnd = target + s.requestRangeBytes;
+    return target;
+}
+// endregion
+
+AVIOContext *hostOpenSource(const std::shared_ptr<HostMemorySource> &source) {
+    auto io = new HostSourceIO;
+    io->source = source;
+    io->nextStall = source->stallIntervalBytes;
+    source->openCount ++;
+    sleepMicros(source->requestLatencyInMicros);
+    io->requestEnd = source->requestRangeBytes;
+    auto avio = avio_alloc_context(nullptr, 0, 0, io, hostSourceRead, nullptr, hostSourceSeek);
+    avio->seekable = source->seekable ? AVIO_SEEKABLE_NORMAL : 0;
+    avio->direct = 1;
+    return avio;
+}
+
+extern "C" {
+
+int __android_log_print(int prio, const char *tag, const char *fmt, ...) {
+    // Native logs are noisy in test output, print them only when asked.
+    if (getenv("TMEDIAPLAYER_HOST_LOG") == nullptr) {
+        return 0;
+    }
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "%s: ", tag);
+    vfprintf(stderr, fmt, args);
+    fputc('\n', stderr);
+    va_end(args);
+    return 0;
+}
+
+// region avutil
+void *av_malloc(size_t size) {
+    return malloc(size);
+}
+
+void av_free(void *ptr) {
+    free(ptr);
+}
+
+void av_freep(void *arg) {
+    auto ptr = static_cast<void **>(arg);
+    free(*ptr);
+    *ptr = nullptr;
+}
+
+struct AVDictionary {
+    std::map<std::string, std::string> entries;
+    // Entry returned by av_dict_get(), valid until next call.
+    AVDictionaryEntry last;
+};
+
+AVDictionaryEntry *av_dict_get(const AVDictionary *m, const char *key, const AVDictionaryEntry *prev, int flags) {
+    if (m == nullptr || prev != nullptr) {
+        return nullptr;
+    }
+    auto it = m->entries.find(key);
+    if (it == m->entries.end()) {
+        return nullptr;
+    }
+    auto entry = const_cast<AVDictionaryEntry *>(&m->last);
+    entry->key = const_cast<char *>(it->first.c_str());
+    entry->value = const_cast<char *>(it->second.c_str());
+    return entry;
+}
+
+int av_dict_set(AVDictionary **pm, const char *key, const char *value, int flags) {
+    if (*pm == nullptr) {
+        *pm = new AVDictionary;
+    }
+    if (value == nullptr) {
+        (*pm)->entries.erase(key);
+    } else {
+        (*pm)->entries[key] = value;
+    }
+    return 0;
+}
+
+int av_dict_copy(AVDictionary **dst, const AVDictionary *src, int flags) {
+    if (src == nullptr) {
+        return 0;
+    }
+    for (auto &e : src->entries) {
+        av_dict_set(dst, e.first.c_str(), e.second.c_str(), flags);
+    }
+    return 0;
+}
+
+void av_dict_free(AVDictionary **m) {
+    delete *m;
+    *m = nullptr;
+}
+
+int av_opt_set_int(void *obj, const char *name, int64_t val, int search_flags) {
+    return 0;
+}
+
+int av_channel_layout_compare(const AVChannelLayout *chl, const AVChannelLayout *chl1) {
+    return chl->nb_channels == chl1->nb_channels ? 0 : 1;
+}
+// endregion
+
+// region avcodec
+uint8_t *av_packet_new_side_data(AVPacket *pkt, enum AVPacketSideDataType type, size_t size) {
+    return nullptr;
+}
+
+void av_packet_rescale_ts(AVPacket *pkt, AVRational tb_src, AVRational tb_dst) {
+    auto rescale = [&](int64_t v) {
+        if (v == AV_NOPTS_VALUE) {
+            return v;
+        }
+        return (int64_t) ((double) v * tb_src.num * tb_dst.den / ((double) tb_src.den * tb_dst.num));
+    };
+    pkt->pts = rescale(pkt->pts);
+    pkt->dts = rescale(pkt->dts);
+    pkt->duration = rescale(pkt->duration);
+}
+// endregion
+
+// region avio, only read callbacks without internal buffering.
+AVIOContext *avio_alloc_context(unsigned char *buffer, int buffer_size, int write_flag, void *opaque,
+                                int (*read_packet)(void *opaque, uint8_t *buf, int buf_size),
+                                int (*write_packet)(void *opaque, const uint8_t *buf, int buf_size),
+                                int64_t (*seek)(void *opaque, int64_t offset, int whence)) {
+    auto s = static_cast<AVIOContext *>(calloc(1, sizeof(AVIOContext)));
+    s->buffer = buffer;
+    s->buffer_size = buffer_size;
+    s->opaque = opaque;
+    s->read_packet = read_packet;
+    s->seek = seek;
+    return s;
+}
+
+void avio_context_free(AVIOContext **s) {
+    free(*s);
+    *s = nullptr;
+}
+
+int avio_open2(AVIOContext **s, const char *url, int flags, const AVIOInterruptCB *int_cb, AVDictionary **options) {
+    std::shared_ptr<HostMemorySource> source;
+    {
+        std::lock_guard<std::mutex> l(sourcesLock);
+        auto it = sources.find(url);
+        if (it != sources.end()) {
+            source = it->second;
+        }
+    }
+    if (source == nullptr) {
+        *s = nullptr;
+        return AVERROR(ENOENT);
+    }
+    *s = hostOpenSource(source);
+    return 0;
+}
+
+int avio_closep(AVIOContext **s) {
+    if (*s == nullptr) {
+        return 0;
+    }
+    if ((*s)->read_packet == hostSourceRead) {
+        delete static_cast<HostSourceIO *>((*s)->opaque);
+    }
+    avio_context_free(s);
+    return 0;
+}
+
+int avio_close(AVIOContext *s) {
+    return avio_closep(&s);
+}
+
+int avio_read_partial(AVIOContext *s, unsigned char *buf, int size) {
+    int ret = s->read_packet(s->opaque, buf, size);
+    if (ret == AVERROR_EOF) {
+        s->eof_reached = 1;
+    } else if (ret < 0) {
+        s->eof_reached = 1;
+        s->error = ret;
+    }
+    return ret;
+}
+
+int avio_feof(AVIOContext *s) {
+    return s->eof_reached;
+}
+
+int64_t avio_seek(AVIOContext *s, int64_t offset, int whence) {
+    if (s->seek == nullptr) {
+        return AVERROR(ENOSYS);
+    }
+    int64_t ret = s->seek(s->opaque, offset, whence);
+    if (ret >= 0) {
+        s->eof_reached = 0;
+    }
+    return ret;
+}
+
+int64_t avio_size(AVIOContext *s) {
+    if (s->seek == nullptr) {
+        return AVERROR(ENOSYS);
+    }
+    return s->seek(s->opaque, 0, AVSEEK_SIZE);
+}
+// endregion
+
+}
@@ -0,0 +1,56 @@
+#ifndef TMEDIAPLAYER_HOST_FFMPEG_H
+#define TMEDIAPLAYER_HOST_FFMPEG_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "libavformat/avio.h"
+#include "libavutil/error.h"
+}
+
+/**
+ * In memory byte stream which stands in for a network source, avio_open2() opens registered urls.
+ * Reads are slowed down to simulate bandwidth, request latency and stalls.
+ */
+typedef struct HostMemorySource {
+    std::vector<uint8_t> data;
+    bool seekable = true;
+    // 0 is unlimited.
+    int64_t bytesPerSecond = 0;
+    // Max bytes of one read.
+    int32_t maxReadSize = 16 * 1024;
+    // Latency of open, seek and every new request range.
+    int64_t requestLatencyInMicros = 0;
+    int64_t requestRangeBytes = 1024 * 1024;
+    // 0 is no stall.
+    int64_t stallIntervalBytes = 0;
+    int64_t stallInMicros = 0;
+
+    std::atomic<int64_t> openCount{0};
+    std::atomic<int64_t> readBytes{0};
+    std::atomic<int64_t> seekCount{0};
+} HostMemorySource;
+
+/**
+ * Deterministic content, byte at offset is a function of offset.
+ */
+std::shared_ptr<HostMemorySource> hostCreateMemorySource(int64_t size);
+
+uint8_t hostMemorySourceByte(int64_t offset);
+
+void hostRegisterSource(const std::string &url, const std::shared_ptr<HostMemorySource> &source);
+
+void hostUnregisterSource(const std::string &url);
+
+/**
+ * AVIOContext reading the source directly, released by avio_closep().
+ */
+AVIOContext *hostOpenSource(const std::shared_ptr<HostMemorySource> &source);
+
+int64_t hostNowInMicros();
+
+#endif //TMEDIAPLAYER_HOST_FFMPEG_H
@@ -0,0 +1,11 @@
+#ifndef TMEDIAPLAYER_HOST_ANDROID_LOG_H
+#define TMEDIAPLAYER_HOST_ANDROID_LOG_H
+
+enum android_LogPriority {
+    ANDROID_LOG_DEBUG = 3,
+    ANDROID_LOG_ERROR = 6
+};
+
+extern "C" int __android_log_print(int prio, const char *tag, const char *fmt, ...);
+
+#endif //TMEDIAPLAYER_HOST_ANDROID_LOG_H
@@ -0,0 +1,6 @@
+#ifndef TMEDIAPLAYER_HOST_ANDROID_NATIVE_WINDOW_H
+#define TMEDIAPLAYER_HOST_ANDROID_NATIVE_WINDOW_H
+
+typedef struct ANativeWindow ANativeWindow;
+
+#endif //TMEDIAPLAYER_HOST_ANDROID_NATIVE_WINDOW_H
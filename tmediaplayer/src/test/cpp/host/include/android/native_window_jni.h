@@ -0,0 +1,7 @@
+#ifndef TMEDIAPLAYER_HOST_ANDROID_NATIVE_WINDOW_JNI_H
+#define TMEDIAPLAYER_HOST_ANDROID_NATIVE_WINDOW_JNI_H
+
+#include <jni.h>
+#include "native_window.h"
+
+#endif //TMEDIAPLAYER_HOST_ANDROID_NATIVE_WINDOW_JNI_H
@@ -0,0 +1,29 @@
+#ifndef TMEDIAPLAYER_HOST_JNI_H
+#define TMEDIAPLAYER_HOST_JNI_H
+
+// Host stand-in of the NDK jni.h, tested modules only keep JNI handles.
+#include <cstdint>
+
+typedef uint8_t jboolean;
+typedef int8_t jbyte;
+typedef int32_t jint;
+typedef int64_t jlong;
+typedef float jfloat;
+typedef double jdouble;
+typedef jint jsize;
+
+class _jobject {};
+typedef _jobject *jobject;
+typedef jobject jclass;
+typedef jobject jstring;
+typedef jobject jarray;
+typedef jarray jbyteArray;
+typedef jarray jlongArray;
+typedef jarray jobjectArray;
+
+struct _JNIEnv;
+struct _JavaVM;
+typedef _JNIEnv JNIEnv;
+typedef _JavaVM JavaVM;
+
+#endif //TMEDIAPLAYER_HOST_JNI_H
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include "tmediakeyframeindex.h"
+
+// Keyframe every 2s, 1MB apart.
+static void readKeyframes(tMediaKeyframeIndex &index, int64_t startPts, int64_t endPts) {
+    for (int64_t pts = startPts; pts <= endPts; pts += 2000) {
+        index.add(pts, pts * 512, 4096);
+    }
+}
+
+TEST(KeyframeIndexTest, FindsKeyframesAroundTarget) {
+    tMediaKeyframeIndex index;
+    readKeyframes(index, 0, 20000);
+    ASSERT_EQ(index.size(), 11);
+
+    KeyframeEntry entry;
+    ASSERT_TRUE(index.findBefore(5000, &entry));
+    EXPECT_EQ(entry.pts, 4000);
+    EXPECT_EQ(entry.pos, 4000 * 512);
+    ASSERT_TRUE(index.findAfter(5000, &entry));
+    EXPECT_EQ(entry.pts, 6000);
+    // Exact match snaps to itself in both directions.
+    ASSERT_TRUE(index.findBefore(6000, &entry));
+    EXPECT_EQ(entry.pts, 6000);
+    ASSERT_TRUE(index.findAfter(6000, &entry));
+    EXPECT_EQ(entry.pts, 6000);
+
+    EXPECT_FALSE(index.findBefore(-1, &entry));
+    EXPECT_FALSE(index.findAfter(20001, &entry));
+}
+
+TEST(KeyframeIndexTest, SkipsKeyframesCloserThanMinInterval) {
+    tMediaKeyframeIndex index;
+    // Audio only media, every packet is a keyframe.
+    for (int64_t pts = 0; pts < 10000; pts += 20) {
+        index.add(pts, pts * 16, 320);
+    }
+    EXPECT_EQ(index.size(), 10000 / KEYFRAME_INDEX_MIN_INTERVAL_IN_MILLIS);
+    // Not indexed keyframes were read, range is still covered.
+    EXPECT_TRUE(index.isCovered(0, 9980));
+}
+
+TEST(KeyframeIndexTest, SeekingLeavesGapNotCovered) {
+    tMediaKeyframeIndex index;
+    readKeyframes(index, 0, 10000);
+    // Seek forward, keyframes between 10000 and 30000 are never read.
+    index.onDiscontinuity();
+    readKeyframes(index, 30000, 40000);
+
+    EXPECT_TRUE(index.isCovered(2000, 10000));
+    EXPECT_TRUE(index.isCovered(30000, 40000));
+    EXPECT_FALSE(index.isCovered(8000, 32000));
+    EXPECT_FALSE(index.isCovered(12000, 14000));
+
+    // Nearest indexed keyframe before 20000 is not the real one, caller must not byte seek there.
+    KeyframeEntry entry;
+    ASSERT_TRUE(index.findBefore(20000, &entry));
+    EXPECT_EQ(entry.pts, 10000);
+    EXPECT_FALSE(index.isCovered(entry.pts, 20000));
+}
+
+TEST(KeyframeIndexTest, ReadingGapMergesRanges) {
+    tMediaKeyframeIndex index;
+    readKeyframes(index, 0, 10000);
+    index.onDiscontinuity();
+    readKeyframes(index, 30000, 40000);
+    // Seek back into the gap and read until known range.
+    index.onDiscontinuity();
+    readKeyframes(index, 10000, 30000);
+
+    EXPECT_EQ(index.size(), 21);
+    EXPECT_TRUE(index.isCovered(0, 40000));
+    ASSERT_EQ(index.coveredRanges.size(), 1u);
+    KeyframeEntry entry;
+    ASSERT_TRUE(index.findBefore(21000, &entry));
+    EXPECT_EQ(entry.pts, 20000);
+}
+
+TEST(KeyframeIndexTest, OutOfOrderKeyframeIsInserted) {
+    tMediaKeyframeIndex index;
+    readKeyframes(index, 10000, 20000);
+    index.onDiscontinuity();
+    index.add(4000, 4000 * 512, 4096);
+    // Duplicate of indexed keyframe is ignored.
+    index.add(10000, 10000 * 512, 4096);
+    EXPECT_EQ(index.size(), 7);
+    KeyframeEntry entry;
+    ASSERT_TRUE(index.findAfter(0, &entry));
+    EXPECT_EQ(entry.pts, 4000);
+}
@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "host_ffmpeg.h"
+#include "tmediaio.h"
+
+// Sequential read of a local file: FFmpeg file protocol (32KB read() per avio fill) vs tMediaLocalIO buffered pread and mmap.
+// File size in MB can be set by TMEDIAPLAYER_BENCHMARK_FILE_MB, cold runs drop the file from page cache first.
+
+static void dropPageCache(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+static void report(const char *name, std::vector<int64_t> &costs, int64_t bytes, int64_t wallInMicros, int64_t syscalls) {
+    std::sort(costs.begin(), costs.end());
+    printf("%-26s %8.0f MB/s  reads=%6zu  p50=%6lldus  p99=%6lldus  max=%6lldus  syscalls=%lld\n", name,
+           (double) bytes / (1024.0 * 1024.0) / ((double) wallInMicros / 1e6), costs.size(),
+           (long long) costs[costs.size() / 2], (long long) costs[costs.size() * 99 / 100], (long long) costs.back(), (long long) syscalls);
+}
+
+static void fileProtocolRead(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    std::vector<uint8_t> buf(32 * 1024);
+    std::vector<int64_t> costs;
+    int64_t bytes = 0;
+    int64_t syscalls = 0;
+    int64_t start = hostNowInMicros();
+    while (true) {
+        int64_t t = hostNowInMicros();
+        ssize_t ret = read(fd, buf.data(), buf.size());
+        syscalls ++;
+        costs.push_back(hostNowInMicros() - t);
+        if (ret <= 0) {
+            break;
+        }
+        bytes += ret;
+    }
+    report("file protocol 32KB read", costs, bytes, hostNowInMicros() - start, syscalls);
+    close(fd);
+}
+
+static void localIORead(const std::string &path, const char *name, bool enableMmap) {
+    tMediaLocalIO io;
+    if (!io.open(path.c_str(), LOCAL_IO_DEFAULT_BUFFER_SIZE, enableMmap)) {
+        printf("%-26s open fail\n", name);
+        return;
+    }
+    std::vector<uint8_t> buf(io.avio->buffer_size);
+    std::vector<int64_t> costs;
+    int64_t bytes = 0;
+    int64_t start = hostNowInMicros();
+    while (true) {
+        int64_t t = hostNowInMicros();
+        int ret = io.avio->read_packet(io.avio->opaque, buf.data(), (int) buf.size());
+        costs.push_back(hostNowInMicros() - t);
+        if (ret <= 0) {
+            break;
+        }
+        bytes += ret;
+    }
+    report(name, costs, bytes, hostNowInMicros() - start, io.stats.syscallCount);
+    io.release();
+}
+
+int main() {
+    const char *sizeEnv = getenv("TMEDIAPLAYER_BENCHMARK_FILE_MB");
+    int64_t sizeInMb = sizeEnv != nullptr ? atoll(sizeEnv) : 256;
+    char tmp[] = "/tmp/tmediaplayer_local_io_benchmark_XXXXXX";
+    int fd = mkstemp(tmp);
+    if (fd < 0) {
+        return 1;
+    }
+    std::string path = tmp;
+    std::vector<uint8_t> chunk(1024 * 1024, 7);
+    for (int64_t i = 0; i < sizeInMb; i ++) {
+        if (write(fd, chunk.data(), chunk.size()) != (ssize_t) chunk.size()) {
+            close(fd);
+            unlink(path.c_str());
+            return 1;
+        }
+    }
+    close(fd);
+    for (int cold = 1; cold >= 0; cold --) {
+        printf("--- %s page cache, %lldMB sequential read\n", cold ? "cold" : "warm", (long long) sizeInMb);
+        if (cold) {
+            dropPageCache(path);
+        }
+        fileProtocolRead(path);
+        if (cold) {
+            dropPageCache(path);
+        }
+        localIORead(path, "local io pread 1MB", false);
+        if (cold) {
+            dropPageCache(path);
+        }
+        localIORead(path, "local io mmap", true);
+    }
+    unlink(path.c_str());
+    return 0;
+}
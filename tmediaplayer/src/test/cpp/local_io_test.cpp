@@ -0,0 +1,131 @@
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include "host_ffmpeg.h"
+#include "tmediaio.h"
+
+class LocalIOTest : public ::testing::TestWithParam<bool> {
+protected:
+    std::string path;
+    int64_t size = 8 * 1024 * 1024 + 123;
+
+    void SetUp() override {
+        char tmp[] = "/tmp/tmediaplayer_local_io_XXXXXX";
+        int fd = mkstemp(tmp);
+        ASSERT_GE(fd, 0);
+        path = tmp;
+        std::vector<uint8_t> data((size_t) size);
+        for (int64_t i = 0; i < size; i ++) {
+            data[i] = hostMemorySourceByte(i);
+        }
+        ASSERT_EQ(write(fd, data.data(), data.size()), (ssize_t) size);
+        close(fd);
+    }
+
+    void TearDown() override {
+        unlink(path.c_str());
+    }
+
+    // Read like demuxer does, through AVIOContext read callback.
+    static int64_t readAll(tMediaLocalIO &io, int64_t offset) {
+        std::vector<uint8_t> buf(io.avio->buffer_size);
+        int64_t total = 0;
+        while (true) {
+            int ret = io.avio->read_packet(io.avio->opaque, buf.data(), (int) buf.size());
+            if (ret == AVERROR_EOF) {
+                break;
+            }
+            EXPECT_GT(ret, 0);
+            if (ret <= 0) {
+                break;
+            }
+            for (int i = 0; i < ret; i ++) {
+                if (buf[i] != hostMemorySourceByte(offset + total + i)) {
+                    ADD_FAILURE() << "Wrong byte at " << offset + total + i;
+                    return -1;
+                }
+            }
+            total += ret;
+        }
+        return total;
+    }
+};
+
+TEST_P(LocalIOTest, ReadsWholeFile) {
+    tMediaLocalIO io;
+    ASSERT_TRUE(io.open(path.c_str(), LOCAL_IO_DEFAULT_BUFFER_SIZE, GetParam()));
+    EXPECT_EQ(io.mapped != nullptr, GetParam());
+    EXPECT_EQ(io.avio->seekable, AVIO_SEEKABLE_NORMAL);
+    EXPECT_EQ(readAll(io, 0), size);
+    EXPECT_EQ(io.stats.bytesRead, size);
+    io.release();
+    EXPECT_EQ(io.fd, -1);
+    EXPECT_EQ(io.avio, nullptr);
+}
+
+TEST_P(LocalIOTest, SeeksWithoutReading) {
+    tMediaLocalIO io;
+    ASSERT_TRUE(io.open(path.c_str(), LOCAL_IO_DEFAULT_BUFFER_SIZE, GetParam()));
+    int64_t syscalls = io.stats.syscallCount;
+    EXPECT_EQ(io.seek(0, AVSEEK_SIZE), size);
+    EXPECT_EQ(io.seek(5000000, SEEK_SET), 5000000);
+    EXPECT_EQ(io.seek(-1000, SEEK_CUR), 4999000);
+    EXPECT_EQ(io.seek(-100, SEEK_END | AVSEEK_FORCE), size - 100);
+    EXPECT_EQ(io.seek(-1, SEEK_SET), AVERROR(EINVAL));
+    if (!GetParam()) {
+        EXPECT_EQ(io.stats.syscallCount, syscalls);
+    }
+    EXPECT_EQ(io.seek(size - 3000000, SEEK_SET), size - 3000000);
+    EXPECT_EQ(readAll(io, size - 3000000), 3000000);
+    // Seek after eof.
+    EXPECT_EQ(io.seek(1, SEEK_SET), 1);
+    EXPECT_EQ(readAll(io, 1), size - 1);
+    io.release();
+}
+
+INSTANTIATE_TEST_SUITE_P(MmapAndBuffered, LocalIOTest, ::testing::Values(true, false),
+                         [](const ::testing::TestParamInfo<bool> &info) { return info.param ? "Mmap" : "Buffered"; });
+
+TEST_F(LocalIOTest, BufferedReadUsesOneSyscallPerBuffer) {
+    tMediaLocalIO io;
+    ASSERT_TRUE(io.open(path.c_str(), LOCAL_IO_DEFAULT_BUFFER_SIZE, false));
+    EXPECT_EQ(readAll(io, 0), size);
+    // posix_fadvise and one pread per 1MB, FFmpeg file protocol does 32KB read() calls.
+    EXPECT_EQ(io.stats.syscallCount, 1 + (size + LOCAL_IO_DEFAULT_BUFFER_SIZE - 1) / LOCAL_IO_DEFAULT_BUFFER_SIZE);
+    io.release();
+
+    // Too small buffer is enlarged.
+    ASSERT_TRUE(io.open(path.c_str(), 1024, false));
+    EXPECT_EQ(io.bufferSize, LOCAL_IO_MIN_BUFFER_SIZE);
+    io.release();
+}
+
+TEST_F(LocalIOTest, MmapHintsReadAheadByWindow) {
+    tMediaLocalIO io;
+    ASSERT_TRUE(io.open(path.c_str(), 0, true));
+    ASSERT_NE(io.mapped, nullptr);
+    EXPECT_EQ(io.readAheadEnd, std::min<int64_t>(size, LOCAL_IO_READ_AHEAD_WINDOW));
+    EXPECT_EQ(readAll(io, 0), size);
+    // mmap, madvise sequential, then madvise willneed about every half window.
+    EXPECT_LE(io.stats.syscallCount, 2 + 1 + size / (LOCAL_IO_READ_AHEAD_WINDOW / 2) + 1);
+    io.release();
+    EXPECT_EQ(io.mapped, nullptr);
+}
+
+TEST_F(LocalIOTest, OpenFailsForMissingOrIrregularFile) {
+    tMediaLocalIO io;
+    EXPECT_FALSE(io.open((path + ".missing").c_str(), LOCAL_IO_DEFAULT_BUFFER_SIZE, true));
+    EXPECT_FALSE(io.open("/tmp", LOCAL_IO_DEFAULT_BUFFER_SIZE, true));
+    EXPECT_EQ(io.fd, -1);
+}
+
+TEST(LocalFilePathTest, StripsFileScheme) {
+    EXPECT_STREQ(localFilePath("/sdcard/a.mp4"), "/sdcard/a.mp4");
+    EXPECT_STREQ(localFilePath("file:/sdcard/a.mp4"), "/sdcard/a.mp4");
+    EXPECT_STREQ(localFilePath("file:///sdcard/a.mp4"), "/sdcard/a.mp4");
+    EXPECT_EQ(localFilePath("http://host/a.mp4"), nullptr);
+    EXPECT_EQ(localFilePath("content://media/1"), nullptr);
+    EXPECT_EQ(localFilePath(nullptr), nullptr);
+}
@@ -0,0 +1,53 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "tmedialoudness.h"
+
+// CPU cost of loudness normalization per second of 48kHz stereo audio, measuring and gain in one pass.
+static const int32_t SAMPLE_RATE = 48000;
+static const int32_t CHANNELS = 2;
+static const int32_t BUFFER_SAMPLES = 1024;
+static const int32_t AUDIO_SECONDS = 600;
+
+static int64_t nowInNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template <typename T>
+static void run(const char *name, AVSampleFormat fmt, double scale, bool enabled, bool tagGain) {
+    std::vector<T> source((size_t) SAMPLE_RATE * CHANNELS);
+    for (int32_t i = 0; i < SAMPLE_RATE; i ++) {
+        double v = 0.1 * sin(2.0 * M_PI * 997.0 * i / SAMPLE_RATE);
+        for (int32_t c = 0; c < CHANNELS; c ++) {
+            source[(size_t) i * CHANNELS + c] = (T) (v * scale);
+        }
+    }
+    std::vector<T> pcm((size_t) BUFFER_SAMPLES * CHANNELS);
+    tMediaLoudness loudness;
+    loudness.prepare(SAMPLE_RATE, CHANNELS, fmt);
+    if (tagGain) {
+        loudness.setTagGain(-3.0);
+    }
+    int64_t cost = 0;
+    int64_t total = (int64_t) SAMPLE_RATE * AUDIO_SECONDS;
+    for (int64_t done = 0; done < total; done += BUFFER_SAMPLES) {
+        // Decoder output, copy is not timed.
+        size_t offset = (size_t) (done % (SAMPLE_RATE - BUFFER_SAMPLES)) * CHANNELS;
+        std::copy(source.begin() + (long) offset, source.begin() + (long) (offset + pcm.size()), pcm.begin());
+        int64_t start = nowInNanos();
+        loudness.process(reinterpret_cast<uint8_t *>(pcm.data()), BUFFER_SAMPLES, enabled);
+        cost += nowInNanos() - start;
+    }
+    printf("%-28s %8.1f us per audio second, %6.3f%% of one core\n", name,
+           (double) cost / 1000.0 / AUDIO_SECONDS, (double) cost / 1e9 / AUDIO_SECONDS * 100.0);
+}
+
+int main() {
+    printf("Loudness normalization, %dHz %d channels, %d samples per buffer, %ds audio\n", SAMPLE_RATE, CHANNELS, BUFFER_SAMPLES, AUDIO_SECONDS);
+    run<int16_t>("s16 measure + gain", AV_SAMPLE_FMT_S16, 32767.0, true, false);
+    run<int16_t>("s16 tag gain only", AV_SAMPLE_FMT_S16, 32767.0, true, true);
+    run<int16_t>("s16 disabled", AV_SAMPLE_FMT_S16, 32767.0, false, false);
+    run<int32_t>("s32 measure + gain", AV_SAMPLE_FMT_S32, 2147483647.0, true, false);
+    return 0;
+}
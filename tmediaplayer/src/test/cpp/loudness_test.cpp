@@ -0,0 +1,144 @@
+#include <cmath>
+#include <vector>
+#include <gtest/gtest.h>
+#include "tmedialoudness.h"
+
+static const int32_t SAMPLE_RATE = 48000;
+// Process in decoder sized buffers.
+static const int32_t BUFFER_SAMPLES = 1024;
+
+static double dbToGain(double db) {
+    return pow(10.0, db / 20.0);
+}
+
+/**
+ * 997Hz sine, same amplitude on every channel.
+ */
+template <typename T>
+static std::vector<T> sine(int32_t channels, int32_t nbSamples, double amplitude, int64_t *phase) {
+    std::vector<T> pcm((size_t) nbSamples * channels);
+    for (int32_t i = 0; i < nbSamples; i ++) {
+        double v = amplitude * sin(2.0 * M_PI * 997.0 * (double) (*phase + i) / SAMPLE_RATE);
+        for (int32_t c = 0; c < channels; c ++) {
+            if (sizeof(T) == 2) {
+                pcm[(size_t) i * channels + c] = (T) lrint(v * 32767.0);
+            } else {
+                pcm[(size_t) i * channels + c] = (T) llrint(v * 2147483647.0);
+            }
+        }
+    }
+    *phase += nbSamples;
+    return pcm;
+}
+
+template <typename T>
+static void play(tMediaLoudness &loudness, int32_t channels, double seconds, double amplitude, bool enabled, std::vector<T> *lastBuffer = nullptr) {
+    int64_t phase = 0;
+    auto total = (int64_t) (seconds * SAMPLE_RATE);
+    for (int64_t done = 0; done < total; done += BUFFER_SAMPLES) {
+        auto pcm = sine<T>(channels, BUFFER_SAMPLES, amplitude, &phase);
+        loudness.process(reinterpret_cast<uint8_t *>(pcm.data()), BUFFER_SAMPLES, enabled);
+        if (lastBuffer != nullptr) {
+            *lastBuffer = pcm;
+        }
+    }
+}
+
+TEST(LoudnessTest, MeasuresSineAtReferenceLevel) {
+    // EBU Tech 3341: 997Hz sine at -20 dBFS on one channel is -23.0 LUFS, both channels add 3 LU.
+    tMediaLoudness mono;
+    mono.prepare(SAMPLE_RATE, 1, AV_SAMPLE_FMT_S16);
+    play<int16_t>(mono, 1, 10.0, dbToGain(-20.0), true);
+    EXPECT_NEAR(mono.integratedLufs, -23.0, 0.2);
+
+    tMediaLoudness stereo;
+    stereo.prepare(SAMPLE_RATE, 2, AV_SAMPLE_FMT_S16);
+    play<int16_t>(stereo, 2, 10.0, dbToGain(-20.0), true);
+    EXPECT_NEAR(stereo.integratedLufs, -20.0, 0.2);
+}
+
+TEST(LoudnessTest, RelativeGateIgnoresQuietParts) {
+    tMediaLoudness loudness;
+    loudness.prepare(SAMPLE_RATE, 1, AV_SAMPLE_FMT_S16);
+    for (int i = 0; i < 5; i ++) {
+        play<int16_t>(loudness, 1, 2.0, dbToGain(-20.0), true);
+        // 30 LU quieter, below relative gate.
+        play<int16_t>(loudness, 1, 2.0, dbToGain(-50.0), true);
+    }
+    // Without relative gate, quiet blocks halve mean energy: -26 LUFS. Blocks overlapping both parts are kept.
+    EXPECT_GT(loudness.integratedLufs, -24.0);
+    EXPECT_LT(loudness.integratedLufs, -22.9);
+}
+
+TEST(LoudnessTest, GainMovesToTargetSmoothly) {
+    tMediaLoudness loudness;
+    loudness.prepare(SAMPLE_RATE, 1, AV_SAMPLE_FMT_S16);
+    // -23 LUFS needs +5 dB to reach -18 LUFS.
+    play<int16_t>(loudness, 1, 1.0, dbToGain(-20.0), true);
+    float early = loudness.currentGain;
+    EXPECT_LT(early, (float) dbToGain(5.0));
+
+    std::vector<int16_t> last;
+    play<int16_t>(loudness, 1, 30.0, dbToGain(-20.0), true, &last);
+    EXPECT_NEAR(loudness.getTargetGainDb(), 5.0, 0.2);
+    EXPECT_NEAR(loudness.currentGain, dbToGain(5.0), 0.02);
+    // Output peak is input peak with gain.
+    int32_t peak = 0;
+    for (auto s : last) {
+        peak = std::max(peak, (int32_t) std::abs(s));
+    }
+    EXPECT_NEAR(peak, 32767.0 * dbToGain(-15.0), 32767.0 * 0.01);
+}
+
+TEST(LoudnessTest, GainIsClamped) {
+    tMediaLoudness quiet;
+    quiet.prepare(SAMPLE_RATE, 1, AV_SAMPLE_FMT_S16);
+    play<int16_t>(quiet, 1, 5.0, dbToGain(-45.0), true);
+    EXPECT_DOUBLE_EQ(quiet.getTargetGainDb(), LOUDNESS_MAX_GAIN_DB);
+
+    tMediaLoudness tagged;
+    tagged.prepare(SAMPLE_RATE, 1, AV_SAMPLE_FMT_S16);
+    tagged.setTagGain(-40.0);
+    EXPECT_DOUBLE_EQ(tagged.getTargetGainDb(), LOUDNESS_MIN_GAIN_DB);
+}
+
+TEST(LoudnessTest, TagGainSkipsMeasuring) {
+    tMediaLoudness loudness;
+    loudness.prepare(SAMPLE_RATE, 2, AV_SAMPLE_FMT_S32);
+    // ReplayGain track gain of the media.
+    loudness.setTagGain(-6.0);
+    play<int32_t>(loudness, 2, 20.0, dbToGain(-20.0), true);
+    EXPECT_EQ(loudness.blockCount, 0);
+    EXPECT_NEAR(loudness.currentGain, dbToGain(-6.0), 0.01);
+}
+
+TEST(LoudnessTest, DisabledReturnsToUnity) {
+    tMediaLoudness loudness;
+    loudness.prepare(SAMPLE_RATE, 1, AV_SAMPLE_FMT_S16);
+    play<int16_t>(loudness, 1, 20.0, dbToGain(-20.0), true);
+    ASSERT_GT(loudness.currentGain, 1.5f);
+    int64_t blocks = loudness.blockCount;
+
+    // Ramp time constant is LOUDNESS_GAIN_SMOOTH_SECONDS.
+    play<int16_t>(loudness, 1, 40.0, dbToGain(-20.0), false);
+    EXPECT_FLOAT_EQ(loudness.currentGain, 1.0f);
+    EXPECT_EQ(loudness.blockCount, blocks);
+    // Unity gain doesn't touch pcm.
+    int64_t phase = 0;
+    auto pcm = sine<int16_t>(1, BUFFER_SAMPLES, dbToGain(-20.0), &phase);
+    auto expect = pcm;
+    loudness.process(reinterpret_cast<uint8_t *>(pcm.data()), BUFFER_SAMPLES, false);
+    EXPECT_EQ(pcm, expect);
+}
+
+TEST(LoudnessTest, ResetClearsMeasurementAndKeepsGain) {
+    tMediaLoudness loudness;
+    loudness.prepare(SAMPLE_RATE, 1, AV_SAMPLE_FMT_S16);
+    play<int16_t>(loudness, 1, 20.0, dbToGain(-20.0), true);
+    float gain = loudness.currentGain;
+    loudness.reset();
+    EXPECT_EQ(loudness.blockCount, 0);
+    EXPECT_FLOAT_EQ(loudness.currentGain, gain);
+    // Not measured enough yet, hold current gain.
+    EXPECT_NEAR(loudness.getTargetGainDb(), 20.0 * log10(gain), 1e-6);
+}
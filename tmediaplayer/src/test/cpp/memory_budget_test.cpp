@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+#include "tmediabuffering.h"
+#include "tmediamemory.h"
+
+static const int64_t MB = 1024 * 1024;
+static const int64_t PACKET_SIZE = 64 * 1024;
+
+class MemoryBudgetTest : public ::testing::Test {
+protected:
+    void TearDown() override {
+        setProcessMemoryBudget(0);
+        ASSERT_EQ(getProcessMemoryBytes(), 0);
+    }
+};
+
+TEST_F(MemoryBudgetTest, TrackersSumToProcessTotals) {
+    tMediaMemoryTracker a;
+    tMediaMemoryTracker b;
+    a.add(MemoryPacket, 3 * MB);
+    a.add(MemoryPacket, -MB);
+    a.set(MemoryVideoBuffer, 6 * MB);
+    b.set(MemoryAudioBuffer, MB);
+    b.set(MemoryAudioBuffer, 2 * MB);
+    EXPECT_EQ(getProcessMemoryBytes(), 10 * MB);
+
+    setProcessMemoryBudget(32 * MB);
+    int64_t stats[MEMORY_STATS_EXPORT_SIZE];
+    a.exportTo(stats);
+    EXPECT_EQ(stats[MemoryPacket], 2 * MB);
+    EXPECT_EQ(stats[MemoryVideoBuffer], 6 * MB);
+    EXPECT_EQ(stats[MemoryAudioBuffer], 0);
+    EXPECT_EQ(stats[MEMORY_TYPE_COUNT + MemoryAudioBuffer], 2 * MB);
+    EXPECT_EQ(stats[MEMORY_TYPE_COUNT * 2], 32 * MB);
+
+    // Released player's bytes leave process totals.
+    a.release();
+    EXPECT_EQ(getProcessMemoryBytes(), 2 * MB);
+    b.release();
+}
+
+TEST_F(MemoryBudgetTest, PacketLimitIsLeftBudget) {
+    EXPECT_EQ(getPacketMemoryLimit(MB), INT64_MAX);
+    setProcessMemoryBudget(-1);
+    EXPECT_EQ(getProcessMemoryBudget(), 0);
+
+    tMediaMemoryTracker a;
+    a.set(MemoryVideoBuffer, 6 * MB);
+    a.set(MemoryPacket, 4 * MB);
+    setProcessMemoryBudget(16 * MB);
+    EXPECT_EQ(getPacketMemoryLimit(4 * MB), 10 * MB);
+    a.add(MemoryPacket, 8 * MB);
+    // Over budget.
+    EXPECT_EQ(getPacketMemoryLimit(12 * MB), 10 * MB);
+    a.release();
+}
+
+/**
+ * Players of 8Mbps network media with 6MB video buffers each, readers add packets until buffering reports full.
+ * @return max process bytes.
+ */
+static int64_t fillPlayers(int64_t budget, int64_t *packetBytes, int count) {
+    setProcessMemoryBudget(budget);
+    std::vector<tMediaBuffering> buffering(count);
+    std::vector<tMediaMemoryTracker> trackers(count);
+    for (int i = 0; i < count; i ++) {
+        buffering[i].prepare(BufferingSourceNetwork, 8000000);
+        trackers[i].set(MemoryVideoBuffer, 6 * MB);
+        packetBytes[i] = 0;
+    }
+    int64_t maxProcessBytes = 0;
+    bool allFull = false;
+    while (!allFull) {
+        allFull = true;
+        for (int i = 0; i < count; i ++) {
+            int64_t duration = packetBytes[i] * 8 * 1000 / 8000000;
+            if (!(buffering[i].update(duration, duration, packetBytes[i], false) & BUFFERING_UPDATE_FULL)) {
+                packetBytes[i] += PACKET_SIZE;
+                trackers[i].add(MemoryPacket, PACKET_SIZE);
+                allFull = false;
+            }
+        }
+        maxProcessBytes = std::max(maxProcessBytes, getProcessMemoryBytes());
+    }
+    for (auto &t : trackers) {
+        t.release();
+    }
+    return maxProcessBytes;
+}
+
+TEST_F(MemoryBudgetTest, BudgetBoundsAllPlayersPackets) {
+    int64_t packetBytes[3];
+    // No budget, each buffers 30s: 30MB.
+    int64_t unlimited = fillPlayers(0, packetBytes, 3);
+    EXPECT_GT(unlimited, 96 * MB);
+    for (auto bytes : packetBytes) {
+        EXPECT_GE(bytes, 28 * MB);
+    }
+
+    for (int64_t budget : {96 * MB, 48 * MB}) {
+        int64_t max = fillPlayers(budget, packetBytes, 3);
+        // A packet of each player may pass the limit.
+        EXPECT_LE(max, budget + 3 * PACKET_SIZE);
+        EXPECT_GE(max, budget - 3 * PACKET_SIZE);
+        for (auto bytes : packetBytes) {
+            EXPECT_GE(bytes, MEMORY_BUDGET_MIN_PACKET_BYTES);
+        }
+    }
+
+    // Budget below video buffers, players keep min packets to play smoothly.
+    int64_t max = fillPlayers(16 * MB, packetBytes, 3);
+    EXPECT_LE(max, 3 * (6 * MB + MEMORY_BUDGET_MIN_PACKET_BYTES + PACKET_SIZE));
+    for (auto bytes : packetBytes) {
+        EXPECT_GE(bytes, MEMORY_BUDGET_MIN_PACKET_BYTES);
+        EXPECT_LE(bytes, MEMORY_BUDGET_MIN_PACKET_BYTES + PACKET_SIZE);
+    }
+}
+
+TEST_F(MemoryBudgetTest, RebufferEndsWhenBudgetIsFull) {
+    setProcessMemoryBudget(8 * MB);
+    tMediaBuffering buffering;
+    tMediaMemoryTracker tracker;
+    // 80Mbps, min duration needs 25MB.
+    buffering.prepare(BufferingSourceNetwork, 80000000);
+    tracker.set(MemoryVideoBuffer, 6 * MB);
+    buffering.update(3000, 3000, 0, false);
+    ASSERT_TRUE(buffering.onUnderrun(false));
+
+    int64_t bytes = 0;
+    int32_t flags = 0;
+    while (!(flags & BUFFERING_UPDATE_REBUFFER_END) && bytes < 64 * MB) {
+        bytes += PACKET_SIZE;
+        tracker.add(MemoryPacket, PACKET_SIZE);
+        int64_t duration = bytes * 8 * 1000 / 80000000;
+        flags = buffering.update(duration, duration, bytes, false);
+    }
+    EXPECT_TRUE(flags & BUFFERING_UPDATE_REBUFFER_END);
+    EXPECT_LE(bytes, MEMORY_BUDGET_MIN_PACKET_BYTES + PACKET_SIZE);
+    EXPECT_LT(buffering.bufferedDurationInMillis, buffering.minDurationInMillis);
+    tracker.release();
+}
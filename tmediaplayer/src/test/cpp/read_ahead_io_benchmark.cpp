@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "host_ffmpeg.h"
+#include "tmediaio.h"
+
+// Demuxer reads 32KB at media bitrate from a http like source with request latency and stalls, directly or through
+// read ahead io. Reads waiting longer than a frame (40ms) are stalls the player sees.
+static const int64_t SOURCE_BYTES_PER_SECOND = 8 * 1024 * 1024;
+static const int64_t MEDIA_BYTES_PER_SECOND = 2 * 1024 * 1024;
+static const int64_t PLAY_BYTES = 12 * 1024 * 1024;
+static const int64_t STALL_THRESHOLD_IN_MICROS = 40000;
+
+static std::shared_ptr<HostMemorySource> createSource() {
+    auto source = hostCreateMemorySource(64 * 1024 * 1024);
+    source->bytesPerSecond = SOURCE_BYTES_PER_SECOND;
+    source->requestLatencyInMicros = 80000;
+    source->requestRangeBytes = 1024 * 1024;
+    source->stallIntervalBytes = 3 * 1024 * 1024;
+    source->stallInMicros = 600000;
+    return source;
+}
+
+static void play(const char *name, AVIOContext *pb) {
+    std::vector<uint8_t> buf(32 * 1024);
+    std::vector<int64_t> costs;
+    int64_t total = 0;
+    int64_t stalls = 0;
+    int64_t stallTime = 0;
+    int64_t start = hostNowInMicros();
+    while (total < PLAY_BYTES) {
+        int64_t wait = start + total * 1000000L / MEDIA_BYTES_PER_SECOND - hostNowInMicros();
+        if (wait > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(wait));
+        }
+        int64_t t = hostNowInMicros();
+        int got = 0;
+        while (got < (int) buf.size()) {
+            int ret = avio_read_partial(pb, buf.data() + got, (int) buf.size() - got);
+            if (ret <= 0) {
+                break;
+            }
+            got += ret;
+        }
+        int64_t cost = hostNowInMicros() - t;
+        costs.push_back(cost);
+        if (cost > STALL_THRESHOLD_IN_MICROS) {
+            stalls ++;
+            stallTime += cost;
+        }
+        if (got <= 0) {
+            break;
+        }
+        total += got;
+    }
+    std::sort(costs.begin(), costs.end());
+    printf("%-18s reads=%zu  p50=%lldus  p99=%lldus  max=%lldms  stalls=%lld  stall total=%lldms\n", name, costs.size(),
+           (long long) costs[costs.size() / 2], (long long) costs[costs.size() * 99 / 100], (long long) costs.back() / 1000,
+           (long long) stalls, (long long) stallTime / 1000);
+}
+
+int main() {
+    printf("Source 8MB/s, 80ms per 1MB request, 600ms stall every 3MB; media 2MB/s, 12MB played\n");
+    {
+        AVIOContext *pb = hostOpenSource(createSource());
+        play("direct", pb);
+        avio_closep(&pb);
+    }
+    {
+        AVIOContext *pb = hostOpenSource(createSource());
+        tMediaReadAheadIO io;
+        io.open("http://host/benchmark.mp4", pb, nullptr, nullptr, READ_AHEAD_DEFAULT_BUFFER_SIZE,
+                READ_AHEAD_DEFAULT_LOW_WATERMARK, READ_AHEAD_DEFAULT_HIGH_WATERMARK);
+        play("read ahead 16MB", io.avio);
+        io.release();
+        avio_closep(&pb);
+    }
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "host_ffmpeg.h"
+#include "tmediaio.h"
+
+static int64_t readAndCheck(tMediaReadAheadIO &io, int64_t offset, int64_t size) {
+    std::vector<uint8_t> buf(READ_AHEAD_AVIO_BUFFER_SIZE);
+    int64_t total = 0;
+    while (size < 0 || total < size) {
+        int want = (int) buf.size();
+        if (size >= 0 && size - total < want) {
+            want = (int) (size - total);
+        }
+        int ret = io.avio->read_packet(io.avio->opaque, buf.data(), want);
+        if (ret == AVERROR_EOF) {
+            break;
+        }
+        EXPECT_GT(ret, 0);
+        if (ret <= 0) {
+            break;
+        }
+        for (int i = 0; i < ret; i ++) {
+            if (buf[i] != hostMemorySourceByte(offset + total + i)) {
+                ADD_FAILURE() << "Wrong byte at " << offset + total + i;
+                return -1;
+            }
+        }
+        total += ret;
+    }
+    return total;
+}
+
+static void waitBuffered(tMediaReadAheadIO &io, int64_t bytes) {
+    for (int i = 0; i < 200 && io.bufferedBytes() < bytes; i ++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+TEST(ReadAheadIOTest, ReadsSourceInOrder) {
+    auto source = hostCreateMemorySource(5 * 1024 * 1024 + 77);
+    hostRegisterSource("http://host/ordered.mp4", source);
+    tMediaReadAheadIO io;
+    ASSERT_TRUE(io.open("http://host/ordered.mp4", nullptr, nullptr, nullptr, 1024 * 1024, 256 * 1024, 768 * 1024));
+    EXPECT_TRUE(io.ownSource);
+    EXPECT_EQ(io.seek(0, AVSEEK_SIZE), (int64_t) source->data.size());
+    EXPECT_EQ(readAndCheck(io, 0, -1), (int64_t) source->data.size());
+    io.release();
+    EXPECT_EQ(io.source, nullptr);
+    hostUnregisterSource("http://host/ordered.mp4");
+}
+
+TEST(ReadAheadIOTest, FillsBetweenWatermarks) {
+    auto source = hostCreateMemorySource(8 * 1024 * 1024);
+    AVIOContext *pb = hostOpenSource(source);
+    tMediaReadAheadIO io;
+    ASSERT_TRUE(io.open("http://host/watermark.mp4", pb, nullptr, nullptr, 1024 * 1024, 256 * 1024, 768 * 1024));
+    EXPECT_FALSE(io.ownSource);
+
+    waitBuffered(io, 768 * 1024);
+    int64_t buffered = io.bufferedBytes();
+    EXPECT_GE(buffered, 768 * 1024);
+    EXPECT_LE(buffered, 1024 * 1024);
+    // Source is idle above low watermark.
+    int64_t sourceRead = source->readBytes;
+    EXPECT_EQ(readAndCheck(io, 0, buffered - 300 * 1024), buffered - 300 * 1024);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(source->readBytes, sourceRead);
+    // Below low watermark, fill again.
+    EXPECT_EQ(readAndCheck(io, buffered - 300 * 1024, 100 * 1024), 100 * 1024);
+    waitBuffered(io, 768 * 1024);
+    EXPECT_GT(source->readBytes, sourceRead);
+    EXPECT_GE(io.bufferedBytes(), 768 * 1024);
+
+    io.release();
+    // External source is released by its owner.
+    EXPECT_EQ(io.source, nullptr);
+    avio_closep(&pb);
+}
+
+TEST(ReadAheadIOTest, SeekInsideBufferDoesNotTouchSource) {
+    auto source = hostCreateMemorySource(8 * 1024 * 1024);
+    AVIOContext *pb = hostOpenSource(source);
+    tMediaReadAheadIO io;
+    ASSERT_TRUE(io.open("http://host/seek.mp4", pb, nullptr, nullptr, 4 * 1024 * 1024, 512 * 1024, 2 * 1024 * 1024));
+    EXPECT_EQ(readAndCheck(io, 0, 1024 * 1024), 1024 * 1024);
+    waitBuffered(io, 2 * 1024 * 1024);
+
+    // Backward into kept data and forward into buffered data.
+    EXPECT_EQ(io.seek(100 * 1024, SEEK_SET), 100 * 1024);
+    EXPECT_EQ(readAndCheck(io, 100 * 1024, 64 * 1024), 64 * 1024);
+    EXPECT_EQ(io.seek(1500 * 1024, SEEK_SET), 1500 * 1024);
+    EXPECT_EQ(readAndCheck(io, 1500 * 1024, 64 * 1024), 64 * 1024);
+    EXPECT_EQ(source->seekCount, 0);
+    EXPECT_EQ(io.stats.seekCount, 0);
+
+    // Out of buffer, io thread seeks source.
+    EXPECT_EQ(io.seek(-1024 * 1024, SEEK_END), 7 * 1024 * 1024);
+    EXPECT_EQ(source->seekCount, 1);
+    EXPECT_EQ(readAndCheck(io, 7 * 1024 * 1024, -1), 1024 * 1024);
+    EXPECT_EQ(io.seek(-1, SEEK_SET), AVERROR(EINVAL));
+    io.release();
+    avio_closep(&pb);
+}
+
+static int interruptCallback(void *opaque) {
+    return static_cast<std::atomic<bool> *>(opaque)->load();
+}
+
+TEST(ReadAheadIOTest, InterruptStopsWaitingRead) {
+    auto source = hostCreateMemorySource(1024 * 1024);
+    // Stalled network, a read takes 250ms.
+    source->maxReadSize = 1024;
+    source->bytesPerSecond = 4096;
+    AVIOContext *pb = hostOpenSource(source);
+    std::atomic<bool> interrupted{false};
+    AVIOInterruptCB cb = {interruptCallback, &interrupted};
+    tMediaReadAheadIO io;
+    ASSERT_TRUE(io.open("http://host/stalled.mp4", pb, &cb, nullptr, READ_AHEAD_MIN_BUFFER_SIZE, 0, 0));
+    std::atomic<int> ret{0};
+    std::thread reader([&] {
+        uint8_t buf[1024];
+        ret = io.read(buf, sizeof(buf));
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    int64_t start = hostNowInMicros();
+    interrupted = true;
+    reader.join();
+    EXPECT_EQ(ret, AVERROR_EXIT);
+    EXPECT_LT(hostNowInMicros() - start, 200000);
+    io.release();
+    avio_closep(&pb);
+}
+
+TEST(ReadAheadIOTest, ReportsSourceThroughputToBuffering) {
+    auto source = hostCreateMemorySource(4 * 1024 * 1024);
+    source->bytesPerSecond = 8 * 1024 * 1024;
+    AVIOContext *pb = hostOpenSource(source);
+    tMediaBuffering buffering;
+    tMediaReadAheadIO io;
+    io.buffering = &buffering;
+    ASSERT_TRUE(io.open("http://host/throughput.mp4", pb, nullptr, nullptr, READ_AHEAD_DEFAULT_BUFFER_SIZE, 0, 0));
+    EXPECT_EQ(readAndCheck(io, 0, 1024 * 1024), 1024 * 1024);
+    io.release();
+    avio_closep(&pb);
+    // Source read time only, never above source bandwidth. Loaded test machines sleep longer.
+    EXPECT_GT(buffering.throughput, 1024 * 1024);
+    EXPECT_LT(buffering.throughput, 9 * 1024 * 1024);
+}